@@ -9,17 +9,110 @@
 
 #include "gcmp-app.h"
 #include "gcmp-win.h"
+#include "gcmp-eval.h"
+#include "gcmp-cost.h"
+#include "gcmp-file.h"
+#include "gcmp-stats.h"
+#include "gcmp-matrix.h"
+#include "gcmp-tab.h"
+#include "gcmp-const.h"
+#include "gcmp-service.h"
 
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* Values the worksheet keeps for the results of all windows, at most */
+#define SHEET_BUDGET ( (size_t)256 << 20 )
+
+/*
+* One engine for all windows: the history and the worksheet are here, the pool and the constants are the process's,
+* and the stored names are the main thread's, which runs every window; each window has its own settings.
+*/
 struct _GcmpApp
 {
 	GtkApplication  parent_instance;
+
+	GcmpHistory *history;
+	GcmpSheet *sheet;
+
+	double start_ms;
+	double frame_ms;
+	gint64 main_time;
+
+	gboolean measure;
 };
 
 G_DEFINE_TYPE ( GcmpApp, gcmp_app, GTK_TYPE_APPLICATION )
 
+/* Milliseconds since the process started ( /proc start time, clock tick resolution ) */
+static double gcmp_app_process_age ( void )
+{
+	g_autofree char *stat = NULL;
+
+	if ( !g_file_get_contents ( "/proc/self/stat", &stat, NULL, NULL ) ) return 0;
+
+	// Field 2 is the command name in parentheses and may hold spaces; start time is field 22
+	const char *p = strrchr ( stat, ')' );
+
+	unsigned long long start = 0;
+	if ( !p || sscanf ( p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu", &start ) != 1 ) return 0;
+
+	struct timespec ts;
+	clock_gettime ( CLOCK_BOOTTIME, &ts );
+
+	double age = ( (double)ts.tv_sec + (double)ts.tv_nsec / 1e9 - (double)start / (double)sysconf ( _SC_CLK_TCK ) ) * 1000;
+
+	return MAX ( age, 0 );
+}
+
+static double gcmp_app_elapsed ( GcmpApp *app )
+{
+	return app->start_ms + (double)( g_get_monotonic_time () - app->main_time ) / 1000;
+}
+
+static gboolean gcmp_app_measure_idle ( GcmpApp *app )
+{
+	g_print ( "startup: first frame %.1f ms, interactive %.1f ms \n", app->frame_ms, gcmp_app_elapsed ( app ) );
+
+	g_application_quit ( G_APPLICATION ( app ) );
+
+	return G_SOURCE_REMOVE;
+}
+
+static void gcmp_app_measure_frame ( GdkFrameClock *clock, GcmpApp *app )
+{
+	g_signal_handlers_disconnect_by_func ( clock, gcmp_app_measure_frame, app );
+
+	app->frame_ms = gcmp_app_elapsed ( app );
+
+	// Interactive once the events queued behind the first frame are handled
+	g_idle_add_full ( G_PRIORITY_LOW, (GSourceFunc)gcmp_app_measure_idle, app, NULL );
+}
+
+GcmpHistory * gcmp_app_get_history ( GcmpApp *app )
+{
+	if ( !app->history ) app->history = gcmp_history_new ();
+
+	return app->history;
+}
+
+GcmpSheet * gcmp_app_get_sheet ( GcmpApp *app )
+{
+	if ( !app->sheet ) app->sheet = gcmp_sheet_new ( ENTRY_DIGITS, SHEET_BUDGET );
+
+	return app->sheet;
+}
+
 static void gcmp_new_win ( GApplication *app )
 {
-	gcmp_win_new ( GCMP_APP ( app ) );
+	GcmpWin *win = gcmp_win_new ( GCMP_APP ( app ) );
+
+	if ( !GCMP_APP ( app )->measure ) return;
+
+	GdkFrameClock *clock = gtk_widget_get_frame_clock ( GTK_WIDGET ( win ) );
+
+	if ( clock ) g_signal_connect ( clock, "after-paint", G_CALLBACK ( gcmp_app_measure_frame ), app );
 }
 
 static void gcmp_app_activate ( GApplication *app )
@@ -27,13 +120,325 @@ static void gcmp_app_activate ( GApplication *app )
 	gcmp_new_win ( app );
 }
 
-static void gcmp_app_init ( G_GNUC_UNUSED GcmpApp *gcmp_app )
+/* The result to a file, or printed */
+static int gcmp_app_output ( mpfr_t res, const char *save, int digits, int base )
+{
+	GError *error = NULL;
+
+	if ( save )
+	{
+		if ( !gcmp_file_export ( save, res, (uint32_t)digits, &error ) ) { g_printerr ( "gcmp: %s \n", error->message ); g_error_free ( error ); return 1; }
+
+		return 0;
+	}
+
+	char *out_str = gcmp_mpfr_get_str_base ( res, (uint32_t)digits, (uint8_t)base );
+
+	g_print ( "%s\n", out_str );
+
+	g_free ( out_str );
+
+	return 0;
+}
+
+static int gcmp_app_eval ( const char *expr, const char *load, const char *save, int digits, int base, gboolean radians, gboolean ball )
+{
+	if ( digits < 1 || digits > MAX_DIGITS ) { g_printerr ( "gcmp: invalid digits \n" ); return 1; }
+
+	if ( base < 2 || base > 36 ) { g_printerr ( "gcmp: invalid base \n" ); return 1; }
+
+	GError *error = NULL;
+	GcmpEval *eval = NULL;
+
+	mpfr_t res;
+	mpfr_init2 ( res, (mpfr_prec_t)digits * 4 );
+
+	// A loaded operand comes first, as #0: the full value, bound when compiled
+	if ( load )
+	{
+		if ( !gcmp_file_import ( load, res, (uint32_t)digits, &error ) ) { g_printerr ( "gcmp: %s \n", error->message ); g_error_free ( error ); mpfr_clear ( res ); return 1; }
+
+		g_autofree char *text = g_strdup_printf ( "#0 %s", ( expr ) ? expr : "" );
+
+		mpfr_srcptr vals[] = { res };
+		eval = gcmp_eval_new_bound ( text, (uint8_t)base, vals, 1 );
+	}
+	else
+		eval = gcmp_eval_new ( expr, (uint8_t)base );
+
+	if ( !eval ) { g_printerr ( "gcmp: invalid expression \n" ); mpfr_clear ( res ); return 1; }
+
+	// Only this evaluation's refusals count
+	gcmp_cost_take_refused ();
+
+	// Certified: only the digits the ball proves are printed
+	if ( ball )
+	{
+		uint32_t got = gcmp_eval_run_ball ( eval, res, (uint32_t)digits, ( radians ) ? 0 : 1 );
+
+		if ( gcmp_cost_take_refused () && !got ) g_printerr ( "gcmp: refused, over the limits ( GCMP_LIMIT ) \n" );
+		else if ( got < (uint32_t)digits ) g_printerr ( "gcmp: %u of %d digits certified \n", got, digits );
+
+		if ( !got ) { gcmp_eval_free ( eval ); mpfr_clear ( res ); return 1; }
+
+		digits = (int)got;
+	}
+	else
+		gcmp_eval_run ( eval, res, (uint32_t)digits, ( radians ) ? 0 : 1 );
+
+	gcmp_eval_free ( eval );
+
+	if ( gcmp_cost_take_refused () && mpfr_nan_p ( res ) ) { g_printerr ( "gcmp: refused, over the limits ( GCMP_LIMIT ) \n" ); mpfr_clear ( res ); return 1; }
+
+	int ret = gcmp_app_output ( res, save, digits, base );
+
+	mpfr_clear ( res );
+
+	return ret;
+}
+
+static int gcmp_app_const ( const char *name, const char *save, int digits, int base, const char *ckpt )
+{
+	if ( digits < 1 || digits > MAX_DIGITS ) { g_printerr ( "gcmp: invalid digits \n" ); return 1; }
+
+	if ( base < 2 || base > 36 ) { g_printerr ( "gcmp: invalid base \n" ); return 1; }
+
+	const char *c_name[] = { "pi", "e", "ln2", "gamma" };
+	enum math_ext c_mt[] = { CPI, CEX, CL2, CEU };
+
+	uint8_t j = 0;
+	for ( j = 0; j < G_N_ELEMENTS ( c_mt ); j++ ) if ( g_str_equal ( name, c_name[j] ) ) break;
+
+	if ( j == G_N_ELEMENTS ( c_mt ) ) { g_printerr ( "gcmp: unknown constant: %s ( pi, e, ln2, gamma ) \n", name ); return 1; }
+
+	mpfr_t res;
+	mpfr_init2 ( res, (mpfr_prec_t)digits * 4 );
+
+	// Checkpointed: a run stopped on the way goes on from there next time
+	gcmp_const_run_ckpt ( c_mt[j], res, MPFR_RNDN, NULL, ckpt );
+
+	int ret = gcmp_app_output ( res, save, digits, base );
+
+	mpfr_clear ( res );
+
+	return ret;
+}
+
+/* The constant and precision come from the checkpoint */
+static int gcmp_app_resume ( const char *ckpt, const char *save, int base )
+{
+	enum math_ext mt = CPI;
+	mpfr_prec_t prec = 0;
+
+	if ( !gcmp_const_ckpt_info ( ckpt, &mt, &prec ) ) { g_printerr ( "gcmp: not a checkpoint: %s \n", ckpt ); return 1; }
+
+	const char *name = ( mt == CPI ) ? "pi" : ( mt == CEX ) ? "e" : ( mt == CL2 ) ? "ln2" : "gamma";
+
+	return gcmp_app_const ( name, save, (int)( prec / 4 ), base, ckpt );
+}
+
+static int gcmp_app_stats ( const char *path, int digits, int base )
 {
-	
+	if ( digits < 1 || digits > MAX_DIGITS ) { g_printerr ( "gcmp: invalid digits \n" ); return 1; }
+
+	if ( base < 2 || base > 36 ) { g_printerr ( "gcmp: invalid base \n" ); return 1; }
+
+	GError *error = NULL;
+	GcmpStats *stats = gcmp_stats_new_file ( path, (uint8_t)base, (uint32_t)digits, &error );
+
+	if ( !stats ) { g_printerr ( "gcmp: %s \n", error->message ); g_error_free ( error ); return 1; }
+
+	g_print ( "n %" G_GUINT64_FORMAT "\n", gcmp_stats_get_count ( stats ) );
+
+	uint8_t j = 0;
+	for ( j = 0; j < ST_NUM; j++ )
+	{
+		char *out_str = gcmp_mpfr_get_str_base ( gcmp_stats_get ( stats, j ), (uint32_t)digits, (uint8_t)base );
+
+		g_print ( "%s %s\n", gcmp_stats_get_name ( j ), out_str );
+
+		g_free ( out_str );
+	}
+
+	gcmp_stats_free ( stats );
+
+	return 0;
+}
+
+static int gcmp_app_matrix ( const char *op, const char *load, const char *with, const char *save, int digits, int base )
+{
+	if ( digits < 1 || digits > MAX_DIGITS ) { g_printerr ( "gcmp: invalid digits \n" ); return 1; }
+
+	if ( base < 2 || base > 36 ) { g_printerr ( "gcmp: invalid base \n" ); return 1; }
+
+	gboolean binary = ( g_str_equal ( op, "mul" ) || g_str_equal ( op, "solve" ) );
+
+	if ( !binary && !g_str_equal ( op, "det" ) && !g_str_equal ( op, "inv" ) ) { g_printerr ( "gcmp: unknown matrix operation: %s \n", op ); return 1; }
+
+	if ( !load || ( binary && !with ) ) { g_printerr ( "gcmp: %s needs %s \n", op, ( binary ) ? "--load A --with B" : "--load A" ); return 1; }
+
+	GError *error = NULL;
+	mpfr_prec_t prec = (mpfr_prec_t)digits * 4;
+
+	GcmpMatrix *a = gcmp_matrix_new_file ( load, (uint8_t)base, prec, &error );
+	GcmpMatrix *b = ( a && binary ) ? gcmp_matrix_new_file ( with, (uint8_t)base, prec, &error ) : NULL;
+	GcmpMatrix *res = NULL;
+
+	int ret = 0;
+
+	if ( a && g_str_equal ( op, "det" ) )
+	{
+		mpfr_t det;
+		mpfr_init2 ( det, prec );
+
+		if ( gcmp_matrix_det ( a, det, &error ) )
+		{
+			char *out_str = gcmp_mpfr_get_str_base ( det, (uint32_t)digits, (uint8_t)base );
+			g_print ( "%s\n", out_str );
+			g_free ( out_str );
+		}
+
+		mpfr_clear ( det );
+	}
+
+	if ( a && g_str_equal ( op, "inv" ) ) res = gcmp_matrix_inv ( a, &error );
+
+	if ( b && g_str_equal ( op, "mul" ) ) res = gcmp_matrix_mul ( a, b, &error );
+
+	if ( b && g_str_equal ( op, "solve" ) ) res = gcmp_matrix_solve ( a, b, &error );
+
+	if ( res ) gcmp_matrix_save ( res, save, (uint32_t)digits, (uint8_t)base, &error );
+
+	if ( error ) { g_printerr ( "gcmp: %s \n", error->message ); g_error_free ( error ); ret = 1; }
+
+	if ( a ) gcmp_matrix_free ( a );
+	if ( b ) gcmp_matrix_free ( b );
+	if ( res ) gcmp_matrix_free ( res );
+
+	return ret;
+}
+
+static int gcmp_app_tab ( const char *expr, const char *range, const char *save, int digits, int base, gboolean radians )
+{
+	if ( digits < 1 || digits > MAX_DIGITS ) { g_printerr ( "gcmp: invalid digits \n" ); return 1; }
+
+	if ( base < 2 || base > 36 ) { g_printerr ( "gcmp: invalid base \n" ); return 1; }
+
+	char **bounds = g_strsplit ( range, ":", 3 );
+
+	if ( !expr || g_strv_length ( bounds ) != 3 ) { g_printerr ( "gcmp: --tab FROM:TO:STEP --eval EXPR \n" ); g_strfreev ( bounds ); return 1; }
+
+	GcmpEval *eval = gcmp_eval_new ( expr, (uint8_t)base );
+
+	if ( !eval ) { g_printerr ( "gcmp: invalid expression \n" ); g_strfreev ( bounds ); return 1; }
+
+	FILE *file = ( save ) ? fopen ( save, "wb" ) : stdout;
+
+	if ( !file ) { g_printerr ( "gcmp: %s: %s \n", save, g_strerror ( errno ) ); gcmp_eval_free ( eval ); g_strfreev ( bounds ); return 1; }
+
+	GError *error = NULL;
+	int ret = 0;
+
+	if ( !gcmp_tab_run ( eval, bounds[0], bounds[1], bounds[2], (uint32_t)digits, (uint8_t)base, ( radians ) ? 0 : 1, file, &error ) )
+	{
+		g_printerr ( "gcmp: %s \n", error->message );
+		g_error_free ( error );
+		ret = 1;
+	}
+
+	if ( save && fclose ( file ) != 0 ) { g_printerr ( "gcmp: %s: %s \n", save, g_strerror ( errno ) ); ret = 1; }
+
+	gcmp_eval_free ( eval );
+	g_strfreev ( bounds );
+
+	return ret;
+}
+
+static int gcmp_app_handle_local_options ( GApplication *app, GVariantDict *options )
+{
+	int digits = 24, base = 10;
+	const char *expr = NULL, *load = NULL, *save = NULL, *stats = NULL, *matrix = NULL, *with = NULL, *tab = NULL, *cnst = NULL, *ckpt = NULL, *resume = NULL;
+
+	g_variant_dict_lookup ( options, "digits", "i", &digits );
+	g_variant_dict_lookup ( options, "base", "i", &base );
+	g_variant_dict_lookup ( options, "eval", "&s", &expr );
+	g_variant_dict_lookup ( options, "load", "^&ay", &load );
+	g_variant_dict_lookup ( options, "save", "^&ay", &save );
+	g_variant_dict_lookup ( options, "stats", "^&ay", &stats );
+	g_variant_dict_lookup ( options, "matrix", "&s", &matrix );
+	g_variant_dict_lookup ( options, "with", "^&ay", &with );
+	g_variant_dict_lookup ( options, "tab", "&s", &tab );
+	g_variant_dict_lookup ( options, "const", "&s", &cnst );
+	g_variant_dict_lookup ( options, "checkpoint", "^&ay", &ckpt );
+	g_variant_dict_lookup ( options, "resume", "^&ay", &resume );
+
+	gboolean radians = g_variant_dict_contains ( options, "radians" );
+	gboolean ball = g_variant_dict_contains ( options, "ball" );
+
+	// Headless paths: no window, no display needed
+	if ( stats ) return gcmp_app_stats ( stats, digits, base );
+
+	if ( matrix ) return gcmp_app_matrix ( matrix, load, with, save, digits, base );
+
+	if ( tab ) return gcmp_app_tab ( expr, tab, save, digits, base, radians );
+
+	if ( cnst ) return gcmp_app_const ( cnst, save, digits, base, ckpt );
+
+	if ( resume ) return gcmp_app_resume ( resume, save, base );
+
+	if ( expr || load ) return gcmp_app_eval ( expr, load, save, digits, base, radians, ball );
+
+	if ( g_variant_dict_contains ( options, "service" ) ) return gcmp_service_main ();
+
+	// A fresh instance every time, so a running one does not hide the cost of a cold start
+	if ( g_variant_dict_contains ( options, "measure-startup" ) )
+	{
+		GcmpApp *gcmp_app = GCMP_APP ( app );
+
+		gcmp_app->measure  = TRUE;
+		gcmp_app->start_ms = gcmp_app_process_age () - (double)( g_get_monotonic_time () - gcmp_app->main_time ) / 1000;
+
+		g_application_set_flags ( app, g_application_get_flags ( app ) | G_APPLICATION_NON_UNIQUE );
+	}
+
+	return -1;
+}
+
+static void gcmp_app_init ( GcmpApp *gcmp_app )
+{
+	gcmp_app->main_time = g_get_monotonic_time ();
+
+	GOptionEntry entries[] =
+	{
+		{ "eval",    'e', 0, G_OPTION_ARG_STRING, NULL, "Evaluate the expression and print the result", "EXPR" },
+		{ "digits",  'd', 0, G_OPTION_ARG_INT,    NULL, "Precision ( maximum characters )", "N" },
+		{ "radians", 'r', 0, G_OPTION_ARG_NONE,   NULL, "Angles in radians", NULL },
+		{ "ball",    'k', 0, G_OPTION_ARG_NONE,   NULL, "Print only the digits proven correct ( ball arithmetic )", NULL },
+		{ "base",    'b', 0, G_OPTION_ARG_INT,    NULL, "Number base of the expression and the result ( 2 - 36 )", "N" },
+		{ "load",    'l', 0, G_OPTION_ARG_FILENAME, NULL, "Read the first operand from a file", "FILE" },
+		{ "save",    'o', 0, G_OPTION_ARG_FILENAME, NULL, "Write the result to a file", "FILE" },
+		{ "stats",   't', 0, G_OPTION_ARG_FILENAME, NULL, "Sum, mean, variance, min, max and product of the values in a file", "FILE" },
+		{ "matrix",  'm', 0, G_OPTION_ARG_STRING, NULL, "Matrix operation on --load ( and --with ): det, inv, mul, solve", "OP" },
+		{ "with",    'w', 0, G_OPTION_ARG_FILENAME, NULL, "Second matrix operand", "FILE" },
+		{ "tab",     'x', 0, G_OPTION_ARG_STRING, NULL, "Tabulate --eval over x = FROM, FROM + STEP, ... TO", "FROM:TO:STEP" },
+		{ "const",   'c', 0, G_OPTION_ARG_STRING, NULL, "Print a constant: pi, e, ln2, gamma", "NAME" },
+		{ "checkpoint", 0, 0, G_OPTION_ARG_FILENAME, NULL, "Checkpoint file of --const ( default: one in the user's cache )", "FILE" },
+		{ "resume",  0, 0, G_OPTION_ARG_FILENAME, NULL, "Go on with the constant of a checkpoint", "FILE" },
+		{ "service", 's', 0, G_OPTION_ARG_NONE,   NULL, "Serve evaluations on a local socket", NULL },
+		{ "measure-startup", 0, 0, G_OPTION_ARG_NONE, NULL, "Print time to first frame and to interactive, then quit", NULL },
+		{ NULL }
+	};
+
+	g_application_add_main_option_entries ( G_APPLICATION ( gcmp_app ), entries );
 }
 
 static void gcmp_app_finalize ( GObject *object )
 {
+	GcmpApp *app = GCMP_APP ( object );
+
+	if ( app->sheet ) gcmp_sheet_free ( app->sheet );
+	if ( app->history ) gcmp_history_free ( app->history );
+
 	G_OBJECT_CLASS (gcmp_app_parent_class)->finalize (object);
 }
 
@@ -42,6 +447,7 @@ static void gcmp_app_class_init ( GcmpAppClass *class )
 	GObjectClass *object_class = G_OBJECT_CLASS (class);
 
 	G_APPLICATION_CLASS (class)->activate = gcmp_app_activate;
+	G_APPLICATION_CLASS (class)->handle_local_options = gcmp_app_handle_local_options;
 
 	object_class->finalize = gcmp_app_finalize;
 }
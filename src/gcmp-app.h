@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include "gcmp-entry.h"
+
 #include <gtk/gtk.h>
 
 #define GCMP_TYPE_APP gcmp_app_get_type ()
@@ -17,3 +19,8 @@ G_DECLARE_FINAL_TYPE ( GcmpApp, gcmp_app, GCMP, APP, GtkApplication )
 
 GcmpApp * gcmp_app_new ( void );
 
+/* Shared by all windows, made on first use */
+GcmpHistory * gcmp_app_get_history ( GcmpApp * );
+
+GcmpSheet * gcmp_app_get_sheet ( GcmpApp * );
+
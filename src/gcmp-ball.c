@@ -0,0 +1,580 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-ball.h"
+#include "gcmp-ntt.h"
+#include "gcmp-const.h"
+#include "gcmp-cost.h"
+
+#include <math.h>
+
+/* Bits of a radius, and of the endpoints where a bound needs a function's value */
+#define RAD_BITS 32
+#define END_BITS 64
+
+void gcmp_ball_init ( GcmpBall *b, mpfr_prec_t prec )
+{
+	mpfr_init2 ( b->mid, prec );
+	mpfr_init2 ( b->rad, RAD_BITS );
+
+	mpfr_set_zero ( b->mid, 1 );
+	mpfr_set_zero ( b->rad, 1 );
+}
+
+void gcmp_ball_clear ( GcmpBall *b )
+{
+	mpfr_clear ( b->mid );
+	mpfr_clear ( b->rad );
+}
+
+/* r += 2^shift ulp ( m ): half of one for rounding to nearest; infinite for no number */
+static void gcmp_ball_err ( mpfr_t r, mpfr_srcptr m, long shift )
+{
+	if ( !mpfr_number_p ( m ) || mpfr_zero_p ( m ) ) { mpfr_set_inf ( r, 1 ); return; }
+
+	mpfr_t u;
+	mpfr_init2 ( u, RAD_BITS );
+
+	mpfr_set_ui_2exp ( u, 1, mpfr_get_exp ( m ) - mpfr_get_prec ( m ) + shift, MPFR_RNDU );
+	mpfr_add ( r, r, u, MPFR_RNDU );
+
+	mpfr_clear ( u );
+}
+
+/* The new midpoint and radius go in last, so the result may be an operand */
+static void gcmp_ball_take ( GcmpBall *res, mpfr_t m, mpfr_t r, int inexact )
+{
+	if ( !mpfr_number_p ( m ) ) mpfr_set_inf ( r, 1 );
+	else if ( inexact ) gcmp_ball_err ( r, m, -1 );
+
+	mpfr_swap ( res->mid, m );
+	mpfr_set ( res->rad, r, MPFR_RNDU );
+}
+
+void gcmp_ball_set ( GcmpBall *res, const GcmpBall *a )
+{
+	int inexact = mpfr_set ( res->mid, a->mid, MPFR_RNDN );
+
+	mpfr_set ( res->rad, a->rad, MPFR_RNDU );
+
+	if ( inexact ) gcmp_ball_err ( res->rad, res->mid, -1 );
+}
+
+void gcmp_ball_set_str ( GcmpBall *b, const char *str, uint8_t base )
+{
+	mpfr_t m, r;
+	mpfr_init2 ( m, mpfr_get_prec ( b->mid ) );
+	mpfr_init2 ( r, RAD_BITS );
+	mpfr_set_zero ( r, 1 );
+
+	int inexact = gcmp_mpfr_set_str ( m, str, base );
+
+	gcmp_ball_take ( b, m, r, inexact );
+
+	mpfr_clear ( m );
+	mpfr_clear ( r );
+}
+
+void gcmp_ball_set_fr ( GcmpBall *b, mpfr_srcptr val )
+{
+	mpfr_t m, r;
+	mpfr_init2 ( m, mpfr_get_prec ( b->mid ) );
+	mpfr_init2 ( r, RAD_BITS );
+	mpfr_set_zero ( r, 1 );
+
+	int inexact = mpfr_set ( m, val, MPFR_RNDN );
+
+	gcmp_ball_take ( b, m, r, inexact );
+
+	mpfr_clear ( m );
+	mpfr_clear ( r );
+}
+
+/* Lower bound of | x | - r; FALSE if the ball reaches zero */
+static gboolean gcmp_ball_low ( mpfr_t lo, mpfr_srcptr x, mpfr_srcptr r )
+{
+	mpfr_abs ( lo, x, MPFR_RNDD );
+	mpfr_sub ( lo, lo, r, MPFR_RNDD );
+
+	return ( mpfr_sgn ( lo ) > 0 );
+}
+
+/* | a | rb + | b | ra + ra rb: the product's radius */
+static void gcmp_ball_mul_rad ( mpfr_t r, const GcmpBall *a, const GcmpBall *b )
+{
+	mpfr_t t, u;
+	mpfr_inits2 ( RAD_BITS, t, u, (mpfr_ptr)0 );
+
+	mpfr_abs ( t, a->mid, MPFR_RNDU );
+	mpfr_mul ( t, t, b->rad, MPFR_RNDU );
+
+	mpfr_abs ( u, b->mid, MPFR_RNDU );
+	mpfr_mul ( u, u, a->rad, MPFR_RNDU );
+	mpfr_add ( t, t, u, MPFR_RNDU );
+
+	mpfr_mul ( u, a->rad, b->rad, MPFR_RNDU );
+	mpfr_add ( r, t, u, MPFR_RNDU );
+
+	mpfr_clears ( t, u, (mpfr_ptr)0 );
+}
+
+/* ( | a | rb + | b | ra ) / ( | b | ( | b | - rb ) ): the quotient's radius */
+static void gcmp_ball_div_rad ( mpfr_t r, const GcmpBall *a, const GcmpBall *b )
+{
+	mpfr_t t, u, lo;
+	mpfr_inits2 ( RAD_BITS, t, u, lo, (mpfr_ptr)0 );
+
+	if ( !gcmp_ball_low ( lo, b->mid, b->rad ) ) mpfr_set_inf ( r, 1 );
+	else
+	{
+		mpfr_abs ( t, a->mid, MPFR_RNDU );
+		mpfr_mul ( t, t, b->rad, MPFR_RNDU );
+
+		mpfr_abs ( u, b->mid, MPFR_RNDU );
+		mpfr_mul ( u, u, a->rad, MPFR_RNDU );
+		mpfr_add ( t, t, u, MPFR_RNDU );
+
+		mpfr_abs ( u, b->mid, MPFR_RNDD );
+		mpfr_mul ( u, u, lo, MPFR_RNDD );
+
+		mpfr_div ( r, t, u, MPFR_RNDU );
+	}
+
+	mpfr_clears ( t, u, lo, (mpfr_ptr)0 );
+}
+
+/* | f | ( e^d - 1 ) <= 3 | f | d for d < 1, where d bounds the change of ln | f | over the ball */
+static void gcmp_ball_rel ( mpfr_t r, mpfr_srcptr m, mpfr_t d )
+{
+	if ( !mpfr_number_p ( d ) || mpfr_cmp_ui ( d, 1 ) >= 0 ) { mpfr_set_inf ( r, 1 ); return; }
+
+	mpfr_abs ( r, m, MPFR_RNDU );
+	mpfr_mul ( r, r, d, MPFR_RNDU );
+	mpfr_mul_ui ( r, r, 3, MPFR_RNDU );
+}
+
+/* x^n, n >= 1: n ( | x | + r )^( n - 1 ) r, the mean value bound; zero may be inside */
+static void gcmp_ball_int_pow_rad ( mpfr_t r, const GcmpBall *a, ulong n )
+{
+	mpfr_t t;
+	mpfr_init2 ( t, RAD_BITS );
+
+	mpfr_abs ( t, a->mid, MPFR_RNDU );
+	mpfr_add ( t, t, a->rad, MPFR_RNDU );
+	mpfr_pow_ui ( t, t, n - 1, MPFR_RNDU );
+	mpfr_mul_ui ( t, t, n, MPFR_RNDU );
+	mpfr_mul ( r, t, a->rad, MPFR_RNDU );
+
+	mpfr_clear ( t );
+}
+
+/* a^b = e^( b ln a ): the change of b ln a, ( | b | + rb ) ra / ( | a | - ra ) + rb max | ln a |, bounds the relative one */
+static void gcmp_ball_pow_rad ( mpfr_t r, mpfr_srcptr m, const GcmpBall *a, const GcmpBall *b )
+{
+	gboolean b_exact = mpfr_zero_p ( b->rad );
+
+	if ( mpfr_zero_p ( a->rad ) && b_exact ) return;
+
+	if ( b_exact && mpfr_integer_p ( b->mid ) && mpfr_cmp_ui ( b->mid, 1 ) >= 0 && mpfr_fits_ulong_p ( b->mid, MPFR_RNDZ ) )
+		{ gcmp_ball_int_pow_rad ( r, a, mpfr_get_ui ( b->mid, MPFR_RNDZ ) ); return; }
+
+	// A negative base only to an exact integer power
+	if ( mpfr_sgn ( a->mid ) < 0 && !( b_exact && mpfr_integer_p ( b->mid ) ) ) { mpfr_set_inf ( r, 1 ); return; }
+
+	mpfr_t d, t, lo;
+	mpfr_inits2 ( RAD_BITS, d, t, lo, (mpfr_ptr)0 );
+
+	if ( !gcmp_ball_low ( lo, a->mid, a->rad ) ) mpfr_set_inf ( r, 1 );
+	else
+	{
+		mpfr_abs ( d, b->mid, MPFR_RNDU );
+		mpfr_add ( d, d, b->rad, MPFR_RNDU );
+		mpfr_mul ( d, d, a->rad, MPFR_RNDU );
+		mpfr_div ( d, d, lo, MPFR_RNDU );
+
+		if ( !b_exact )
+		{
+			// | ln | is largest at one of the ends
+			mpfr_log ( lo, lo, MPFR_RNDD );
+			mpfr_abs ( lo, lo, MPFR_RNDU );
+
+			mpfr_abs ( t, a->mid, MPFR_RNDU );
+			mpfr_add ( t, t, a->rad, MPFR_RNDU );
+			mpfr_log ( t, t, MPFR_RNDU );
+			mpfr_abs ( t, t, MPFR_RNDU );
+
+			mpfr_max ( t, t, lo, MPFR_RNDU );
+			mpfr_mul ( t, t, b->rad, MPFR_RNDU );
+			mpfr_add ( d, d, t, MPFR_RNDU );
+		}
+
+		gcmp_ball_rel ( r, m, d );
+	}
+
+	mpfr_clears ( d, t, lo, (mpfr_ptr)0 );
+}
+
+/* The integer part must be the same all over the ball */
+static gboolean gcmp_ball_trunc_same ( const GcmpBall *a )
+{
+	if ( mpfr_zero_p ( a->rad ) ) return TRUE;
+
+	mpfr_t lo, hi;
+	mpfr_inits2 ( END_BITS, lo, hi, (mpfr_ptr)0 );
+
+	mpfr_sub ( lo, a->mid, a->rad, MPFR_RNDD );
+	mpfr_add ( hi, a->mid, a->rad, MPFR_RNDU );
+
+	mpfr_trunc ( lo, lo );
+	mpfr_trunc ( hi, hi );
+
+	gboolean ret = mpfr_number_p ( lo ) && mpfr_equal_p ( lo, hi );
+
+	mpfr_clears ( lo, hi, (mpfr_ptr)0 );
+
+	return ret;
+}
+
+/* a - n b, n = trunc ( a / b ): ra + | n | rb, away from the jumps at 0 and | b | */
+static void gcmp_ball_mod_rad ( mpfr_t r, mpfr_srcptr m, const GcmpBall *a, const GcmpBall *b )
+{
+	if ( mpfr_zero_p ( a->rad ) && mpfr_zero_p ( b->rad ) ) return;
+
+	mpfr_t t, lo;
+	mpfr_inits2 ( RAD_BITS, t, lo, (mpfr_ptr)0 );
+
+	if ( !gcmp_ball_low ( lo, b->mid, b->rad ) ) mpfr_set_inf ( r, 1 );
+	else
+	{
+		mpfr_abs ( t, a->mid, MPFR_RNDU );
+		mpfr_div ( t, t, lo, MPFR_RNDU );
+		mpfr_mul ( t, t, b->rad, MPFR_RNDU );
+		mpfr_add ( r, t, a->rad, MPFR_RNDU );
+
+		// | m | > r and | b | - rb - | m | > r
+		mpfr_abs ( t, m, MPFR_RNDD );
+		if ( mpfr_lessequal_p ( t, r ) ) mpfr_set_inf ( r, 1 );
+
+		mpfr_abs ( t, m, MPFR_RNDU );
+		mpfr_sub ( t, lo, t, MPFR_RNDD );
+		if ( mpfr_lessequal_p ( t, r ) ) mpfr_set_inf ( r, 1 );
+	}
+
+	mpfr_clears ( t, lo, (mpfr_ptr)0 );
+}
+
+void gcmp_ball_op ( enum math mt, GcmpBall *res, const GcmpBall *a, const GcmpBall *b )
+{
+	mpfr_t m, r;
+	mpfr_init2 ( m, mpfr_get_prec ( res->mid ) );
+	mpfr_init2 ( r, RAD_BITS );
+	mpfr_set_zero ( r, 1 );
+
+	int inexact = 0;
+
+	if ( mt == ADD || mt == SUB ) mpfr_add ( r, a->rad, b->rad, MPFR_RNDU );
+
+	if ( mt == ADD ) inexact = mpfr_add ( m, a->mid, b->mid, MPFR_RNDN );
+	if ( mt == SUB ) inexact = mpfr_sub ( m, a->mid, b->mid, MPFR_RNDN );
+
+	if ( mt == MUL ) { gcmp_ball_mul_rad ( r, a, b ); inexact = gcmp_ntt_mul ( m, a->mid, b->mid, MPFR_RNDN ); }
+	if ( mt == DIV ) { gcmp_ball_div_rad ( r, a, b ); inexact = gcmp_ntt_div ( m, a->mid, b->mid, MPFR_RNDN ); }
+
+	if ( mt == POW ) { inexact = mpfr_pow ( m, a->mid, b->mid, MPFR_RNDN ); gcmp_ball_pow_rad ( r, m, a, b ); }
+
+	if ( mt == RUT )
+	{
+		ulong n = mpfr_get_ui ( b->mid, MPFR_RNDZ );
+
+		inexact = mpfr_rootn_ui ( m, a->mid, n, MPFR_RNDN );
+
+		mpfr_t d, lo;
+		mpfr_inits2 ( RAD_BITS, d, lo, (mpfr_ptr)0 );
+
+		// d ln ( a^( 1 / n ) ) = da / ( n a )
+		if ( !gcmp_ball_trunc_same ( b ) ) mpfr_set_inf ( r, 1 );
+		else if ( !mpfr_zero_p ( a->rad ) && n )
+		{
+			if ( !gcmp_ball_low ( lo, a->mid, a->rad ) ) mpfr_set_inf ( r, 1 );
+			else { mpfr_mul_ui ( lo, lo, n, MPFR_RNDD ); mpfr_div ( d, a->rad, lo, MPFR_RNDU ); gcmp_ball_rel ( r, m, d ); }
+		}
+
+		mpfr_clears ( d, lo, (mpfr_ptr)0 );
+	}
+
+	if ( mt == MOD ) { inexact = mpfr_fmod ( m, a->mid, b->mid, MPFR_RNDN ); gcmp_ball_mod_rad ( r, m, a, b ); }
+
+	if ( mt == PRC )
+	{
+		GcmpBall t;
+		gcmp_ball_init ( &t, mpfr_get_prec ( m ) );
+
+		gcmp_ball_op ( MUL, &t, a, b );
+
+		inexact = mpfr_div_ui ( m, t.mid, 100, MPFR_RNDN );
+		mpfr_div_ui ( r, t.rad, 100, MPFR_RNDU );
+
+		gcmp_ball_clear ( &t );
+	}
+
+	gcmp_ball_take ( res, m, r, inexact );
+
+	mpfr_clear ( m );
+	mpfr_clear ( r );
+}
+
+/* sin, cos, tan: the argument in radians is a ball too, pi / 180 being rounded */
+static int gcmp_ball_sct ( enum math_ext mt, mpfr_t m, mpfr_t r, const GcmpBall *a, uint8_t deg_rad )
+{
+	GcmpBall x;
+	gcmp_ball_init ( &x, mpfr_get_prec ( m ) );
+
+	if ( deg_rad )
+	{
+		GcmpBall c;
+		gcmp_ball_init ( &c, mpfr_get_prec ( m ) );
+
+		mpfr_set_ui ( c.mid, 180, MPFR_RNDN );
+
+		gcmp_const_run ( CPI, x.mid, MPFR_RNDN, NULL );
+		gcmp_ball_err ( x.rad, x.mid, -1 );
+
+		gcmp_ball_op ( DIV, &x, &x, &c );
+		gcmp_ball_op ( MUL, &x, a, &x );
+
+		gcmp_ball_clear ( &c );
+	}
+	else
+		gcmp_ball_set ( &x, a );
+
+	int inexact = 0;
+
+	if ( !gcmp_cost_admit_sct ( x.mid, mpfr_get_prec ( m ) ) ) { mpfr_set_nan ( m ); mpfr_set_inf ( x.rad, 1 ); }
+
+	else if ( mt == SIN ) inexact = mpfr_sin ( m, x.mid, MPFR_RNDN );
+	else if ( mt == COS ) inexact = mpfr_cos ( m, x.mid, MPFR_RNDN );
+	else if ( mt == TAN ) inexact = mpfr_tan ( m, x.mid, MPFR_RNDN );
+
+	// | sin' |, | cos' | <= 1
+	mpfr_set ( r, x.rad, MPFR_RNDU );
+
+	if ( mt == TAN && !mpfr_zero_p ( x.rad ) )
+	{
+		// tan' = 1 + tan^2, largest at an end when no pole is between: shorter than pi, cos of one sign
+		mpfr_t lo, hi, t;
+		mpfr_inits2 ( END_BITS, lo, hi, t, (mpfr_ptr)0 );
+
+		mpfr_sub ( lo, x.mid, x.rad, MPFR_RNDD );
+		mpfr_add ( hi, x.mid, x.rad, MPFR_RNDU );
+
+		mpfr_cos ( t, lo, MPFR_RNDN );
+		int s = mpfr_sgn ( t );
+		gboolean ok = ( s && mpfr_get_exp ( t ) > -END_BITS / 2 );
+
+		mpfr_cos ( t, hi, MPFR_RNDN );
+		ok = ok && s == mpfr_sgn ( t ) && mpfr_get_exp ( t ) > -END_BITS / 2 && mpfr_cmp_d ( x.rad, 1.5 ) < 0;
+
+		if ( !ok ) mpfr_set_inf ( r, 1 );
+		else
+		{
+			mpfr_tan ( lo, lo, MPFR_RNDN );
+			mpfr_tan ( hi, hi, MPFR_RNDN );
+
+			mpfr_abs ( lo, lo, MPFR_RNDU );
+			mpfr_abs ( hi, hi, MPFR_RNDU );
+			mpfr_max ( t, lo, hi, MPFR_RNDU );
+
+			// The ends were rounded: a little more
+			mpfr_mul_d ( t, t, 1.0 + 0x1p-24, MPFR_RNDU );
+			mpfr_sqr ( t, t, MPFR_RNDU );
+			mpfr_add_ui ( t, t, 1, MPFR_RNDU );
+
+			mpfr_mul ( r, x.rad, t, MPFR_RNDU );
+		}
+
+		mpfr_clears ( lo, hi, t, (mpfr_ptr)0 );
+	}
+
+	gcmp_ball_clear ( &x );
+
+	return inexact;
+}
+
+void gcmp_ball_op_ext ( enum math_ext mt, GcmpBall *res, const GcmpBall *a, uint8_t deg_rad )
+{
+	mpfr_t m, r, t, lo;
+	mpfr_init2 ( m, mpfr_get_prec ( res->mid ) );
+	mpfr_inits2 ( RAD_BITS, r, t, lo, (mpfr_ptr)0 );
+	mpfr_set_zero ( r, 1 );
+
+	int inexact = 0;
+	gboolean exact = mpfr_zero_p ( a->rad );
+
+	if ( mt == PW2 ) { inexact = gcmp_ntt_mul ( m, a->mid, a->mid, MPFR_RNDN ); gcmp_ball_int_pow_rad ( r, a, 2 ); }
+	if ( mt == PW3 ) { inexact = mpfr_pow_ui ( m, a->mid, 3, MPFR_RNDN ); gcmp_ball_int_pow_rad ( r, a, 3 ); }
+
+	// The derivatives are largest at the end nearest zero: lo = | a | - ra
+	if ( mt == RT2 || mt == RT3 || mt == D1R || mt == D1X || mt == LGN || mt == LOG )
+	{
+		if ( mt == RT2 ) inexact = gcmp_ntt_sqrt ( m, a->mid, MPFR_RNDN );
+		if ( mt == RT3 ) inexact = mpfr_cbrt ( m, a->mid, MPFR_RNDN );
+		if ( mt == D1R ) inexact = gcmp_ntt_rec_sqrt ( m, a->mid, MPFR_RNDN );
+		if ( mt == LGN ) inexact = mpfr_log ( m, a->mid, MPFR_RNDN );
+		if ( mt == LOG ) inexact = mpfr_log10 ( m, a->mid, MPFR_RNDN );
+
+		if ( mt == D1X )
+		{
+			mpfr_t one;
+			mpfr_init2 ( one, mpfr_get_prec ( m ) );
+			mpfr_set_ui ( one, 1, MPFR_RNDN );
+
+			inexact = gcmp_ntt_div ( m, one, a->mid, MPFR_RNDN );
+
+			mpfr_clear ( one );
+		}
+
+		if ( !exact && !gcmp_ball_low ( lo, a->mid, a->rad ) ) mpfr_set_inf ( r, 1 );
+		else if ( !exact )
+		{
+			// 1 / ( 2 sqrt lo ), 1 / ( 3 lo^( 2 / 3 ) ), 1 / ( 2 lo^( 3 / 2 ) ), 1 / ( | a | lo ), 1 / lo, 1 / ( lo ln 10 )
+			if ( mt == RT2 ) { mpfr_sqrt ( t, lo, MPFR_RNDD ); mpfr_mul_ui ( t, t, 2, MPFR_RNDD ); }
+			if ( mt == RT3 ) { mpfr_cbrt ( t, lo, MPFR_RNDD ); mpfr_sqr ( t, t, MPFR_RNDD ); mpfr_mul_ui ( t, t, 3, MPFR_RNDD ); }
+			if ( mt == D1R ) { mpfr_sqrt ( t, lo, MPFR_RNDD ); mpfr_mul ( t, t, lo, MPFR_RNDD ); mpfr_mul_ui ( t, t, 2, MPFR_RNDD ); }
+			if ( mt == D1X ) { mpfr_abs ( t, a->mid, MPFR_RNDD ); mpfr_mul ( t, t, lo, MPFR_RNDD ); }
+			if ( mt == LGN || mt == LOG ) mpfr_set ( t, lo, MPFR_RNDD );
+
+			mpfr_div ( r, a->rad, t, MPFR_RNDU );
+
+			if ( mt == LOG ) mpfr_mul_d ( r, r, 0.4343, MPFR_RNDU );
+		}
+	}
+
+	if ( mt == FAC )
+	{
+		ulong n = mpfr_get_ui ( a->mid, MPFR_RNDZ );
+
+		inexact = gcmp_mpfr_fac ( m, n, MPFR_RNDN );
+
+		if ( !gcmp_ball_trunc_same ( a ) ) mpfr_set_inf ( r, 1 );
+	}
+
+	if ( mt == CPI || mt == CEU || mt == CEX || mt == CL2 ) { gcmp_const_run ( mt, m, MPFR_RNDN, NULL ); inexact = 1; }
+
+	if ( mt == SIN || mt == COS || mt == TAN ) inexact = gcmp_ball_sct ( mt, m, r, a, deg_rad );
+
+	gcmp_ball_take ( res, m, r, inexact );
+
+	mpfr_clear ( m );
+	mpfr_clears ( r, t, lo, (mpfr_ptr)0 );
+}
+
+void gcmp_ball_op_nary ( enum math_nary mt, GcmpBall *res, GcmpBall **args, uint32_t n )
+{
+	mpfr_t m, r, t;
+	mpfr_init2 ( m, mpfr_get_prec ( res->mid ) );
+	mpfr_inits2 ( RAD_BITS, r, t, (mpfr_ptr)0 );
+	mpfr_set_zero ( r, 1 );
+
+	mpfr_ptr *mids = malloc ( n * sizeof ( mpfr_ptr ) );
+
+	uint32_t j = 0;
+	for ( j = 0; j < n; j++ ) mids[j] = args[j]->mid;
+
+	int inexact = 0;
+
+	if ( !gcmp_mpfr_nary_fits ( mt, n ) ) mpfr_set_nan ( m );
+
+	else if ( mt == PWM || mt == GCD || mt == INV || mt == PRM )
+	{
+		gcmp_mpfr_op_nary ( mt, m, mids, n );
+
+		// Exact on exact integers; rounded down when the answer is longer than the precision
+		for ( j = 0; j < n; j++ ) if ( !mpfr_zero_p ( args[j]->rad ) ) mpfr_set_inf ( r, 1 );
+
+		if ( mpfr_regular_p ( m ) && mpfr_get_exp ( m ) > mpfr_get_prec ( m ) ) gcmp_ball_err ( r, m, 0 );
+	}
+
+	else if ( mt == DOT )
+	{
+		inexact = mpfr_dot ( m, mids, mids + n / 2, n / 2, MPFR_RNDN );
+
+		for ( j = 0; j < n / 2; j++ ) { gcmp_ball_mul_rad ( t, args[j], args[j + n / 2] ); mpfr_add ( r, r, t, MPFR_RNDU ); }
+	}
+
+	else if ( mt == FMA || mt == FMS || mt == FMMA || mt == FMMS )
+	{
+		if ( mt == FMA ) inexact = mpfr_fma ( m, mids[0], mids[1], mids[2], MPFR_RNDN );
+		if ( mt == FMS ) inexact = mpfr_fms ( m, mids[0], mids[1], mids[2], MPFR_RNDN );
+
+		if ( mt == FMMA ) inexact = mpfr_fmma ( m, mids[0], mids[1], mids[2], mids[3], MPFR_RNDN );
+		if ( mt == FMMS ) inexact = mpfr_fmms ( m, mids[0], mids[1], mids[2], mids[3], MPFR_RNDN );
+
+		gcmp_ball_mul_rad ( r, args[0], args[1] );
+
+		if ( n == 3 ) mpfr_add ( r, r, args[2]->rad, MPFR_RNDU );
+		else { gcmp_ball_mul_rad ( t, args[2], args[3] ); mpfr_add ( r, r, t, MPFR_RNDU ); }
+	}
+
+	else if ( mt == PLY )
+	{
+		// Horner's rule on balls: each fma adds | acc | rx + | x | racc + racc rx + rc and its rounding
+		GcmpBall acc;
+		gcmp_ball_init ( &acc, mpfr_get_prec ( m ) );
+		gcmp_ball_set ( &acc, args[1] );
+
+		for ( j = 2; j < n; j++ )
+		{
+			gcmp_ball_mul_rad ( r, &acc, args[0] );
+			mpfr_add ( r, r, args[j]->rad, MPFR_RNDU );
+
+			inexact = mpfr_fma ( m, acc.mid, args[0]->mid, args[j]->mid, MPFR_RNDN );
+
+			gcmp_ball_take ( &acc, m, r, inexact );
+		}
+
+		mpfr_swap ( m, acc.mid );
+		mpfr_set ( r, acc.rad, MPFR_RNDU );
+		inexact = 0;
+
+		gcmp_ball_clear ( &acc );
+	}
+
+	gcmp_ball_take ( res, m, r, inexact );
+
+	free ( mids );
+
+	mpfr_clear ( m );
+	mpfr_clears ( r, t, (mpfr_ptr)0 );
+}
+
+uint32_t gcmp_ball_digits ( const GcmpBall *b, uint8_t base )
+{
+	if ( !mpfr_number_p ( b->mid ) || !mpfr_number_p ( b->rad ) ) return 0;
+
+	if ( mpfr_zero_p ( b->rad ) ) return UINT32_MAX;
+
+	if ( mpfr_zero_p ( b->mid ) ) return 0;
+
+	// | mid | = 0.d1 d2 ... × base^e; k digits are right when rad <= base^( e - k ) / 2
+	long em = 0, er = 0;
+	double dm = mpfr_get_d_2exp ( &em, b->mid, MPFR_RNDN );
+	double dr = mpfr_get_d_2exp ( &er, b->rad, MPFR_RNDU );
+
+	double lb = log2 ( base );
+	double lm = ( (double)em + log2 ( fabs ( dm ) ) ) / lb;
+	double lr = ( (double)er + log2 ( dr ) + 1 ) / lb;
+
+	// Near a power of the base the smaller exponent, and the doubles' error away from the digits
+	double e = floor ( lm - 1e-9 ) + 1;
+	double k = floor ( e - lr - 1e-6 );
+
+	if ( k < 1 ) return 0;
+
+	return ( k >= UINT32_MAX ) ? UINT32_MAX - 1 : (uint32_t)k;
+}
@@ -0,0 +1,48 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+/*
+* Ball arithmetic: a midpoint at the working precision and a radius of 32 bits, rounded up,
+* such that the true value lies within radius of the midpoint. The operations are those of gcmp-mpfr,
+* the midpoint rounded to nearest, the radius grown by the rounding and by the operands' radii
+* ( derivative bounds over the ball ); a ball the function is not smooth on gets an infinite radius.
+*/
+typedef struct _GcmpBall GcmpBall;
+
+struct _GcmpBall
+{
+	mpfr_t mid;
+	mpfr_t rad;
+};
+
+void gcmp_ball_init ( GcmpBall *, mpfr_prec_t );
+
+void gcmp_ball_clear ( GcmpBall * );
+
+void gcmp_ball_set ( GcmpBall *, const GcmpBall * );
+
+/* A number is exact only when it parses so; else its radius holds the rounding */
+void gcmp_ball_set_str ( GcmpBall *, const char *, uint8_t );
+
+/* A stored or bound value ( gcmp_eval_new_bound ) counts as exact: it is the number referred to */
+void gcmp_ball_set_fr ( GcmpBall *, mpfr_srcptr );
+
+/* The result may be one of the operands */
+void gcmp_ball_op ( enum math, GcmpBall *, const GcmpBall *, const GcmpBall * );
+
+void gcmp_ball_op_ext ( enum math_ext, GcmpBall *, const GcmpBall *, uint8_t );
+
+void gcmp_ball_op_nary ( enum math_nary, GcmpBall *, GcmpBall **, uint32_t );
+
+/* Significant digits in the base that the midpoint gets right, to one unit of the last; UINT32_MAX if exact */
+uint32_t gcmp_ball_digits ( const GcmpBall *, uint8_t );
@@ -0,0 +1,1113 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-const.h"
+#include "gcmp-pool.h"
+#include "gcmp-ntt.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <glib/gstdio.h>
+
+/* Below this MPFR's own constants ( cached per thread ) are as quick */
+#define CONST_MIN_BITS 65536
+
+/* Subtrees of fewer terms stay on one thread; products of a merge run side by side from this size */
+#define SPAWN_TERMS 256
+#define MUL_TASK_LIMBS 2048
+
+/* A checkpoint: the split tree's nodes at this depth ( up to 64 ) run one by one, the state is written at most this often */
+#define CKPT_DEPTH 6
+#define CKPT_PERIOD ( 30 * G_USEC_PER_SEC )
+
+/* Error of the final value in ulps of the working precision ( gamma loses a few bits to ln n ) */
+#define ERR_BITS 16
+
+typedef unsigned long ulong;
+
+typedef struct _Split Split;
+
+/*
+* Terms a .. b - 1 of sum a ( k ) p ( a ) .. p ( k ) / q ( a ) .. q ( k ): the sum is T / Q, P is the product of the p.
+* Gamma adds its harmonic numbers: C / D is the sum of 1 / k, V / ( D Q ) the sum of the terms times their partial sums.
+*/
+struct _Split
+{
+	mpz_t p, q, t;
+	mpz_t c, d, v;
+};
+
+typedef struct _Series Series;
+
+struct _Series
+{
+	enum math_ext mt;
+	ulong m; // atanh ( 1 / m ) for ln 2, n of gamma
+
+	gboolean harm;
+	uint8_t spawn_depth;
+
+	GcmpConstProgress *prog;
+};
+
+typedef struct _Node Node;
+
+struct _Node
+{
+	const Series *s;
+	ulong a, b;
+
+	Split *r;
+	gboolean need_p;
+	uint8_t depth;
+};
+
+typedef struct _Mul Mul;
+
+struct _Mul
+{
+	mpz_ptr r;
+	mpz_srcptr a, b;
+};
+
+typedef struct _Cache Cache;
+
+struct _Cache
+{
+	mpfr_t val;
+	gboolean set;
+};
+
+/* The last big value of each constant: pi, e, ln 2, gamma */
+static Cache cache[4];
+static GMutex cache_mutex;
+
+static gboolean gcmp_const_cancelled ( const Series *s )
+{
+	return ( s->prog && g_atomic_int_get ( &s->prog->cancel ) );
+}
+
+static void gcmp_const_split_init ( const Series *s, Split *r )
+{
+	mpz_inits ( r->p, r->q, r->t, NULL );
+
+	if ( s->harm ) mpz_inits ( r->c, r->d, r->v, NULL );
+}
+
+static void gcmp_const_split_clear ( const Series *s, Split *r )
+{
+	mpz_clears ( r->p, r->q, r->t, NULL );
+
+	if ( s->harm ) mpz_clears ( r->c, r->d, r->v, NULL );
+}
+
+static void gcmp_const_leaf ( const Series *s, ulong k, Split *r )
+{
+	if ( s->mt == CPI )
+	{
+		if ( k == 0 ) { mpz_set_ui ( r->p, 1 ); mpz_set_ui ( r->q, 1 ); mpz_set_ui ( r->t, 13591409 ); return; }
+
+		// p = - ( 6k - 5 ) ( 2k - 1 ) ( 6k - 1 ), q = k³ 640320³ / 24, a = 13591409 + 545140134 k
+		mpz_set_ui ( r->p, 6 * k - 5 );
+		mpz_mul_ui ( r->p, r->p, 2 * k - 1 );
+		mpz_mul_ui ( r->p, r->p, 6 * k - 1 );
+		mpz_neg ( r->p, r->p );
+
+		mpz_set_ui ( r->q, k );
+		mpz_mul_ui ( r->q, r->q, k );
+		mpz_mul_ui ( r->q, r->q, k );
+		mpz_mul_ui ( r->q, r->q, 26680 );
+		mpz_mul_ui ( r->q, r->q, 640320 );
+		mpz_mul_ui ( r->q, r->q, 640320 );
+
+		mpz_mul_ui ( r->t, r->p, k );
+		mpz_mul_ui ( r->t, r->t, 545140134 );
+		mpz_addmul_ui ( r->t, r->p, 13591409 );
+	}
+
+	// 1 / k! from k = 1
+	if ( s->mt == CEX ) { mpz_set_ui ( r->p, 1 ); mpz_set_ui ( r->q, k ); mpz_set_ui ( r->t, 1 ); }
+
+	// atanh ( 1 / m ) = ( 1 / m ) sum 1 / ( ( 2k + 1 ) m^2k )
+	if ( s->mt == CL2 )
+	{
+		if ( k == 0 ) { mpz_set_ui ( r->p, 1 ); mpz_set_ui ( r->q, 1 ); mpz_set_ui ( r->t, 1 ); return; }
+
+		mpz_set_ui ( r->p, 2 * k - 1 );
+
+		mpz_set_ui ( r->q, 2 * k + 1 );
+		mpz_mul_ui ( r->q, r->q, s->m * s->m );
+
+		mpz_set ( r->t, r->p );
+	}
+
+	// ( n^k / k! )² and H ( k ) from k = 1
+	if ( s->mt == CEU )
+	{
+		mpz_set_ui ( r->p, s->m );
+		mpz_mul_ui ( r->p, r->p, s->m );
+
+		mpz_set_ui ( r->q, k );
+		mpz_mul_ui ( r->q, r->q, k );
+
+		mpz_set ( r->t, r->p );
+
+		mpz_set_ui ( r->c, 1 );
+		mpz_set_ui ( r->d, k );
+		mpz_set ( r->v, r->p );
+	}
+}
+
+static void gcmp_const_mul_task ( gpointer data )
+{
+	Mul *mul = data;
+
+	gcmp_ntt_mul_z ( mul->r, mul->a, mul->b );
+}
+
+/* Independent products of one merge: side by side when big, the first on this thread */
+static void gcmp_const_muls ( Mul *muls, uint8_t n )
+{
+	size_t size = 0;
+
+	uint8_t j = 0;
+	for ( j = 0; j < n; j++ ) size = MAX ( size, MIN ( mpz_size ( muls[j].a ), mpz_size ( muls[j].b ) ) );
+
+	if ( size < MUL_TASK_LIMBS || !gcmp_pool_get_workers () )
+	{
+		for ( j = 0; j < n; j++ ) gcmp_const_mul_task ( &muls[j] );
+
+		return;
+	}
+
+	GcmpPoolGroup group = { 0 };
+
+	for ( j = 1; j < n; j++ ) gcmp_pool_spawn ( &group, gcmp_const_mul_task, &muls[j] );
+
+	gcmp_const_mul_task ( &muls[0] );
+
+	gcmp_pool_wait ( &group );
+}
+
+/* P = P1 P2, Q = Q1 Q2, T = T1 Q2 + P1 T2; C = C1 D2 + C2 D1, D = D1 D2, V = D2 ( V1 Q2 + P1 C1 T2 ) + P1 D1 V2 */
+static void gcmp_const_merge ( const Series *s, Split *r, Split *l, Split *h, gboolean need_p )
+{
+	mpz_t pt;
+	mpz_init ( pt );
+
+	Mul muls[9] = { { r->t, l->t, h->q }, { r->q, l->q, h->q }, { pt, l->p, h->t } };
+	uint8_t n = 3;
+
+	if ( need_p ) muls[n++] = (Mul){ r->p, l->p, h->p };
+
+	if ( !s->harm )
+	{
+		gcmp_const_muls ( muls, n );
+
+		mpz_add ( r->t, r->t, pt );
+		mpz_clear ( pt );
+
+		return;
+	}
+
+	mpz_t c2, vq, dv, x;
+	mpz_inits ( c2, vq, dv, x, NULL );
+
+	muls[n++] = (Mul){ r->c, l->c, h->d };
+	muls[n++] = (Mul){ c2, h->c, l->d };
+	muls[n++] = (Mul){ r->d, l->d, h->d };
+	muls[n++] = (Mul){ vq, l->v, h->q };
+	muls[n++] = (Mul){ dv, l->d, h->v };
+
+	gcmp_const_muls ( muls, n );
+
+	mpz_add ( r->c, r->c, c2 );
+
+	muls[0] = (Mul){ c2, l->c, pt };
+	muls[1] = (Mul){ x, l->p, dv };
+
+	gcmp_const_muls ( muls, 2 );
+
+	mpz_add ( r->t, r->t, pt );
+	mpz_add ( vq, vq, c2 );
+
+	gcmp_ntt_mul_z ( r->v, h->d, vq );
+	mpz_add ( r->v, r->v, x );
+
+	mpz_clears ( pt, c2, vq, dv, x, NULL );
+}
+
+static void gcmp_const_split ( const Series *s, ulong a, ulong b, Split *r, gboolean need_p, uint8_t depth );
+
+static void gcmp_const_split_task ( gpointer data )
+{
+	Node *node = data;
+
+	gcmp_const_split ( node->s, node->a, node->b, node->r, node->need_p, node->depth );
+}
+
+/* Halves to single terms; the top levels hand their left half to the pool. P is not kept where no one needs it */
+static void gcmp_const_split ( const Series *s, ulong a, ulong b, Split *r, gboolean need_p, uint8_t depth )
+{
+	if ( gcmp_const_cancelled ( s ) ) return;
+
+	if ( b - a == 1 ) { gcmp_const_leaf ( s, a, r ); return; }
+
+	ulong m = a + ( b - a ) / 2;
+
+	Split l, h;
+	gcmp_const_split_init ( s, &l );
+	gcmp_const_split_init ( s, &h );
+
+	if ( depth < s->spawn_depth && b - a >= SPAWN_TERMS )
+	{
+		GcmpPoolGroup group = { 0 };
+		Node node = { s, a, m, &l, TRUE, (uint8_t)( depth + 1 ) };
+
+		gcmp_pool_spawn ( &group, gcmp_const_split_task, &node );
+		gcmp_const_split ( s, m, b, &h, need_p, (uint8_t)( depth + 1 ) );
+
+		gcmp_pool_wait ( &group );
+	}
+	else
+	{
+		gcmp_const_split ( s, a, m, &l, TRUE, (uint8_t)( depth + 1 ) );
+		gcmp_const_split ( s, m, b, &h, need_p, (uint8_t)( depth + 1 ) );
+	}
+
+	if ( !gcmp_const_cancelled ( s ) ) gcmp_const_merge ( s, r, &l, &h, need_p );
+
+	gcmp_const_split_clear ( s, &l );
+	gcmp_const_split_clear ( s, &h );
+
+	if ( s->prog ) g_atomic_int_add ( &s->prog->done, (gint)( b - a ) );
+}
+
+/* Terms merged by a split of n terms, counted as done above: f ( s ) and f ( s + 1 ) */
+static void gcmp_const_work ( ulong s, double *fs, double *fs1 )
+{
+	if ( s <= 1 ) { *fs = 0; *fs1 = ( s ) ? 2 : 0; return; }
+
+	double a = 0, b = 0;
+	gcmp_const_work ( s / 2, &a, &b );
+
+	*fs  = ( s % 2 ) ? s + a + b : s + 2 * a;
+	*fs1 = ( s % 2 ) ? s + 1 + 2 * b : s + 1 + a + b;
+}
+
+static double gcmp_const_total ( ulong n )
+{
+	double fs = 0, fs1 = 0;
+	gcmp_const_work ( n, &fs, &fs1 );
+
+	return fs;
+}
+
+static void gcmp_const_series_init ( Series *s, enum math_ext mt, ulong m, GcmpConstProgress *prog )
+{
+	uint8_t workers = gcmp_pool_get_workers (), depth = 0;
+
+	// Some four subtrees per core, no more: each holds its numbers until merged
+	while ( workers && ( 1u << depth ) < 4u * ( workers + 1u ) ) depth++;
+
+	*s = (Series){ mt, m, ( mt == CEU ), depth, prog };
+}
+
+typedef struct _Part Part;
+
+/* A node of the split tree done: terms a .. b - 1 at depth */
+struct _Part
+{
+	ulong a, b;
+	uint8_t depth;
+
+	Split r;
+};
+
+typedef struct _Track Track;
+
+/* One series by nodes of the tree, left to right: the parts done, siblings merged as soon as both are */
+struct _Track
+{
+	ulong a, b, next;
+
+	Part part[CKPT_DEPTH + 1];
+	uint8_t n;
+};
+
+typedef struct _Ckpt Ckpt;
+
+struct _Ckpt
+{
+	char *path;
+
+	enum math_ext mt;
+	mpfr_prec_t prec, wp;
+
+	// ln 2 has three series
+	Track track[3];
+	uint8_t n_track;
+
+	gboolean harm;
+	gint64 time;
+
+	// The writer: the latest state waits in pending, an older one not yet written is dropped
+	GMutex mutex;
+	GCond cond;
+	GThread *thread;
+	GByteArray *pending;
+	gboolean stop;
+};
+
+typedef struct _Reader Reader;
+
+struct _Reader
+{
+	const uint8_t *p, *end;
+};
+
+/* File: "GCMPCKPT", then 64-bit little-endian words: constant, precision, working precision, series;
+*  per series a, b, next, parts; per part a, b, depth and its numbers, each as its length in words ( times 2, plus 1 if negative ) and the words */
+static const char ckpt_magic[8] = { 'G', 'C', 'M', 'P', 'C', 'K', 'P', 'T' };
+
+static void gcmp_const_put_u64 ( GByteArray *buf, uint64_t v )
+{
+	v = GUINT64_TO_LE ( v );
+	g_byte_array_append ( buf, (const uint8_t *)&v, sizeof ( v ) );
+}
+
+static void gcmp_const_put_z ( GByteArray *buf, mpz_srcptr z )
+{
+	size_t n = ( mpz_sgn ( z ) ) ? ( mpz_sizeinbase ( z, 2 ) + 63 ) / 64 : 0;
+
+	gcmp_const_put_u64 ( buf, ( n << 1 ) | ( mpz_sgn ( z ) < 0 ) );
+
+	guint len = buf->len;
+	g_byte_array_set_size ( buf, (guint)( len + n * 8 ) );
+
+	mpz_export ( buf->data + len, NULL, -1, 8, -1, 0, z );
+}
+
+static gboolean gcmp_const_get_u64 ( Reader *rd, uint64_t *v )
+{
+	if ( rd->end - rd->p < 8 ) return FALSE;
+
+	memcpy ( v, rd->p, 8 );
+	*v = GUINT64_FROM_LE ( *v );
+	rd->p += 8;
+
+	return TRUE;
+}
+
+static gboolean gcmp_const_get_z ( Reader *rd, mpz_t z )
+{
+	uint64_t h = 0;
+
+	if ( !gcmp_const_get_u64 ( rd, &h ) || ( h >> 1 ) > (uint64_t)( rd->end - rd->p ) / 8 ) return FALSE;
+
+	mpz_import ( z, h >> 1, -1, 8, -1, 0, rd->p );
+	if ( h & 1 ) mpz_neg ( z, z );
+
+	rd->p += ( h >> 1 ) * 8;
+
+	return TRUE;
+}
+
+static void gcmp_const_put_split ( const Ckpt *ck, GByteArray *buf, const Split *r )
+{
+	gcmp_const_put_z ( buf, r->p );
+	gcmp_const_put_z ( buf, r->q );
+	gcmp_const_put_z ( buf, r->t );
+
+	if ( !ck->harm ) return;
+
+	gcmp_const_put_z ( buf, r->c );
+	gcmp_const_put_z ( buf, r->d );
+	gcmp_const_put_z ( buf, r->v );
+}
+
+static gboolean gcmp_const_get_split ( const Ckpt *ck, Reader *rd, Split *r )
+{
+	gboolean ok = ( gcmp_const_get_z ( rd, r->p ) && gcmp_const_get_z ( rd, r->q ) && gcmp_const_get_z ( rd, r->t ) );
+
+	if ( ok && ck->harm ) ok = ( gcmp_const_get_z ( rd, r->c ) && gcmp_const_get_z ( rd, r->d ) && gcmp_const_get_z ( rd, r->v ) );
+
+	return ok;
+}
+
+static void gcmp_const_track_clear ( const Series *s, Track *tr )
+{
+	uint8_t j = 0;
+	for ( j = 0; j < tr->n; j++ ) gcmp_const_split_clear ( s, &tr->part[j].r );
+
+	tr->n = 0;
+}
+
+/* Two parts are siblings if together they are the node split between them */
+static gboolean gcmp_const_siblings ( const Part *l, const Part *h )
+{
+	return ( l->depth == h->depth && l->b == h->a && h->a == l->a + ( h->b - l->a ) / 2 );
+}
+
+/* Depth of the nodes run one by one: at most CKPT_DEPTH, and none shorter than two terms */
+static uint8_t gcmp_const_track_depth ( const Track *tr )
+{
+	uint8_t depth = 0;
+	while ( depth < CKPT_DEPTH && ( 2ul << depth ) <= tr->b - tr->a ) depth++;
+
+	return depth;
+}
+
+/* The node at depth with term next in it */
+static void gcmp_const_track_node ( const Track *tr, uint8_t depth, ulong next, ulong *a, ulong *b )
+{
+	*a = tr->a; *b = tr->b;
+
+	uint8_t d = 0;
+	for ( d = 0; d < depth; d++ ) { ulong m = *a + ( *b - *a ) / 2; if ( next < m ) *b = m; else *a = m; }
+}
+
+/* The parts are those gcmp_const_track_run leaves after the terms before next: anything else is not of this tree */
+static gboolean gcmp_const_track_valid ( const Track *tr )
+{
+	if ( tr->a > tr->next || tr->next > tr->b ) return FALSE;
+
+	uint8_t depth = gcmp_const_track_depth ( tr ), n = 0, j = 0;
+
+	Part ex[CKPT_DEPTH + 1];
+	ulong next = tr->a;
+
+	while ( next < tr->next && n <= CKPT_DEPTH )
+	{
+		Part *pt = &ex[n++];
+		pt->depth = depth;
+
+		gcmp_const_track_node ( tr, depth, next, &pt->a, &pt->b );
+		next = pt->b;
+
+		for ( ; n >= 2 && gcmp_const_siblings ( &ex[n - 2], &ex[n - 1] ); n-- ) { ex[n - 2].b = ex[n - 1].b; ex[n - 2].depth--; }
+	}
+
+	if ( next != tr->next || n != tr->n ) return FALSE;
+
+	for ( j = 0; j < n; j++ )
+		if ( ex[j].a != tr->part[j].a || ex[j].b != tr->part[j].b || ex[j].depth != tr->part[j].depth ) return FALSE;
+
+	return TRUE;
+}
+
+/* Its own a and b are checked against the series when a track is used ( gcmp_const_series_run ) */
+static gboolean gcmp_const_ckpt_read ( Ckpt *ck, Reader *rd, const Series *s )
+{
+	uint64_t v[4] = { 0 };
+
+	uint8_t j = 0, k = 0;
+	for ( j = 0; j < 4; j++ ) if ( !gcmp_const_get_u64 ( rd, &v[j] ) ) return FALSE;
+
+	if ( v[0] != (uint64_t)ck->mt || v[2] != (uint64_t)ck->wp || v[3] > G_N_ELEMENTS ( ck->track ) ) return FALSE;
+
+	for ( j = 0; j < (uint8_t)v[3]; j++ )
+	{
+		Track *tr = &ck->track[j];
+		uint64_t t[4] = { 0 };
+
+		for ( k = 0; k < 4; k++ ) if ( !gcmp_const_get_u64 ( rd, &t[k] ) ) return FALSE;
+
+		// A run pushes its next part at n: one more than CKPT_DEPTH could not be merged
+		if ( t[3] > CKPT_DEPTH ) return FALSE;
+
+		*tr = (Track){ t[0], t[1], t[2], { { 0 } }, 0 };
+		ck->n_track = j + 1;
+
+		for ( k = 0; k < (uint8_t)t[3]; k++ )
+		{
+			Part *pt = &tr->part[k];
+			uint64_t a = 0, b = 0, depth = 0;
+
+			if ( !gcmp_const_get_u64 ( rd, &a ) || !gcmp_const_get_u64 ( rd, &b ) || !gcmp_const_get_u64 ( rd, &depth ) ) return FALSE;
+
+			pt->a = a; pt->b = b; pt->depth = (uint8_t)depth;
+			gcmp_const_split_init ( s, &pt->r );
+			tr->n++;
+
+			if ( !gcmp_const_get_split ( ck, rd, &pt->r ) ) return FALSE;
+		}
+
+		if ( !gcmp_const_track_valid ( tr ) ) return FALSE;
+	}
+
+	return ( rd->p == rd->end );
+}
+
+static Ckpt * gcmp_const_ckpt_open ( const char *path, enum math_ext mt, mpfr_prec_t prec, mpfr_prec_t wp )
+{
+	Ckpt *ck = g_new0 ( Ckpt, 1 );
+
+	ck->path = g_strdup ( path );
+	ck->mt   = mt;
+	ck->prec = prec;
+	ck->wp   = wp;
+	ck->harm = ( mt == CEU );
+	ck->time = g_get_monotonic_time ();
+
+	g_mutex_init ( &ck->mutex );
+	g_cond_init ( &ck->cond );
+
+	char *data = NULL;
+	gsize len = 0;
+
+	if ( !g_file_get_contents ( path, &data, &len, NULL ) ) return ck;
+
+	Series s = { mt, 0, ck->harm, 0, NULL };
+	Reader rd = { (const uint8_t *)data + sizeof ( ckpt_magic ), (const uint8_t *)data + len };
+
+	// Another constant or precision, or a broken file: started anew, and written over
+	if ( len < sizeof ( ckpt_magic ) || memcmp ( data, ckpt_magic, sizeof ( ckpt_magic ) ) != 0 || !gcmp_const_ckpt_read ( ck, &rd, &s ) )
+	{
+		uint8_t j = 0;
+		for ( j = 0; j < ck->n_track; j++ ) gcmp_const_track_clear ( &s, &ck->track[j] );
+
+		ck->n_track = 0;
+	}
+
+	g_free ( data );
+
+	return ck;
+}
+
+static gpointer gcmp_const_ckpt_thread ( Ckpt *ck )
+{
+	g_autofree char *dir = g_path_get_dirname ( ck->path );
+	g_mkdir_with_parents ( dir, 0700 );
+
+	g_mutex_lock ( &ck->mutex );
+
+	while ( TRUE )
+	{
+		while ( !ck->pending && !ck->stop ) g_cond_wait ( &ck->cond, &ck->mutex );
+
+		if ( !ck->pending ) break;
+
+		GByteArray *buf = ck->pending;
+		ck->pending = NULL;
+
+		g_mutex_unlock ( &ck->mutex );
+
+		// Written aside and renamed over: a crash while writing leaves the last checkpoint
+		GError *error = NULL;
+
+		if ( !g_file_set_contents ( ck->path, (const char *)buf->data, (gssize)buf->len, &error ) ) { g_warning ( "%s: %s ", __func__, error->message ); g_error_free ( error ); }
+
+		g_byte_array_unref ( buf );
+
+		g_mutex_lock ( &ck->mutex );
+	}
+
+	g_mutex_unlock ( &ck->mutex );
+
+	return NULL;
+}
+
+/* The state in memory on this thread ( a copy, as long as the numbers ), the file on the writer's */
+static void gcmp_const_ckpt_save ( Ckpt *ck )
+{
+	GByteArray *buf = g_byte_array_new ();
+	g_byte_array_append ( buf, (const uint8_t *)ckpt_magic, sizeof ( ckpt_magic ) );
+
+	gcmp_const_put_u64 ( buf, (uint64_t)ck->mt );
+	gcmp_const_put_u64 ( buf, (uint64_t)ck->prec );
+	gcmp_const_put_u64 ( buf, (uint64_t)ck->wp );
+	gcmp_const_put_u64 ( buf, ck->n_track );
+
+	uint8_t j = 0, k = 0;
+	for ( j = 0; j < ck->n_track; j++ )
+	{
+		const Track *tr = &ck->track[j];
+
+		gcmp_const_put_u64 ( buf, tr->a );
+		gcmp_const_put_u64 ( buf, tr->b );
+		gcmp_const_put_u64 ( buf, tr->next );
+		gcmp_const_put_u64 ( buf, tr->n );
+
+		for ( k = 0; k < tr->n; k++ )
+		{
+			gcmp_const_put_u64 ( buf, tr->part[k].a );
+			gcmp_const_put_u64 ( buf, tr->part[k].b );
+			gcmp_const_put_u64 ( buf, tr->part[k].depth );
+
+			gcmp_const_put_split ( ck, buf, &tr->part[k].r );
+		}
+	}
+
+	g_mutex_lock ( &ck->mutex );
+
+	if ( ck->pending ) g_byte_array_unref ( ck->pending );
+	ck->pending = buf;
+
+	if ( !ck->thread ) ck->thread = g_thread_new ( "gcmp-ckpt", (GThreadFunc)gcmp_const_ckpt_thread, ck );
+
+	g_cond_signal ( &ck->cond );
+	g_mutex_unlock ( &ck->mutex );
+
+	ck->time = g_get_monotonic_time ();
+}
+
+/* Done: the file goes. Cancelled: the state so far is written, to go on from later */
+static void gcmp_const_ckpt_close ( Ckpt *ck, gboolean done )
+{
+	if ( !done ) gcmp_const_ckpt_save ( ck );
+
+	g_mutex_lock ( &ck->mutex );
+
+	if ( done && ck->pending ) { g_byte_array_unref ( ck->pending ); ck->pending = NULL; }
+
+	ck->stop = TRUE;
+
+	g_cond_signal ( &ck->cond );
+	g_mutex_unlock ( &ck->mutex );
+
+	if ( ck->thread ) g_thread_join ( ck->thread );
+
+	if ( done ) g_remove ( ck->path );
+
+	Series s = { ck->mt, 0, ck->harm, 0, NULL };
+
+	uint8_t j = 0;
+	for ( j = 0; j < ck->n_track; j++ ) gcmp_const_track_clear ( &s, &ck->track[j] );
+
+	g_mutex_clear ( &ck->mutex );
+	g_cond_clear ( &ck->cond );
+
+	g_free ( ck->path );
+	g_free ( ck );
+}
+
+/* The nodes at some depth one by one, each on the pool as a tree of its own; the merges are the tree's, so the value is the same */
+static void gcmp_const_track_run ( const Series *s, Ckpt *ck, Track *tr )
+{
+	uint8_t depth = gcmp_const_track_depth ( tr );
+
+	while ( tr->next < tr->b && !gcmp_const_cancelled ( s ) )
+	{
+		ulong a = 0, b = 0;
+		gcmp_const_track_node ( tr, depth, tr->next, &a, &b );
+
+		Part *pt = &tr->part[tr->n];
+		pt->a = a; pt->b = b; pt->depth = depth;
+
+		gcmp_const_split_init ( s, &pt->r );
+		gcmp_const_split ( s, a, b, &pt->r, ( b != tr->b ), 0 );
+
+		if ( gcmp_const_cancelled ( s ) ) { gcmp_const_split_clear ( s, &pt->r ); break; }
+
+		tr->n++;
+		tr->next = b;
+
+		while ( tr->n >= 2 && gcmp_const_siblings ( &tr->part[tr->n - 2], &tr->part[tr->n - 1] ) )
+		{
+			Part *l = &tr->part[tr->n - 2], *h = &tr->part[tr->n - 1];
+
+			Split r;
+			gcmp_const_split_init ( s, &r );
+			gcmp_const_merge ( s, &r, &l->r, &h->r, ( h->b != tr->b ) );
+
+			gcmp_const_split_clear ( s, &l->r );
+			gcmp_const_split_clear ( s, &h->r );
+
+			l->r = r;
+			l->b = h->b;
+			l->depth--;
+			tr->n--;
+
+			if ( s->prog ) g_atomic_int_add ( &s->prog->done, (gint)( l->b - l->a ) );
+		}
+
+		if ( g_get_monotonic_time () - ck->time >= CKPT_PERIOD ) gcmp_const_ckpt_save ( ck );
+	}
+}
+
+/* Terms a .. b - 1 of series idx, in one tree or, with a checkpoint, node by node from where it stopped */
+static void gcmp_const_series_run ( const Series *s, ulong a, ulong b, Split *r, Ckpt *ck, uint8_t idx )
+{
+	if ( !ck ) { gcmp_const_split ( s, a, b, r, FALSE, 0 ); return; }
+
+	Track *tr = &ck->track[idx];
+
+	if ( idx >= ck->n_track || tr->a != a || tr->b != b )
+	{
+		if ( idx < ck->n_track ) gcmp_const_track_clear ( s, tr );
+
+		*tr = (Track){ a, b, a, { { 0 } }, 0 };
+	}
+
+	ck->n_track = MAX ( ck->n_track, idx + 1 );
+
+	uint8_t j = 0;
+	for ( j = 0; s->prog && j < tr->n; j++ ) g_atomic_int_add ( &s->prog->done, (gint)MIN ( gcmp_const_total ( tr->part[j].b - tr->part[j].a ), G_MAXINT ) );
+
+	gcmp_const_track_run ( s, ck, tr );
+
+	if ( gcmp_const_cancelled ( s ) ) return;
+
+	const Split *t = &tr->part[0].r;
+
+	mpz_set ( r->p, t->p );
+	mpz_set ( r->q, t->q );
+	mpz_set ( r->t, t->t );
+
+	if ( !s->harm ) return;
+
+	mpz_set ( r->c, t->c );
+	mpz_set ( r->d, t->d );
+	mpz_set ( r->v, t->v );
+}
+
+typedef struct _Atanh Atanh;
+
+struct _Atanh
+{
+	Series s;
+	ulong n;
+
+	Split r;
+};
+
+static void gcmp_const_atanh_task ( gpointer data )
+{
+	Atanh *at = data;
+
+	gcmp_const_split ( &at->s, 0, at->n, &at->r, FALSE, 0 );
+}
+
+/* num / den, rounded to the precision of x */
+static void gcmp_const_set_q ( mpfr_t x, mpz_srcptr num, mpz_srcptr den )
+{
+	mpfr_t a, b;
+	mpfr_inits2 ( mpfr_get_prec ( x ), a, b, NULL );
+
+	mpfr_set_z ( a, num, MPFR_RNDN );
+	mpfr_set_z ( b, den, MPFR_RNDN );
+
+	gcmp_ntt_div ( x, a, b, MPFR_RNDN );
+
+	mpfr_clears ( a, b, NULL );
+}
+
+static void gcmp_const_progress_set ( GcmpConstProgress *prog, double total )
+{
+	if ( !prog ) return;
+
+	g_atomic_int_set ( &prog->done, 0 );
+	g_atomic_int_set ( &prog->total, (gint)MIN ( total, G_MAXINT ) );
+}
+
+static gboolean gcmp_const_pi ( mpfr_t x, GcmpConstProgress *prog, Ckpt *ck )
+{
+	// 47.11 bits a term
+	ulong n = (ulong)( (double)mpfr_get_prec ( x ) / 47.11 ) + 2;
+
+	Series s;
+	gcmp_const_series_init ( &s, CPI, 0, prog );
+	gcmp_const_progress_set ( prog, gcmp_const_total ( n ) );
+
+	Split r;
+	gcmp_const_split_init ( &s, &r );
+	gcmp_const_series_run ( &s, 0, n, &r, ck, 0 );
+
+	gboolean ok = !gcmp_const_cancelled ( &s );
+
+	// pi = 426880 sqrt ( 10005 ) Q / T
+	if ( ok )
+	{
+		mpfr_t a;
+		mpfr_init2 ( a, mpfr_get_prec ( x ) );
+
+		gcmp_const_set_q ( x, r.q, r.t );
+
+		mpfr_sqrt_ui ( a, 10005, MPFR_RNDN );
+		mpfr_mul_ui ( a, a, 426880, MPFR_RNDN );
+
+		gcmp_ntt_mul ( x, x, a, MPFR_RNDN );
+
+		mpfr_clear ( a );
+	}
+
+	gcmp_const_split_clear ( &s, &r );
+
+	return ok;
+}
+
+static gboolean gcmp_const_e ( mpfr_t x, GcmpConstProgress *prog, Ckpt *ck )
+{
+	// log2 ( n! ) past the precision
+	ulong n = 1;
+	double bits = 0;
+
+	while ( bits < (double)mpfr_get_prec ( x ) + 8 ) bits += log2 ( (double)++n );
+
+	Series s;
+	gcmp_const_series_init ( &s, CEX, 0, prog );
+	gcmp_const_progress_set ( prog, gcmp_const_total ( n ) );
+
+	Split r;
+	gcmp_const_split_init ( &s, &r );
+	gcmp_const_series_run ( &s, 1, n + 1, &r, ck, 0 );
+
+	gboolean ok = !gcmp_const_cancelled ( &s );
+
+	// e = 1 + T / Q
+	if ( ok )
+	{
+		gcmp_const_set_q ( x, r.t, r.q );
+		mpfr_add_ui ( x, x, 1, MPFR_RNDN );
+	}
+
+	gcmp_const_split_clear ( &s, &r );
+
+	return ok;
+}
+
+/* ln 2 = 18 atanh ( 1 / 26 ) - 2 atanh ( 1 / 4801 ) + 8 atanh ( 1 / 8749 ): the three series at once */
+static gboolean gcmp_const_ln2 ( mpfr_t x, GcmpConstProgress *prog, Ckpt *ck )
+{
+	const ulong m[3] = { 26, 4801, 8749 };
+	const long coef[3] = { 18, -2, 8 };
+
+	Atanh at[3];
+	double total = 0;
+
+	uint8_t j = 0;
+	for ( j = 0; j < 3; j++ )
+	{
+		at[j].n = (ulong)( (double)mpfr_get_prec ( x ) / ( 2 * log2 ( (double)m[j] ) ) ) + 2;
+		total += gcmp_const_total ( at[j].n );
+
+		gcmp_const_series_init ( &at[j].s, CL2, m[j], prog );
+		gcmp_const_split_init ( &at[j].s, &at[j].r );
+	}
+
+	gcmp_const_progress_set ( prog, total );
+
+	// With a checkpoint one after another, each on the pool node by node
+	if ( ck )
+	{
+		for ( j = 0; j < 3; j++ ) gcmp_const_series_run ( &at[j].s, 0, at[j].n, &at[j].r, ck, j );
+	}
+	else
+	{
+		GcmpPoolGroup group = { 0 };
+
+		for ( j = 1; j < 3; j++ ) gcmp_pool_spawn ( &group, gcmp_const_atanh_task, &at[j] );
+
+		gcmp_const_atanh_task ( &at[0] );
+		gcmp_pool_wait ( &group );
+	}
+
+	gboolean ok = !gcmp_const_cancelled ( &at[0].s );
+
+	if ( ok )
+	{
+		mpfr_t a;
+		mpfr_init2 ( a, mpfr_get_prec ( x ) );
+
+		mpfr_set_ui ( x, 0, MPFR_RNDN );
+
+		for ( j = 0; j < 3; j++ )
+		{
+			gcmp_const_set_q ( a, at[j].r.t, at[j].r.q );
+
+			mpfr_mul_si ( a, a, coef[j], MPFR_RNDN );
+			mpfr_div_ui ( a, a, m[j], MPFR_RNDN );
+
+			mpfr_add ( x, x, a, MPFR_RNDN );
+		}
+
+		mpfr_clear ( a );
+	}
+
+	for ( j = 0; j < 3; j++ ) gcmp_const_split_clear ( &at[j].s, &at[j].r );
+
+	return ok;
+}
+
+/* Brent and McMillan: gamma = A / B - ln n, off by less than pi e^-4n; A and B summed to k = 3.5911 n */
+static gboolean gcmp_const_gamma ( mpfr_t x, GcmpConstProgress *prog, Ckpt *ck )
+{
+	ulong n = (ulong)( ( (double)mpfr_get_prec ( x ) + 4 ) * M_LN2 / 4 ) + 1;
+	ulong k = (ulong)( 3.5911 * (double)n ) + 2;
+
+	Series s;
+	gcmp_const_series_init ( &s, CEU, n, prog );
+	gcmp_const_progress_set ( prog, gcmp_const_total ( k ) );
+
+	Split r;
+	gcmp_const_split_init ( &s, &r );
+	gcmp_const_series_run ( &s, 1, k + 1, &r, ck, 0 );
+
+	gboolean ok = !gcmp_const_cancelled ( &s );
+
+	// B = 1 + T / Q, A = V / ( D Q ): A / B = V / ( D ( Q + T ) )
+	if ( ok )
+	{
+		mpz_add ( r.q, r.q, r.t );
+		gcmp_ntt_mul_z ( r.t, r.d, r.q );
+
+		gcmp_const_set_q ( x, r.v, r.t );
+
+		mpfr_t a;
+		mpfr_init2 ( a, mpfr_get_prec ( x ) );
+
+		mpfr_log_ui ( a, n, MPFR_RNDN );
+		mpfr_sub ( x, x, a, MPFR_RNDN );
+
+		mpfr_clear ( a );
+	}
+
+	gcmp_const_split_clear ( &s, &r );
+
+	return ok;
+}
+
+static uint8_t gcmp_const_slot ( enum math_ext mt )
+{
+	return ( mt == CPI ) ? 0 : ( mt == CEX ) ? 1 : ( mt == CL2 ) ? 2 : 3;
+}
+
+static int gcmp_const_mpfr ( enum math_ext mt, mpfr_t res, mpfr_rnd_t rnd )
+{
+	if ( mt == CPI ) return mpfr_const_pi ( res, rnd );
+	if ( mt == CL2 ) return mpfr_const_log2 ( res, rnd );
+	if ( mt == CEU ) return mpfr_const_euler ( res, rnd );
+
+	mpfr_t one;
+	mpfr_init2 ( one, 2 );
+	mpfr_set_ui ( one, 1, MPFR_RNDN );
+
+	int ret = mpfr_exp ( res, one, rnd );
+
+	mpfr_clear ( one );
+
+	return ret;
+}
+
+/* The kept value, if good enough for this precision and rounding */
+static gboolean gcmp_const_cached ( enum math_ext mt, mpfr_t res, mpfr_rnd_t rnd )
+{
+	Cache *c = &cache[gcmp_const_slot ( mt )];
+	mpfr_prec_t prec = mpfr_get_prec ( res );
+
+	g_mutex_lock ( &cache_mutex );
+
+	gboolean ok = ( c->set && mpfr_can_round ( c->val, mpfr_get_prec ( c->val ) - ERR_BITS, MPFR_RNDN, MPFR_RNDZ, prec + ( rnd == MPFR_RNDN ) ) );
+
+	if ( ok ) mpfr_set ( res, c->val, rnd );
+
+	g_mutex_unlock ( &cache_mutex );
+
+	return ok;
+}
+
+static void gcmp_const_keep ( enum math_ext mt, mpfr_t x )
+{
+	Cache *c = &cache[gcmp_const_slot ( mt )];
+
+	g_mutex_lock ( &cache_mutex );
+
+	if ( !c->set ) { mpfr_init2 ( c->val, mpfr_get_prec ( x ) ); c->set = TRUE; }
+
+	if ( mpfr_get_prec ( x ) >= mpfr_get_prec ( c->val ) ) { mpfr_set_prec ( c->val, mpfr_get_prec ( x ) ); mpfr_set ( c->val, x, MPFR_RNDN ); }
+
+	g_mutex_unlock ( &cache_mutex );
+}
+
+static gboolean gcmp_const_run_path ( enum math_ext mt, mpfr_t res, mpfr_rnd_t rnd, GcmpConstProgress *prog, const char *path )
+{
+	mpfr_prec_t prec = mpfr_get_prec ( res );
+
+	// Gamma's splitting does more products than MPFR's: worth it on more than one core
+	if ( prec < CONST_MIN_BITS || ( mt == CEU && !gcmp_pool_get_workers () ) ) { gcmp_const_mpfr ( mt, res, rnd ); return TRUE; }
+
+	if ( gcmp_const_cached ( mt, res, rnd ) ) return TRUE;
+
+	mpfr_prec_t wp = prec + 64;
+
+	mpfr_t x;
+	mpfr_init2 ( x, wp );
+
+	gboolean ok = TRUE;
+
+	// Ziv: once in a while the value sits too close to a rounding boundary
+	while ( ok )
+	{
+		Ckpt *ck = ( path ) ? gcmp_const_ckpt_open ( path, mt, prec, wp ) : NULL;
+
+		if ( mt == CPI ) ok = gcmp_const_pi ( x, prog, ck );
+		if ( mt == CEX ) ok = gcmp_const_e ( x, prog, ck );
+		if ( mt == CL2 ) ok = gcmp_const_ln2 ( x, prog, ck );
+		if ( mt == CEU ) ok = gcmp_const_gamma ( x, prog, ck );
+
+		if ( ck ) gcmp_const_ckpt_close ( ck, ok );
+
+		if ( ok && mpfr_can_round ( x, wp - ERR_BITS, MPFR_RNDN, MPFR_RNDZ, prec + ( rnd == MPFR_RNDN ) ) ) break;
+
+		wp += 64;
+		mpfr_set_prec ( x, wp );
+	}
+
+	if ( ok ) { mpfr_set ( res, x, rnd ); gcmp_const_keep ( mt, x ); }
+
+	mpfr_clear ( x );
+
+	return ok;
+}
+
+gboolean gcmp_const_run ( enum math_ext mt, mpfr_t res, mpfr_rnd_t rnd, GcmpConstProgress *prog )
+{
+	return gcmp_const_run_path ( mt, res, rnd, prog, NULL );
+}
+
+static const char * gcmp_const_name ( enum math_ext mt )
+{
+	return ( mt == CPI ) ? "pi" : ( mt == CEX ) ? "e" : ( mt == CL2 ) ? "ln2" : "gamma";
+}
+
+gboolean gcmp_const_run_ckpt ( enum math_ext mt, mpfr_t res, mpfr_rnd_t rnd, GcmpConstProgress *prog, const char *path )
+{
+	g_autofree char *name = g_strdup_printf ( "%s-%ld.ckpt", gcmp_const_name ( mt ), (long)mpfr_get_prec ( res ) );
+	g_autofree char *def  = g_build_filename ( g_get_user_cache_dir (), "gcmp", name, NULL );
+
+	return gcmp_const_run_path ( mt, res, rnd, prog, ( path ) ? path : def );
+}
+
+gboolean gcmp_const_ckpt_info ( const char *path, enum math_ext *mt, mpfr_prec_t *prec )
+{
+	FILE *file = g_fopen ( path, "rb" );
+
+	if ( !file ) return FALSE;
+
+	uint8_t head[sizeof ( ckpt_magic ) + 16];
+	gboolean ok = ( fread ( head, 1, sizeof ( head ), file ) == sizeof ( head ) && memcmp ( head, ckpt_magic, sizeof ( ckpt_magic ) ) == 0 );
+
+	fclose ( file );
+
+	if ( !ok ) return FALSE;
+
+	Reader rd = { head + sizeof ( ckpt_magic ), head + sizeof ( head ) };
+	uint64_t m = 0, p = 0;
+
+	gcmp_const_get_u64 ( &rd, &m );
+	gcmp_const_get_u64 ( &rd, &p );
+
+	if ( m != CPI && m != CEX && m != CL2 && m != CEU ) return FALSE;
+
+	*mt   = (enum math_ext)m;
+	*prec = (mpfr_prec_t)p;
+
+	return ( p >= MPFR_PREC_MIN && p <= MPFR_PREC_MAX );
+}
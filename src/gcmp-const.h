@@ -0,0 +1,43 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+/*
+* Constants by binary splitting, the split tree and its big products on the pool:
+* pi ( Chudnovsky ), e, ln 2 ( three atanh series ) and Euler's gamma ( Brent-McMillan ).
+* Small precisions are MPFR's own; the last big value of each is kept for the next call.
+*/
+
+typedef struct _GcmpConstProgress GcmpConstProgress;
+
+/* Shared with a watching thread ( atomic ): done runs up to total, cancel stops the run */
+struct _GcmpConstProgress
+{
+	gint done;
+	gint total;
+	gint cancel;
+};
+
+/* CPI, CEX, CL2 or CEU, correctly rounded; FALSE if cancelled. Progress may be NULL */
+gboolean gcmp_const_run ( enum math_ext, mpfr_t, mpfr_rnd_t, GcmpConstProgress * );
+
+/*
+* As above, with a checkpoint: the series' state goes to the file every half minute ( written on a thread of its own )
+* and is read back to go on from there. The file goes once done and stays if cancelled. NULL is one per constant
+* and precision in the user's cache directory
+*/
+gboolean gcmp_const_run_ckpt ( enum math_ext, mpfr_t, mpfr_rnd_t, GcmpConstProgress *, const char * );
+
+/* The constant and precision a checkpoint is of */
+gboolean gcmp_const_ckpt_info ( const char *, enum math_ext *, mpfr_prec_t * );
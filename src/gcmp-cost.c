@@ -0,0 +1,104 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-cost.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static double limit_time  = 60;
+static double limit_bytes = 2048.0 * 1024 * 1024;
+
+/* Per thread, as evaluations are */
+static __thread gboolean refused = FALSE;
+
+static void gcmp_cost_env_apply ( void )
+{
+	const char *env = g_getenv ( "GCMP_LIMIT" );
+
+	double sec = 0, mb = 0;
+	int n = ( env ) ? sscanf ( env, "%lf:%lf", &sec, &mb ) : 0;
+
+	if ( n >= 1 && sec > 0 ) limit_time  = sec;
+	if ( n == 2 && mb  > 0 ) limit_bytes = mb * 1024 * 1024;
+}
+
+static void gcmp_cost_env ( void )
+{
+	static gsize once = 0;
+
+	if ( !g_once_init_enter ( &once ) ) return;
+
+	gcmp_cost_env_apply ();
+
+	g_once_init_leave ( &once, 1 );
+}
+
+double gcmp_cost_mul ( mpfr_prec_t bits )
+{
+	double p = MAX ( 1.0, (double)bits / 64.0 );
+
+	return pow ( p, 1.585 );
+}
+
+double gcmp_cost_fn ( mpfr_prec_t bits )
+{
+	double p = MAX ( 1.0, (double)bits / 64.0 );
+
+	return 30 * gcmp_cost_mul ( bits ) * log2 ( p + 1 );
+}
+
+void gcmp_cost_set_limit ( double sec, double bytes )
+{
+	limit_time  = sec;
+	limit_bytes = bytes;
+
+	gcmp_cost_env_apply ();
+}
+
+gboolean gcmp_cost_admit ( double products, double bytes )
+{
+	gcmp_cost_env ();
+
+	if ( products <= limit_time * COST_RATE && bytes <= limit_bytes ) return TRUE;
+
+	refused = TRUE;
+
+	return FALSE;
+}
+
+gboolean gcmp_cost_take_refused ( void )
+{
+	gboolean ret = refused;
+
+	refused = FALSE;
+
+	return ret;
+}
+
+void gcmp_cost_set_refused ( void )
+{
+	refused = TRUE;
+}
+
+gboolean gcmp_cost_admit_sct ( mpfr_srcptr x, mpfr_prec_t prec )
+{
+	if ( !mpfr_regular_p ( x ) || mpfr_get_exp ( x ) <= prec ) return TRUE;
+
+	// Pi to the exponent's bits and the precision's, some eight values of that size alive at once
+	mpfr_prec_t bits = (mpfr_prec_t)mpfr_get_exp ( x ) + prec;
+
+	return gcmp_cost_admit ( gcmp_cost_fn ( bits ), (double)bits );
+}
+
+gboolean gcmp_cost_fac_by_gamma ( unsigned long n, mpfr_prec_t prec )
+{
+	// One product of the precision per factor
+	return ( (double)n * gcmp_cost_mul ( prec ) > gcmp_cost_fn ( prec ) );
+}
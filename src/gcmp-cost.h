@@ -0,0 +1,47 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <mpfr.h>
+#include <glib.h>
+
+/*
+* Cost model and admission: time in products of 64 bits ( a product of p limbs is p^1.585 of them, Karatsuba ),
+* memory in bytes, estimated from the operands' size and the precision before an operation runs.
+* What is over the limits is refused: the operation gives nan and the thread is flagged; a pool task's flag goes to its spawner.
+* Limits: GCMP_LIMIT=SECONDS[:MB] in the environment, else those set, else 60 s and 2048 MB.
+*/
+
+/* Products of 64 bits per second, about */
+#define COST_RATE 4e8
+
+double gcmp_cost_mul ( mpfr_prec_t );
+
+/* An elementary function: some 30 log p products */
+double gcmp_cost_fn ( mpfr_prec_t );
+
+/* Seconds and bytes; GCMP_LIMIT still wins */
+void gcmp_cost_set_limit ( double, double );
+
+/* FALSE, and the thread flagged, if over a limit */
+gboolean gcmp_cost_admit ( double, double );
+
+/* The flag of this thread, cleared: taken before an evaluation and after, a nan it gives with the flag set was refused */
+gboolean gcmp_cost_take_refused ( void );
+
+/* Flags this thread: a refusal passed on ( gcmp-pool.c ) */
+void gcmp_cost_set_refused ( void );
+
+/* Sine, cosine, tangent: reducing the argument needs pi to its exponent's bits as well */
+gboolean gcmp_cost_admit_sct ( mpfr_srcptr, mpfr_prec_t );
+
+/* n! by products ( mpfr_fac_ui ) costs more than by the gamma function */
+gboolean gcmp_cost_fac_by_gamma ( unsigned long, mpfr_prec_t );
@@ -0,0 +1,271 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-digits.h"
+
+#include <string.h>
+
+/*
+* The digits are one integer split in halves down to blocks ( divide and conquer ).
+* Only the path to the last block is kept: a neighbouring block costs a small division,
+* a far one a few larger ones, and the full string is never built.
+*/
+#define BLOCK_DIGITS 4096
+#define BLOCK_CACHE 8
+#define DEPTH_MAX 32
+
+typedef struct _Node Node;
+
+struct _Node
+{
+	uint32_t l, r;
+	mpz_t val;
+
+	gboolean valid;
+};
+
+typedef struct _Block Block;
+
+struct _Block
+{
+	uint32_t num;
+	char *str;
+};
+
+struct _GcmpDigits
+{
+	uint32_t len;
+	long exp;
+	gboolean neg;
+
+	uint8_t depth;
+	uint32_t n_blocks;
+	Node path[DEPTH_MAX];
+
+	GHashTable *pows;
+
+	Block cache[BLOCK_CACHE];
+	uint8_t cache_next;
+};
+
+static uint32_t gcmp_digits_end ( GcmpDigits *digits, uint32_t block )
+{
+	return (uint32_t)MIN ( (uint64_t)block * BLOCK_DIGITS, digits->len );
+}
+
+static mpz_ptr gcmp_digits_pow ( GcmpDigits *digits, uint32_t n )
+{
+	mpz_ptr pow = g_hash_table_lookup ( digits->pows, GUINT_TO_POINTER ( n ) );
+
+	if ( pow ) return pow;
+
+	pow = g_new ( __mpz_struct, 1 );
+	mpz_init ( pow );
+	mpz_ui_pow_ui ( pow, 10, n );
+
+	g_hash_table_insert ( digits->pows, GUINT_TO_POINTER ( n ), pow );
+
+	return pow;
+}
+
+/*
+* ⌊ x × 10^shift ⌋ for x >= 0: 10^shift is 5^shift × 2^shift, the power of two exact, so nothing past the precision's size is built.
+* Bounded from below and above; the precision grows while the two floors differ ( only near an integer ).
+*/
+static void gcmp_digits_scale ( mpz_t res, mpfr_srcptr x, long shift, mpfr_prec_t prec )
+{
+	unsigned long e = ( shift < 0 ) ? 0ul - (unsigned long)shift : (unsigned long)shift;
+
+	mpz_t hi;
+	mpz_init ( hi );
+
+	mpfr_t p, t;
+	mpfr_init2 ( p, prec );
+	mpfr_init2 ( t, prec );
+
+	while ( TRUE )
+	{
+		uint8_t j = 0;
+		for ( j = 0; j < 2; j++ )
+		{
+			mpfr_rnd_t rnd = ( j ) ? MPFR_RNDU : MPFR_RNDD, inv = ( j ) ? MPFR_RNDD : MPFR_RNDU;
+
+			mpfr_ui_pow_ui ( p, 5, e, ( shift >= 0 ) ? rnd : inv );
+
+			if ( shift >= 0 ) mpfr_mul ( t, x, p, rnd ); else mpfr_div ( t, x, p, rnd );
+
+			mpfr_mul_2si ( t, t, shift, rnd );
+			mpfr_get_z ( ( j ) ? hi : res, t, MPFR_RNDD );
+		}
+
+		if ( mpz_cmp ( res, hi ) == 0 ) break;
+
+		prec += prec / 2;
+		mpfr_set_prec ( p, prec );
+		mpfr_set_prec ( t, prec );
+	}
+
+	mpfr_clear ( p );
+	mpfr_clear ( t );
+	mpz_clear ( hi );
+}
+
+static void gcmp_digits_pow_free ( mpz_ptr pow )
+{
+	mpz_clear ( pow );
+	g_free ( pow );
+}
+
+static void gcmp_digits_split ( GcmpDigits *digits, uint8_t d, uint32_t block )
+{
+	Node *node = &digits->path[d], *child = &digits->path[d+1];
+
+	uint32_t m = node->l + ( node->r - node->l ) / 2;
+	uint32_t lo_len = gcmp_digits_end ( digits, node->r ) - gcmp_digits_end ( digits, m );
+
+	if ( block < m )
+	{
+		child->l = node->l; child->r = m;
+
+		if ( lo_len )
+			mpz_tdiv_q ( child->val, node->val, gcmp_digits_pow ( digits, lo_len ) );
+		else
+			mpz_set ( child->val, node->val );
+	}
+	else
+	{
+		child->l = m; child->r = node->r;
+
+		mpz_tdiv_r ( child->val, node->val, gcmp_digits_pow ( digits, lo_len ) );
+	}
+
+	child->valid = TRUE;
+}
+
+static const char * gcmp_digits_block ( GcmpDigits *digits, uint32_t block )
+{
+	uint8_t j = 0;
+
+	for ( j = 0; j < BLOCK_CACHE; j++ )
+		if ( digits->cache[j].str && digits->cache[j].num == block ) return digits->cache[j].str;
+
+	// Deepest kept node holding the block, then down to the leaf
+	uint8_t d = 0;
+	while ( d < digits->depth && digits->path[d+1].valid && block >= digits->path[d+1].l && block < digits->path[d+1].r ) d++;
+
+	for ( ; d < digits->depth; d++ ) gcmp_digits_split ( digits, d, block );
+
+	Block *bl = &digits->cache[digits->cache_next];
+	digits->cache_next = ( digits->cache_next + 1 ) % BLOCK_CACHE;
+
+	if ( !bl->str ) bl->str = g_malloc ( BLOCK_DIGITS + 2 );
+
+	bl->num = block;
+
+	// Leading zeros are digits too
+	size_t len = gcmp_digits_end ( digits, block + 1 ) - gcmp_digits_end ( digits, block );
+
+	mpz_get_str ( bl->str, 10, digits->path[digits->depth].val );
+	size_t n = strlen ( bl->str );
+
+	memmove ( bl->str + len - n, bl->str, n + 1 );
+	memset ( bl->str, '0', len - n );
+
+	return bl->str;
+}
+
+uint32_t gcmp_digits_get ( GcmpDigits *digits, uint32_t pos, uint32_t n, char *out )
+{
+	uint32_t done = 0;
+
+	while ( done < n && pos + done < digits->len )
+	{
+		uint32_t at = pos + done;
+		uint32_t block = at / BLOCK_DIGITS, off = at % BLOCK_DIGITS;
+
+		const char *str = gcmp_digits_block ( digits, block );
+		uint32_t avail = gcmp_digits_end ( digits, block + 1 ) - at;
+		uint32_t take = MIN ( avail, n - done );
+
+		memcpy ( out + done, str + off, take );
+		done += take;
+	}
+
+	out[done] = '\0';
+
+	return done;
+}
+
+uint32_t gcmp_digits_get_len ( GcmpDigits *digits )
+{
+	return digits->len;
+}
+
+long gcmp_digits_get_exp ( GcmpDigits *digits )
+{
+	return digits->exp;
+}
+
+gboolean gcmp_digits_is_neg ( GcmpDigits *digits )
+{
+	return digits->neg;
+}
+
+GcmpDigits * gcmp_digits_new ( mpfr_t val, uint32_t n_digits )
+{
+	GcmpDigits *digits = g_new0 ( GcmpDigits, 1 );
+
+	digits->pows = g_hash_table_new_full ( g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)gcmp_digits_pow_free );
+
+	uint8_t d = 0;
+	for ( d = 0; d < DEPTH_MAX; d++ ) mpz_init ( digits->path[d].val );
+
+	digits->neg = mpfr_signbit ( val ) ? TRUE : FALSE;
+
+	// Inf and nan have no digits
+	if ( !mpfr_number_p ( val ) || n_digits == 0 ) return digits;
+
+	digits->len = n_digits;
+	digits->n_blocks = ( n_digits + BLOCK_DIGITS - 1 ) / BLOCK_DIGITS;
+
+	while ( ( 1u << digits->depth ) < digits->n_blocks ) digits->depth++;
+
+	Node *root = &digits->path[0];
+	root->l = 0; root->r = 1u << digits->depth; root->valid = TRUE;
+
+	if ( mpfr_zero_p ( val ) ) return digits;
+
+	mpfr_t abs;
+	mpfr_init2 ( abs, mpfr_get_prec ( val ) );
+	mpfr_abs ( abs, val, MPFR_RNDN );
+
+	// Rounding down keeps the exponent: 10^( exp - 1 ) <= |val| < 10^exp
+	mpfr_exp_t exp = 0;
+	mpfr_free_str ( mpfr_get_str ( NULL, &exp, 10, 2, abs, MPFR_RNDD ) );
+	digits->exp = exp;
+
+	// All the digits as one integer: |val| × 10^( n - exp )
+	gcmp_digits_scale ( root->val, abs, (long)n_digits - exp, (mpfr_prec_t)n_digits * 4 + 64 );
+
+	mpfr_clear ( abs );
+
+	return digits;
+}
+
+void gcmp_digits_free ( GcmpDigits *digits )
+{
+	uint8_t j = 0;
+
+	for ( j = 0; j < DEPTH_MAX; j++ ) mpz_clear ( digits->path[j].val );
+	for ( j = 0; j < BLOCK_CACHE; j++ ) g_free ( digits->cache[j].str );
+
+	g_hash_table_destroy ( digits->pows );
+
+	g_free ( digits );
+}
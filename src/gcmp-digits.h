@@ -0,0 +1,31 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+/* Decimal digits of a value, formatted on demand: value = ±0.d1 d2 ... dN × 10^exp */
+typedef struct _GcmpDigits GcmpDigits;
+
+GcmpDigits * gcmp_digits_new ( mpfr_t, uint32_t );
+
+void gcmp_digits_free ( GcmpDigits * );
+
+uint32_t gcmp_digits_get_len ( GcmpDigits * );
+
+long gcmp_digits_get_exp ( GcmpDigits * );
+
+gboolean gcmp_digits_is_neg ( GcmpDigits * );
+
+/* Digits [ pos, pos + n ) ( 0 based ) into the buffer, NUL terminated; returns the count written */
+uint32_t gcmp_digits_get ( GcmpDigits *, uint32_t, uint32_t, char * );
+
@@ -8,6 +8,13 @@
 */
 
 #include "gcmp-entry.h"
+#include "gcmp-gap.h"
+#include "gcmp-index.h"
+#include "gcmp-radix.h"
+#include "gcmp-vars.h"
+
+/* Search results shown at most */
+#define MAX_FOUND 500
 
 enum cols
 {
@@ -16,45 +23,198 @@ enum cols
 	NUM_COLS
 };
 
+enum store_cols
+{
+	COL_NREC,
+	NUM_STORE_COLS
+};
+
+typedef struct _Bind Bind;
+
+/* A span of the text, in characters, that shows a value held in full: a result, a history row, a loaded operand */
+struct _Bind
+{
+	uint32_t start;
+	uint32_t end;
+
+	mpfr_t val;
+};
+
 struct _GcmpEntry
 {
 	GtkBox parent_instance;
 
 	GtkEntry *entry;
+	GcmpGap *gap;
+	GArray *binds;
 	GtkTreeView *treeview;
+	GtkListStore *store;
 	GtkPopover *popover_edit;
 
+	GcmpIndex *index;
+	GcmpSheet *sheet;
+	GcmpHistory *history;
+	gboolean history_load;
+
+	// Rows of the shared history in the list and in the index so far
+	uint32_t n_loaded;
+	uint32_t n_indexed;
+
+	uint8_t base;
+
+	// The last edit was an insert: a delete leaves nothing new to check
+	gboolean typed;
+
 	ulong entry_signal_id;
 };
 
 G_DEFINE_TYPE ( GcmpEntry, gcmp_entry, GTK_TYPE_BOX )
 
-static void gcmp_entry_treeview_append ( const char *data, const char *res, GcmpEntry *entry );
+static void gcmp_entry_treeview_append ( const char *data, const char *res, mpfr_srcptr val, GcmpEntry *entry );
 
 static char * gcmp_entry_get_text ( GcmpEntry *entry )
 {
-	return g_strdup ( gtk_entry_get_text ( entry->entry ) );
+	return gcmp_gap_get_text ( entry->gap );
 }
 
-static void gcmp_entry_set_text ( GcmpEntry *entry, const char *text, gboolean add )
+/* A bound span stands for its value only while nothing joins it into a longer number */
+static gboolean gcmp_entry_alone ( const char *text, const char *start, const char *end )
 {
-	const char *old_text = gtk_entry_get_text ( entry->entry );
+	if ( start > text && ( g_ascii_isalnum ( start[-1] ) || start[-1] == '.' || start[-1] == '@' ) ) return FALSE;
+
+	return !( g_ascii_isalnum ( *end ) || *end == '.' || *end == '@' );
+}
+
+/* The text compiled, each bound span read as its value ( #k ); NULL if it does not parse */
+static gpointer gcmp_entry_get_eval ( GcmpEntry *entry )
+{
+	g_autofree char *text = gcmp_gap_get_text ( entry->gap );
+
+	GString *expr = g_string_new ( NULL );
+	GPtrArray *vals = g_ptr_array_new ();
+
+	const char *copied = text, *cur = text;
+	uint32_t j = 0, pos = 0, len = gcmp_gap_get_length ( entry->gap );
 
-	if ( !add )
+	for ( j = 0; j < entry->binds->len; j++ )
 	{
-		gcmp_entry_treeview_append ( old_text, text, entry );
+		Bind *bind = &g_array_index ( entry->binds, Bind, j );
 
-		gtk_entry_set_text ( entry->entry, text );
+		if ( bind->end > len ) break;
+
+		const char *start = g_utf8_offset_to_pointer ( cur, bind->start - pos );
+		const char *end = g_utf8_offset_to_pointer ( start, bind->end - bind->start );
+
+		cur = end;
+		pos = bind->end;
+
+		if ( !gcmp_entry_alone ( text, start, end ) ) continue;
+
+		g_string_append_len ( expr, copied, start - copied );
+		g_string_append_printf ( expr, "#%u", vals->len );
+		g_ptr_array_add ( vals, bind->val );
+
+		copied = end;
 	}
-	else
+
+	g_string_append ( expr, copied );
+
+	GcmpEval *eval = gcmp_eval_new_bound ( expr->str, entry->base, (mpfr_srcptr *)vals->pdata, vals->len );
+
+	g_ptr_array_free ( vals, TRUE );
+	g_string_free ( expr, TRUE );
+
+	return eval;
+}
+
+static void gcmp_entry_bind_clear ( Bind *bind )
+{
+	mpfr_clear ( bind->val );
+}
+
+/* Characters [ start, end ) replaced by n: spans after move, a span the edit reaches into is only text from now */
+static void gcmp_entry_binds_edit ( GcmpEntry *entry, uint32_t start, uint32_t end, uint32_t n )
+{
+	uint32_t j = entry->binds->len;
+	while ( j-- > 0 )
 	{
-		g_autofree char *text_set = g_strdup_printf ( "%s%s", old_text, text );
+		Bind *bind = &g_array_index ( entry->binds, Bind, j );
+
+		if ( bind->start >= end ) { bind->start = bind->start - ( end - start ) + n; bind->end = bind->end - ( end - start ) + n; continue; }
 
-		gtk_entry_set_text ( entry->entry, text_set );
+		if ( bind->end > start ) g_array_remove_index ( entry->binds, j );
 	}
+}
+
+/* Every edit of the entry reaches the gap buffer first, before "changed" */
+static void gcmp_entry_insert_text ( G_GNUC_UNUSED GtkEditable *editable, const char *text, int len, int *pos, GcmpEntry *entry )
+{
+	size_t size = ( len < 0 ) ? strlen ( text ) : (size_t)len;
 
-	uint16_t len = gtk_entry_get_text_length ( entry->entry );
-	g_signal_emit_by_name ( entry->entry, "move-cursor", GTK_MOVEMENT_WORDS, len, FALSE, NULL );
+	gcmp_entry_binds_edit ( entry, (uint32_t)*pos, (uint32_t)*pos, (uint32_t)g_utf8_strlen ( text, (gssize)size ) );
+
+	gcmp_gap_insert ( entry->gap, (uint32_t)*pos, text, size );
+
+	entry->typed = TRUE;
+}
+
+static void gcmp_entry_delete_text ( G_GNUC_UNUSED GtkEditable *editable, int start, int end, GcmpEntry *entry )
+{
+	uint32_t last = ( end < 0 ) ? gcmp_gap_get_length ( entry->gap ) : (uint32_t)end;
+
+	gcmp_entry_binds_edit ( entry, (uint32_t)start, last, 0 );
+
+	gcmp_gap_delete ( entry->gap, (uint32_t)start, ( end < 0 ) ? G_MAXUINT32 : (uint32_t)end );
+
+	entry->typed = FALSE;
+}
+
+/* Inserts at a position, then puts the cursor after: only the new span goes to the widget */
+static void gcmp_entry_insert ( GcmpEntry *entry, const char *text, int pos )
+{
+	gtk_editable_insert_text ( GTK_EDITABLE ( entry->entry ), text, -1, &pos );
+	gtk_editable_set_position ( GTK_EDITABLE ( entry->entry ), pos );
+}
+
+/* The same, the text bound to the value ( NULL: none ); a sign stays text, the span is the digits */
+static void gcmp_entry_insert_value ( GcmpEntry *entry, const char *text, int pos, mpfr_srcptr val )
+{
+	gcmp_entry_insert ( entry, text, pos );
+
+	if ( !val || !text[0] ) return;
+
+	gboolean sign = ( text[0] == '-' || text[0] == '+' );
+
+	Bind bind;
+	bind.start = (uint32_t)pos + ( ( sign ) ? 1 : 0 );
+	bind.end = (uint32_t)pos + (uint32_t)g_utf8_strlen ( text, -1 );
+
+	mpfr_init2 ( bind.val, mpfr_get_prec ( val ) );
+	mpfr_set ( bind.val, val, MPFR_RNDN );
+
+	if ( text[0] == '-' ) mpfr_neg ( bind.val, bind.val, MPFR_RNDN );
+
+	// In text order
+	uint32_t j = 0;
+	while ( j < entry->binds->len && g_array_index ( entry->binds, Bind, j ).start < bind.start ) j++;
+
+	g_array_insert_val ( entry->binds, j, bind );
+}
+
+/* Add: at the cursor; else a result: the entry and its text go to the history, the text replaces them */
+static void gcmp_entry_set_value ( GcmpEntry *entry, const char *text, gpointer val, gboolean add )
+{
+	if ( add ) { gcmp_entry_insert_value ( entry, text, gtk_editable_get_position ( GTK_EDITABLE ( entry->entry ) ), val ); return; }
+
+	gcmp_entry_treeview_append ( gtk_entry_get_text ( entry->entry ), text, val, entry );
+
+	gtk_entry_set_text ( entry->entry, "" );
+	gcmp_entry_insert_value ( entry, text, 0, val );
+}
+
+static void gcmp_entry_set_text ( GcmpEntry *entry, const char *text, gboolean add )
+{
+	gcmp_entry_set_value ( entry, text, NULL, add );
 }
 
 static void gcmp_entry_clr ( GcmpEntry *entry )
@@ -62,58 +222,72 @@ static void gcmp_entry_clr ( GcmpEntry *entry )
 	gtk_entry_set_text ( entry->entry, "" );
 }
 
+/* The character before the cursor */
 static void gcmp_entry_dec ( GcmpEntry *entry )
 {
-	uint16_t len = gtk_entry_get_text_length ( entry->entry );
+	int pos = gtk_editable_get_position ( GTK_EDITABLE ( entry->entry ) );
 
-	if ( len == 0 ) return;
+	if ( pos == 0 ) return;
 
-	const char *text = gtk_entry_get_text ( entry->entry );
+	gtk_editable_delete_text ( GTK_EDITABLE ( entry->entry ), pos - 1, pos );
+}
+
+/* The character before the last edit: the one just typed */
+static void gcmp_entry_drop ( GcmpEntry *entry )
+{
+	uint32_t pos = gcmp_gap_get_pos ( entry->gap );
 
-	g_autofree char *text_set = g_strndup ( text, len - 1 );
+	if ( pos == 0 ) return;
 
-	gtk_entry_set_text ( entry->entry, text_set );
+	gtk_editable_delete_text ( GTK_EDITABLE ( entry->entry ), (int)pos - 1, (int)pos );
 }
 
 static void gcmp_entry_sgn ( GcmpEntry *entry )
 {
-	const char *text = gtk_entry_get_text ( entry->entry );
-
-	char text_set[UINT16_MAX];
-	sprintf ( text_set, "%s%s", text, "-" );
-
 	g_signal_handler_block   ( entry->entry, entry->entry_signal_id );
 
-		gtk_entry_set_text ( entry->entry, text_set );
+		gcmp_entry_insert ( entry, "-", gtk_editable_get_position ( GTK_EDITABLE ( entry->entry ) ) );
 
 	g_signal_handler_unblock ( entry->entry, entry->entry_signal_id );
 }
 
-static void gcmp_entry_check_op ( GcmpEntry *entry )
+/* Suffix test against a known length: the checks run on every key */
+static gboolean gcmp_entry_ends ( const char *text, size_t len, const char *suffix )
+{
+	size_t n = strlen ( suffix );
+
+	return ( n <= len && memcmp ( text + len - n, suffix, n ) == 0 );
+}
+
+/* The checks drop the character just typed and return TRUE */
+static gboolean gcmp_entry_check_op ( GcmpEntry *entry, const char *text, size_t len )
 {
 	const char *op_n[] = { "+", "-", "*", "/", "%", "^", "√", "m" };
-	const char *text  = gtk_entry_get_text ( entry->entry );
 
 	uint8_t x = 0, y = 0;
 	for ( x = 0; x < G_N_ELEMENTS ( op_n ); x++ )
 	{
+		// Only pairs ending with the last character can match
+		if ( !gcmp_entry_ends ( text, len, op_n[x] ) ) continue;
+
 		for ( y = 0; y < G_N_ELEMENTS ( op_n ); y++ )
 		{
 			char c1_text[8];
-			sprintf ( c1_text, "%s%s", op_n[x], op_n[y] );
+			sprintf ( c1_text, "%s%s", op_n[y], op_n[x] );
 
 			char c2_text[8];
-			sprintf ( c2_text, "%s %s", op_n[x], op_n[y] );
+			sprintf ( c2_text, "%s %s", op_n[y], op_n[x] );
 
-			if ( g_str_has_suffix ( text, c1_text ) || g_str_has_suffix ( text, c2_text ) ) gcmp_entry_dec ( entry );
+			if ( gcmp_entry_ends ( text, len, c1_text ) || gcmp_entry_ends ( text, len, c2_text ) ) { gcmp_entry_drop ( entry ); return TRUE; }
 		}
 	}
+
+	return FALSE;
 }
 
-static void gcmp_entry_check_epm ( GcmpEntry *entry )
+static gboolean gcmp_entry_check_epm ( GcmpEntry *entry, const char *text, size_t len )
 {
 	const char *op_n[] = { "e+", "e-" };
-	const char *text  = gtk_entry_get_text ( entry->entry );
 
 	uint8_t x = 0, y = 0;
 	for ( x = 0; x < G_N_ELEMENTS ( op_n ); x++ )
@@ -126,106 +300,205 @@ static void gcmp_entry_check_epm ( GcmpEntry *entry )
 			char c2_text[8];
 			sprintf ( c2_text, "%s %s", op_n[x], op_n[y] );
 
-			if ( g_str_has_suffix ( text, c1_text ) || g_str_has_suffix ( text, c2_text ) ) gcmp_entry_dec ( entry );
+			if ( gcmp_entry_ends ( text, len, c1_text ) || gcmp_entry_ends ( text, len, c2_text ) ) { gcmp_entry_drop ( entry ); return TRUE; }
 		}
 	}
 
-	if ( g_str_has_prefix ( text, "e+" ) || g_str_has_prefix ( text, "e-" ) ) gcmp_entry_dec ( entry );
+	if ( len >= 2 && ( memcmp ( text, "e+", 2 ) == 0 || memcmp ( text, "e-", 2 ) == 0 ) ) { gcmp_entry_drop ( entry ); return TRUE; }
+
+	return FALSE;
 }
 
-static void gcmp_entry_check_sp ( GcmpEntry *entry )
+static gboolean gcmp_entry_check_sp ( GcmpEntry *entry, const char *text, size_t len )
 {
-	const char *sp_n[] = { "~", "!", "@", "#", "$", "&", "(", ")", "_", "=" };
-	const char *text  = gtk_entry_get_text ( entry->entry );
+	const char *sp_n = "~!@#$&()_=";
 
-	uint8_t x = 0;
-	for ( x = 0; x < G_N_ELEMENTS ( sp_n ); x++ )
-	{
-		if ( g_str_has_suffix ( text, sp_n[x] ) ) gcmp_entry_dec ( entry );
-	}
+	if ( strchr ( sp_n, text[len-1] ) ) { gcmp_entry_drop ( entry ); return TRUE; }
+
+	return FALSE;
 }
 
-static gboolean gcmp_entry_check_sct ( GcmpEntry *entry )
+static gboolean gcmp_entry_check_sct ( const char *text, size_t len )
 {
 	gboolean ret = FALSE;
 	const char *sct_n[] = { "s", "si", "sin", "sin ", "c", "co", "cos", "cos ", "t", "ta", "tan", "tan " };
-	const char *text  = gtk_entry_get_text ( entry->entry );
 
 	uint8_t x = 0;
 	for ( x = 0; x < G_N_ELEMENTS ( sct_n ); x++ )
 	{
-		if ( g_str_has_suffix ( text, sct_n[x] ) ) ret = TRUE;
+		if ( gcmp_entry_ends ( text, len, sct_n[x] ) ) ret = TRUE;
 	}
 
-	if ( g_str_has_suffix ( text, "ss" ) || g_str_has_suffix ( text, "cc" ) || g_str_has_suffix ( text, "tt" ) ) ret = FALSE;
+	if ( gcmp_entry_ends ( text, len, "ss" ) || gcmp_entry_ends ( text, len, "cc" ) || gcmp_entry_ends ( text, len, "tt" ) ) ret = FALSE;
 
 	return ret;
 }
 
-static gboolean gcmp_entry_check_log ( GcmpEntry *entry )
+static gboolean gcmp_entry_check_log ( const char *text, size_t len )
 {
 	gboolean ret = FALSE;
 	const char *sct_n[] = { "l", "lo", "log", "log ", "ln", "ln " };
-	const char *text  = gtk_entry_get_text ( entry->entry );
 
 	uint8_t x = 0;
 	for ( x = 0; x < G_N_ELEMENTS ( sct_n ); x++ )
 	{
-		if ( g_str_has_suffix ( text, sct_n[x] ) ) ret = TRUE;
+		if ( gcmp_entry_ends ( text, len, sct_n[x] ) ) ret = TRUE;
 	}
 
-	if ( g_str_has_suffix ( text, "ll" ) ) ret = FALSE;
+	if ( gcmp_entry_ends ( text, len, "ll" ) ) ret = FALSE;
 
 	return ret;
 }
 
+/* A stored name being typed ( ans, M ), or a new one after -> */
+static gboolean gcmp_entry_check_var ( const char *text, size_t len )
+{
+	size_t k = len;
+	while ( k > 0 && g_ascii_isalnum ( text[k-1] ) ) k--;
+
+	if ( k == len || !g_ascii_isalpha ( text[k] ) ) return FALSE;
+
+	size_t j = k;
+	while ( j > 0 && text[j-1] == ' ' ) j--;
+
+	if ( gcmp_entry_ends ( text, j, "->" ) ) return TRUE;
+
+	return gcmp_vars_has_prefix ( text + k, len - k );
+}
+
 static void gcmp_entry_changed ( GtkEntry *entry, GcmpEntry *tool )
 {
+	// Only inserts are checked: after a delete the character before the gap was not typed
+	if ( !tool->typed ) return;
+
+	tool->typed = FALSE;
+
 	uint16_t len = gtk_entry_get_text_length ( entry );
-	const char *text = gtk_entry_get_text ( entry );
 
-	if ( !text || len == 0 ) return;
+	// Only the text up to the last edit is checked: it was valid before
+	size_t size = 0;
+	const char *text = gcmp_gap_get_front ( tool->gap, &size );
+
+	if ( len == 0 || size == 0 ) return;
 
-	uint32_t c = text[len-1];
+	gunichar c = g_utf8_get_char ( g_utf8_prev_char ( text + size ) );
 
-	if ( g_str_has_suffix ( text, "nan" ) || g_str_has_suffix ( text, "inf" ) ) return;
+	if ( gcmp_entry_ends ( text, size, "nan" ) || gcmp_entry_ends ( text, size, "inf" ) ) return;
 
-	if ( gcmp_entry_check_sct ( tool ) ) return;
-	if ( gcmp_entry_check_log ( tool ) ) return;
+	if ( gcmp_entry_check_sct ( text, size ) ) return;
+	if ( gcmp_entry_check_log ( text, size ) ) return;
+	if ( gcmp_entry_check_var ( text, size ) ) return;
 
-	if ( len == 1 && !g_unichar_isdigit ( c ) ) { gcmp_entry_dec ( tool ); return; }
+	// Letters are digits in bases above 10
+	gboolean digit = ( c < 128 && gcmp_radix_is_digit ( (char)c, tool->base ) );
 
-	if ( g_unichar_isalpha ( c ) && c != 'm'  ) { gcmp_entry_dec ( tool ); return; }
+	if ( len == 1 && !digit ) { gcmp_entry_drop ( tool ); return; }
 
-	gcmp_entry_check_op ( tool );
-	gcmp_entry_check_sp ( tool );
-	gcmp_entry_check_epm ( tool );
+	if ( g_unichar_isalpha ( c ) && c != 'm' && !digit ) { gcmp_entry_drop ( tool ); return; }
 
-	if ( ( len == 1 && g_str_has_suffix ( text, " " ) ) || g_str_has_suffix ( text, "  " ) || g_str_has_suffix ( text, ".." ) 
-		|| g_str_has_suffix ( text, " ." ) || g_str_has_suffix ( text, ". " ) ) gcmp_entry_dec ( tool );
+	if ( gcmp_entry_check_op  ( tool, text, size ) ) return;
+	if ( gcmp_entry_check_sp  ( tool, text, size ) ) return;
+	if ( gcmp_entry_check_epm ( tool, text, size ) ) return;
+
+	if ( ( len == 1 && gcmp_entry_ends ( text, size, " " ) ) || gcmp_entry_ends ( text, size, "  " ) || gcmp_entry_ends ( text, size, ".." ) 
+		|| gcmp_entry_ends ( text, size, " ." ) || gcmp_entry_ends ( text, size, ". " ) ) gcmp_entry_drop ( tool );
 }
 
-static void gcmp_entry_treeview_append ( const char *data, const char *res, GcmpEntry *entry )
+/* Rows other windows added to the shared history, or all on first use */
+static void gcmp_entry_history_sync ( GcmpEntry *entry )
 {
-	GtkTreeIter iter;
-	GtkTreeModel *model = gtk_tree_view_get_model ( entry->treeview );
+	uint32_t n_rows = gcmp_history_get_n_rows ( entry->history );
 
-	gtk_list_store_append ( GTK_LIST_STORE ( model ), &iter );
-	gtk_list_store_set    ( GTK_LIST_STORE ( model ), &iter, COL_DATA, data, COL_RESL, res, -1 );
+	for ( ; entry->index && entry->n_indexed < n_rows; entry->n_indexed++ )
+	{
+		g_autofree char *data = NULL;
+		g_autofree char *res  = NULL;
+		gcmp_history_get_row ( entry->history, entry->n_indexed, &data, &res );
+
+		gcmp_index_add ( entry->index, data, res );
+	}
+
+	for ( ; entry->history_load && entry->n_loaded < n_rows; entry->n_loaded++ )
+		gtk_list_store_insert_with_values ( entry->store, NULL, -1, COL_NREC, entry->n_loaded, -1 );
+}
+
+static void gcmp_entry_treeview_append ( const char *data, const char *res, mpfr_srcptr val, GcmpEntry *entry )
+{
+	gcmp_history_append ( entry->history, data, res, val );
+
+	gcmp_entry_history_sync ( entry );
+}
+
+static void gcmp_entry_treeview_load ( GcmpEntry *entry )
+{
+	entry->history_load = TRUE;
+
+	gcmp_entry_history_sync ( entry );
+}
+
+static void gcmp_entry_index_load ( GcmpEntry *entry )
+{
+	entry->index = gcmp_index_new ();
+
+	gcmp_entry_history_sync ( entry );
+}
+
+static void gcmp_entry_search_changed ( GtkSearchEntry *search, GcmpEntry *entry )
+{
+	const char *text = gtk_entry_get_text ( GTK_ENTRY ( search ) );
+
+	if ( !text || text[0] == '\0' ) { gtk_tree_view_set_model ( entry->treeview, GTK_TREE_MODEL ( entry->store ) ); return; }
+
+	if ( !entry->index ) gcmp_entry_index_load ( entry ); else gcmp_entry_history_sync ( entry );
+
+	GArray *found = gcmp_index_search ( entry->index, text, MAX_FOUND );
+	GtkListStore *store = (GtkListStore *)gtk_list_store_new ( NUM_STORE_COLS, G_TYPE_UINT );
+
+	uint32_t j = 0;
+	for ( j = 0; j < found->len; j++ )
+		gtk_list_store_insert_with_values ( store, NULL, -1, COL_NREC, g_array_index ( found, uint32_t, j ), -1 );
+
+	gtk_tree_view_set_model ( entry->treeview, GTK_TREE_MODEL ( store ) );
+
+	g_object_unref ( store );
+	g_array_free ( found, TRUE );
 }
 
-static void gcmp_entry_treeview_create_columns ( GtkTreeView *tree_view, int column_id )
+static void gcmp_entry_treeview_cell_data ( GtkTreeViewColumn *column, GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, GcmpEntry *entry )
+{
+	uint32_t nrec = 0;
+	gtk_tree_model_get ( model, iter, COL_NREC, &nrec, -1 );
+
+	int column_id = GPOINTER_TO_INT ( g_object_get_data ( G_OBJECT ( column ), "column-id" ) );
+
+	g_autofree char *data = NULL;
+	g_autofree char *res  = NULL;
+	gcmp_history_get_row ( entry->history, nrec, &data, &res );
+
+	if ( column_id == COL_DATA ) { g_object_set ( cell, "text", data, "style", PANGO_STYLE_NORMAL, NULL ); return; }
+
+	// Refreshed at the new precision, or in italics while it is not yet
+	gboolean stale = FALSE;
+	g_autofree char *fresh = gcmp_sheet_get_res ( entry->sheet, nrec, &stale );
+
+	g_object_set ( cell, "text", ( fresh ) ? fresh : res, "style", ( stale ) ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL, NULL );
+}
+
+static void gcmp_entry_treeview_create_columns ( GtkTreeView *tree_view, int column_id, GcmpEntry *entry )
 {
 	GtkCellRenderer *renderer = gtk_cell_renderer_text_new ();
 
-	GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes ( "", renderer, "text", column_id, NULL );
+	GtkTreeViewColumn *column = gtk_tree_view_column_new_with_attributes ( "", renderer, NULL );
+	g_object_set_data ( G_OBJECT ( column ), "column-id", GINT_TO_POINTER ( column_id ) );
+
+	gtk_tree_view_column_set_cell_data_func ( column, renderer, (GtkTreeCellDataFunc)gcmp_entry_treeview_cell_data, entry, NULL );
 	gtk_tree_view_append_column ( tree_view, column );
 }
 
-static void gcmp_entry_treeview_add_columns ( GtkTreeView *tree_view )
+static void gcmp_entry_treeview_add_columns ( GtkTreeView *tree_view, GcmpEntry *entry )
 {
 	uint8_t c = 0; for ( c = 0; c < NUM_COLS; c++ )
-		gcmp_entry_treeview_create_columns ( tree_view, c );
+		gcmp_entry_treeview_create_columns ( tree_view, c, entry );
 }
 
 static void gcmp_entry_treeview_row_activated ( GtkTreeView *tree_view, GtkTreePath *path, GtkTreeViewColumn *column, GcmpEntry *entry )
@@ -244,26 +517,42 @@ static void gcmp_entry_treeview_row_activated ( GtkTreeView *tree_view, GtkTreeP
 
 	if ( gtk_tree_model_get_iter ( model, &iter, path ) )
 	{
-		g_autofree char *data = NULL;
-		gtk_tree_model_get ( model, &iter, num, &data, -1 );
+		uint32_t nrec = 0;
+		gtk_tree_model_get ( model, &iter, COL_NREC, &nrec, -1 );
+
+		g_autofree char *expr = NULL;
+		g_autofree char *res  = NULL;
+		gcmp_history_get_row ( entry->history, nrec, &expr, &res );
+
+		gboolean stale = FALSE;
+		g_autofree char *fresh = gcmp_sheet_get_res ( entry->sheet, nrec, &stale );
+
+		const char *data = ( num == COL_DATA ) ? expr : ( fresh ) ? fresh : res;
+
+		// The result text stays bound to the row's value, in binary: no decimal re-parsing
+		mpfr_t val;
+		mpfr_init2 ( val, MPFR_PREC_MIN );
+
+		gboolean bound = ( num == COL_RESL && ( ( fresh ) ? gcmp_sheet_get_value ( entry->sheet, nrec, val ) : gcmp_history_get_value ( entry->history, nrec, val ) ) );
 
-		const char *text = gtk_entry_get_text ( entry->entry );
 		uint16_t len = gtk_entry_get_text_length ( entry->entry );
 
-		g_autofree char *text_set = ( len ) ? g_strdup_printf ( "%s %s", text, data ) : g_strdup_printf ( "%s", data );
+		if ( len ) gcmp_entry_insert ( entry, " ", len++ );
+
+		gcmp_entry_insert_value ( entry, data, len, ( bound ) ? val : NULL );
 
-		gtk_entry_set_text ( entry->entry, text_set );
+		mpfr_clear ( val );
 	}
 }
 
 static GtkTreeView * gcmp_entry_treeview_new ( GcmpEntry *entry )
 {
-	GtkListStore *store = (GtkListStore *)gtk_list_store_new ( 2, G_TYPE_STRING, G_TYPE_STRING );
+	entry->store = (GtkListStore *)gtk_list_store_new ( NUM_STORE_COLS, G_TYPE_UINT );
 
-	GtkTreeView *treeview = (GtkTreeView *)gtk_tree_view_new_with_model ( GTK_TREE_MODEL ( store ) );
+	GtkTreeView *treeview = (GtkTreeView *)gtk_tree_view_new_with_model ( GTK_TREE_MODEL ( entry->store ) );
 	gtk_tree_view_set_headers_visible ( treeview, FALSE );
 
-	gcmp_entry_treeview_add_columns ( treeview );
+	gcmp_entry_treeview_add_columns ( treeview, entry );
 	g_object_set ( treeview, "activate-on-single-click", TRUE, NULL );
 
 	g_signal_connect ( treeview, "row-activated", G_CALLBACK ( gcmp_entry_treeview_row_activated ), entry );
@@ -271,6 +560,54 @@ static GtkTreeView * gcmp_entry_treeview_new ( GcmpEntry *entry )
 	return treeview;
 }
 
+/* The rows in view are refreshed first */
+static void gcmp_entry_sheet_visible ( GcmpEntry *entry )
+{
+	GtkTreePath *start = NULL, *end = NULL;
+
+	if ( !entry->treeview || !gtk_tree_view_get_visible_range ( entry->treeview, &start, &end ) ) return;
+
+	GtkTreeIter iter;
+	GtkTreeModel *model = gtk_tree_view_get_model ( entry->treeview );
+
+	uint32_t first = 0, last = 0;
+	if ( gtk_tree_model_get_iter ( model, &iter, start ) ) gtk_tree_model_get ( model, &iter, COL_NREC, &first, -1 );
+	if ( gtk_tree_model_get_iter ( model, &iter, end   ) ) gtk_tree_model_get ( model, &iter, COL_NREC, &last,  -1 );
+
+	// Search results need not be in order
+	gcmp_sheet_set_visible ( entry->sheet, MIN ( first, last ), MAX ( first, last ) );
+
+	gtk_tree_path_free ( start );
+	gtk_tree_path_free ( end );
+}
+
+static void gcmp_entry_scrolled ( G_GNUC_UNUSED GtkAdjustment *adj, GcmpEntry *entry )
+{
+	gcmp_entry_sheet_visible ( entry );
+}
+
+static void gcmp_entry_sheet_done ( G_GNUC_UNUSED uint32_t nrec, GcmpEntry *entry )
+{
+	if ( entry->treeview ) gtk_widget_queue_draw ( GTK_WIDGET ( entry->treeview ) );
+}
+
+/* A result of an expression: the row just added to the history keeps it compiled, for a new precision */
+static void gcmp_entry_set_expr ( GcmpEntry *entry, gpointer eval, gpointer res, uint32_t digits, uint32_t deg_rad )
+{
+	uint32_t n_rows = gcmp_history_get_n_rows ( entry->history );
+
+	if ( !n_rows ) { gcmp_eval_free ( eval ); return; }
+
+	gcmp_sheet_add ( entry->sheet, n_rows - 1, entry, eval, entry->base, (uint8_t)deg_rad, digits, res );
+}
+
+static void gcmp_entry_set_digits ( GcmpEntry *entry, uint32_t digits )
+{
+	gcmp_entry_sheet_visible ( entry );
+
+	gcmp_sheet_set_digits ( entry->sheet, entry, digits );
+}
+
 static GtkScrolledWindow * gcmp_entry_create_scroll ( GtkTreeView *tree_view )
 {
 	GtkScrolledWindow *scroll = (GtkScrolledWindow *)gtk_scrolled_window_new ( NULL, NULL );
@@ -286,18 +623,40 @@ static GtkScrolledWindow * gcmp_entry_create_scroll ( GtkTreeView *tree_view )
 static GtkBox * gcmp_entry_create_history ( GcmpEntry *entry )
 {
 	GtkBox *m_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_VERTICAL, 0 );
+	gtk_box_set_spacing ( m_box, 5 );
+
+	GtkSearchEntry *search = (GtkSearchEntry *)gtk_search_entry_new ();
+	g_signal_connect ( search, "search-changed", G_CALLBACK ( gcmp_entry_search_changed ), entry );
+
+	gtk_widget_set_visible ( GTK_WIDGET ( search ), TRUE );
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( search ), FALSE, FALSE, 0 );
 
 	entry->treeview = gcmp_entry_treeview_new ( entry );
 	gtk_box_pack_start ( m_box, GTK_WIDGET ( gcmp_entry_create_scroll ( entry->treeview ) ), TRUE, TRUE, 0 );
 
+	g_signal_connect ( gtk_scrollable_get_vadjustment ( GTK_SCROLLABLE ( entry->treeview ) ), "value-changed", G_CALLBACK ( gcmp_entry_scrolled ), entry );
+
 	gtk_widget_set_visible ( GTK_WIDGET ( entry->treeview ), TRUE );
 	gtk_widget_set_visible ( GTK_WIDGET ( m_box ), TRUE );
 
 	return m_box;
 }
 
+static void gcmp_entry_create_popover ( GcmpEntry *entry )
+{
+	entry->popover_edit = (GtkPopover *)gtk_popover_new ( GTK_WIDGET ( entry->entry ) );
+	gtk_popover_set_position ( entry->popover_edit, GTK_POS_BOTTOM );
+	gtk_container_add ( GTK_CONTAINER (entry->popover_edit), GTK_WIDGET ( gcmp_entry_create_history ( entry ) ) );
+	gtk_container_set_border_width ( GTK_CONTAINER ( entry->popover_edit ), 2 );
+}
+
 static void entry_icon_press ( GtkEntry *entry, GtkEntryIconPosition icon_pos, G_GNUC_UNUSED GdkEvent *event, GcmpEntry *tool )
 {
+	// The history popover is built on first use, not before the first frame
+	if ( !tool->popover_edit ) gcmp_entry_create_popover ( tool );
+
+	if ( !tool->history_load ) gcmp_entry_treeview_load ( tool ); else gcmp_entry_history_sync ( tool );
+
 	cairo_rectangle_int_t rect;
 
 	gtk_entry_get_icon_area ( entry, icon_pos, &rect );
@@ -309,23 +668,32 @@ static void entry_icon_press ( GtkEntry *entry, GtkEntryIconPosition icon_pos, G
 
 static void gcmp_entry_create ( GcmpEntry *entry )
 {
+	entry->gap = gcmp_gap_new ();
+
+	entry->binds = g_array_new ( FALSE, FALSE, sizeof ( Bind ) );
+	g_array_set_clear_func ( entry->binds, (GDestroyNotify)gcmp_entry_bind_clear );
+
 	entry->entry = (GtkEntry *)gtk_entry_new ();
 	gtk_entry_set_text ( entry->entry, "" );
 	gtk_entry_set_icon_from_icon_name ( entry->entry, GTK_ENTRY_ICON_SECONDARY, "edit-copy" );
 	gtk_widget_set_visible ( GTK_WIDGET ( entry->entry ), TRUE );
 
-	entry->popover_edit = (GtkPopover *)gtk_popover_new ( GTK_WIDGET ( entry->entry ) );
-	gtk_popover_set_position ( entry->popover_edit, GTK_POS_BOTTOM );
-	gtk_container_add ( GTK_CONTAINER (entry->popover_edit), GTK_WIDGET ( gcmp_entry_create_history ( entry ) ) );
-	gtk_container_set_border_width ( GTK_CONTAINER ( entry->popover_edit ), 2 );
-
 	g_signal_connect ( entry->entry, "icon-press", G_CALLBACK ( entry_icon_press ), entry );
+	g_signal_connect ( entry->entry, "insert-text", G_CALLBACK ( gcmp_entry_insert_text ), entry );
+	g_signal_connect ( entry->entry, "delete-text", G_CALLBACK ( gcmp_entry_delete_text ), entry );
 
 	entry->entry_signal_id = g_signal_connect ( entry->entry, "changed", G_CALLBACK ( gcmp_entry_changed ), entry );
 }
 
+static void gcmp_entry_set_base ( GcmpEntry *entry, uint8_t base )
+{
+	entry->base = base;
+}
+
 static void gcmp_entry_init ( GcmpEntry *entry )
 {
+	entry->base = 10;
+
 	GtkBox *box = GTK_BOX ( entry );
 	gtk_orientable_set_orientation ( GTK_ORIENTABLE ( box ), GTK_ORIENTATION_VERTICAL );
 
@@ -340,10 +708,24 @@ static void gcmp_entry_init ( GcmpEntry *entry )
 	g_signal_connect ( entry, "entry-sgn", G_CALLBACK ( gcmp_entry_sgn ), NULL );
 	g_signal_connect ( entry, "entry-set-text", G_CALLBACK ( gcmp_entry_set_text ), NULL );
 	g_signal_connect ( entry, "entry-get-text", G_CALLBACK ( gcmp_entry_get_text ), NULL );
+	g_signal_connect ( entry, "entry-get-eval", G_CALLBACK ( gcmp_entry_get_eval ), NULL );
+	g_signal_connect ( entry, "entry-set-value", G_CALLBACK ( gcmp_entry_set_value ), NULL );
+	g_signal_connect ( entry, "entry-set-base", G_CALLBACK ( gcmp_entry_set_base ), NULL );
+	g_signal_connect ( entry, "entry-set-expr", G_CALLBACK ( gcmp_entry_set_expr ), NULL );
+	g_signal_connect ( entry, "entry-set-digits", G_CALLBACK ( gcmp_entry_set_digits ), NULL );
 }
 
 static void gcmp_entry_finalize ( GObject *object )
 {
+	GcmpEntry *entry = GCMP_ENTRY ( object );
+
+	gcmp_sheet_unwatch ( entry->sheet, entry );
+	gcmp_gap_free ( entry->gap );
+	g_array_free ( entry->binds, TRUE );
+	if ( entry->index ) gcmp_index_free ( entry->index );
+
+	if ( entry->store ) g_object_unref ( entry->store );
+
 	G_OBJECT_CLASS (gcmp_entry_parent_class)->finalize (object);
 }
 
@@ -367,10 +749,35 @@ static void gcmp_entry_class_init ( GcmpEntryClass *class )
 
 	g_signal_new ( "entry-get-text", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
 		0, NULL, NULL, NULL, G_TYPE_STRING, 0 );
+
+	// GcmpEval * ( the caller's ), NULL if the text does not parse
+	g_signal_new ( "entry-get-eval", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_POINTER, 0 );
+
+	// Text, mpfr_ptr value ( copied ), add: as entry-set-text, the text bound to the value
+	g_signal_new ( "entry-set-value", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 3, G_TYPE_STRING, G_TYPE_POINTER, G_TYPE_BOOLEAN );
+
+	g_signal_new ( "entry-set-base", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_UINT );
+
+	// GcmpEval * ( taken ), mpfr_ptr result, digits, deg_rad
+	g_signal_new ( "entry-set-expr", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 4, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_UINT, G_TYPE_UINT );
+
+	g_signal_new ( "entry-set-digits", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_UINT );
 }
 
-GcmpEntry * gcmp_entry_new ( void )
+GcmpEntry * gcmp_entry_new ( GcmpHistory *history, GcmpSheet *sheet )
 {
-	return g_object_new ( GCMP_TYPE_ENTRY, NULL );
+	GcmpEntry *entry = g_object_new ( GCMP_TYPE_ENTRY, NULL );
+
+	entry->history = history;
+	entry->sheet = sheet;
+
+	gcmp_sheet_watch ( sheet, (GcmpSheetDone)gcmp_entry_sheet_done, entry );
+
+	return entry;
 }
 
@@ -9,11 +9,18 @@
 
 #pragma once
 
+#include "gcmp-history.h"
+#include "gcmp-sheet.h"
+
 #include <gtk/gtk.h>
 
+/* Longer results are shown in the viewer; the entry keeps this many digits */
+#define ENTRY_DIGITS 1000
+
 #define GCMP_TYPE_ENTRY gcmp_entry_get_type ()
 
 G_DECLARE_FINAL_TYPE ( GcmpEntry, gcmp_entry, GCMP, ENTRY, GtkBox )
 
-GcmpEntry * gcmp_entry_new ( void );
+/* The history and the worksheet are shared with the other windows */
+GcmpEntry * gcmp_entry_new ( GcmpHistory *, GcmpSheet * );
 
@@ -0,0 +1,1008 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-eval.h"
+#include "gcmp-ball.h"
+#include "gcmp-cost.h"
+#include "gcmp-radix.h"
+#include "gcmp-pool.h"
+#include "gcmp-scan.h"
+#include "gcmp-vars.h"
+
+#include <math.h>
+#include <uchar.h>
+
+/*
+* Expression: term { op term }, evaluated left to right ( calculator order ).
+* Expression [ -> name ]: the result is also stored under the name ( gcmp-vars.h ), as it is under ans.
+* Term: [ sin | cos | tan | ln | log ] ( number | nary | x | name | #k )
+* x is the free variable of gcmp_eval_run_at ( up to base 33, where it is not a digit ).
+* Name: a stored value, copied when compiled; a name the base reads as a number is that number.
+* #k: the k-th value given to gcmp_eval_new_bound, copied when compiled, with an optional sign.
+* Nary: ( dot | fma | fms | fmma | fmms | poly ) '(' expression { ',' expression } ')', rounded once;
+*       ( powm | gcd | invm | prime ) the same, on exact integers.
+* Number: digits of the base, '@' exponent in any base, 'e' up to base 10.
+* Above base 22 'm' is a digit: mod needs spaces around it.
+*/
+
+typedef struct _Step Step;
+
+struct _Step
+{
+	enum math op;
+	enum math_ext fn;
+	enum math_nary nary;
+
+	char *num;
+	GPtrArray *args;
+
+	double d;
+
+	gboolean var;
+	gboolean bound;
+
+	mpfr_ptr val;
+};
+
+typedef struct _Bound Bound;
+
+/* Values the #k terms stand for, while compiling */
+struct _Bound
+{
+	mpfr_srcptr *vals;
+	uint32_t n;
+};
+
+struct _GcmpEval
+{
+	GArray *steps;
+	char *store;
+
+	uint8_t base;
+};
+
+/* A term worth a task of its own: about 20 µs and more, so the handoff stays small beside it */
+#define TASK_MIN 20000
+
+/* Values of the precision alive besides one per term: a function's own and the product buffers, about */
+#define TEMPS_MIN 16
+
+typedef struct _Frame Frame;
+
+typedef struct _Term Term;
+
+/* One term of one parallel run; numbers are read before any task starts */
+struct _Term
+{
+	Step *step;
+	Frame *frame;
+	GPtrArray *args;
+
+	mpfr_t val;
+	double cost;
+};
+
+struct _Frame
+{
+	GcmpEval *eval;
+	Term *terms;
+
+	mpfr_t res;
+	double cost;
+
+	uint32_t digits;
+	uint8_t deg_rad;
+};
+
+static const char * gcmp_eval_skip ( const char *str )
+{
+	while ( *str == ' ' ) str++;
+
+	return str;
+}
+
+static enum math gcmp_eval_get_op ( const uint32_t sym )
+{
+	enum math mtf = UNF;
+
+	if ( sym == '+' ) mtf = ADD;
+	if ( sym == '-' ) mtf = SUB;
+	if ( sym == '/' ) mtf = DIV;
+	if ( sym == '*' ) mtf = MUL;
+	if ( sym == '%' ) mtf = PRC;
+	if ( sym == '^' ) mtf = POW;
+	if ( sym == 'm' ) mtf = MOD;
+	if ( sym == U'√' ) mtf = RUT;
+
+	return mtf;
+}
+
+static const char * gcmp_eval_get_fn ( const char *str, enum math_ext *fn )
+{
+	const char *name[] = { "sin", "cos", "tan", "log", "ln" };
+	enum math_ext mte[] = {  SIN,   COS,   TAN,   LOG,  LGN };
+
+	uint8_t j = 0;
+	for ( j = 0; j < G_N_ELEMENTS ( name ); j++ )
+	{
+		if ( g_str_has_prefix ( str, name[j] ) ) { *fn = mte[j]; return str + strlen ( name[j] ); }
+	}
+
+	*fn = UND;
+
+	return str;
+}
+
+static const char * gcmp_eval_get_nary ( const char *str, enum math_nary *nary )
+{
+	const char *name[] = { "dot", "fma", "fms", "fmma", "fmms", "poly", "powm", "gcd", "invm", "prime" };
+	enum math_nary mtn[] = {  DOT,   FMA,   FMS,   FMMA,   FMMS,   PLY,    PWM,    GCD,   INV,    PRM };
+
+	uint8_t j = 0;
+	for ( j = 0; j < G_N_ELEMENTS ( name ); j++ )
+	{
+		size_t len = strlen ( name[j] );
+
+		// The parenthesis tells the name from a number in a high base
+		if ( g_str_has_prefix ( str, name[j] ) && str[len] == '(' ) { *nary = mtn[j]; return str + len + 1; }
+	}
+
+	*nary = NNR;
+
+	return str;
+}
+
+static const char * gcmp_eval_number ( const char *str, uint8_t base )
+{
+	const char *p = str;
+
+	if ( *p == '-' || *p == '+' ) p++;
+
+	if ( g_str_has_prefix ( p, "@inf@" ) || g_str_has_prefix ( p, "@nan@" ) ) return p + 5;
+
+	if ( base <= 16 && ( g_str_has_prefix ( p, "inf" ) || g_str_has_prefix ( p, "nan" ) ) ) return p + 3;
+
+	const char *digits = p;
+
+	// Decimal digits a vector at a time
+	if ( base == 10 )
+	{
+		p += gcmp_scan_digits_str ( p );
+
+		while ( *p == '.' ) { p++; p += gcmp_scan_digits_str ( p ); }
+	}
+	else
+		while ( gcmp_radix_is_digit ( *p, base ) || *p == '.' ) p++;
+
+	if ( p == digits ) return str;
+
+	if ( *p == '@' || ( base <= 10 && *p == 'e' ) )
+	{
+		const char *exp = p + 1;
+
+		if ( *exp == '+' || *exp == '-' ) exp++;
+
+		if ( g_ascii_isdigit ( *exp ) ) { p = exp; while ( g_ascii_isdigit ( *p ) ) p++; }
+	}
+
+	return p;
+}
+
+static GcmpEval * gcmp_eval_parse ( const char *, uint8_t, const Bound * );
+
+/* Arguments up to the closing parenthesis; each one is an expression of its own */
+static const char * gcmp_eval_args ( const char *str, uint8_t base, const Bound *bound, Step *step )
+{
+	step->args = g_ptr_array_new_with_free_func ( (GDestroyNotify)gcmp_eval_free );
+
+	const char *arg = str;
+	uint32_t depth = 0;
+
+	for ( ; *str; str++ )
+	{
+		if ( *str == '(' ) { depth++; continue; }
+
+		if ( depth && *str == ')' ) { depth--; continue; }
+
+		if ( depth || ( *str != ',' && *str != ')' ) ) continue;
+
+		g_autofree char *sub = g_strndup ( arg, (gsize)( str - arg ) );
+		GcmpEval *eval = gcmp_eval_parse ( sub, base, bound );
+
+		if ( !eval ) return NULL;
+
+		g_ptr_array_add ( step->args, eval );
+
+		if ( *str == ')' ) break;
+
+		arg = str + 1;
+	}
+
+	if ( *str != ')' || !gcmp_mpfr_nary_fits ( step->nary, step->args->len ) ) return NULL;
+
+	return str + 1;
+}
+
+/* Bound now, at full precision: no text in between, and threads running the expression share it */
+static void gcmp_eval_bind ( Step *step, mpfr_srcptr val, int sign )
+{
+	step->val = g_new ( __mpfr_struct, 1 );
+	mpfr_init2 ( step->val, mpfr_get_prec ( val ) );
+	mpfr_set ( step->val, val, MPFR_RNDN );
+
+	if ( sign < 0 ) mpfr_neg ( step->val, step->val, MPFR_RNDN );
+
+	step->d = mpfr_get_d ( step->val, MPFR_RNDN );
+}
+
+static const char * gcmp_eval_bound ( const char *str, const Bound *bound, Step *step )
+{
+	int sign = ( *str == '-' ) ? -1 : 1;
+
+	if ( *str == '-' || *str == '+' ) str++;
+
+	if ( *str != '#' || !g_ascii_isdigit ( str[1] ) ) return NULL;
+
+	char *end = NULL;
+	guint64 k = g_ascii_strtoull ( str + 1, &end, 10 );
+
+	if ( !bound || k >= bound->n ) return NULL;
+
+	gcmp_eval_bind ( step, bound->vals[k], sign );
+	step->bound = TRUE;
+
+	return end;
+}
+
+static const char * gcmp_eval_term ( const char *str, uint8_t base, const Bound *bound, Step *step )
+{
+	str = gcmp_eval_skip ( str );
+	str = gcmp_eval_get_fn ( str, &step->fn );
+	str = gcmp_eval_skip ( str );
+	str = gcmp_eval_get_nary ( str, &step->nary );
+
+	if ( step->nary != NNR ) return gcmp_eval_args ( str, base, bound, step );
+
+	if ( *str == '#' || ( ( *str == '-' || *str == '+' ) && str[1] == '#' ) ) return gcmp_eval_bound ( str, bound, step );
+
+	if ( *str == 'x' && !gcmp_radix_is_digit ( 'x', base ) && !g_ascii_isalnum ( str[1] ) ) { step->var = TRUE; return str + 1; }
+
+	const char *end = gcmp_eval_number ( str, base );
+
+	size_t len = gcmp_vars_name ( str );
+	mpfr_srcptr val = ( len && end != str + len ) ? gcmp_vars_find ( str, len ) : NULL;
+
+	if ( val ) { gcmp_eval_bind ( step, val, 1 ); return str + len; }
+
+	if ( end == str ) return NULL;
+
+	step->num = g_strndup ( str, (gsize)( end - str ) );
+
+	// Parsed once for gcmp_eval_run_d
+	mpfr_t t;
+	mpfr_init2 ( t, 64 );
+	gcmp_mpfr_set_str ( t, step->num, base );
+
+	step->d = mpfr_get_d ( t, MPFR_RNDN );
+
+	mpfr_clear ( t );
+
+	return end;
+}
+
+static void gcmp_eval_step_clear ( Step *step )
+{
+	g_free ( step->num );
+
+	if ( step->args ) g_ptr_array_unref ( step->args );
+
+	if ( step->val ) { mpfr_clear ( step->val ); g_free ( step->val ); }
+}
+
+/* -> name at the end of the expression; names that read as x or a function are not stored */
+static const char * gcmp_eval_store ( const char *str, GcmpEval *eval )
+{
+	str = gcmp_eval_skip ( str + ( ( *str == '-' ) ? 2 : strlen ( "→" ) ) );
+
+	enum math_ext fn = UND;
+	gcmp_eval_get_fn ( str, &fn );
+
+	size_t len = gcmp_vars_name ( str );
+
+	if ( !len || fn != UND || ( len == 1 && *str == 'x' ) ) return NULL;
+
+	eval->store = g_strndup ( str, len );
+
+	str = gcmp_eval_skip ( str + len );
+
+	return ( *str == '\0' ) ? str : NULL;
+}
+
+static GcmpEval * gcmp_eval_parse ( const char *expr, uint8_t base, const Bound *bound )
+{
+	GcmpEval *eval = g_new0 ( GcmpEval, 1 );
+
+	eval->base  = base;
+	eval->steps = g_array_new ( FALSE, TRUE, sizeof ( Step ) );
+	g_array_set_clear_func ( eval->steps, (GDestroyNotify)gcmp_eval_step_clear );
+
+	const char *str = expr;
+	enum math op = UNF;
+
+	while ( TRUE )
+	{
+		Step step = { op, UND, NNR, NULL, NULL, 0, FALSE, FALSE, NULL };
+
+		str = gcmp_eval_term ( str, base, bound, &step );
+
+		// A term that failed half way may hold arguments already
+		if ( !str ) { gcmp_eval_step_clear ( &step ); gcmp_eval_free ( eval ); return NULL; }
+
+		g_array_append_val ( eval->steps, step );
+
+		str = gcmp_eval_skip ( str );
+
+		if ( *str == '\0' ) break;
+
+		if ( g_str_has_prefix ( str, "->" ) || g_str_has_prefix ( str, "→" ) )
+		{
+			if ( !gcmp_eval_store ( str, eval ) ) { gcmp_eval_free ( eval ); return NULL; }
+
+			break;
+		}
+
+		op = gcmp_eval_get_op ( g_utf8_get_char ( str ) );
+
+		if ( op == UNF ) { gcmp_eval_free ( eval ); return NULL; }
+
+		str = g_utf8_next_char ( str );
+	}
+
+	return eval;
+}
+
+GcmpEval * gcmp_eval_new ( const char *expr, uint8_t base )
+{
+	return gcmp_eval_parse ( expr, base, NULL );
+}
+
+GcmpEval * gcmp_eval_new_bound ( const char *expr, uint8_t base, mpfr_srcptr *vals, uint32_t n )
+{
+	Bound bound = { vals, n };
+
+	return gcmp_eval_parse ( expr, base, &bound );
+}
+
+GcmpEval * gcmp_eval_new_at ( GcmpEval *eval, uint32_t digits )
+{
+	GcmpEval *copy = g_new0 ( GcmpEval, 1 );
+
+	copy->base  = eval->base;
+	copy->store = g_strdup ( eval->store );
+	copy->steps = g_array_sized_new ( FALSE, TRUE, sizeof ( Step ), eval->steps->len );
+	g_array_set_clear_func ( copy->steps, (GDestroyNotify)gcmp_eval_step_clear );
+
+	uint32_t j = 0, k = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+		Step at = { step->op, step->fn, step->nary, g_strdup ( step->num ), NULL, step->d, step->var, step->bound, NULL };
+
+		if ( step->args )
+		{
+			at.args = g_ptr_array_new_with_free_func ( (GDestroyNotify)gcmp_eval_free );
+
+			for ( k = 0; k < step->args->len; k++ ) g_ptr_array_add ( at.args, gcmp_eval_new_at ( g_ptr_array_index ( step->args, k ), digits ) );
+		}
+
+		if ( step->val ) gcmp_eval_bind ( &at, step->val, 1 );
+
+		// Read as gcmp_eval_run_at would at these digits, so the results are the same
+		if ( step->num )
+		{
+			at.val = g_new ( __mpfr_struct, 1 );
+			mpfr_init2 ( at.val, digits * 4 );
+			gcmp_mpfr_set_str ( at.val, step->num, eval->base );
+		}
+
+		g_array_append_val ( copy->steps, at );
+	}
+
+	return copy;
+}
+
+void gcmp_eval_free ( GcmpEval *eval )
+{
+	g_array_free ( eval->steps, TRUE );
+
+	g_free ( eval->store );
+	g_free ( eval );
+}
+
+gboolean gcmp_eval_is_plain ( GcmpEval *eval )
+{
+	Step *step = &g_array_index ( eval->steps, Step, 0 );
+
+	// A bound number is still a number; a name is not
+	return ( eval->steps->len == 1 && step->fn == UND && step->nary == NNR && !step->var && ( !step->val || step->bound ) );
+}
+
+gboolean gcmp_eval_is_bound ( GcmpEval *eval )
+{
+	uint32_t j = 0, k = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		if ( step->val ) return TRUE;
+
+		for ( k = 0; step->args && k < step->args->len; k++ ) if ( gcmp_eval_is_bound ( g_ptr_array_index ( step->args, k ) ) ) return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void gcmp_eval_nary ( Step *step, mpfr_t res, uint32_t digits, uint8_t deg_rad, mpfr_srcptr x )
+{
+	uint32_t j = 0, n = step->args->len;
+
+	// The operands stay binary until the single rounding of the fused operation
+	__mpfr_struct *a = g_new ( __mpfr_struct, n );
+	mpfr_ptr *args = g_new ( mpfr_ptr, n );
+
+	for ( j = 0; j < n; j++ )
+	{
+		args[j] = &a[j];
+		mpfr_init2 ( args[j], digits * 4 );
+
+		gcmp_eval_run_at ( g_ptr_array_index ( step->args, j ), args[j], digits, deg_rad, x );
+	}
+
+	gcmp_mpfr_op_nary ( step->nary, res, args, n );
+
+	for ( j = 0; j < n; j++ ) mpfr_clear ( args[j] );
+
+	g_free ( args );
+	g_free ( a );
+}
+
+/* Rough time in products of 64 bits ( gcmp-cost.h ) */
+static double gcmp_eval_cost_mul ( uint32_t digits )
+{
+	return gcmp_cost_mul ( (mpfr_prec_t)digits * 4 );
+}
+
+static double gcmp_eval_cost_fn ( enum math_ext fn, uint32_t digits )
+{
+	double m = gcmp_eval_cost_mul ( digits );
+
+	if ( fn == SIN || fn == COS || fn == TAN || fn == LGN || fn == LOG || fn == FAC ) return gcmp_cost_fn ( (mpfr_prec_t)digits * 4 );
+
+	if ( fn == RT2 || fn == RT3 || fn == D1R || fn == D1X ) return 4 * m;
+
+	if ( fn == CPI || fn == CEU || fn == CEX || fn == CL2 ) return gcmp_cost_fn ( (mpfr_prec_t)digits * 4 );
+
+	if ( fn == PW2 || fn == PW3 ) return 2 * m;
+
+	return 0;
+}
+
+static double gcmp_eval_cost_op ( enum math op, uint32_t digits )
+{
+	double m = gcmp_eval_cost_mul ( digits ), p = MAX ( 1.0, digits * 4 / 64.0 );
+
+	if ( op == POW || op == RUT ) return 60 * m * log2 ( p + 1 );
+
+	if ( op == MUL || op == DIV || op == PRC || op == MOD ) return 2 * m;
+
+	return p;
+}
+
+static double gcmp_eval_cost ( GcmpEval *eval, uint32_t digits, uint32_t *tasks );
+
+/* Cost of a term; terms above TASK_MIN are counted as tasks */
+static double gcmp_eval_cost_term ( Step *step, uint32_t digits, uint32_t *tasks )
+{
+	double cost = gcmp_eval_cost_fn ( step->fn, digits );
+
+	if ( step->nary != NNR )
+	{
+		uint32_t j = 0, n = step->args->len;
+
+		for ( j = 0; j < n; j++ ) cost += gcmp_eval_cost ( g_ptr_array_index ( step->args, j ), digits, tasks );
+
+		cost += n * gcmp_eval_cost_mul ( digits );
+
+		// A square and a product per bit of the power
+		if ( step->nary == PWM ) cost += digits * 4 * 2 * gcmp_eval_cost_mul ( digits );
+	}
+
+	if ( tasks && cost >= TASK_MIN ) *tasks += 1;
+
+	return cost;
+}
+
+static double gcmp_eval_cost ( GcmpEval *eval, uint32_t digits, uint32_t *tasks )
+{
+	double cost = 0;
+
+	uint32_t j = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		cost += gcmp_eval_cost_term ( step, digits, tasks );
+
+		if ( j ) cost += gcmp_eval_cost_op ( step->op, digits );
+	}
+
+	return cost;
+}
+
+static uint32_t gcmp_eval_terms ( GcmpEval *eval )
+{
+	uint32_t j = 0, k = 0, n = eval->steps->len;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		if ( step->args ) for ( k = 0; k < step->args->len; k++ ) n += gcmp_eval_terms ( g_ptr_array_index ( step->args, k ) );
+	}
+
+	return n;
+}
+
+static double gcmp_eval_bytes ( GcmpEval *eval, uint32_t digits )
+{
+	return (double)digits * 4 / 8 * ( gcmp_eval_terms ( eval ) + TEMPS_MIN );
+}
+
+gboolean gcmp_eval_admit ( GcmpEval *eval, uint32_t digits )
+{
+	return gcmp_cost_admit ( gcmp_eval_cost ( eval, digits, NULL ), gcmp_eval_bytes ( eval, digits ) );
+}
+
+gboolean gcmp_eval_admit_fn ( enum math_ext fn, uint32_t digits )
+{
+	return gcmp_cost_admit ( gcmp_eval_cost_fn ( fn, digits ), (double)digits * 4 / 8 * ( 2 + TEMPS_MIN ) );
+}
+
+static void gcmp_eval_frame_free ( Frame *frame )
+{
+	uint32_t j = 0;
+	for ( j = 0; j < frame->eval->steps->len; j++ )
+	{
+		Term *term = &frame->terms[j];
+
+		if ( term->args ) g_ptr_array_unref ( term->args );
+
+		mpfr_clear ( term->val );
+	}
+
+	mpfr_clear ( frame->res );
+
+	g_free ( frame->terms );
+	g_free ( frame );
+}
+
+static Frame * gcmp_eval_frame_new ( GcmpEval *eval, uint32_t digits, uint8_t deg_rad, mpfr_srcptr x )
+{
+	Frame *frame = g_new0 ( Frame, 1 );
+
+	frame->eval = eval;
+	frame->digits = digits;
+	frame->deg_rad = deg_rad;
+	frame->terms = g_new0 ( Term, eval->steps->len );
+	frame->cost = gcmp_eval_cost ( eval, digits, NULL );
+
+	mpfr_init2 ( frame->res, digits * 4 );
+
+	uint32_t j = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Term *term = &frame->terms[j];
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		term->step = step;
+		term->frame = frame;
+		term->cost = gcmp_eval_cost_term ( step, digits, NULL );
+
+		mpfr_init2 ( term->val, digits * 4 );
+
+		if ( step->var )
+		{
+			if ( x ) mpfr_set ( term->val, x, MPFR_RNDN ); else mpfr_set_nan ( term->val );
+		}
+		else if ( step->val )
+			mpfr_set ( term->val, step->val, MPFR_RNDN );
+		else if ( step->nary != NNR )
+		{
+			term->args = g_ptr_array_new_with_free_func ( (GDestroyNotify)gcmp_eval_frame_free );
+
+			uint32_t k = 0;
+			for ( k = 0; k < step->args->len; k++ ) g_ptr_array_add ( term->args, gcmp_eval_frame_new ( g_ptr_array_index ( step->args, k ), digits, deg_rad, x ) );
+		}
+		else
+			gcmp_mpfr_set_str ( term->val, step->num, eval->base );
+	}
+
+	return frame;
+}
+
+static void gcmp_eval_frame_run ( Frame *frame );
+
+static void gcmp_eval_term_run ( Term *term )
+{
+	Step *step = term->step;
+	Frame *frame = term->frame;
+
+	if ( step->nary != NNR )
+	{
+		uint32_t j = 0, n = term->args->len;
+
+		GcmpPoolGroup group = { 0 };
+
+		for ( j = 0; j < n; j++ )
+		{
+			Frame *arg = g_ptr_array_index ( term->args, j );
+
+			if ( arg->cost >= TASK_MIN ) gcmp_pool_spawn ( &group, (GcmpPoolFunc)gcmp_eval_frame_run, arg );
+		}
+
+		for ( j = 0; j < n; j++ )
+		{
+			Frame *arg = g_ptr_array_index ( term->args, j );
+
+			if ( arg->cost < TASK_MIN ) gcmp_eval_frame_run ( arg );
+		}
+
+		gcmp_pool_wait ( &group );
+
+		mpfr_ptr *args = g_new ( mpfr_ptr, n );
+
+		for ( j = 0; j < n; j++ ) args[j] = ( (Frame *)g_ptr_array_index ( term->args, j ) )->res;
+
+		gcmp_mpfr_op_nary ( step->nary, term->val, args, n );
+
+		g_free ( args );
+	}
+
+	if ( step->fn != UND )
+	{
+		mpfr_t t;
+		mpfr_init2 ( t, frame->digits * 4 );
+
+		gcmp_mpfr_op_ext ( step->fn, t, term->val, frame->digits, frame->deg_rad );
+		mpfr_swap ( term->val, t );
+
+		mpfr_clear ( t );
+	}
+}
+
+/* Costly terms go to the pool, the rest runs here; then the same left to right fold */
+static void gcmp_eval_frame_run ( Frame *frame )
+{
+	uint32_t j = 0, n = frame->eval->steps->len;
+
+	GcmpPoolGroup group = { 0 };
+
+	for ( j = 0; j < n; j++ ) if ( frame->terms[j].cost >= TASK_MIN ) gcmp_pool_spawn ( &group, (GcmpPoolFunc)gcmp_eval_term_run, &frame->terms[j] );
+
+	for ( j = 0; j < n; j++ ) if ( frame->terms[j].cost < TASK_MIN ) gcmp_eval_term_run ( &frame->terms[j] );
+
+	gcmp_pool_wait ( &group );
+
+	mpfr_t t;
+	mpfr_init2 ( t, frame->digits * 4 );
+
+	mpfr_set ( frame->res, frame->terms[0].val, MPFR_RNDN );
+
+	for ( j = 1; j < n; j++ )
+	{
+		gcmp_mpfr_op ( frame->terms[j].step->op, t, frame->res, frame->terms[j].val, frame->digits );
+		mpfr_swap ( frame->res, t );
+	}
+
+	mpfr_clear ( t );
+}
+
+/* Independent terms in parallel, when two of them at least are worth it; the result is the same bits */
+static gboolean gcmp_eval_run_par ( GcmpEval *eval, mpfr_t res, uint32_t digits, uint8_t deg_rad, mpfr_srcptr x )
+{
+	uint32_t tasks = 0;
+
+	gcmp_eval_cost ( eval, digits, &tasks );
+
+	if ( tasks < 2 || !gcmp_pool_get_workers () ) return FALSE;
+
+	Frame *frame = gcmp_eval_frame_new ( eval, digits, deg_rad, x );
+
+	gcmp_eval_frame_run ( frame );
+
+	mpfr_set_prec ( res, digits * 4 );
+	mpfr_set ( res, frame->res, MPFR_RNDN );
+
+	gcmp_eval_frame_free ( frame );
+
+	return TRUE;
+}
+
+void gcmp_eval_run_at ( GcmpEval *eval, mpfr_t res, uint32_t digits, uint8_t deg_rad, mpfr_srcptr x )
+{
+	if ( gcmp_eval_run_par ( eval, res, digits, deg_rad, x ) ) return;
+
+	mpfr_t a, t;
+
+	mpfr_init2 ( a, digits * 4 );
+	mpfr_init2 ( t, digits * 4 );
+	mpfr_set_prec ( res, digits * 4 );
+
+	uint32_t j = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		if ( step->var )
+		{
+			if ( x ) mpfr_set ( a, x, MPFR_RNDN ); else mpfr_set_nan ( a );
+		}
+		else if ( step->val )
+			mpfr_set ( a, step->val, MPFR_RNDN );
+		else if ( step->nary != NNR )
+			gcmp_eval_nary ( step, a, digits, deg_rad, x );
+		else
+			gcmp_mpfr_set_str ( a, step->num, eval->base );
+
+		if ( step->fn != UND ) { gcmp_mpfr_op_ext ( step->fn, t, a, digits, deg_rad ); mpfr_swap ( a, t ); }
+
+		if ( j == 0 ) { mpfr_set ( res, a, MPFR_RNDN ); continue; }
+
+		// The running value stays binary: no rounding to text between steps
+		gcmp_mpfr_op ( step->op, t, res, a, digits );
+		mpfr_swap ( res, t );
+	}
+
+	mpfr_clear ( a );
+	mpfr_clear ( t );
+}
+
+void gcmp_eval_keep ( GcmpEval *eval, mpfr_srcptr res )
+{
+	gcmp_vars_set ( "ans", res );
+
+	if ( eval->store ) gcmp_vars_set ( eval->store, res );
+}
+
+void gcmp_eval_run ( GcmpEval *eval, mpfr_t res, uint32_t digits, uint8_t deg_rad )
+{
+	if ( !gcmp_eval_admit ( eval, digits ) ) { mpfr_set_prec ( res, digits * 4 ); mpfr_set_nan ( res ); return; }
+
+	gcmp_eval_run_at ( eval, res, digits, deg_rad, NULL );
+
+	gcmp_eval_keep ( eval, res );
+}
+
+char * gcmp_eval_run_str ( GcmpEval *eval, uint32_t digits, uint8_t deg_rad )
+{
+	mpfr_t res;
+	mpfr_init2 ( res, digits * 4 );
+
+	gcmp_eval_run ( eval, res, digits, deg_rad );
+
+	// Printed in the base it was read in
+	char *out_str = gcmp_mpfr_get_str_base ( res, digits, eval->base );
+
+	mpfr_clear ( res );
+
+	return out_str;
+}
+
+/* Guard bits of the first ball run, and runs at most */
+#define BALL_GUARD 32
+#define BALL_RUNS 4
+
+static void gcmp_eval_ball ( GcmpEval *eval, GcmpBall *res, uint8_t deg_rad )
+{
+	GcmpBall a;
+	gcmp_ball_init ( &a, mpfr_get_prec ( res->mid ) );
+
+	uint32_t j = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		if ( step->var )
+			{ mpfr_set_nan ( a.mid ); mpfr_set_inf ( a.rad, 1 ); }
+		else if ( step->val )
+			gcmp_ball_set_fr ( &a, step->val );
+		else if ( step->nary != NNR )
+		{
+			uint32_t k = 0, n = step->args->len;
+
+			GcmpBall *b = g_new ( GcmpBall, n );
+			GcmpBall **args = g_new ( GcmpBall *, n );
+
+			for ( k = 0; k < n; k++ )
+			{
+				args[k] = &b[k];
+				gcmp_ball_init ( args[k], mpfr_get_prec ( res->mid ) );
+
+				gcmp_eval_ball ( g_ptr_array_index ( step->args, k ), args[k], deg_rad );
+			}
+
+			gcmp_ball_op_nary ( step->nary, &a, args, n );
+
+			for ( k = 0; k < n; k++ ) gcmp_ball_clear ( args[k] );
+
+			g_free ( args );
+			g_free ( b );
+		}
+		else
+			gcmp_ball_set_str ( &a, step->num, eval->base );
+
+		if ( step->fn != UND ) gcmp_ball_op_ext ( step->fn, &a, &a, deg_rad );
+
+		if ( j == 0 ) gcmp_ball_set ( res, &a ); else gcmp_ball_op ( step->op, res, res, &a );
+	}
+
+	gcmp_ball_clear ( &a );
+}
+
+uint32_t gcmp_eval_run_ball ( GcmpEval *eval, mpfr_t res, uint32_t digits, uint8_t deg_rad )
+{
+	double bits = log2 ( eval->base );
+	mpfr_prec_t prec = (mpfr_prec_t)ceil ( digits * bits ) + BALL_GUARD;
+
+	uint32_t got = 0;
+
+	uint8_t j = 0;
+	for ( j = 0; j < BALL_RUNS; j++ )
+	{
+		// Each run admitted at its own precision; the radii are short beside the midpoints
+		if ( !gcmp_eval_admit ( eval, (uint32_t)( prec / 4 + 1 ) ) ) { if ( !got ) { mpfr_set_prec ( res, prec ); mpfr_set_nan ( res ); } break; }
+
+		GcmpBall b;
+		gcmp_ball_init ( &b, prec );
+
+		gcmp_eval_ball ( eval, &b, deg_rad );
+
+		got = MIN ( gcmp_ball_digits ( &b, eval->base ), digits );
+
+		mpfr_set_prec ( res, prec );
+		mpfr_set ( res, b.mid, MPFR_RNDN );
+
+		gcmp_ball_clear ( &b );
+
+		if ( got == digits ) break;
+
+		// The digits lost to cancellation, and twice the guard
+		prec += (mpfr_prec_t)ceil ( ( digits - got ) * bits ) + ( BALL_GUARD << ( j + 1 ) );
+	}
+
+	if ( got ) gcmp_eval_keep ( eval, res );
+
+	return got;
+}
+
+/* The same operations in double precision, as close to the MPFR ones as libm allows */
+static double gcmp_eval_op_d ( enum math mt, double a, double b )
+{
+	if ( mt == ADD ) return a + b;
+	if ( mt == SUB ) return a - b;
+	if ( mt == MUL ) return a * b;
+	if ( mt == DIV ) return a / b;
+
+	if ( mt == POW ) return pow ( a, b );
+	if ( mt == MOD ) return fmod ( a, b );
+	if ( mt == PRC ) return a * b / 100.0;
+
+	if ( mt == RUT )
+	{
+		double n = trunc ( b );
+
+		if ( n < 1 ) return NAN;
+
+		if ( a < 0 ) return ( fmod ( n, 2 ) == 1 ) ? -pow ( -a, 1 / n ) : NAN;
+
+		return pow ( a, 1 / n );
+	}
+
+	return NAN;
+}
+
+static double gcmp_eval_op_ext_d ( enum math_ext mt, double a, uint8_t deg_rad )
+{
+	double r = ( deg_rad ) ? a * M_PI / 180 : a;
+
+	if ( mt == RT2 ) return sqrt ( a );
+	if ( mt == RT3 ) return cbrt ( a );
+
+	if ( mt == D1R ) return 1 / sqrt ( a );
+	if ( mt == D1X ) return 1 / a;
+
+	if ( mt == PW2 ) return a * a;
+	if ( mt == PW3 ) return a * a * a;
+
+	if ( mt == LGN ) return log   ( a );
+	if ( mt == LOG ) return log10 ( a );
+
+	if ( mt == FAC ) return ( trunc ( a ) > 1 ) ? tgamma ( trunc ( a ) + 1 ) : 1;
+
+	if ( mt == CPI ) return M_PI;
+	if ( mt == CEU ) return 0.57721566490153286061;
+	if ( mt == CEX ) return M_E;
+	if ( mt == CL2 ) return M_LN2;
+
+	if ( mt == SIN ) return sin ( r );
+	if ( mt == COS ) return cos ( r );
+	if ( mt == TAN ) return tan ( r );
+
+	return a;
+}
+
+static double gcmp_eval_nary_d ( Step *step, uint8_t deg_rad, double x )
+{
+	uint32_t j = 0, n = step->args->len;
+
+	double *a = g_new ( double, n ), res = 0;
+
+	for ( j = 0; j < n; j++ ) a[j] = gcmp_eval_run_d ( g_ptr_array_index ( step->args, j ), deg_rad, x );
+
+	if ( step->nary == DOT ) for ( j = 0; j < n / 2; j++ ) res = fma ( a[j], a[n / 2 + j], res );
+
+	if ( step->nary == FMA ) res = fma ( a[0], a[1],  a[2] );
+	if ( step->nary == FMS ) res = fma ( a[0], a[1], -a[2] );
+
+	if ( step->nary == FMMA ) res = fma ( a[0], a[1],  a[2] * a[3] );
+	if ( step->nary == FMMS ) res = fma ( a[0], a[1], -a[2] * a[3] );
+
+	if ( step->nary == PLY ) { res = a[1]; for ( j = 2; j < n; j++ ) res = fma ( res, a[0], a[j] ); }
+
+	// Integers of a double are exact in 64 bits
+	if ( step->nary == PWM || step->nary == GCD || step->nary == INV || step->nary == PRM )
+	{
+		mpfr_t r, *b = g_new ( mpfr_t, n );
+		mpfr_ptr *args = g_new ( mpfr_ptr, n );
+
+		mpfr_init2 ( r, 64 );
+		for ( j = 0; j < n; j++ ) { mpfr_init2 ( b[j], 64 ); mpfr_set_d ( b[j], a[j], MPFR_RNDN ); args[j] = b[j]; }
+
+		gcmp_mpfr_op_nary ( step->nary, r, args, n );
+		res = mpfr_get_d ( r, MPFR_RNDN );
+
+		for ( j = 0; j < n; j++ ) mpfr_clear ( b[j] );
+
+		mpfr_clear ( r );
+		g_free ( args );
+		g_free ( b );
+	}
+
+	g_free ( a );
+
+	return res;
+}
+
+double gcmp_eval_run_d ( GcmpEval *eval, uint8_t deg_rad, double x )
+{
+	double res = 0;
+
+	uint32_t j = 0;
+	for ( j = 0; j < eval->steps->len; j++ )
+	{
+		Step *step = &g_array_index ( eval->steps, Step, j );
+
+		double a = ( step->var ) ? x : ( step->nary != NNR ) ? gcmp_eval_nary_d ( step, deg_rad, x ) : step->d;
+
+		if ( step->fn != UND ) a = gcmp_eval_op_ext_d ( step->fn, a, deg_rad );
+
+		res = ( j == 0 ) ? a : gcmp_eval_op_d ( step->op, res, a );
+	}
+
+	return res;
+}
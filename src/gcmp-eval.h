@@ -0,0 +1,59 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+typedef struct _GcmpEval GcmpEval;
+
+GcmpEval * gcmp_eval_new ( const char *, uint8_t );
+
+/* The same, where #k stands for the k-th of the values: a number shown for one held in full ( gcmp-entry.c ) */
+GcmpEval * gcmp_eval_new_bound ( const char *, uint8_t, mpfr_srcptr *, uint32_t );
+
+/* A copy with the numbers read once at these digits, for many gcmp_eval_run_at at them ( gcmp-tab.c ); not for balls */
+GcmpEval * gcmp_eval_new_at ( GcmpEval *, uint32_t );
+
+void gcmp_eval_free ( GcmpEval * );
+
+gboolean gcmp_eval_is_plain ( GcmpEval * );
+
+/* Some value was bound when compiled ( a name, #k ): at more digits it is still the one it was */
+gboolean gcmp_eval_is_bound ( GcmpEval * );
+
+/* FALSE, and the thread flagged ( gcmp-cost.h ), if a run at these digits is over the limits: time and values alive */
+gboolean gcmp_eval_admit ( GcmpEval *, uint32_t );
+
+/* The same for one function of a value ( the keys that act on the entry ) */
+gboolean gcmp_eval_admit_fn ( enum math_ext, uint32_t );
+
+/* A result at the top is ans, and the name it was stored to; in this thread's variables ( gcmp-vars.h ) */
+void gcmp_eval_keep ( GcmpEval *, mpfr_srcptr );
+
+/* Admitted first: a refused run gives nan; kept */
+void gcmp_eval_run ( GcmpEval *, mpfr_t, uint32_t, uint8_t );
+
+/* The same with a value for x ( nan without one ); the compiled expression is only read, threads may share it */
+void gcmp_eval_run_at ( GcmpEval *, mpfr_t, uint32_t, uint8_t, mpfr_srcptr );
+
+/* Double precision at x: fast, for plotting; the numbers were rounded to double when compiled */
+double gcmp_eval_run_d ( GcmpEval *, uint8_t, double );
+
+char * gcmp_eval_run_str ( GcmpEval *, uint32_t, uint8_t );
+
+/*
+* Ball arithmetic ( gcmp-ball.h ): the result is the midpoint, the return the digits of the base it certifies, up to the ones asked for.
+* The precision starts near those digits and grows by what was lost, only while they are not certified.
+* Each run is admitted first: a refused first one gives nan and 0.
+*/
+uint32_t gcmp_eval_run_ball ( GcmpEval *, mpfr_t, uint32_t, uint8_t );
+
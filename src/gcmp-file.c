@@ -0,0 +1,321 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-file.h"
+#include "gcmp-digits.h"
+#include "gcmp-scan.h"
+
+#include <errno.h>
+
+/* Digits per chunk ( eight, parsed in one word ) and chunks per leaf of the merge */
+#define CHUNK_DIGITS 8
+#define CHUNK_BASE 100000000u
+#define LEAF_CHUNKS 32
+
+/* Digits per write */
+#define WRITE_DIGITS 65536
+
+/* Largest exponent accepted in a file */
+#define EXP_MAX 1000000000000000
+
+typedef struct _Scan Scan;
+
+struct _Scan
+{
+	GArray *chunks;
+
+	uint32_t chunk;
+	uint8_t chunk_len;
+
+	uint64_t keep;
+	uint64_t kept;
+
+	int64_t exp;
+	gboolean neg;
+};
+
+/* Appends a run of digits: the open chunk first, then whole chunks a word at a time */
+static void gcmp_file_push_run ( Scan *scan, const char *d, size_t n )
+{
+	size_t k = 0;
+
+	scan->kept += n;
+
+	for ( ; k < n && scan->chunk_len; k++ )
+	{
+		scan->chunk = scan->chunk * 10 + (uint32_t)( d[k] - '0' );
+
+		if ( ++scan->chunk_len < CHUNK_DIGITS ) continue;
+
+		g_array_append_val ( scan->chunks, scan->chunk );
+
+		scan->chunk = 0;
+		scan->chunk_len = 0;
+	}
+
+	for ( ; k + CHUNK_DIGITS <= n; k += CHUNK_DIGITS )
+	{
+		uint32_t v = gcmp_scan_parse8 ( d + k );
+		g_array_append_val ( scan->chunks, v );
+	}
+
+	for ( ; k < n; k++, scan->chunk_len++ ) scan->chunk = scan->chunk * 10 + (uint32_t)( d[k] - '0' );
+}
+
+/* One pass: validates and packs the digits; the offset where parsing stopped goes to end */
+static gboolean gcmp_file_scan ( const char *data, size_t len, Scan *scan, size_t *end )
+{
+	size_t i = 0;
+
+	i += gcmp_scan_blanks ( data, len );
+
+	if ( i < len && ( data[i] == '-' || data[i] == '+' ) ) { scan->neg = ( data[i] == '-' ); i++; }
+
+	gboolean point = FALSE, any = FALSE, lead = TRUE;
+
+	while ( i < len )
+	{
+		char c = data[i];
+
+		if ( c >= '0' && c <= '9' )
+		{
+			const char *d = data + i;
+			size_t n = gcmp_scan_digits ( d, len - i ), k = 0;
+
+			any = TRUE;
+			i += n;
+
+			// Leading zeros carry no digits, only scale after the point
+			if ( lead )
+			{
+				while ( k < n && d[k] == '0' ) k++;
+
+				if ( point ) scan->exp -= (int64_t)k;
+				if ( k < n ) lead = FALSE;
+			}
+
+			// Digits past the precision only scale the value
+			size_t rest = n - k, take = ( rest < scan->keep - scan->kept ) ? rest : (size_t)( scan->keep - scan->kept );
+
+			gcmp_file_push_run ( scan, d + k, take );
+
+			if ( point ) scan->exp -= (int64_t)take; else scan->exp += (int64_t)( rest - take );
+
+			continue;
+		}
+
+		if ( c == '.' && !point ) { point = TRUE; i++; continue; }
+
+		size_t b = gcmp_scan_blanks ( data + i, len - i );
+
+		if ( !b ) break;
+
+		i += b;
+	}
+
+	*end = i;
+
+	if ( !any ) return FALSE;
+
+	if ( i < len && ( data[i] == 'e' || data[i] == 'E' ) )
+	{
+		i++;
+
+		gboolean neg = FALSE;
+		if ( i < len && ( data[i] == '-' || data[i] == '+' ) ) { neg = ( data[i] == '-' ); i++; }
+
+		*end = i;
+
+		if ( i == len || !g_ascii_isdigit ( data[i] ) ) return FALSE;
+
+		int64_t exp = 0;
+		for ( ; i < len && g_ascii_isdigit ( data[i] ); i++ )
+		{
+			exp = exp * 10 + ( data[i] - '0' );
+
+			if ( exp > EXP_MAX ) { *end = i; return FALSE; }
+		}
+
+		scan->exp += ( neg ) ? -exp : exp;
+	}
+
+	i += gcmp_scan_blanks ( data + i, len - i );
+
+	*end = i;
+
+	return ( i == len );
+}
+
+/* Chunks ( most significant first ) to one integer: leaves by Horner, then pairs merged level by level */
+static void gcmp_file_merge ( GArray *chunks, mpz_t res )
+{
+	uint32_t n_chunks = chunks->len;
+	uint32_t n = ( n_chunks + LEAF_CHUNKS - 1 ) / LEAF_CHUNKS;
+
+	if ( n == 0 ) { mpz_set_ui ( res, 0 ); return; }
+
+	// v[0] is the least significant leaf; the most significant one may be short
+	__mpz_struct *v = g_new ( __mpz_struct, n );
+
+	uint32_t i = 0, j = 0;
+	for ( i = 0; i < n; i++ )
+	{
+		mpz_init ( &v[i] );
+
+		uint32_t end = n_chunks - i * LEAF_CHUNKS;
+		uint32_t start = ( end > LEAF_CHUNKS ) ? end - LEAF_CHUNKS : 0;
+
+		for ( j = start; j < end; j++ )
+		{
+			mpz_mul_ui ( &v[i], &v[i], CHUNK_BASE );
+			mpz_add_ui ( &v[i], &v[i], g_array_index ( chunks, uint32_t, j ) );
+		}
+	}
+
+	mpz_t pow;
+	mpz_init ( pow );
+	mpz_ui_pow_ui ( pow, CHUNK_BASE, LEAF_CHUNKS );
+
+	for ( ; n > 1; n = ( n + 1 ) / 2 )
+	{
+		for ( i = 0; 2 * i < n; i++ )
+		{
+			if ( 2 * i + 1 < n )
+			{
+				mpz_mul ( &v[2*i+1], &v[2*i+1], pow );
+				mpz_add ( &v[i], &v[2*i], &v[2*i+1] );
+			}
+			else
+				mpz_swap ( &v[i], &v[2*i] );
+		}
+
+		if ( n > 2 ) mpz_mul ( pow, pow, pow );
+	}
+
+	mpz_swap ( res, &v[0] );
+
+	for ( i = 0; i < ( n_chunks + LEAF_CHUNKS - 1 ) / LEAF_CHUNKS; i++ ) mpz_clear ( &v[i] );
+
+	g_free ( v );
+	mpz_clear ( pow );
+}
+
+static void gcmp_file_value ( Scan *scan, mpfr_t val, uint32_t digits )
+{
+	// The last chunk is filled up with zeros
+	if ( scan->chunk_len )
+	{
+		uint8_t pad = CHUNK_DIGITS - scan->chunk_len;
+
+		scan->exp -= pad;
+		while ( pad-- ) scan->chunk *= 10;
+
+		g_array_append_val ( scan->chunks, scan->chunk );
+	}
+
+	mpz_t z;
+	mpz_init ( z );
+	gcmp_file_merge ( scan->chunks, z );
+
+	mpfr_set_prec ( val, digits * 4 );
+
+	if ( scan->exp == 0 || mpz_sgn ( z ) == 0 )
+		mpfr_set_z ( val, z, MPFR_RNDN );
+	else
+	{
+		mpfr_t m, p;
+		mpfr_init2 ( m, MAX ( (mpfr_prec_t)mpz_sizeinbase ( z, 2 ), MPFR_PREC_MIN ) );
+		mpfr_init2 ( p, digits * 4 + 64 );
+
+		mpfr_set_z ( m, z, MPFR_RNDN );
+		mpfr_ui_pow_ui ( p, 10, (unsigned long)( ( scan->exp > 0 ) ? scan->exp : -scan->exp ), MPFR_RNDN );
+
+		if ( scan->exp > 0 )
+			mpfr_mul ( val, m, p, MPFR_RNDN );
+		else
+			mpfr_div ( val, m, p, MPFR_RNDN );
+
+		mpfr_clear ( m );
+		mpfr_clear ( p );
+	}
+
+	if ( scan->neg ) mpfr_neg ( val, val, MPFR_RNDN );
+
+	mpz_clear ( z );
+}
+
+gboolean gcmp_file_import ( const char *path, mpfr_t val, uint32_t digits, GError **error )
+{
+	GMappedFile *mapped = g_mapped_file_new ( path, FALSE, error );
+
+	if ( !mapped ) return FALSE;
+
+	const char *data = g_mapped_file_get_contents ( mapped );
+	size_t len = g_mapped_file_get_length ( mapped );
+
+	// 4 bits per digit of precision, and a few more to round from
+	Scan scan = { g_array_new ( FALSE, FALSE, sizeof ( uint32_t ) ), 0, 0, (uint64_t)digits * 5 / 4 + 16, 0, 0, FALSE };
+
+	size_t end = 0;
+	gboolean ret = gcmp_file_scan ( data, len, &scan, &end );
+
+	if ( ret )
+		gcmp_file_value ( &scan, val, digits );
+	else
+		g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s: not a number ( byte %zu )", path, end + 1 );
+
+	g_array_free ( scan.chunks, TRUE );
+	g_mapped_file_unref ( mapped );
+
+	return ret;
+}
+
+gboolean gcmp_file_export ( const char *path, mpfr_t val, uint32_t digits, GError **error )
+{
+	FILE *file = fopen ( path, "wb" );
+
+	if ( !file ) { g_set_error ( error, G_FILE_ERROR, g_file_error_from_errno ( errno ), "%s: %s", path, g_strerror ( errno ) ); return FALSE; }
+
+	if ( !mpfr_regular_p ( val ) )
+		mpfr_fprintf ( file, "%Rg\n", val );
+	else
+	{
+		// d.ddd...e+N, formatted one block at a time
+		GcmpDigits *dg = gcmp_digits_new ( val, digits );
+		char *buf = g_malloc ( WRITE_DIGITS + 1 );
+
+		uint32_t pos = 1, n = 0, len = gcmp_digits_get_len ( dg );
+
+		if ( gcmp_digits_is_neg ( dg ) ) fputc ( '-', file );
+
+		gcmp_digits_get ( dg, 0, 1, buf );
+		fputs ( buf, file );
+
+		if ( len > 1 ) fputc ( '.', file );
+
+		for ( pos = 1; pos < len; pos += n )
+		{
+			n = gcmp_digits_get ( dg, pos, WRITE_DIGITS, buf );
+			fwrite ( buf, 1, n, file );
+		}
+
+		fprintf ( file, "e%+ld\n", gcmp_digits_get_exp ( dg ) - 1 );
+
+		g_free ( buf );
+		gcmp_digits_free ( dg );
+	}
+
+	gboolean ret = !ferror ( file );
+
+	if ( fclose ( file ) != 0 ) ret = FALSE;
+
+	if ( !ret ) g_set_error ( error, G_FILE_ERROR, g_file_error_from_errno ( errno ), "%s: %s", path, g_strerror ( errno ) );
+
+	return ret;
+}
@@ -0,0 +1,21 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+/* Decimal number from a file: [ sign ] digits [ . digits ] [ e exp ]; blanks between digits are skipped */
+gboolean gcmp_file_import ( const char *, mpfr_t, uint32_t, GError ** );
+
+/* Decimal number to a file, written block by block */
+gboolean gcmp_file_export ( const char *, mpfr_t, uint32_t, GError ** );
+
@@ -0,0 +1,157 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-gap.h"
+
+#include <string.h>
+
+/* Bytes of the first gap */
+#define GAP_MIN 256
+
+struct _GcmpGap
+{
+	char *buf;
+	size_t size;
+
+	// Bytes [ start, end ) are the gap
+	size_t start;
+	size_t end;
+
+	// Characters before the gap, and in all
+	uint32_t pos;
+	uint32_t len;
+};
+
+GcmpGap * gcmp_gap_new ( void )
+{
+	GcmpGap *gap = g_new0 ( GcmpGap, 1 );
+
+	gap->size = GAP_MIN;
+	gap->buf  = g_malloc ( gap->size );
+	gap->end  = gap->size;
+
+	return gap;
+}
+
+void gcmp_gap_free ( GcmpGap *gap )
+{
+	g_free ( gap->buf );
+	g_free ( gap );
+}
+
+/* Moves the gap to a position: only the text between the two is copied */
+static void gcmp_gap_move ( GcmpGap *gap, uint32_t pos )
+{
+	size_t n = 0;
+
+	if ( pos < gap->pos )
+	{
+		const char *p = gap->buf + gap->start;
+
+		for ( ; gap->pos > pos; gap->pos-- ) p = g_utf8_prev_char ( p );
+
+		n = (size_t)( gap->buf + gap->start - p );
+
+		memmove ( gap->buf + gap->end - n, p, n );
+
+		gap->start -= n;
+		gap->end   -= n;
+	}
+	else if ( pos > gap->pos )
+	{
+		const char *p = gap->buf + gap->end;
+
+		for ( ; gap->pos < pos && p < gap->buf + gap->size; gap->pos++ ) p = g_utf8_next_char ( p );
+
+		n = (size_t)( p - ( gap->buf + gap->end ) );
+
+		memmove ( gap->buf + gap->start, gap->buf + gap->end, n );
+
+		gap->start += n;
+		gap->end   += n;
+	}
+}
+
+/* At least n free bytes: the buffer doubles, so long pastes stay linear */
+static void gcmp_gap_reserve ( GcmpGap *gap, size_t n )
+{
+	if ( gap->end - gap->start >= n ) return;
+
+	size_t back = gap->size - gap->end;
+	size_t size = MAX ( gap->size * 2, gap->size + n );
+
+	gap->buf = g_realloc ( gap->buf, size );
+
+	memmove ( gap->buf + size - back, gap->buf + gap->end, back );
+
+	gap->end  = size - back;
+	gap->size = size;
+}
+
+void gcmp_gap_insert ( GcmpGap *gap, uint32_t pos, const char *text, size_t n )
+{
+	gcmp_gap_move ( gap, MIN ( pos, gap->len ) );
+	gcmp_gap_reserve ( gap, n );
+
+	memcpy ( gap->buf + gap->start, text, n );
+	gap->start += n;
+
+	uint32_t chars = (uint32_t)g_utf8_strlen ( text, (gssize)n );
+
+	gap->pos += chars;
+	gap->len += chars;
+}
+
+void gcmp_gap_delete ( GcmpGap *gap, uint32_t start, uint32_t end )
+{
+	end = MIN ( end, gap->len );
+
+	if ( start >= end ) return;
+
+	gcmp_gap_move ( gap, start );
+
+	const char *p = gap->buf + gap->end;
+
+	uint32_t j = 0;
+	for ( j = start; j < end; j++ ) p = g_utf8_next_char ( p );
+
+	gap->end  = (size_t)( p - gap->buf );
+	gap->len -= end - start;
+}
+
+uint32_t gcmp_gap_get_length ( GcmpGap *gap )
+{
+	return gap->len;
+}
+
+uint32_t gcmp_gap_get_pos ( GcmpGap *gap )
+{
+	return gap->pos;
+}
+
+const char * gcmp_gap_get_front ( GcmpGap *gap, size_t *size )
+{
+	*size = gap->start;
+
+	return gap->buf;
+}
+
+char * gcmp_gap_get_text ( GcmpGap *gap )
+{
+	size_t back = gap->size - gap->end;
+
+	char *text = g_malloc ( gap->start + back + 1 );
+
+	memcpy ( text, gap->buf, gap->start );
+	memcpy ( text + gap->start, gap->buf + gap->end, back );
+
+	text[gap->start + back] = '\0';
+
+	return text;
+}
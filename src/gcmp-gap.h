@@ -0,0 +1,40 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+/*
+* Gap buffer of UTF-8 text: the gap follows the last edit, so typing at one place
+* moves nothing, and the text before it ( up to that edit ) is one contiguous span.
+* Positions are in characters, as in GtkEditable.
+*/
+typedef struct _GcmpGap GcmpGap;
+
+GcmpGap * gcmp_gap_new ( void );
+
+void gcmp_gap_free ( GcmpGap * );
+
+/* Bytes of text at a position; the gap ends up after them */
+void gcmp_gap_insert ( GcmpGap *, uint32_t, const char *, size_t );
+
+/* Characters [ start, end ); the gap ends up at start */
+void gcmp_gap_delete ( GcmpGap *, uint32_t, uint32_t );
+
+uint32_t gcmp_gap_get_length ( GcmpGap * );
+
+/* Position of the gap */
+uint32_t gcmp_gap_get_pos ( GcmpGap * );
+
+/* Text before the gap, not NUL terminated; its size in bytes goes to the second argument */
+const char * gcmp_gap_get_front ( GcmpGap *, size_t * );
+
+/* The whole text, newly allocated */
+char * gcmp_gap_get_text ( GcmpGap * );
@@ -0,0 +1,252 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-history.h"
+#include "gcmp-mpfr.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+
+/*
+* Append-only log: magic, then records.
+* Record: uint32 expr_len, res_len, bin_len; expr; res; bin ( mpfr_fpif_export ).
+*/
+#define HISTORY_MAGIC "GCMPHIS1"
+#define HISTORY_MAGIC_LEN 8
+#define HISTORY_HEAD_LEN ( 3 * sizeof ( uint32_t ) )
+
+typedef struct _Record Record;
+
+struct _Record
+{
+	const char *expr;
+	const char *res;
+	const char *bin;
+
+	uint32_t expr_len;
+	uint32_t res_len;
+	uint32_t bin_len;
+};
+
+struct _GcmpHistory
+{
+	char *path;
+	FILE *file;
+
+	GMappedFile *mapped;
+	GArray *offsets;
+	GPtrArray *session;
+
+	size_t valid_len;
+
+	gboolean reset;
+	gboolean scanned;
+};
+
+static size_t gcmp_history_record_read ( const char *data, size_t len, Record *rec )
+{
+	if ( len < HISTORY_HEAD_LEN ) return 0;
+
+	uint32_t head[3];
+	memcpy ( head, data, HISTORY_HEAD_LEN );
+
+	size_t size = HISTORY_HEAD_LEN + (size_t)head[0] + (size_t)head[1] + (size_t)head[2];
+
+	if ( size > len ) return 0;
+
+	rec->expr_len = head[0];
+	rec->res_len  = head[1];
+	rec->bin_len  = head[2];
+
+	rec->expr = data + HISTORY_HEAD_LEN;
+	rec->res  = rec->expr + rec->expr_len;
+	rec->bin  = rec->res  + rec->res_len;
+
+	return size;
+}
+
+static void gcmp_history_scan ( GcmpHistory *history )
+{
+	history->scanned = TRUE;
+
+	if ( !history->mapped ) return;
+
+	const char *data = g_mapped_file_get_contents ( history->mapped );
+	size_t len = g_mapped_file_get_length ( history->mapped );
+
+	Record rec;
+	size_t size = 0, offset = HISTORY_MAGIC_LEN;
+
+	// A record cut short by a crash ends the scan
+	while ( ( size = gcmp_history_record_read ( data + offset, len - offset, &rec ) ) )
+	{
+		uint64_t off = offset;
+		g_array_append_val ( history->offsets, off );
+
+		offset += size;
+	}
+
+	history->valid_len = offset;
+}
+
+static gboolean gcmp_history_get_record ( GcmpHistory *history, uint32_t num, Record *rec )
+{
+	if ( !history->scanned ) gcmp_history_scan ( history );
+
+	if ( num < history->offsets->len )
+	{
+		const char *data = g_mapped_file_get_contents ( history->mapped );
+		size_t len = g_mapped_file_get_length ( history->mapped );
+		uint64_t off = g_array_index ( history->offsets, uint64_t, num );
+
+		return ( gcmp_history_record_read ( data + off, len - off, rec ) > 0 );
+	}
+
+	num -= history->offsets->len;
+
+	if ( num >= history->session->len ) return FALSE;
+
+	return ( gcmp_history_record_read ( g_ptr_array_index ( history->session, num ), G_MAXSIZE, rec ) > 0 );
+}
+
+static void gcmp_history_write ( GcmpHistory *history, const char *block, size_t size )
+{
+	if ( !history->file )
+	{
+		g_autofree char *dir = g_path_get_dirname ( history->path );
+		g_mkdir_with_parents ( dir, 0700 );
+
+		if ( !history->scanned ) gcmp_history_scan ( history );
+
+		// Drop a torn tail so that new records stay reachable
+		if ( history->mapped && history->valid_len < g_mapped_file_get_length ( history->mapped ) )
+			if ( truncate ( history->path, (off_t)history->valid_len ) != 0 ) g_warning ( "%s: %s ", __func__, g_strerror ( errno ) );
+
+		history->file = fopen ( history->path, ( history->reset ) ? "wb" : "ab" );
+
+		if ( !history->file ) { g_warning ( "%s: %s ", __func__, g_strerror ( errno ) ); return; }
+
+		fseek ( history->file, 0, SEEK_END );
+		if ( ftell ( history->file ) == 0 ) fwrite ( HISTORY_MAGIC, 1, HISTORY_MAGIC_LEN, history->file );
+	}
+
+	fwrite ( block, 1, size, history->file );
+	fflush ( history->file );
+}
+
+uint32_t gcmp_history_get_n_rows ( GcmpHistory *history )
+{
+	if ( !history->scanned ) gcmp_history_scan ( history );
+
+	return history->offsets->len + history->session->len;
+}
+
+void gcmp_history_get_row ( GcmpHistory *history, uint32_t num, char **expr, char **res )
+{
+	Record rec;
+
+	if ( !gcmp_history_get_record ( history, num, &rec ) ) { *expr = g_strdup ( "" ); *res = g_strdup ( "" ); return; }
+
+	*expr = g_strndup ( rec.expr, rec.expr_len );
+	*res  = g_strndup ( rec.res,  rec.res_len  );
+}
+
+gboolean gcmp_history_get_value ( GcmpHistory *history, uint32_t num, mpfr_t val )
+{
+	Record rec;
+
+	if ( !gcmp_history_get_record ( history, num, &rec ) || rec.bin_len == 0 ) return FALSE;
+
+	FILE *fp = fmemopen ( (void *)rec.bin, rec.bin_len, "rb" );
+
+	if ( !fp ) return FALSE;
+
+	int ret = mpfr_fpif_import ( val, fp );
+	fclose ( fp );
+
+	return ( ret == 0 );
+}
+
+/* Binary of the value, malloc'd; returns size, 0 if none */
+static size_t gcmp_history_export ( mpfr_srcptr val, char **data )
+{
+	size_t len = 0;
+	FILE *fp = ( val ) ? open_memstream ( data, &len ) : NULL;
+
+	if ( !fp ) return 0;
+
+	int ret = mpfr_fpif_export ( fp, (mpfr_ptr)val );
+	fclose ( fp );
+
+	if ( ret != 0 ) { free ( *data ); *data = NULL; return 0; }
+
+	return len;
+}
+
+void gcmp_history_append ( GcmpHistory *history, const char *expr, const char *res, mpfr_srcptr val )
+{
+	char *bin = NULL;
+	size_t bin_len = gcmp_history_export ( val, &bin );
+
+	uint32_t head[3] = { (uint32_t)strlen ( expr ), (uint32_t)strlen ( res ), (uint32_t)bin_len };
+	size_t size = HISTORY_HEAD_LEN + (size_t)head[0] + (size_t)head[1] + (size_t)head[2];
+
+	char *block = g_malloc ( size );
+
+	memcpy ( block, head, HISTORY_HEAD_LEN );
+	memcpy ( block + HISTORY_HEAD_LEN, expr, head[0] );
+	memcpy ( block + HISTORY_HEAD_LEN + head[0], res, head[1] );
+	if ( bin_len ) memcpy ( block + HISTORY_HEAD_LEN + head[0] + head[1], bin, bin_len );
+
+	free ( bin );
+
+	g_ptr_array_add ( history->session, block );
+	gcmp_history_write ( history, block, size );
+}
+
+GcmpHistory * gcmp_history_new ( void )
+{
+	GcmpHistory *history = g_new0 ( GcmpHistory, 1 );
+
+	history->path = g_build_filename ( g_get_user_data_dir (), "gcmp", "history", NULL );
+	history->offsets = g_array_new ( FALSE, FALSE, sizeof ( uint64_t ) );
+	history->session = g_ptr_array_new_with_free_func ( g_free );
+
+	// Only map here: records are indexed on first use and decoded when shown
+	history->mapped = g_mapped_file_new ( history->path, FALSE, NULL );
+
+	if ( history->mapped )
+	{
+		const char *data = g_mapped_file_get_contents ( history->mapped );
+		size_t len = g_mapped_file_get_length ( history->mapped );
+
+		if ( len < HISTORY_MAGIC_LEN || memcmp ( data, HISTORY_MAGIC, HISTORY_MAGIC_LEN ) != 0 )
+		{
+			g_mapped_file_unref ( history->mapped );
+
+			history->mapped = NULL;
+			history->reset  = TRUE;
+		}
+	}
+
+	return history;
+}
+
+void gcmp_history_free ( GcmpHistory *history )
+{
+	if ( history->file ) fclose ( history->file );
+	if ( history->mapped ) g_mapped_file_unref ( history->mapped );
+
+	g_array_free ( history->offsets, TRUE );
+	g_ptr_array_free ( history->session, TRUE );
+
+	g_free ( history->path );
+	g_free ( history );
+}
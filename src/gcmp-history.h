@@ -0,0 +1,31 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+typedef struct _GcmpHistory GcmpHistory;
+
+GcmpHistory * gcmp_history_new ( void );
+
+void gcmp_history_free ( GcmpHistory * );
+
+uint32_t gcmp_history_get_n_rows ( GcmpHistory * );
+
+void gcmp_history_get_row ( GcmpHistory *, uint32_t, char **, char ** );
+
+/* Expression, result text and the result's value in binary ( NULL: the text alone ) */
+void gcmp_history_append ( GcmpHistory *, const char *, const char *, mpfr_srcptr );
+
+/* The row's value at its own precision; FALSE if it has none */
+gboolean gcmp_history_get_value ( GcmpHistory *, uint32_t, mpfr_t );
+
@@ -0,0 +1,149 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-index.h"
+
+/* n-grams of 1 .. GRAM_MAX bytes; posting lists hold row numbers in ascending order */
+#define GRAM_MAX 3
+
+struct _GcmpIndex
+{
+	GHashTable *grams;
+	GPtrArray *texts;
+	GStringChunk *chunk;
+};
+
+static uint32_t gcmp_index_gram ( const char *str, uint8_t n )
+{
+	uint32_t key = (uint32_t)n << 24;
+
+	uint8_t j = 0;
+	for ( j = 0; j < n; j++ ) key |= (uint32_t)(uint8_t)str[j] << ( 16 - j * 8 );
+
+	return key;
+}
+
+static GArray * gcmp_index_posting ( GcmpIndex *index, uint32_t key )
+{
+	return g_hash_table_lookup ( index->grams, GUINT_TO_POINTER ( key ) );
+}
+
+uint32_t gcmp_index_add ( GcmpIndex *index, const char *expr, const char *res )
+{
+	uint32_t num = index->texts->len;
+
+	g_autofree char *str  = g_strdup_printf ( "%s\n%s", expr, res );
+	g_autofree char *text = g_ascii_strdown ( str, -1 );
+
+	g_ptr_array_add ( index->texts, g_string_chunk_insert ( index->chunk, text ) );
+
+	size_t i = 0, len = strlen ( text );
+
+	for ( i = 0; i < len; i++ )
+	{
+		uint8_t n = 0;
+
+		for ( n = 1; n <= GRAM_MAX && i + n <= len; n++ )
+		{
+			uint32_t key = gcmp_index_gram ( text + i, n );
+			GArray *posting = gcmp_index_posting ( index, key );
+
+			if ( !posting )
+			{
+				posting = g_array_new ( FALSE, FALSE, sizeof ( uint32_t ) );
+				g_hash_table_insert ( index->grams, GUINT_TO_POINTER ( key ), posting );
+			}
+
+			if ( posting->len && g_array_index ( posting, uint32_t, posting->len - 1 ) == num ) continue;
+
+			g_array_append_val ( posting, num );
+		}
+	}
+
+	return num;
+}
+
+static gboolean gcmp_index_is_prefix ( const char *text, const char *query )
+{
+	if ( g_str_has_prefix ( text, query ) ) return TRUE;
+
+	const char *res = strchr ( text, '\n' );
+
+	return ( res && g_str_has_prefix ( res + 1, query ) );
+}
+
+GArray * gcmp_index_search ( GcmpIndex *index, const char *query, uint32_t max )
+{
+	GArray *found = g_array_new ( FALSE, FALSE, sizeof ( uint32_t ) );
+
+	g_autofree char *text = g_ascii_strdown ( query, -1 );
+	size_t i = 0, len = strlen ( text );
+
+	if ( len == 0 ) return found;
+
+	// Short queries are grams themselves; longer ones start from the rarest gram and are verified
+	GArray *posting = NULL;
+
+	if ( len <= GRAM_MAX )
+		posting = gcmp_index_posting ( index, gcmp_index_gram ( text, (uint8_t)len ) );
+	else
+	{
+		for ( i = 0; i + GRAM_MAX <= len; i++ )
+		{
+			GArray *cand = gcmp_index_posting ( index, gcmp_index_gram ( text + i, GRAM_MAX ) );
+
+			if ( !cand ) return found;
+
+			if ( !posting || cand->len < posting->len ) posting = cand;
+		}
+	}
+
+	if ( !posting ) return found;
+
+	// Newest first; rows starting with the query go before other matches
+	GArray *other = g_array_new ( FALSE, FALSE, sizeof ( uint32_t ) );
+
+	for ( i = posting->len; i > 0 && found->len < max; i-- )
+	{
+		uint32_t num = g_array_index ( posting, uint32_t, i - 1 );
+		const char *row = g_ptr_array_index ( index->texts, num );
+
+		if ( len > GRAM_MAX && !strstr ( row, text ) ) continue;
+
+		if ( gcmp_index_is_prefix ( row, text ) )
+			g_array_append_val ( found, num );
+		else if ( found->len + other->len < max )
+			g_array_append_val ( other, num );
+	}
+
+	g_array_append_vals ( found, other->data, MIN ( other->len, max - found->len ) );
+	g_array_free ( other, TRUE );
+
+	return found;
+}
+
+GcmpIndex * gcmp_index_new ( void )
+{
+	GcmpIndex *index = g_new0 ( GcmpIndex, 1 );
+
+	index->grams = g_hash_table_new_full ( g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_array_unref );
+	index->texts = g_ptr_array_new ();
+	index->chunk = g_string_chunk_new ( 4096 );
+
+	return index;
+}
+
+void gcmp_index_free ( GcmpIndex *index )
+{
+	g_hash_table_destroy ( index->grams );
+	g_ptr_array_free ( index->texts, TRUE );
+	g_string_chunk_free ( index->chunk );
+
+	g_free ( index );
+}
@@ -0,0 +1,23 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+typedef struct _GcmpIndex GcmpIndex;
+
+GcmpIndex * gcmp_index_new ( void );
+
+void gcmp_index_free ( GcmpIndex * );
+
+uint32_t gcmp_index_add ( GcmpIndex *, const char *, const char * );
+
+GArray * gcmp_index_search ( GcmpIndex *, const char *, uint32_t );
+
@@ -0,0 +1,232 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-list.h"
+#include "gcmp-stats.h"
+
+/* Digits shown per result; the full value goes to the calculator */
+#define LIST_DIGITS 32
+
+struct _GcmpList
+{
+	GtkWindow  parent_instance;
+
+	GtkTextView *text;
+	GtkLabel *label;
+	GtkLabel *vals[ST_NUM];
+	GtkButton *buttons[ST_NUM];
+
+	GcmpStats *stats;
+
+	uint8_t base;
+	uint32_t digits;
+};
+
+G_DEFINE_TYPE ( GcmpList, gcmp_list, GTK_TYPE_WINDOW )
+
+static void gcmp_list_set_stats ( GcmpList *list, GcmpStats *stats, GError *error )
+{
+	if ( list->stats ) gcmp_stats_free ( list->stats );
+
+	list->stats = stats;
+
+	uint8_t j = 0;
+	for ( j = 0; j < ST_NUM; j++ )
+	{
+		g_autofree char *str = ( stats ) ? gcmp_mpfr_get_str_base ( gcmp_stats_get ( stats, j ), MIN ( list->digits, LIST_DIGITS ), list->base ) : NULL;
+
+		gtk_label_set_text ( list->vals[j], ( str ) ? str : "" );
+		gtk_widget_set_sensitive ( GTK_WIDGET ( list->buttons[j] ), stats != NULL );
+	}
+
+	g_autofree char *text = ( stats ) ? g_strdup_printf ( "%" G_GUINT64_FORMAT " values", gcmp_stats_get_count ( stats ) ) : g_strdup ( error->message );
+
+	gtk_label_set_text ( list->label, text );
+}
+
+static void gcmp_list_run ( G_GNUC_UNUSED GtkButton *button, GcmpList *list )
+{
+	GtkTextBuffer *buffer = gtk_text_view_get_buffer ( list->text );
+
+	GtkTextIter start, end;
+	gtk_text_buffer_get_bounds ( buffer, &start, &end );
+
+	g_autofree char *text = gtk_text_buffer_get_text ( buffer, &start, &end, FALSE );
+
+	GError *error = NULL;
+	GcmpStats *stats = gcmp_stats_new ( text, strlen ( text ), list->base, list->digits, &error );
+
+	gcmp_list_set_stats ( list, stats, error );
+
+	if ( error ) g_error_free ( error );
+}
+
+static void gcmp_list_open ( G_GNUC_UNUSED GtkButton *button, GcmpList *list )
+{
+	GtkWidget *dialog = gtk_file_chooser_dialog_new ( NULL, GTK_WINDOW ( list ), GTK_FILE_CHOOSER_ACTION_OPEN,
+		"gtk-cancel", GTK_RESPONSE_CANCEL, "gtk-open", GTK_RESPONSE_ACCEPT, NULL );
+
+	g_autofree char *path = NULL;
+
+	if ( gtk_dialog_run ( GTK_DIALOG ( dialog ) ) == GTK_RESPONSE_ACCEPT ) path = gtk_file_chooser_get_filename ( GTK_FILE_CHOOSER ( dialog ) );
+
+	gtk_widget_destroy ( dialog );
+
+	if ( !path ) return;
+
+	// A file is read in place, not through the text view
+	GError *error = NULL;
+	GcmpStats *stats = gcmp_stats_new_file ( path, list->base, list->digits, &error );
+
+	gcmp_list_set_stats ( list, stats, error );
+
+	if ( error ) g_error_free ( error );
+}
+
+static void gcmp_list_send ( GtkButton *button, GcmpList *list )
+{
+	if ( !list->stats ) return;
+
+	uint8_t num = (uint8_t)GPOINTER_TO_UINT ( g_object_get_data ( G_OBJECT ( button ), "stats-num" ) );
+
+	g_signal_emit_by_name ( list, "list-result", gcmp_stats_get ( list->stats, num ) );
+}
+
+static void gcmp_list_show ( GcmpList *list, uint32_t digits, uint8_t base )
+{
+	list->digits = digits;
+	list->base = base;
+
+	gtk_window_present ( GTK_WINDOW ( list ) );
+}
+
+static GtkButton * gcmp_list_create_button ( const char *icon_name, void ( *f )( GtkButton *, GcmpList * ), GcmpList *list )
+{
+	GtkButton *button = (GtkButton *)gtk_button_new_from_icon_name ( icon_name, GTK_ICON_SIZE_MENU );
+	gtk_widget_set_visible ( GTK_WIDGET ( button ), TRUE );
+
+	g_signal_connect ( button, "clicked", G_CALLBACK ( f ), list );
+
+	return button;
+}
+
+static void gcmp_list_create ( GcmpList *list )
+{
+	GtkWindow *window = GTK_WINDOW ( list );
+
+	gtk_window_set_title ( window, "Gcmp: list" );
+	gtk_window_set_icon_name ( window, "gnome-calculator" );
+	gtk_window_set_default_size ( window, 480, 480 );
+
+	GtkBox *m_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_VERTICAL, 0 );
+	gtk_box_set_spacing ( m_box, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( m_box ), TRUE );
+
+	list->text = (GtkTextView *)gtk_text_view_new ();
+	gtk_text_view_set_monospace ( list->text, TRUE );
+	gtk_text_view_set_wrap_mode ( list->text, GTK_WRAP_CHAR );
+	gtk_widget_set_visible ( GTK_WIDGET ( list->text ), TRUE );
+
+	GtkScrolledWindow *scroll = (GtkScrolledWindow *)gtk_scrolled_window_new ( NULL, NULL );
+	gtk_container_add ( GTK_CONTAINER ( scroll ), GTK_WIDGET ( list->text ) );
+	gtk_widget_set_visible ( GTK_WIDGET ( scroll ), TRUE );
+
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( scroll ), TRUE, TRUE, 0 );
+
+	GtkBox *h_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
+	gtk_box_set_spacing ( h_box, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( h_box ), TRUE );
+
+	list->label = (GtkLabel *)gtk_label_new ( "Values: blanks, ',' or ';' between" );
+	gtk_widget_set_visible ( GTK_WIDGET ( list->label ), TRUE );
+
+	gtk_box_pack_start ( h_box, GTK_WIDGET ( list->label ), FALSE, FALSE, 0 );
+	gtk_box_pack_end   ( h_box, GTK_WIDGET ( gcmp_list_create_button ( "system-run",    gcmp_list_run,  list ) ), FALSE, FALSE, 0 );
+	gtk_box_pack_end   ( h_box, GTK_WIDGET ( gcmp_list_create_button ( "document-open", gcmp_list_open, list ) ), FALSE, FALSE, 0 );
+
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( h_box ), FALSE, FALSE, 0 );
+
+	GtkGrid *grid = (GtkGrid *)gtk_grid_new ();
+	gtk_grid_set_row_spacing ( grid, 2 );
+	gtk_grid_set_column_spacing ( grid, 10 );
+	gtk_widget_set_visible ( GTK_WIDGET ( grid ), TRUE );
+
+	uint8_t j = 0;
+	for ( j = 0; j < ST_NUM; j++ )
+	{
+		GtkLabel *name = (GtkLabel *)gtk_label_new ( gcmp_stats_get_name ( j ) );
+		gtk_widget_set_halign ( GTK_WIDGET ( name ), GTK_ALIGN_START );
+		gtk_widget_set_visible ( GTK_WIDGET ( name ), TRUE );
+
+		list->vals[j] = (GtkLabel *)gtk_label_new ( "" );
+		gtk_label_set_selectable ( list->vals[j], TRUE );
+		gtk_label_set_ellipsize ( list->vals[j], PANGO_ELLIPSIZE_END );
+		gtk_widget_set_halign ( GTK_WIDGET ( list->vals[j] ), GTK_ALIGN_START );
+		gtk_widget_set_hexpand ( GTK_WIDGET ( list->vals[j] ), TRUE );
+		gtk_widget_set_visible ( GTK_WIDGET ( list->vals[j] ), TRUE );
+
+		// Sends the full value to the calculator
+		list->buttons[j] = gcmp_list_create_button ( "go-next", gcmp_list_send, list );
+		g_object_set_data ( G_OBJECT ( list->buttons[j] ), "stats-num", GUINT_TO_POINTER ( j ) );
+		gtk_widget_set_sensitive ( GTK_WIDGET ( list->buttons[j] ), FALSE );
+
+		gtk_grid_attach ( grid, GTK_WIDGET ( name ), 0, j, 1, 1 );
+		gtk_grid_attach ( grid, GTK_WIDGET ( list->vals[j] ), 1, j, 1, 1 );
+		gtk_grid_attach ( grid, GTK_WIDGET ( list->buttons[j] ), 2, j, 1, 1 );
+	}
+
+	gtk_box_pack_end ( m_box, GTK_WIDGET ( grid ), FALSE, FALSE, 0 );
+
+	gtk_container_set_border_width ( GTK_CONTAINER ( m_box ), 10 );
+	gtk_container_add ( GTK_CONTAINER ( window ), GTK_WIDGET ( m_box ) );
+
+	g_signal_connect ( list, "delete-event", G_CALLBACK ( gtk_widget_hide_on_delete ), NULL );
+}
+
+static void gcmp_list_init ( GcmpList *list )
+{
+	list->base = 10;
+	list->digits = 24;
+
+	gcmp_list_create ( list );
+
+	g_signal_connect ( list, "list-show", G_CALLBACK ( gcmp_list_show ), NULL );
+}
+
+static void gcmp_list_finalize ( GObject *object )
+{
+	GcmpList *list = GCMP_LIST ( object );
+
+	if ( list->stats ) gcmp_stats_free ( list->stats );
+
+	G_OBJECT_CLASS (gcmp_list_parent_class)->finalize (object);
+}
+
+static void gcmp_list_class_init ( GcmpListClass *class )
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+
+	oclass->finalize = gcmp_list_finalize;
+
+	g_signal_new ( "list-show", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT );
+
+	g_signal_new ( "list-result", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_POINTER );
+}
+
+GcmpList * gcmp_list_new ( GtkWindow *parent )
+{
+	GcmpList *list = g_object_new ( GCMP_TYPE_LIST, NULL );
+
+	gtk_window_set_transient_for ( GTK_WINDOW ( list ), parent );
+	gtk_window_set_destroy_with_parent ( GTK_WINDOW ( list ), TRUE );
+
+	return list;
+}
@@ -0,0 +1,548 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-matrix.h"
+#include "gcmp-radix.h"
+#include "gcmp-pool.h"
+
+#include <errno.h>
+
+/* Workers, and the least work ( multiply-adds or values ) worth one */
+#define MAX_WORKERS 16
+#define WORK_MIN 4096
+
+/* Columns of the product per tile: their pointers stay in cache across the rows */
+#define TILE_COLS 32
+
+/* Extra bits of the LU factors */
+#define GUARD_BITS 64
+
+struct _GcmpMatrix
+{
+	uint32_t rows, cols;
+	mpfr_prec_t prec;
+
+	__mpfr_struct *val;
+	void *limbs;
+};
+
+typedef struct _Lu Lu;
+
+struct _Lu
+{
+	GcmpMatrix *a;
+	uint32_t *perm;
+	mpfr_ptr *ptrs;
+
+	int sign;
+	gboolean singular;
+
+	// Column being eliminated
+	uint32_t k;
+};
+
+typedef struct _Token Token;
+
+struct _Token
+{
+	size_t start;
+	size_t len;
+};
+
+typedef struct _Task Task;
+
+struct _Task
+{
+	uint8_t id, n_workers;
+
+	GcmpMatrix *a, *b, *c;
+	mpfr_ptr *ptrs;
+	Lu *lu;
+
+	const char *data;
+	GArray *tokens;
+	uint8_t base;
+
+	gboolean failed;
+	size_t fail_at;
+};
+
+static uint8_t gcmp_matrix_workers ( uint64_t work )
+{
+	return (uint8_t)CLAMP ( work / WORK_MIN, 1, (uint64_t)MIN ( gcmp_pool_get_workers () + 1, MAX_WORKERS ) );
+}
+
+/* Shares go to the pool ( gcmp-pool.h ); the caller takes the first */
+static void gcmp_matrix_run ( Task *tasks, uint8_t n_workers, GcmpPoolFunc func )
+{
+	GcmpPoolGroup group = { 0 };
+
+	uint8_t j = 0;
+	for ( j = 0; j < n_workers; j++ ) { tasks[j].id = j; tasks[j].n_workers = n_workers; }
+
+	for ( j = 1; j < n_workers; j++ ) gcmp_pool_spawn ( &group, func, &tasks[j] );
+
+	func ( &tasks[0] );
+
+	gcmp_pool_wait ( &group );
+}
+
+/* First and last + 1 of the worker's share of n */
+static void gcmp_matrix_share ( Task *task, uint32_t n, uint32_t *first, uint32_t *last )
+{
+	*first = (uint32_t)( (uint64_t)n * task->id / task->n_workers );
+	*last  = (uint32_t)( (uint64_t)n * ( task->id + 1 ) / task->n_workers );
+}
+
+GcmpMatrix * gcmp_matrix_new ( uint32_t rows, uint32_t cols, mpfr_prec_t prec )
+{
+	GcmpMatrix *m = g_new0 ( GcmpMatrix, 1 );
+
+	m->rows = rows;
+	m->cols = cols;
+	m->prec = prec;
+
+	// The significands of all elements in one block, row after row
+	size_t n = (size_t)rows * cols, size = mpfr_custom_get_size ( prec );
+
+	m->val   = g_new ( __mpfr_struct, n );
+	m->limbs = g_malloc ( n * size );
+
+	size_t j = 0;
+	for ( j = 0; j < n; j++ )
+	{
+		void *limbs = (char *)m->limbs + j * size;
+
+		mpfr_custom_init ( limbs, prec );
+		mpfr_custom_init_set ( &m->val[j], MPFR_ZERO_KIND, 0, prec, limbs );
+	}
+
+	return m;
+}
+
+void gcmp_matrix_free ( GcmpMatrix *m )
+{
+	g_free ( m->val );
+	g_free ( m->limbs );
+	g_free ( m );
+}
+
+uint32_t gcmp_matrix_get_rows ( GcmpMatrix *m )
+{
+	return m->rows;
+}
+
+uint32_t gcmp_matrix_get_cols ( GcmpMatrix *m )
+{
+	return m->cols;
+}
+
+mpfr_ptr gcmp_matrix_get ( GcmpMatrix *m, uint32_t row, uint32_t col )
+{
+	return &m->val[(size_t)row * m->cols + col];
+}
+
+static gboolean gcmp_matrix_is_sep ( char c )
+{
+	return ( c == ' ' || c == '\t' || c == '\r' || c == ',' || c == ';' );
+}
+
+static void gcmp_matrix_parse_part ( Task *task )
+{
+	GString *token = g_string_new ( NULL );
+
+	uint32_t j = 0, first = 0, last = 0;
+	gcmp_matrix_share ( task, task->tokens->len, &first, &last );
+
+	for ( j = first; j < last; j++ )
+	{
+		Token *t = &g_array_index ( task->tokens, Token, j );
+
+		// mpfr_strtofr needs the token on its own
+		g_string_truncate ( token, 0 );
+		g_string_append_len ( token, task->data + t->start, (gssize)t->len );
+
+		char *end = NULL;
+		mpfr_strtofr ( &task->a->val[j], token->str, &end, task->base, MPFR_RNDN );
+
+		if ( end == token->str || *end ) { task->failed = TRUE; task->fail_at = t->start; break; }
+	}
+
+	g_string_free ( token, TRUE );
+}
+
+static GcmpMatrix * gcmp_matrix_parse ( const char *data, size_t len, uint8_t base, mpfr_prec_t prec, GError **error )
+{
+	GArray *tokens = g_array_new ( FALSE, FALSE, sizeof ( Token ) );
+
+	uint32_t rows = 0, cols = 0;
+	size_t i = 0;
+
+	// Token bounds first, in one pass; the values are parsed in parallel after
+	while ( i < len )
+	{
+		uint32_t n = 0;
+
+		while ( i < len && data[i] != '\n' )
+		{
+			if ( gcmp_matrix_is_sep ( data[i] ) ) { i++; continue; }
+
+			Token t = { i, 0 };
+			while ( i < len && data[i] != '\n' && !gcmp_matrix_is_sep ( data[i] ) ) i++;
+
+			t.len = i - t.start;
+			g_array_append_val ( tokens, t );
+			n++;
+		}
+
+		i++;
+
+		if ( n == 0 ) continue;
+
+		if ( rows && n != cols ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "row %u has %u values, not %u", rows + 1, n, cols ); g_array_free ( tokens, TRUE ); return NULL; }
+
+		cols = n;
+		rows++;
+	}
+
+	if ( rows == 0 ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "no values" ); g_array_free ( tokens, TRUE ); return NULL; }
+
+	GcmpMatrix *m = gcmp_matrix_new ( rows, cols, prec );
+
+	uint8_t j = 0, n_workers = gcmp_matrix_workers ( tokens->len );
+	Task *tasks = g_new0 ( Task, n_workers );
+
+	for ( j = 0; j < n_workers; j++ ) { tasks[j].a = m; tasks[j].data = data; tasks[j].tokens = tokens; tasks[j].base = base; }
+
+	gcmp_matrix_run ( tasks, n_workers, (GcmpPoolFunc)gcmp_matrix_parse_part );
+
+	for ( j = 0; j < n_workers; j++ )
+	{
+		if ( !tasks[j].failed ) continue;
+
+		g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "not a number ( byte %zu )", tasks[j].fail_at + 1 );
+
+		gcmp_matrix_free ( m );
+		m = NULL;
+
+		break;
+	}
+
+	g_free ( tasks );
+	g_array_free ( tokens, TRUE );
+
+	return m;
+}
+
+GcmpMatrix * gcmp_matrix_new_file ( const char *path, uint8_t base, mpfr_prec_t prec, GError **error )
+{
+	GMappedFile *mapped = g_mapped_file_new ( path, FALSE, error );
+
+	if ( !mapped ) return NULL;
+
+	GError *err = NULL;
+	GcmpMatrix *m = gcmp_matrix_parse ( g_mapped_file_get_contents ( mapped ), g_mapped_file_get_length ( mapped ), base, prec, &err );
+
+	if ( err ) { g_set_error ( error, err->domain, err->code, "%s: %s", path, err->message ); g_error_free ( err ); }
+
+	g_mapped_file_unref ( mapped );
+
+	return m;
+}
+
+gboolean gcmp_matrix_save ( GcmpMatrix *m, const char *path, uint32_t digits, uint8_t base, GError **error )
+{
+	FILE *file = ( path ) ? fopen ( path, "wb" ) : stdout;
+
+	if ( !file ) { g_set_error ( error, G_FILE_ERROR, g_file_error_from_errno ( errno ), "%s: %s", path, g_strerror ( errno ) ); return FALSE; }
+
+	uint32_t i = 0, j = 0;
+	for ( i = 0; i < m->rows; i++ )
+	{
+		for ( j = 0; j < m->cols; j++ )
+		{
+			if ( j ) fputc ( ' ', file );
+
+			if ( base == 10 )
+				mpfr_fprintf ( file, "%.*Rg", digits, gcmp_matrix_get ( m, i, j ) );
+			else
+			{
+				char *str = gcmp_radix_get_str ( gcmp_matrix_get ( m, i, j ), base, digits );
+				fputs ( str, file );
+				free ( str );
+			}
+		}
+
+		fputc ( '\n', file );
+	}
+
+	gboolean ret = !ferror ( file );
+
+	if ( path && fclose ( file ) != 0 ) ret = FALSE;
+
+	if ( !ret ) g_set_error ( error, G_FILE_ERROR, g_file_error_from_errno ( errno ), "%s: %s", ( path ) ? path : "stdout", g_strerror ( errno ) );
+
+	return ret;
+}
+
+static void gcmp_matrix_mul_part ( Task *task )
+{
+	GcmpMatrix *a = task->a, *c = task->c;
+
+	uint32_t k = a->cols, first = 0, last = 0, i = 0, j = 0, l = 0, tile = 0;
+	gcmp_matrix_share ( task, c->rows, &first, &last );
+
+	mpfr_ptr *row = g_new ( mpfr_ptr, k );
+
+	for ( tile = 0; tile < c->cols; tile += TILE_COLS )
+	{
+		for ( i = first; i < last; i++ )
+		{
+			for ( l = 0; l < k; l++ ) row[l] = gcmp_matrix_get ( a, i, l );
+
+			for ( j = tile; j < MIN ( tile + TILE_COLS, c->cols ); j++ )
+				mpfr_dot ( gcmp_matrix_get ( c, i, j ), row, task->ptrs + (size_t)j * k, k, MPFR_RNDN );
+		}
+	}
+
+	g_free ( row );
+}
+
+GcmpMatrix * gcmp_matrix_mul ( GcmpMatrix *a, GcmpMatrix *b, GError **error )
+{
+	if ( a->cols != b->rows ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%ux%u by %ux%u: sizes do not fit", a->rows, a->cols, b->rows, b->cols ); return NULL; }
+
+	GcmpMatrix *c = gcmp_matrix_new ( a->rows, b->cols, MAX ( a->prec, b->prec ) );
+
+	// Columns of b as pointer arrays, shared by all workers
+	uint32_t k = a->cols, l = 0, j = 0;
+	mpfr_ptr *cols = g_new ( mpfr_ptr, (size_t)b->cols * k );
+
+	for ( j = 0; j < b->cols; j++ )
+		for ( l = 0; l < k; l++ ) cols[(size_t)j * k + l] = gcmp_matrix_get ( b, l, j );
+
+	uint8_t n_workers = gcmp_matrix_workers ( MIN ( (uint64_t)a->rows * b->cols * k, (uint64_t)a->rows * WORK_MIN ) );
+	Task *tasks = g_new0 ( Task, n_workers );
+
+	uint8_t w = 0;
+	for ( w = 0; w < n_workers; w++ ) { tasks[w].a = a; tasks[w].c = c; tasks[w].ptrs = cols; }
+
+	gcmp_matrix_run ( tasks, n_workers, (GcmpPoolFunc)gcmp_matrix_mul_part );
+
+	g_free ( tasks );
+	g_free ( cols );
+
+	return c;
+}
+
+static void gcmp_matrix_pivot ( Lu *lu, uint32_t k )
+{
+	GcmpMatrix *a = lu->a;
+
+	uint32_t i = 0, p = k;
+	for ( i = k + 1; i < a->rows; i++ )
+		if ( mpfr_cmpabs ( gcmp_matrix_get ( a, lu->perm[i], k ), gcmp_matrix_get ( a, lu->perm[p], k ) ) > 0 ) p = i;
+
+	if ( mpfr_zero_p ( gcmp_matrix_get ( a, lu->perm[p], k ) ) ) { lu->singular = TRUE; return; }
+
+	if ( p == k ) return;
+
+	uint32_t t = lu->perm[p]; lu->perm[p] = lu->perm[k]; lu->perm[k] = t;
+
+	lu->sign = -lu->sign;
+}
+
+/* Eliminates column lu->k from the worker's rows below it */
+static void gcmp_matrix_lu_part ( Task *task )
+{
+	Lu *lu = task->lu;
+	GcmpMatrix *a = lu->a;
+
+	mpfr_t l;
+	mpfr_init2 ( l, a->prec );
+
+	uint32_t n = a->rows, k = lu->k, i = 0, j = 0;
+
+	mpfr_ptr pivot = gcmp_matrix_get ( a, lu->perm[k], 0 );
+
+	// Rows go round robin, so the shares stay even
+	for ( i = k + 1 + task->id; i < n; i += task->n_workers )
+	{
+		mpfr_ptr row = gcmp_matrix_get ( a, lu->perm[i], 0 );
+
+		mpfr_div ( &row[k], &row[k], &pivot[k], MPFR_RNDN );
+
+		if ( mpfr_zero_p ( &row[k] ) ) continue;
+
+		mpfr_neg ( l, &row[k], MPFR_RNDN );
+
+		for ( j = k + 1; j < n; j++ ) mpfr_fma ( &row[j], l, &pivot[j], &row[j], MPFR_RNDN );
+	}
+
+	mpfr_clear ( l );
+}
+
+static void gcmp_matrix_lu_free ( Lu *lu )
+{
+	gcmp_matrix_free ( lu->a );
+
+	g_free ( lu->perm );
+	g_free ( lu->ptrs );
+	g_free ( lu );
+}
+
+/* L below the diagonal ( unit diagonal implied ) and U on and above it, rows in perm order */
+static Lu * gcmp_matrix_lu ( GcmpMatrix *m, GError **error )
+{
+	if ( m->rows != m->cols ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%ux%u: not a square matrix", m->rows, m->cols ); return NULL; }
+
+	uint32_t n = m->rows, i = 0, j = 0;
+
+	Lu *lu = g_new0 ( Lu, 1 );
+	lu->a = gcmp_matrix_new ( n, n, m->prec + GUARD_BITS );
+	lu->perm = g_new ( uint32_t, n );
+	lu->sign = 1;
+
+	for ( i = 0; i < n; i++ ) lu->perm[i] = i;
+	for ( i = 0; i < (size_t)n * n; i++ ) mpfr_set ( &lu->a->val[i], &m->val[i], MPFR_RNDN );
+
+	Task tasks[MAX_WORKERS];
+
+	// One fork-join per column: the pivot row must be final before the rows below use it
+	for ( lu->k = 0; lu->k < n; lu->k++ )
+	{
+		gcmp_matrix_pivot ( lu, lu->k );
+
+		if ( lu->singular ) break;
+
+		uint64_t left = n - lu->k - 1;
+		uint8_t w = 0, n_workers = MIN ( gcmp_matrix_workers ( left * left ), MAX ( left, 1 ) );
+
+		memset ( tasks, 0, sizeof ( tasks ) );
+		for ( w = 0; w < n_workers; w++ ) tasks[w].lu = lu;
+
+		gcmp_matrix_run ( tasks, n_workers, (GcmpPoolFunc)gcmp_matrix_lu_part );
+	}
+
+	// Rows in pivot order as pointer arrays, for the dot products of the substitutions
+	lu->ptrs = g_new ( mpfr_ptr, (size_t)n * n );
+
+	for ( i = 0; i < n; i++ )
+		for ( j = 0; j < n; j++ ) lu->ptrs[(size_t)i * n + j] = gcmp_matrix_get ( lu->a, lu->perm[i], j );
+
+	return lu;
+}
+
+gboolean gcmp_matrix_det ( GcmpMatrix *m, mpfr_t res, GError **error )
+{
+	Lu *lu = gcmp_matrix_lu ( m, error );
+
+	if ( !lu ) return FALSE;
+
+	if ( lu->singular )
+		mpfr_set_ui ( res, 0, MPFR_RNDN );
+	else
+	{
+		mpfr_t t;
+		mpfr_init2 ( t, lu->a->prec );
+		mpfr_set_si ( t, lu->sign, MPFR_RNDN );
+
+		uint32_t i = 0;
+		for ( i = 0; i < m->rows; i++ ) mpfr_mul ( t, t, gcmp_matrix_get ( lu->a, lu->perm[i], i ), MPFR_RNDN );
+
+		mpfr_set ( res, t, MPFR_RNDN );
+		mpfr_clear ( t );
+	}
+
+	gcmp_matrix_lu_free ( lu );
+
+	return TRUE;
+}
+
+static void gcmp_matrix_solve_part ( Task *task )
+{
+	Lu *lu = task->lu;
+	GcmpMatrix *b = task->b, *x = task->c;
+
+	uint32_t n = lu->a->rows, first = 0, last = 0, c = 0, i = 0;
+	gcmp_matrix_share ( task, b->cols, &first, &last );
+
+	// One column at a time: forward, then back substitution in place
+	GcmpMatrix *y = gcmp_matrix_new ( n, 1, lu->a->prec );
+	mpfr_ptr *yp = g_new ( mpfr_ptr, n );
+
+	for ( i = 0; i < n; i++ ) yp[i] = gcmp_matrix_get ( y, i, 0 );
+
+	mpfr_t s;
+	mpfr_init2 ( s, lu->a->prec );
+
+	for ( c = first; c < last; c++ )
+	{
+		for ( i = 0; i < n; i++ )
+		{
+			mpfr_dot ( s, lu->ptrs + (size_t)i * n, yp, i, MPFR_RNDN );
+			mpfr_sub ( yp[i], gcmp_matrix_get ( b, lu->perm[i], c ), s, MPFR_RNDN );
+		}
+
+		for ( i = n; i-- > 0; )
+		{
+			mpfr_ptr *row = lu->ptrs + (size_t)i * n;
+
+			mpfr_dot ( s, row + i + 1, yp + i + 1, n - i - 1, MPFR_RNDN );
+			mpfr_sub ( s, yp[i], s, MPFR_RNDN );
+			mpfr_div ( yp[i], s, row[i], MPFR_RNDN );
+		}
+
+		for ( i = 0; i < n; i++ ) mpfr_set ( gcmp_matrix_get ( x, i, c ), yp[i], MPFR_RNDN );
+	}
+
+	mpfr_clear ( s );
+	g_free ( yp );
+	gcmp_matrix_free ( y );
+}
+
+GcmpMatrix * gcmp_matrix_solve ( GcmpMatrix *a, GcmpMatrix *b, GError **error )
+{
+	if ( a->rows != b->rows ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%ux%u and %ux%u: sizes do not fit", a->rows, a->cols, b->rows, b->cols ); return NULL; }
+
+	Lu *lu = gcmp_matrix_lu ( a, error );
+
+	if ( !lu ) return NULL;
+
+	if ( lu->singular ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "singular matrix" ); gcmp_matrix_lu_free ( lu ); return NULL; }
+
+	GcmpMatrix *x = gcmp_matrix_new ( a->rows, b->cols, a->prec );
+
+	uint8_t n_workers = MIN ( gcmp_matrix_workers ( (uint64_t)a->rows * a->rows * b->cols ), b->cols );
+	Task *tasks = g_new0 ( Task, n_workers );
+
+	uint8_t w = 0;
+	for ( w = 0; w < n_workers; w++ ) { tasks[w].lu = lu; tasks[w].b = b; tasks[w].c = x; }
+
+	gcmp_matrix_run ( tasks, n_workers, (GcmpPoolFunc)gcmp_matrix_solve_part );
+
+	g_free ( tasks );
+	gcmp_matrix_lu_free ( lu );
+
+	return x;
+}
+
+GcmpMatrix * gcmp_matrix_inv ( GcmpMatrix *a, GError **error )
+{
+	GcmpMatrix *id = gcmp_matrix_new ( a->rows, a->rows, a->prec );
+
+	uint32_t i = 0;
+	for ( i = 0; i < a->rows; i++ ) mpfr_set_ui ( gcmp_matrix_get ( id, i, i ), 1, MPFR_RNDN );
+
+	GcmpMatrix *x = gcmp_matrix_solve ( a, id, error );
+
+	gcmp_matrix_free ( id );
+
+	return x;
+}
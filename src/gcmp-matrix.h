@@ -0,0 +1,43 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+typedef struct _GcmpMatrix GcmpMatrix;
+
+/* Zero matrix; all elements share one precision and one block of memory */
+GcmpMatrix * gcmp_matrix_new ( uint32_t, uint32_t, mpfr_prec_t );
+
+/* One row per line, values separated by blanks, ',' or ';' */
+GcmpMatrix * gcmp_matrix_new_file ( const char *, uint8_t, mpfr_prec_t, GError ** );
+
+/* Same layout; NULL path is stdout */
+gboolean gcmp_matrix_save ( GcmpMatrix *, const char *, uint32_t, uint8_t, GError ** );
+
+void gcmp_matrix_free ( GcmpMatrix * );
+
+uint32_t gcmp_matrix_get_rows ( GcmpMatrix * );
+
+uint32_t gcmp_matrix_get_cols ( GcmpMatrix * );
+
+mpfr_ptr gcmp_matrix_get ( GcmpMatrix *, uint32_t, uint32_t );
+
+/* Each element is one dot product, rounded once */
+GcmpMatrix * gcmp_matrix_mul ( GcmpMatrix *, GcmpMatrix *, GError ** );
+
+/* LU with partial pivoting */
+gboolean gcmp_matrix_det ( GcmpMatrix *, mpfr_t, GError ** );
+
+GcmpMatrix * gcmp_matrix_solve ( GcmpMatrix *, GcmpMatrix *, GError ** );
+
+GcmpMatrix * gcmp_matrix_inv ( GcmpMatrix *, GError ** );
@@ -8,84 +8,74 @@
 */
 
 #include "gcmp-mpfr.h"
+#include "gcmp-radix.h"
+#include "gcmp-ntt.h"
+#include "gcmp-const.h"
+#include "gcmp-cost.h"
 
-#include <mpfr.h>
+#include <string.h>
 
 typedef unsigned long ulong;
 
-static void mpfr_prc ( mpfr_t res, mpfr_t a, mpfr_t b, uint16_t digits, mpfr_rnd_t rnd )
+int gcmp_mpfr_set_str ( mpfr_t a, const char *a_str, uint8_t base )
+{
+	return mpfr_strtofr ( a, a_str, NULL, base, MPFR_RNDN );
+}
+
+static void mpfr_prc ( mpfr_t res, mpfr_t a, mpfr_t b, uint32_t digits, mpfr_rnd_t rnd )
 {
 	mpfr_t c;
 	mpfr_init2 ( c, digits * 4 );
 	mpfr_set_d ( c, 100.0, MPFR_RNDD );
 
-	mpfr_mul ( res, a, b, rnd );
+	gcmp_ntt_mul ( res, a, b, rnd );
 	mpfr_div ( res, res, c, rnd );
 
 	mpfr_clear ( c );
 }
 
-static void gcmp_mpfr_init_str ( mpfr_t res, mpfr_t a, mpfr_t b, const char *a_str, const char *b_str, uint16_t digits, uint8_t base )
+void gcmp_mpfr_get_str ( mpfr_t res, uint32_t digits, uint8_t out_fm, char *out_str )
 {
-	mpfr_init2 ( a, digits * 4 );
-	mpfr_set_str ( a, a_str, base, MPFR_RNDN );
-
-	mpfr_init2 ( b, digits * 4 );
-	mpfr_set_str ( b, b_str, base, MPFR_RNDN );
-
-	mpfr_init2 ( res, digits * 4 );
-	mpfr_set_d ( res, 0.0, MPFR_RNDD );
+	gcmp_radix_get_dec ( res, digits, out_fm, out_str );
 }
 
-static void gcmp_mpfr_clear_all ( mpfr_t a, mpfr_t b, mpfr_t res )
+char * gcmp_mpfr_get_str_base ( mpfr_t res, uint32_t digits, uint8_t base )
 {
-	mpfr_clear ( a );
-	mpfr_clear ( b );
-	mpfr_clear ( res );
-}
+	char *out_str = NULL;
 
-static void gcmp_mpfr_get_str ( mpfr_t res, uint16_t digits, uint8_t out_fm, char *out_str )
-{
-	if ( out_fm == 0 ) mpfr_sprintf ( out_str, "%.*Rg", digits, res );
-	if ( out_fm == 1 ) mpfr_sprintf ( out_str, "%.*Re", digits, res );
-	if ( out_fm == 2 ) mpfr_sprintf ( out_str, "%.*Rf", digits, res );
-}
+	if ( base == 10 )
+	{
+		out_str = malloc ( (size_t)digits + 32 );
+		gcmp_mpfr_get_str ( res, digits, 0, out_str );
 
-void gcmp_mpfr_all ( enum math mt, const char *a_str, const char *b_str, uint16_t digits, uint8_t out_fm, uint8_t base, char *out_str )
-{
-	mpfr_t a, b, res;
+		return out_str;
+	}
 
-	gcmp_mpfr_init_str ( res, a, b, a_str, b_str, digits, base );
+	return gcmp_radix_get_str ( res, base, digits );
+}
 
+void gcmp_mpfr_op ( enum math mt, mpfr_t res, mpfr_t a, mpfr_t b, uint32_t digits )
+{
 	if ( mt == ADD ) mpfr_add ( res, a, b, MPFR_RNDD );
 	if ( mt == SUB ) mpfr_sub ( res, a, b, MPFR_RNDD );
-	if ( mt == MUL ) mpfr_mul ( res, a, b, MPFR_RNDD );
-	if ( mt == DIV ) mpfr_div ( res, a, b, MPFR_RNDD );
+	if ( mt == MUL ) gcmp_ntt_mul ( res, a, b, MPFR_RNDD );
+	if ( mt == DIV ) gcmp_ntt_div ( res, a, b, MPFR_RNDD );
 
-	if ( mt == RUT ) mpfr_rootn_ui ( res, a, (ulong)atol ( b_str ), MPFR_RNDD );
+	if ( mt == RUT ) mpfr_rootn_ui ( res, a, mpfr_get_ui ( b, MPFR_RNDZ ), MPFR_RNDD );
 	if ( mt == POW ) mpfr_pow  ( res, a, b, MPFR_RNDD );
 	if ( mt == MOD ) mpfr_fmod ( res, a, b, MPFR_RNDD );
 	if ( mt == PRC ) mpfr_prc  ( res, a, b, digits, MPFR_RNDD );
-
-	gcmp_mpfr_get_str ( res, digits, out_fm, out_str );
-
-	gcmp_mpfr_clear_all ( a, b, res );
 }
 
-static void gcmp_mpfr_init_str_one ( mpfr_t a, const char *a_str, uint16_t digits, uint8_t base )
-{
-	mpfr_init2 ( a, digits*4 );
-	mpfr_set_str ( a, a_str, base, MPFR_RNDN );
-}
-
-static void mpfr_sct ( enum math_ext mt, mpfr_t res, mpfr_t a, const char *a_str, uint16_t digits, uint8_t base, uint8_t deg_rad )
+static void mpfr_sct ( enum math_ext mt, mpfr_t res, mpfr_t a, uint32_t digits, uint8_t deg_rad )
 {
 	mpfr_t grd, pi;
 
 	mpfr_init2 ( pi,  digits*4 );
-	mpfr_const_pi ( pi, MPFR_RNDN );
+	gcmp_const_run ( CPI, pi, MPFR_RNDN, NULL );
 
-	gcmp_mpfr_init_str_one ( grd, "180", digits, base );
+	mpfr_init2 ( grd, digits*4 );
+	mpfr_set_ui ( grd, 180, MPFR_RNDN );
 
 	if ( deg_rad )
 	{
@@ -93,50 +83,151 @@ static void mpfr_sct ( enum math_ext mt, mpfr_t res, mpfr_t a, const char *a_str
 		mpfr_mul ( grd,  a, grd, MPFR_RNDD );
 	}
 	else
-		mpfr_set_str ( grd, a_str, base, MPFR_RNDN );
+		mpfr_set ( grd, a, MPFR_RNDN );
 
-	if ( mt == SIN ) mpfr_sin ( res, grd, MPFR_RNDD );
-	if ( mt == COS ) mpfr_cos ( res, grd, MPFR_RNDD );
-	if ( mt == TAN ) mpfr_tan ( res, grd, MPFR_RNDD );
+	if ( !gcmp_cost_admit_sct ( grd, digits * 4 ) ) mpfr_set_nan ( res );
+
+	else if ( mt == SIN ) mpfr_sin ( res, grd, MPFR_RNDD );
+	else if ( mt == COS ) mpfr_cos ( res, grd, MPFR_RNDD );
+	else if ( mt == TAN ) mpfr_tan ( res, grd, MPFR_RNDD );
 
 	mpfr_clear ( grd );
 	mpfr_clear ( pi  );
 }
 
-void gcmp_mpfr_all_ext ( enum math_ext mt, const char *a_str, uint16_t digits, uint8_t out_fm, uint8_t base, char *out_str, uint8_t deg_rad )
+/* 1 / a: the one at full precision, so huge divisors take the NTT path */
+static void gcmp_mpfr_recip ( mpfr_t res, mpfr_t a )
+{
+	mpfr_t one;
+	mpfr_init2 ( one, mpfr_get_prec ( res ) );
+	mpfr_set_ui ( one, 1, MPFR_RNDD );
+
+	gcmp_ntt_div ( res, one, a, MPFR_RNDD );
+
+	mpfr_clear ( one );
+}
+
+int gcmp_mpfr_fac ( mpfr_t res, ulong n, mpfr_rnd_t rnd )
 {
-	mpfr_t a, b, res;
-	mpfr_t one, two, tre;
+	if ( n <= 1 ) return mpfr_set_ui ( res, 1, rnd );
 
-	gcmp_mpfr_init_str ( res, a, b, a_str, "0", digits, base );
+	if ( !gcmp_cost_fac_by_gamma ( n, mpfr_get_prec ( res ) ) ) return mpfr_fac_ui ( res, n, rnd );
 
-	gcmp_mpfr_init_str_one ( one, "1", digits, base );
-	gcmp_mpfr_init_str_one ( two, "2", digits, base );
-	gcmp_mpfr_init_str_one ( tre, "3", digits, base );
+	// n! = gamma ( n + 1 ), correctly rounded all the same; it also sees an overflow coming
+	mpfr_t m;
+	mpfr_init2 ( m, 65 );
+	mpfr_set_ui ( m, n, MPFR_RNDN );
+	mpfr_add_ui ( m, m, 1, MPFR_RNDN );
 
-	if ( mt == RT2 ) mpfr_sqrt ( res, a, MPFR_RNDD );
+	int inexact = mpfr_gamma ( res, m, rnd );
+
+	mpfr_clear ( m );
+
+	return inexact;
+}
+
+void gcmp_mpfr_op_ext ( enum math_ext mt, mpfr_t res, mpfr_t a, uint32_t digits, uint8_t deg_rad )
+{
+	if ( mt == RT2 ) gcmp_ntt_sqrt ( res, a, MPFR_RNDD );
 	if ( mt == RT3 ) mpfr_cbrt ( res, a, MPFR_RNDD );
 
-	if ( mt == D1R ) mpfr_rec_sqrt ( res, a, MPFR_RNDD );
-	if ( mt == D1X ) mpfr_div      ( res, one, a, MPFR_RNDD );
+	if ( mt == D1R ) gcmp_ntt_rec_sqrt ( res, a, MPFR_RNDD );
+	if ( mt == D1X ) gcmp_mpfr_recip ( res, a );
 
-	if ( mt == PW2 ) mpfr_pow ( res, a, two, MPFR_RNDD );
-	if ( mt == PW3 ) mpfr_pow ( res, a, tre, MPFR_RNDD );
+	if ( mt == PW2 ) gcmp_ntt_mul ( res, a, a, MPFR_RNDD );
+	if ( mt == PW3 ) mpfr_pow_ui ( res, a, 3, MPFR_RNDD );
 
 	if ( mt == LGN ) mpfr_log   ( res, a, MPFR_RNDD );
 	if ( mt == LOG ) mpfr_log10 ( res, a, MPFR_RNDD );
 
-	if ( mt == FAC ) { if ( atol ( a_str ) > 1 ) mpfr_fac_ui ( res, (ulong)atol ( a_str ), MPFR_RNDD ); }
+	if ( mt == FAC ) gcmp_mpfr_fac ( res, mpfr_get_ui ( a, MPFR_RNDZ ), MPFR_RNDD );
+
+	if ( mt == CPI || mt == CEU || mt == CEX || mt == CL2 ) gcmp_const_run ( mt, res, MPFR_RNDN, NULL );
+
+	if ( mt == SIN || mt == COS || mt == TAN ) mpfr_sct ( mt, res, a, digits, deg_rad );
+}
+
+int gcmp_mpfr_nary_fits ( enum math_nary mt, uint32_t n )
+{
+	if ( mt == DOT ) return ( n >= 2 && n % 2 == 0 );
+
+	if ( mt == FMA  || mt == FMS  ) return ( n == 3 );
+	if ( mt == FMMA || mt == FMMS ) return ( n == 4 );
+
+	if ( mt == PLY ) return ( n >= 2 );
+
+	if ( mt == PWM ) return ( n == 3 );
+	if ( mt == GCD ) return ( n >= 2 );
+	if ( mt == INV ) return ( n == 2 );
+	if ( mt == PRM ) return ( n == 1 );
+
+	return 0;
+}
 
-	if ( mt == CPI ) mpfr_const_pi    ( res, MPFR_RNDN );
-	if ( mt == CEU ) mpfr_const_euler ( res, MPFR_RNDN );
+/* Exact integers only: a rounded one would have more bits than the precision */
+static int gcmp_mpfr_get_int ( mpz_t z, mpfr_srcptr a )
+{
+	if ( !mpfr_integer_p ( a ) ) return 0;
 
-	if ( mt == SIN || mt == COS || mt == TAN ) mpfr_sct ( mt, res, a, a_str, digits, base, deg_rad );
+	if ( !mpfr_zero_p ( a ) && mpfr_get_exp ( a ) > mpfr_get_prec ( a ) ) return 0;
 
-	gcmp_mpfr_get_str ( res, digits, out_fm, out_str );
+	mpfr_get_z ( z, a, MPFR_RNDN );
 
-	gcmp_mpfr_clear_all ( a, b, res );
-	gcmp_mpfr_clear_all ( one, two, tre );
-	mpfr_free_cache ();
+	return 1;
 }
 
+/* mpz_powm is GMP's windowed exponentiation, with Montgomery reduction for odd moduli */
+static void gcmp_mpfr_op_int ( enum math_nary mt, mpfr_t res, mpfr_ptr *args, uint32_t n )
+{
+	mpz_t r, *z = malloc ( n * sizeof ( mpz_t ) );
+	mpz_init ( r );
+
+	int ok = 1;
+
+	uint32_t j = 0;
+	for ( j = 0; j < n; j++ ) { mpz_init ( z[j] ); if ( !gcmp_mpfr_get_int ( z[j], args[j] ) ) ok = 0; }
+
+	// A square and a product per bit of the power; a primality test is some eight such powers
+	if ( ok && mt == PWM ) ok = gcmp_cost_admit ( (double)mpz_sizeinbase ( z[1], 2 ) * 2 * gcmp_cost_mul ( (mpfr_prec_t)mpz_sizeinbase ( z[2], 2 ) ), 0 );
+	if ( ok && mt == PRM ) ok = gcmp_cost_admit ( 8.0 * (double)mpz_sizeinbase ( z[0], 2 ) * 2 * gcmp_cost_mul ( (mpfr_prec_t)mpz_sizeinbase ( z[0], 2 ) ), 0 );
+
+	// A negative power needs the inverse
+	if ( ok && mt == PWM ) ok = ( mpz_sgn ( z[2] ) != 0 && ( mpz_sgn ( z[1] ) >= 0 || mpz_invert ( r, z[0], z[2] ) ) );
+	if ( ok && mt == PWM ) mpz_powm ( r, z[0], z[1], z[2] );
+
+	if ( ok && mt == GCD ) { mpz_set ( r, z[0] ); for ( j = 1; j < n; j++ ) mpz_gcd ( r, r, z[j] ); }
+
+	if ( ok && mt == INV ) ok = ( mpz_sgn ( z[1] ) != 0 && mpz_invert ( r, z[0], z[1] ) );
+
+	if ( ok && mt == PRM ) mpz_set_ui ( r, ( mpz_probab_prime_p ( z[0], 30 ) > 0 ) );
+
+	if ( ok ) mpfr_set_z ( res, r, MPFR_RNDD ); else mpfr_set_nan ( res );
+
+	for ( j = 0; j < n; j++ ) mpz_clear ( z[j] );
+
+	mpz_clear ( r );
+	free ( z );
+}
+
+void gcmp_mpfr_op_nary ( enum math_nary mt, mpfr_t res, mpfr_ptr *args, uint32_t n )
+{
+	if ( !gcmp_mpfr_nary_fits ( mt, n ) ) { mpfr_set_nan ( res ); return; }
+
+	if ( mt == PWM || mt == GCD || mt == INV || mt == PRM ) { gcmp_mpfr_op_int ( mt, res, args, n ); return; }
+
+	if ( mt == DOT ) mpfr_dot ( res, args, args + n / 2, n / 2, MPFR_RNDD );
+
+	if ( mt == FMA ) mpfr_fma ( res, args[0], args[1], args[2], MPFR_RNDD );
+	if ( mt == FMS ) mpfr_fms ( res, args[0], args[1], args[2], MPFR_RNDD );
+
+	if ( mt == FMMA ) mpfr_fmma ( res, args[0], args[1], args[2], args[3], MPFR_RNDD );
+	if ( mt == FMMS ) mpfr_fmms ( res, args[0], args[1], args[2], args[3], MPFR_RNDD );
+
+	if ( mt != PLY ) return;
+
+	// Highest coefficient first: res = ( ( cn * x + cn-1 ) * x + ... ) * x + c0
+	mpfr_set ( res, args[1], MPFR_RNDD );
+
+	uint32_t j = 0;
+	for ( j = 2; j < n; j++ ) mpfr_fma ( res, res, args[0], args[j], MPFR_RNDD );
+}
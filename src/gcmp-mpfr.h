@@ -9,8 +9,13 @@
 
 #pragma once
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <mpfr.h>
+
+/* Precision ( maximum characters ) */
+#define MAX_DIGITS 10000000
 
 enum math 
 {
@@ -41,10 +46,48 @@ enum math_ext
 	TAN,
 	CPI,
 	CEU,
+	CEX,
+	CL2,
 	UND
 };
 
-void gcmp_mpfr_all ( enum math, const char *, const char *, uint16_t, uint8_t, uint8_t, char * );
+enum math_nary
+{
+	DOT,
+	FMA,
+	FMS,
+	FMMA,
+	FMMS,
+	PLY,
+	PWM,
+	GCD,
+	INV,
+	PRM,
+	NNR
+};
+
+void gcmp_mpfr_op ( enum math, mpfr_t, mpfr_t, mpfr_t, uint32_t );
+
+void gcmp_mpfr_op_ext ( enum math_ext, mpfr_t, mpfr_t, uint32_t, uint8_t );
+
+/* n! ( 0! = 1! = 1 ) at the result's precision; by the gamma function when that is cheaper ( gcmp-cost.h ) */
+int gcmp_mpfr_fac ( mpfr_t, unsigned long, mpfr_rnd_t );
+
+/*
+* Fused, rounded once: dot ( a1 .. an, b1 .. bn ), fma / fms ( a, b, c ), fmma / fmms ( a, b, c, d );
+* poly ( x, cn .. c0 ) is Horner's rule, one fma per coefficient. Nan if the arguments do not fit.
+* On GMP integers, exact: powm ( a, b, m ), gcd ( a, b .. ), invm ( a, m ), prime ( n ) ( 1 if probably prime, else 0 );
+* nan if an operand is not an integer held exactly at its precision, or there is no answer.
+*/
+void gcmp_mpfr_op_nary ( enum math_nary, mpfr_t, mpfr_ptr *, uint32_t );
+
+int gcmp_mpfr_nary_fits ( enum math_nary, uint32_t );
+
+/* Ternary of the rounding */
+int gcmp_mpfr_set_str ( mpfr_t, const char *, uint8_t );
+
+void gcmp_mpfr_get_str ( mpfr_t, uint32_t, uint8_t, char * );
 
-void gcmp_mpfr_all_ext ( enum math_ext, const char *, uint16_t, uint8_t, uint8_t, char *, uint8_t );
+/* Result text in base 2 .. 36 ( decimal as gcmp_mpfr_get_str ); malloc'd */
+char * gcmp_mpfr_get_str_base ( mpfr_t, uint32_t, uint8_t );
 
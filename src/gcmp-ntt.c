@@ -0,0 +1,690 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-ntt.h"
+#include "gcmp-pool.h"
+
+#include <string.h>
+
+/*
+* Limbs are the coefficients: a convolution term is below n × 2^128, the three primes near 2^62
+* take up to 2^186, so n may go far beyond any memory. Residues are multiplied in Montgomery form.
+* Forward transforms decimate in frequency ( bit-reversed out ), the inverse in time ( bit-reversed in ).
+*/
+
+/* Operands of at least 16384 limbs ( some 315000 digits ) on 6 cores or more: the transforms do about three times the work of GMP */
+#define NTT_MIN_LIMBS 16384
+#ifndef NTT_MIN_CORES
+#define NTT_MIN_CORES 6
+#endif
+
+/* Transforms below LEAF points run in place; from PAR_HALF the two halves and from PAR_FLY the butterflies are tasks */
+#define LEAF 1024
+#define PAR_HALF 16384
+#define PAR_FLY  65536
+
+/* Newton below this precision is MPFR's; guard bits of the Newton results */
+#define NEWTON_MIN 4096
+#define GUARD_BITS 128
+
+#if defined ( __SIZEOF_INT128__ ) && GMP_NUMB_BITS == 64
+
+typedef unsigned __int128 u128;
+
+typedef struct _Prime Prime;
+
+struct _Prime
+{
+	uint64_t p, g;
+
+	// -1 / p mod 2^64, 2^64 mod p, 2^128 mod p
+	uint64_t pinv, r1, r2;
+};
+
+/* p = k × 2^s + 1 with s >= 38, in ascending order ( Garner needs it ); g generates the group */
+static Prime primes[3] =
+{
+	{ 4611546380450660353ULL,  5, 0, 0, 0 },
+	{ 4611627194555301889ULL,  7, 0, 0, 0 },
+	{ 4611672549409947649ULL, 14, 0, 0, 0 }
+};
+
+typedef struct _Ntt Ntt;
+
+struct _Ntt
+{
+	const Prime *q;
+
+	uint64_t *a, *b, *w, *wi;
+	size_t n;
+
+	const mp_limb_t *la, *lb;
+	size_t na, nb;
+};
+
+typedef struct _Part Part;
+
+struct _Part
+{
+	Ntt *ntt;
+	uint64_t *a;
+	const uint64_t *w;
+
+	size_t m, stride, from, to;
+};
+
+static inline uint64_t gcmp_ntt_add ( uint64_t a, uint64_t b, uint64_t p )
+{
+	uint64_t r = a + b;
+
+	return ( r >= p ) ? r - p : r;
+}
+
+static inline uint64_t gcmp_ntt_sub ( uint64_t a, uint64_t b, uint64_t p )
+{
+	return ( a >= b ) ? a - b : a + p - b;
+}
+
+/* a × b / 2^64 mod p */
+static inline uint64_t gcmp_ntt_redc ( uint64_t a, uint64_t b, const Prime *q )
+{
+	u128 t = (u128)a * b;
+	uint64_t m = (uint64_t)t * q->pinv;
+	uint64_t r = (uint64_t)( ( t + (u128)m * q->p ) >> 64 );
+
+	return ( r >= q->p ) ? r - q->p : r;
+}
+
+static uint64_t gcmp_ntt_pow ( uint64_t a, uint64_t e, uint64_t p )
+{
+	uint64_t r = 1;
+
+	for ( ; e; e >>= 1 )
+	{
+		if ( e & 1 ) r = (uint64_t)( (u128)r * a % p );
+
+		a = (uint64_t)( (u128)a * a % p );
+	}
+
+	return r;
+}
+
+static void gcmp_ntt_init ( void )
+{
+	static gsize init = 0;
+
+	if ( !g_once_init_enter ( &init ) ) return;
+
+	uint8_t j = 0, k = 0;
+	for ( j = 0; j < 3; j++ )
+	{
+		Prime *q = &primes[j];
+
+		// Newton: each step doubles the correct low bits of 1 / p
+		uint64_t x = q->p;
+		for ( k = 0; k < 5; k++ ) x *= 2 - q->p * x;
+
+		q->pinv = -x;
+		q->r1 = (uint64_t)( ( (u128)1 << 64 ) % q->p );
+		q->r2 = (uint64_t)( (u128)q->r1 * q->r1 % q->p );
+	}
+
+	g_once_init_leave ( &init, 1 );
+}
+
+static void gcmp_ntt_fly_dif ( Part *part )
+{
+	const Prime *q = part->ntt->q;
+	uint64_t *a = part->a;
+	size_t i = 0, h = part->m / 2;
+
+	for ( i = part->from; i < part->to; i++ )
+	{
+		uint64_t u = a[i], v = a[i + h];
+
+		a[i] = gcmp_ntt_add ( u, v, q->p );
+		a[i + h] = gcmp_ntt_redc ( gcmp_ntt_sub ( u, v, q->p ), part->w[i * part->stride], q );
+	}
+}
+
+static void gcmp_ntt_fly_dit ( Part *part )
+{
+	const Prime *q = part->ntt->q;
+	uint64_t *a = part->a;
+	size_t i = 0, h = part->m / 2;
+
+	for ( i = part->from; i < part->to; i++ )
+	{
+		uint64_t u = a[i], v = gcmp_ntt_redc ( a[i + h], part->w[i * part->stride], q );
+
+		a[i] = gcmp_ntt_add ( u, v, q->p );
+		a[i + h] = gcmp_ntt_sub ( u, v, q->p );
+	}
+}
+
+/* One level of butterflies, cut into tasks when it is long */
+static void gcmp_ntt_fly ( Part *part, GcmpPoolFunc func )
+{
+	size_t h = part->m / 2;
+
+	if ( part->m < PAR_FLY ) { part->from = 0; part->to = h; func ( part ); return; }
+
+	size_t j = 0, n = MIN ( (size_t)gcmp_pool_get_workers () + 1, part->m / PAR_FLY * 4 );
+
+	Part *parts = g_new ( Part, n );
+	GcmpPoolGroup group = { 0 };
+
+	for ( j = 0; j < n; j++ )
+	{
+		parts[j] = *part;
+		parts[j].from = h * j / n;
+		parts[j].to = h * ( j + 1 ) / n;
+
+		if ( j ) gcmp_pool_spawn ( &group, func, &parts[j] );
+	}
+
+	func ( &parts[0] );
+	gcmp_pool_wait ( &group );
+
+	g_free ( parts );
+}
+
+static void gcmp_ntt_leaf_dif ( Part *part )
+{
+	const Prime *q = part->ntt->q;
+	uint64_t *a = part->a;
+	size_t m = part->m, len = 0, st = 0, i = 0;
+
+	for ( len = m; len >= 2; len >>= 1 )
+	{
+		size_t h = len / 2, s = part->stride * ( m / len );
+
+		for ( st = 0; st < m; st += len )
+		for ( i = 0; i < h; i++ )
+		{
+			uint64_t u = a[st + i], v = a[st + i + h];
+
+			a[st + i] = gcmp_ntt_add ( u, v, q->p );
+			a[st + i + h] = gcmp_ntt_redc ( gcmp_ntt_sub ( u, v, q->p ), part->w[i * s], q );
+		}
+	}
+}
+
+static void gcmp_ntt_leaf_dit ( Part *part )
+{
+	const Prime *q = part->ntt->q;
+	uint64_t *a = part->a;
+	size_t m = part->m, len = 0, st = 0, i = 0;
+
+	for ( len = 2; len <= m; len <<= 1 )
+	{
+		size_t h = len / 2, s = part->stride * ( m / len );
+
+		for ( st = 0; st < m; st += len )
+		for ( i = 0; i < h; i++ )
+		{
+			uint64_t u = a[st + i], v = gcmp_ntt_redc ( a[st + i + h], part->w[i * s], q );
+
+			a[st + i] = gcmp_ntt_add ( u, v, q->p );
+			a[st + i + h] = gcmp_ntt_sub ( u, v, q->p );
+		}
+	}
+}
+
+static void gcmp_ntt_dif ( Part *part );
+static void gcmp_ntt_dit ( Part *part );
+
+/* The two halves are independent transforms: one of them may go to another core */
+static void gcmp_ntt_halves ( Part *part, GcmpPoolFunc func )
+{
+	Part lo = *part, hi = *part;
+
+	lo.m = hi.m = part->m / 2;
+	lo.stride = hi.stride = part->stride * 2;
+	hi.a = part->a + part->m / 2;
+
+	if ( part->m < PAR_HALF ) { func ( &lo ); func ( &hi ); return; }
+
+	GcmpPoolGroup group = { 0 };
+
+	gcmp_pool_spawn ( &group, func, &hi );
+	func ( &lo );
+
+	gcmp_pool_wait ( &group );
+}
+
+static void gcmp_ntt_dif ( Part *part )
+{
+	if ( part->m <= LEAF ) { gcmp_ntt_leaf_dif ( part ); return; }
+
+	gcmp_ntt_fly ( part, (GcmpPoolFunc)gcmp_ntt_fly_dif );
+	gcmp_ntt_halves ( part, (GcmpPoolFunc)gcmp_ntt_dif );
+}
+
+static void gcmp_ntt_dit ( Part *part )
+{
+	if ( part->m <= LEAF ) { gcmp_ntt_leaf_dit ( part ); return; }
+
+	gcmp_ntt_halves ( part, (GcmpPoolFunc)gcmp_ntt_dit );
+	gcmp_ntt_fly ( part, (GcmpPoolFunc)gcmp_ntt_fly_dit );
+}
+
+static void gcmp_ntt_transform ( Ntt *ntt, uint64_t *a, const uint64_t *w, GcmpPoolFunc func )
+{
+	Part part = { ntt, a, w, ntt->n, 1, 0, 0 };
+
+	func ( &part );
+}
+
+/* Powers of the root in Montgomery form, i < n / 2 */
+static void gcmp_ntt_roots ( const Prime *q, uint64_t root, uint64_t *w, size_t h )
+{
+	uint64_t wr = gcmp_ntt_redc ( root, q->r2, q );
+
+	w[0] = q->r1;
+
+	size_t i = 0;
+	for ( i = 1; i < h; i++ ) w[i] = gcmp_ntt_redc ( w[i - 1], wr, q );
+}
+
+static void gcmp_ntt_load ( const Prime *q, uint64_t *a, const mp_limb_t *l, size_t nl, size_t n )
+{
+	size_t i = 0;
+	for ( i = 0; i < nl; i++ ) a[i] = l[i] % q->p;
+
+	memset ( a + nl, 0, ( n - nl ) * sizeof ( uint64_t ) );
+}
+
+/* The whole product modulo one prime, left in a */
+static void gcmp_ntt_prime ( Ntt *ntt )
+{
+	const Prime *q = ntt->q;
+	size_t i = 0, n = ntt->n;
+
+	uint64_t root = gcmp_ntt_pow ( q->g, ( q->p - 1 ) / n, q->p );
+
+	gcmp_ntt_roots ( q, root, ntt->w, n / 2 );
+	gcmp_ntt_roots ( q, gcmp_ntt_pow ( root, n - 1, q->p ), ntt->wi, n / 2 );
+
+	gcmp_ntt_load ( q, ntt->a, ntt->la, ntt->na, n );
+	gcmp_ntt_transform ( ntt, ntt->a, ntt->w, (GcmpPoolFunc)gcmp_ntt_dif );
+
+	// A square needs one forward transform
+	uint64_t *b = ntt->a;
+
+	if ( ntt->lb != ntt->la || ntt->nb != ntt->na )
+	{
+		gcmp_ntt_load ( q, ntt->b, ntt->lb, ntt->nb, n );
+		gcmp_ntt_transform ( ntt, ntt->b, ntt->w, (GcmpPoolFunc)gcmp_ntt_dif );
+
+		b = ntt->b;
+	}
+
+	for ( i = 0; i < n; i++ ) ntt->a[i] = gcmp_ntt_redc ( ntt->a[i], b[i], q );
+
+	gcmp_ntt_transform ( ntt, ntt->a, ntt->wi, (GcmpPoolFunc)gcmp_ntt_dit );
+
+	// The products lost one 2^64, the inverse gained n: both come back in one factor
+	uint64_t s = gcmp_ntt_redc ( gcmp_ntt_pow ( n % q->p, q->p - 2, q->p ), q->r2, q );
+	s = gcmp_ntt_redc ( s, q->r2, q );
+
+	for ( i = 0; i < n; i++ ) ntt->a[i] = gcmp_ntt_redc ( ntt->a[i], s, q );
+}
+
+/* Terms back from their three residues ( Garner ), then the carries */
+static void gcmp_ntt_crt ( Ntt *ntt, mp_limb_t *out, size_t nout )
+{
+	const Prime *q0 = &primes[0], *q1 = &primes[1], *q2 = &primes[2];
+
+	// 1 / p0 mod p1, 1 / p0 mod p2, 1 / p1 mod p2, in Montgomery form
+	uint64_t c01 = gcmp_ntt_redc ( gcmp_ntt_pow ( q0->p % q1->p, q1->p - 2, q1->p ), q1->r2, q1 );
+	uint64_t c02 = gcmp_ntt_redc ( gcmp_ntt_pow ( q0->p % q2->p, q2->p - 2, q2->p ), q2->r2, q2 );
+	uint64_t c12 = gcmp_ntt_redc ( gcmp_ntt_pow ( q1->p % q2->p, q2->p - 2, q2->p ), q2->r2, q2 );
+
+	u128 p01 = (u128)q0->p * q1->p;
+	uint64_t p01_lo = (uint64_t)p01, p01_hi = (uint64_t)( p01 >> 64 );
+
+	uint64_t a0 = 0, a1 = 0, a2 = 0;
+
+	size_t k = 0;
+	for ( k = 0; k < nout; k++ )
+	{
+		uint64_t v1 = ntt[0].a[k];
+		uint64_t v2 = gcmp_ntt_redc ( gcmp_ntt_sub ( ntt[1].a[k], v1, q1->p ), c01, q1 );
+		uint64_t v3 = gcmp_ntt_redc ( gcmp_ntt_sub ( ntt[2].a[k], v1, q2->p ), c02, q2 );
+
+		v3 = gcmp_ntt_redc ( gcmp_ntt_sub ( v3, v2, q2->p ), c12, q2 );
+
+		// v1 + p0 v2 + p0 p1 v3
+		u128 x = (u128)q0->p * v2 + v1;
+		u128 t = (u128)p01_lo * v3 + (uint64_t)x;
+
+		uint64_t c0 = (uint64_t)t;
+		t = ( t >> 64 ) + (u128)p01_hi * v3 + (uint64_t)( x >> 64 );
+		uint64_t c1 = (uint64_t)t, c2 = (uint64_t)( t >> 64 );
+
+		u128 s = (u128)a0 + c0;
+		out[k] = (uint64_t)s;
+
+		s = ( s >> 64 ) + a1 + c1;
+		a0 = (uint64_t)s;
+
+		s = ( s >> 64 ) + a2 + c2;
+		a1 = (uint64_t)s;
+		a2 = (uint64_t)( s >> 64 );
+	}
+}
+
+static gboolean gcmp_ntt_worth ( size_t na, size_t nb )
+{
+	return ( MIN ( na, nb ) >= NTT_MIN_LIMBS && gcmp_pool_get_workers () + 1 >= NTT_MIN_CORES );
+}
+
+void gcmp_ntt_mul_z ( mpz_t r, const mpz_t a, const mpz_t b )
+{
+	size_t na = mpz_size ( a ), nb = mpz_size ( b );
+
+	if ( !gcmp_ntt_worth ( na, nb ) ) { mpz_mul ( r, a, b ); return; }
+
+	gcmp_ntt_init ();
+
+	size_t n = 1, nout = na + nb;
+	while ( n < nout ) n <<= 1;
+
+	gboolean square = ( a == b );
+
+	Ntt ntt[3];
+	GcmpPoolGroup group = { 0 };
+
+	uint8_t j = 0;
+	for ( j = 0; j < 3; j++ )
+	{
+		ntt[j] = (Ntt){ &primes[j], g_new ( uint64_t, n ), ( square ) ? NULL : g_new ( uint64_t, n ), g_new ( uint64_t, n / 2 ), g_new ( uint64_t, n / 2 ),
+			n, mpz_limbs_read ( a ), mpz_limbs_read ( b ), na, nb };
+
+		// The three primes run side by side, each transform spread further
+		if ( j ) gcmp_pool_spawn ( &group, (GcmpPoolFunc)gcmp_ntt_prime, &ntt[j] );
+	}
+
+	gcmp_ntt_prime ( &ntt[0] );
+	gcmp_pool_wait ( &group );
+
+	mpz_t t;
+	mpz_init ( t );
+
+	gcmp_ntt_crt ( ntt, mpz_limbs_write ( t, (mp_size_t)nout ), nout );
+
+	mpz_limbs_finish ( t, ( ( mpz_sgn ( a ) < 0 ) != ( mpz_sgn ( b ) < 0 ) ) ? -(mp_size_t)nout : (mp_size_t)nout );
+
+	mpz_swap ( r, t );
+	mpz_clear ( t );
+
+	for ( j = 0; j < 3; j++ ) { g_free ( ntt[j].a ); g_free ( ntt[j].b ); g_free ( ntt[j].w ); g_free ( ntt[j].wi ); }
+}
+
+#else
+
+/* No 128-bit products or other limbs: GMP alone */
+static gboolean gcmp_ntt_worth ( G_GNUC_UNUSED size_t na, G_GNUC_UNUSED size_t nb )
+{
+	return FALSE;
+}
+
+void gcmp_ntt_mul_z ( mpz_t r, const mpz_t a, const mpz_t b )
+{
+	mpz_mul ( r, a, b );
+}
+
+#endif
+
+static gboolean gcmp_ntt_use ( mpfr_srcptr a, mpfr_srcptr b, mpfr_prec_t prec )
+{
+	if ( !mpfr_regular_p ( a ) || !mpfr_regular_p ( b ) ) return FALSE;
+
+	mpfr_prec_t p = MIN ( prec, MIN ( mpfr_get_prec ( a ), mpfr_get_prec ( b ) ) );
+
+	return gcmp_ntt_worth ( (size_t)( p / GMP_NUMB_BITS ), (size_t)( p / GMP_NUMB_BITS ) );
+}
+
+/* The exact product of the mantissas, rounded once: the same as mpfr_mul */
+int gcmp_ntt_mul ( mpfr_t res, mpfr_srcptr a, mpfr_srcptr b, mpfr_rnd_t rnd )
+{
+	if ( !gcmp_ntt_use ( a, b, mpfr_get_prec ( res ) ) ) return mpfr_mul ( res, a, b, rnd );
+
+	mpz_t za, zb;
+	mpz_inits ( za, zb, NULL );
+
+	mpfr_exp_t e = mpfr_get_z_2exp ( za, a );
+
+	if ( a == b )
+		gcmp_ntt_mul_z ( za, za, za );
+	else
+	{
+		e += mpfr_get_z_2exp ( zb, b );
+		gcmp_ntt_mul_z ( za, za, zb );
+	}
+
+	if ( a == b ) e *= 2;
+
+	int ret = mpfr_set_z_2exp ( res, za, e, rnd );
+
+	mpz_clears ( za, zb, NULL );
+
+	return ret;
+}
+
+/* Precisions of the Newton steps, the last one first; the first one comes from MPFR */
+static uint8_t gcmp_ntt_steps ( mpfr_prec_t prec, mpfr_prec_t *steps )
+{
+	uint8_t n = 0;
+
+	for ( ; prec > NEWTON_MIN; prec = prec / 2 + 64 ) steps[n++] = prec;
+
+	steps[n] = prec;
+
+	return n;
+}
+
+/* x = 1 / b to prec bits, a few ulps off: x += x ( 1 - b x ) doubles the correct bits */
+static void gcmp_ntt_recip ( mpfr_t x, mpfr_srcptr b, mpfr_prec_t prec )
+{
+	mpfr_prec_t steps[64];
+	uint8_t n = gcmp_ntt_steps ( prec, steps );
+
+	mpfr_t bk, e;
+	mpfr_inits2 ( steps[n], bk, e, NULL );
+
+	mpfr_set_prec ( x, steps[n] );
+	mpfr_set ( bk, b, MPFR_RNDN );
+	mpfr_ui_div ( x, 1, bk, MPFR_RNDN );
+
+	while ( n-- )
+	{
+		mpfr_prec_t p = steps[n];
+
+		mpfr_set_prec ( bk, p );
+		mpfr_set ( bk, b, MPFR_RNDN );
+
+		// x has half the bits yet: the products are half size
+		mpfr_set_prec ( e, p );
+		gcmp_ntt_mul ( e, bk, x, MPFR_RNDN );
+		mpfr_ui_sub ( e, 1, e, MPFR_RNDN );
+
+		mpfr_prec_round ( e, p / 2 + 64, MPFR_RNDN );
+		gcmp_ntt_mul ( e, x, e, MPFR_RNDN );
+
+		mpfr_prec_round ( x, p, MPFR_RNDN );
+		mpfr_add ( x, x, e, MPFR_RNDN );
+	}
+
+	mpfr_clears ( bk, e, NULL );
+}
+
+/* y = 1 / sqrt ( a ): y += y ( 1 - a y² ) / 2 */
+static void gcmp_ntt_rsqrt ( mpfr_t y, mpfr_srcptr a, mpfr_prec_t prec )
+{
+	mpfr_prec_t steps[64];
+	uint8_t n = gcmp_ntt_steps ( prec, steps );
+
+	mpfr_t ak, e;
+	mpfr_inits2 ( steps[n], ak, e, NULL );
+
+	mpfr_set_prec ( y, steps[n] );
+	mpfr_set ( ak, a, MPFR_RNDN );
+	mpfr_rec_sqrt ( y, ak, MPFR_RNDN );
+
+	while ( n-- )
+	{
+		mpfr_prec_t p = steps[n];
+
+		mpfr_set_prec ( ak, p );
+		mpfr_set ( ak, a, MPFR_RNDN );
+
+		mpfr_set_prec ( e, p );
+		gcmp_ntt_mul ( e, ak, y, MPFR_RNDN );
+		gcmp_ntt_mul ( e, e, y, MPFR_RNDN );
+		mpfr_ui_sub ( e, 1, e, MPFR_RNDN );
+
+		mpfr_prec_round ( e, p / 2 + 64, MPFR_RNDN );
+		gcmp_ntt_mul ( e, y, e, MPFR_RNDN );
+		mpfr_div_2ui ( e, e, 1, MPFR_RNDN );
+
+		mpfr_prec_round ( y, p, MPFR_RNDN );
+		mpfr_add ( y, y, e, MPFR_RNDN );
+	}
+
+	mpfr_clears ( ak, e, NULL );
+}
+
+/* Newton result with GUARD_BITS to spare: rounded when that is safe and something is discarded, else left to gcmp_ntt_exact and MPFR ( rare ) */
+static gboolean gcmp_ntt_round ( mpfr_t res, mpfr_t v, mpfr_rnd_t rnd, int *ret )
+{
+	mpfr_prec_t prec = mpfr_get_prec ( res );
+
+	if ( !mpfr_can_round ( v, mpfr_get_prec ( v ) - GUARD_BITS / 2, MPFR_RNDN, rnd, prec + ( rnd == MPFR_RNDN ) ) ) return FALSE;
+
+	*ret = mpfr_set ( res, v, rnd );
+
+	// Nothing discarded says nothing of the exact result: 0 only once checked
+	return ( *ret != 0 );
+}
+
+/* An exact result is never rounded by can_round: v to the nearest is it when x = res^n × y ( NULL: 1 ), nothing is discarded and the ternary is 0 */
+static gboolean gcmp_ntt_exact ( mpfr_t res, mpfr_t v, mpfr_srcptr x, mpfr_srcptr y, uint8_t n, int *ret )
+{
+	mpfr_set ( res, v, MPFR_RNDN );
+
+	// Products at the sum of the precisions: exact
+	mpfr_t t;
+	mpfr_init2 ( t, mpfr_get_prec ( res ) * n + ( ( y ) ? mpfr_get_prec ( y ) : 0 ) );
+	mpfr_set ( t, res, MPFR_RNDN );
+
+	if ( n == 2 ) gcmp_ntt_mul ( t, t, t, MPFR_RNDN );
+	if ( y ) gcmp_ntt_mul ( t, t, y, MPFR_RNDN );
+
+	gboolean exact = ( x ) ? mpfr_equal_p ( t, x ) : ( mpfr_cmp_ui ( t, 1 ) == 0 );
+
+	mpfr_clear ( t );
+
+	if ( exact ) *ret = 0;
+
+	return exact;
+}
+
+/* Karp and Markstein: 1 / b to half the bits, q = a / b then one correction q += ( a - b q ) / b at full size */
+int gcmp_ntt_div ( mpfr_t res, mpfr_srcptr a, mpfr_srcptr b, mpfr_rnd_t rnd )
+{
+	mpfr_prec_t prec = mpfr_get_prec ( res ) + GUARD_BITS, half = prec / 2 + 64;
+
+	if ( !gcmp_ntt_use ( a, b, prec ) ) return mpfr_div ( res, a, b, rnd );
+
+	mpfr_t x, q, t;
+	mpfr_init2 ( x, half );
+	mpfr_init2 ( q, half );
+	mpfr_init2 ( t, prec );
+
+	gcmp_ntt_recip ( x, b, half );
+
+	mpfr_set ( t, a, MPFR_RNDN );
+	gcmp_ntt_mul ( q, t, x, MPFR_RNDN );
+
+	mpfr_set ( t, b, MPFR_RNDN );
+	gcmp_ntt_mul ( t, t, q, MPFR_RNDN );
+	mpfr_sub ( t, a, t, MPFR_RNDN );
+
+	mpfr_prec_round ( t, half, MPFR_RNDN );
+	gcmp_ntt_mul ( t, x, t, MPFR_RNDN );
+
+	mpfr_prec_round ( q, prec, MPFR_RNDN );
+	mpfr_add ( q, q, t, MPFR_RNDN );
+
+	int ret = 0;
+
+	if ( !gcmp_ntt_round ( res, q, rnd, &ret ) && !gcmp_ntt_exact ( res, q, a, b, 1, &ret ) ) ret = mpfr_div ( res, a, b, rnd );
+
+	mpfr_clears ( x, q, t, NULL );
+
+	return ret;
+}
+
+int gcmp_ntt_rec_sqrt ( mpfr_t res, mpfr_srcptr a, mpfr_rnd_t rnd )
+{
+	mpfr_prec_t prec = mpfr_get_prec ( res ) + GUARD_BITS;
+
+	if ( mpfr_sgn ( a ) <= 0 || !gcmp_ntt_use ( a, a, prec ) ) return mpfr_rec_sqrt ( res, a, rnd );
+
+	mpfr_t y;
+	mpfr_init2 ( y, prec );
+
+	gcmp_ntt_rsqrt ( y, a, prec );
+
+	int ret = 0;
+
+	if ( !gcmp_ntt_round ( res, y, rnd, &ret ) && !gcmp_ntt_exact ( res, y, NULL, a, 2, &ret ) ) ret = mpfr_rec_sqrt ( res, a, rnd );
+
+	mpfr_clear ( y );
+
+	return ret;
+}
+
+/* The same for the root: s = a y with y = 1 / sqrt ( a ) to half the bits, then s += y ( a - s² ) / 2 */
+int gcmp_ntt_sqrt ( mpfr_t res, mpfr_srcptr a, mpfr_rnd_t rnd )
+{
+	mpfr_prec_t prec = mpfr_get_prec ( res ) + GUARD_BITS, half = prec / 2 + 64;
+
+	if ( mpfr_sgn ( a ) <= 0 || !gcmp_ntt_use ( a, a, prec ) ) return mpfr_sqrt ( res, a, rnd );
+
+	mpfr_t y, s, t;
+	mpfr_init2 ( y, half );
+	mpfr_init2 ( s, half );
+	mpfr_init2 ( t, prec );
+
+	gcmp_ntt_rsqrt ( y, a, half );
+
+	mpfr_set ( t, a, MPFR_RNDN );
+	gcmp_ntt_mul ( s, t, y, MPFR_RNDN );
+
+	gcmp_ntt_mul ( t, s, s, MPFR_RNDN );
+	mpfr_sub ( t, a, t, MPFR_RNDN );
+
+	mpfr_prec_round ( t, half, MPFR_RNDN );
+	gcmp_ntt_mul ( t, y, t, MPFR_RNDN );
+	mpfr_div_2ui ( t, t, 1, MPFR_RNDN );
+
+	mpfr_prec_round ( s, prec, MPFR_RNDN );
+	mpfr_add ( s, s, t, MPFR_RNDN );
+
+	int ret = 0;
+
+	if ( !gcmp_ntt_round ( res, s, rnd, &ret ) && !gcmp_ntt_exact ( res, s, a, NULL, 2, &ret ) ) ret = mpfr_sqrt ( res, a, rnd );
+
+	mpfr_clears ( y, s, t, NULL );
+
+	return ret;
+}
@@ -0,0 +1,29 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <gmp.h>
+#include <mpfr.h>
+
+/*
+* Products of huge numbers on all cores: three-prime NTT, the transforms split over the pool.
+* Below the size threshold, or on too few cores, these are GMP and MPFR themselves.
+*/
+
+void gcmp_ntt_mul_z ( mpz_t, const mpz_t, const mpz_t );
+
+/* Same results as mpfr_mul, mpfr_div, mpfr_sqrt and mpfr_rec_sqrt ( correctly rounded ) */
+int gcmp_ntt_mul ( mpfr_t, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t );
+
+int gcmp_ntt_div ( mpfr_t, mpfr_srcptr, mpfr_srcptr, mpfr_rnd_t );
+
+int gcmp_ntt_sqrt ( mpfr_t, mpfr_srcptr, mpfr_rnd_t );
+
+int gcmp_ntt_rec_sqrt ( mpfr_t, mpfr_srcptr, mpfr_rnd_t );
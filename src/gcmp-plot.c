@@ -0,0 +1,885 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-plot.h"
+#include "gcmp-eval.h"
+#include "gcmp-pool.h"
+
+#include <math.h>
+
+/*
+* The plane is cut into square tiles of pixels at each zoom level; a level doubles the scale.
+* Pixel coordinates are relative to an anchor point kept in MPFR, so zooming has no floor.
+* Tiles are sampled and drawn in the shared pool ( gcmp-pool.h ); the main thread only paints cached tiles.
+*/
+
+/* Pixels per tile side, cached tiles, cached sample columns */
+#define TILE 256
+#define TILE_MAX 128
+#define COLUMN_MAX 64
+
+/* Pixels per unit at level 0 ( 2^6 ), and the levels */
+#define UNIT_SHIFT 6
+#define LEVEL_MIN -100
+#define LEVEL_MAX 3000
+
+/* First samples every 8 pixels, then halved up to 10 times where the curve bends or breaks */
+#define SAMPLE_STEP 8
+#define DEPTH_MAX 10
+#define FLAT 0.25
+#define JUMP TILE
+
+/* Doubles while a pixel is above 2^-40 of the coordinates; MPFR with guard bits below */
+#define DOUBLE_BITS 40
+#define GUARD_BITS 64
+
+/* Pixel offsets from the anchor stay below 2^40: the anchor moves beyond */
+#define ANCHOR_MAX 1099511627776.0
+
+typedef struct _Tile Tile;
+
+struct _Tile
+{
+	int level, epoch;
+	int64_t i, j;
+};
+
+typedef struct _Entry Entry;
+
+struct _Entry
+{
+	cairo_surface_t *surface;
+	uint64_t stamp;
+};
+
+typedef struct _Point Point;
+
+struct _Point
+{
+	double x, y;
+};
+
+typedef struct _Job Job;
+
+struct _Job
+{
+	GcmpPlot *plot;
+	Tile tile;
+
+	char *text;
+	mpfr_t ox, oy;
+
+	uint8_t base, deg_rad;
+
+	cairo_surface_t *surface;
+};
+
+typedef struct _Sampler Sampler;
+
+struct _Sampler
+{
+	Job *job;
+	GcmpEval *eval;
+
+	int shift;
+	uint32_t digits;
+
+	double oxd, oyd, scale;
+	mpfr_t x, y;
+};
+
+struct _GcmpPlot
+{
+	GtkWindow  parent_instance;
+
+	GtkEntry *entry;
+	GtkLabel *label;
+	GtkDrawingArea *area;
+
+	// Jobs not back yet
+	GcmpPoolGroup jobs;
+	GHashTable *tiles;
+
+	GMutex mutex;
+	GHashTable *columns;
+
+	char *text;
+	mpfr_t ox, oy;
+	double cx, cy, drag_x, drag_y, scroll;
+
+	int level, epoch;
+	uint64_t stamp;
+	uint32_t visible;
+
+	uint8_t base, deg_rad;
+};
+
+G_DEFINE_TYPE ( GcmpPlot, gcmp_plot, GTK_TYPE_WINDOW )
+
+static guint gcmp_plot_tile_hash ( gconstpointer key )
+{
+	const Tile *t = key;
+
+	return (guint)( t->level * 31 + t->epoch * 7 ) ^ (guint)( t->i * 1000003 ) ^ (guint)( t->j * 8191 );
+}
+
+static gboolean gcmp_plot_tile_equal ( gconstpointer a, gconstpointer b )
+{
+	const Tile *ta = a, *tb = b;
+
+	return ( ta->level == tb->level && ta->epoch == tb->epoch && ta->i == tb->i && ta->j == tb->j );
+}
+
+static void gcmp_plot_entry_free ( Entry *entry )
+{
+	if ( entry->surface ) cairo_surface_destroy ( entry->surface );
+
+	g_free ( entry );
+}
+
+static long gcmp_plot_exp ( mpfr_t v )
+{
+	return ( mpfr_zero_p ( v ) ) ? -100000 : mpfr_get_exp ( v );
+}
+
+/* 0: doubles resolve a pixel here; otherwise the digits that do */
+static uint32_t gcmp_plot_digits ( mpfr_t ox, mpfr_t oy, double px, int shift )
+{
+	long e = MAX ( gcmp_plot_exp ( ox ), gcmp_plot_exp ( oy ) );
+
+	if ( px >= 1 ) e = MAX ( e, ilogb ( px ) + 1 - shift );
+
+	long bits = e + shift;
+
+	if ( bits <= DOUBLE_BITS && shift < 1000 ) return 0;
+
+	// Past the range of doubles the scale alone forces MPFR, relative precision is still enough
+	return (uint32_t)MAX ( 16, ( MAX ( bits, 0 ) + GUARD_BITS ) / 4 + 1 );
+}
+
+/* o += px pixels, exactly: the precision grows with the level */
+static void gcmp_plot_move ( mpfr_t o, double px, int shift )
+{
+	mpfr_t d;
+	mpfr_init2 ( d, 64 );
+	mpfr_set_d ( d, px, MPFR_RNDN );
+	mpfr_mul_2si ( d, d, -shift, MPFR_RNDN );
+
+	long bits = MAX ( gcmp_plot_exp ( o ), gcmp_plot_exp ( d ) ) + shift + GUARD_BITS;
+
+	if ( bits > (long)mpfr_get_prec ( o ) ) mpfr_prec_round ( o, bits, MPFR_RNDN );
+
+	mpfr_add ( o, o, d, MPFR_RNDN );
+
+	mpfr_clear ( d );
+}
+
+static gboolean gcmp_plot_job_stale ( Job *job )
+{
+	GcmpPlot *plot = job->plot;
+
+	return ( g_atomic_int_get ( &plot->epoch ) != job->tile.epoch || g_atomic_int_get ( &plot->level ) != job->tile.level );
+}
+
+/* Pixel y of the expression at pixel x, both from the anchor */
+static double gcmp_plot_sample ( Sampler *s, double px )
+{
+	Job *job = s->job;
+
+	if ( !s->digits ) return ( gcmp_eval_run_d ( s->eval, job->deg_rad, s->oxd + px * s->scale ) - s->oyd ) / s->scale;
+
+	mpfr_set_d ( s->x, px, MPFR_RNDN );
+	mpfr_mul_2si ( s->x, s->x, -s->shift, MPFR_RNDN );
+	mpfr_add ( s->x, s->x, job->ox, MPFR_RNDN );
+
+	gcmp_eval_run_at ( s->eval, s->y, s->digits, job->deg_rad, s->x );
+
+	mpfr_sub ( s->y, s->y, job->oy, MPFR_RNDN );
+	mpfr_mul_2si ( s->y, s->y, s->shift, MPFR_RNDN );
+
+	return mpfr_get_d ( s->y, MPFR_RNDN );
+}
+
+/* Points after a up to b: halved while the midpoint is off the chord or the domain ends inside */
+static void gcmp_plot_refine ( Sampler *s, Point a, Point b, uint8_t depth, GArray *pts )
+{
+	Point m = { ( a.x + b.x ) / 2, gcmp_plot_sample ( s, ( a.x + b.x ) / 2 ) };
+
+	gboolean fa = isfinite ( a.y ), fb = isfinite ( b.y ), fm = isfinite ( m.y );
+	gboolean split = ( fa && fb && fm ) ? fabs ( m.y - ( a.y + b.y ) / 2 ) > FLAT : ( fa || fb || fm );
+
+	// Out of reach of every tile row: no need to follow the curve there
+	if ( fa && fb && fm && ( MIN ( m.y, MIN ( a.y, b.y ) ) > 2 * ANCHOR_MAX || MAX ( m.y, MAX ( a.y, b.y ) ) < -2 * ANCHOR_MAX ) ) split = FALSE;
+
+	if ( split && depth < DEPTH_MAX && !gcmp_plot_job_stale ( s->job ) )
+	{
+		gcmp_plot_refine ( s, a, m, depth + 1, pts );
+		gcmp_plot_refine ( s, m, b, depth + 1, pts );
+
+		return;
+	}
+
+	// Still a jump at the finest step: a discontinuity, the line breaks
+	if ( fa && fb && fabs ( b.y - a.y ) > JUMP ) m.y = NAN;
+
+	g_array_append_val ( pts, m );
+	g_array_append_val ( pts, b );
+}
+
+/* A column of tiles shares its samples; a pixel of margin joins it to its neighbours */
+static GArray * gcmp_plot_sample_column ( Job *job )
+{
+	GcmpEval *eval = gcmp_eval_new ( job->text, job->base );
+
+	if ( !eval ) return NULL;
+
+	Sampler s;
+	s.job = job;
+	s.eval = eval;
+	s.shift = UNIT_SHIFT + job->tile.level;
+	s.scale = ldexp ( 1, -s.shift );
+	s.oxd = mpfr_get_d ( job->ox, MPFR_RNDN );
+	s.oyd = mpfr_get_d ( job->oy, MPFR_RNDN );
+	s.digits = gcmp_plot_digits ( job->ox, job->oy, fabs ( (double)job->tile.i ) * TILE + TILE, s.shift );
+
+	// In MPFR the column's numbers are read once, not at every sample
+	if ( s.digits )
+	{
+		s.eval = gcmp_eval_new_at ( eval, s.digits );
+
+		mpfr_init2 ( s.x, s.digits * 4 );
+		mpfr_init2 ( s.y, s.digits * 4 );
+	}
+
+	GArray *pts = g_array_new ( FALSE, FALSE, sizeof ( Point ) );
+
+	double x0 = (double)job->tile.i * TILE - SAMPLE_STEP;
+
+	Point a = { x0, gcmp_plot_sample ( &s, x0 ) };
+	g_array_append_val ( pts, a );
+
+	uint32_t k = 0;
+	for ( k = 1; k <= TILE / SAMPLE_STEP + 2 && !gcmp_plot_job_stale ( job ); k++ )
+	{
+		Point b = { x0 + k * SAMPLE_STEP, gcmp_plot_sample ( &s, x0 + k * SAMPLE_STEP ) };
+
+		gcmp_plot_refine ( &s, a, b, 0, pts );
+
+		a = b;
+	}
+
+	if ( s.digits ) { gcmp_eval_free ( s.eval ); mpfr_clear ( s.x ); mpfr_clear ( s.y ); }
+
+	gcmp_eval_free ( eval );
+
+	if ( gcmp_plot_job_stale ( job ) ) { g_array_unref ( pts ); return NULL; }
+
+	return pts;
+}
+
+static GArray * gcmp_plot_column ( GcmpPlot *plot, Job *job )
+{
+	Tile key = { job->tile.level, job->tile.epoch, job->tile.i, 0 };
+
+	g_mutex_lock ( &plot->mutex );
+
+	GArray *pts = g_hash_table_lookup ( plot->columns, &key );
+
+	if ( pts ) g_array_ref ( pts );
+
+	g_mutex_unlock ( &plot->mutex );
+
+	if ( pts ) return pts;
+
+	pts = gcmp_plot_sample_column ( job );
+
+	if ( !pts ) return NULL;
+
+	Tile *tile = g_new ( Tile, 1 );
+	*tile = key;
+
+	g_mutex_lock ( &plot->mutex );
+
+	if ( g_hash_table_size ( plot->columns ) >= COLUMN_MAX ) g_hash_table_remove_all ( plot->columns );
+
+	g_hash_table_insert ( plot->columns, tile, g_array_ref ( pts ) );
+
+	g_mutex_unlock ( &plot->mutex );
+
+	return pts;
+}
+
+/* Clipped to a band around the tile: cairo's fixed point would overflow on far ends */
+static void gcmp_plot_segment ( cairo_t *cr, double xa, double ya, double xb, double yb )
+{
+	const double lo = -TILE, hi = 2 * TILE;
+
+	if ( ( ya < lo && yb < lo ) || ( ya > hi && yb > hi ) ) return;
+
+	if ( ya < lo ) { xa += ( xb - xa ) * ( lo - ya ) / ( yb - ya ); ya = lo; }
+	if ( ya > hi ) { xa += ( xb - xa ) * ( hi - ya ) / ( yb - ya ); ya = hi; }
+	if ( yb < lo ) { xb += ( xa - xb ) * ( lo - yb ) / ( ya - yb ); yb = lo; }
+	if ( yb > hi ) { xb += ( xa - xb ) * ( hi - yb ) / ( ya - yb ); yb = hi; }
+
+	cairo_move_to ( cr, xa, ya );
+	cairo_line_to ( cr, xb, yb );
+}
+
+static cairo_surface_t * gcmp_plot_render ( Job *job, GArray *pts )
+{
+	cairo_surface_t *surface = cairo_image_surface_create ( CAIRO_FORMAT_ARGB32, TILE, TILE );
+	cairo_t *cr = cairo_create ( surface );
+
+	cairo_set_source_rgb ( cr, 0.21, 0.52, 0.89 );
+	cairo_set_line_width ( cr, 2 );
+	cairo_set_line_cap ( cr, CAIRO_LINE_CAP_ROUND );
+
+	// Tile rows go down, pixel y goes up
+	double left = (double)job->tile.i * TILE, top = (double)( job->tile.j + 1 ) * TILE;
+
+	guint k = 0;
+	for ( k = 1; k < pts->len; k++ )
+	{
+		Point *a = &g_array_index ( pts, Point, k - 1 ), *b = &g_array_index ( pts, Point, k );
+
+		if ( isfinite ( a->y ) && isfinite ( b->y ) ) gcmp_plot_segment ( cr, a->x - left, top - a->y, b->x - left, top - b->y );
+	}
+
+	cairo_stroke ( cr );
+	cairo_destroy ( cr );
+
+	return surface;
+}
+
+static void gcmp_plot_job_free ( Job *job )
+{
+	if ( job->surface ) cairo_surface_destroy ( job->surface );
+
+	mpfr_clear ( job->ox );
+	mpfr_clear ( job->oy );
+
+	g_free ( job->text );
+	g_free ( job );
+}
+
+static void gcmp_plot_evict ( GcmpPlot *plot )
+{
+	// Never below what is on screen, or visible tiles would push each other out
+	while ( g_hash_table_size ( plot->tiles ) > MAX ( TILE_MAX, 2 * plot->visible ) )
+	{
+		Tile *old = NULL;
+		uint64_t stamp = UINT64_MAX;
+
+		GHashTableIter iter;
+		gpointer key, value;
+
+		g_hash_table_iter_init ( &iter, plot->tiles );
+
+		// Pending tiles stay
+		while ( g_hash_table_iter_next ( &iter, &key, &value ) )
+		{
+			Entry *entry = value;
+
+			if ( entry->surface && entry->stamp < stamp ) { stamp = entry->stamp; old = key; }
+		}
+
+		if ( !old ) break;
+
+		g_hash_table_remove ( plot->tiles, old );
+	}
+}
+
+/* Main thread: every job comes back here, done or dropped */
+static gboolean gcmp_plot_done ( Job *job )
+{
+	GcmpPlot *plot = job->plot;
+
+	if ( plot->tiles && job->tile.epoch == plot->epoch )
+	{
+		Entry *entry = g_hash_table_lookup ( plot->tiles, &job->tile );
+
+		if ( entry && job->surface )
+		{
+			entry->surface = job->surface;
+			entry->stamp = ++plot->stamp;
+			job->surface = NULL;
+
+			gcmp_plot_evict ( plot );
+		}
+		else if ( entry )
+			g_hash_table_remove ( plot->tiles, &job->tile );
+
+		gtk_widget_queue_draw ( GTK_WIDGET ( plot->area ) );
+	}
+
+	gcmp_plot_job_free ( job );
+	g_object_unref ( plot );
+
+	return G_SOURCE_REMOVE;
+}
+
+static void gcmp_plot_job ( Job *job )
+{
+	GcmpPlot *plot = job->plot;
+
+	GArray *pts = ( gcmp_plot_job_stale ( job ) ) ? NULL : gcmp_plot_column ( plot, job );
+
+	if ( pts ) { job->surface = gcmp_plot_render ( job, pts ); g_array_unref ( pts ); }
+
+	g_idle_add ( (GSourceFunc)gcmp_plot_done, job );
+}
+
+static void gcmp_plot_request ( GcmpPlot *plot, Tile *tile )
+{
+	Tile *key = g_new ( Tile, 1 );
+	*key = *tile;
+
+	g_hash_table_insert ( plot->tiles, key, g_new0 ( Entry, 1 ) );
+
+	Job *job = g_new0 ( Job, 1 );
+
+	job->plot = g_object_ref ( plot );
+	job->tile = *tile;
+	job->text = g_strdup ( plot->text );
+	job->base = plot->base;
+	job->deg_rad = plot->deg_rad;
+
+	mpfr_init2 ( job->ox, mpfr_get_prec ( plot->ox ) );
+	mpfr_init2 ( job->oy, mpfr_get_prec ( plot->oy ) );
+	mpfr_set ( job->ox, plot->ox, MPFR_RNDN );
+	mpfr_set ( job->oy, plot->oy, MPFR_RNDN );
+
+	gcmp_pool_spawn ( &plot->jobs, (GcmpPoolFunc)gcmp_plot_job, job );
+}
+
+/* New expression, anchor or angle unit: nothing cached is valid, queued jobs drop out */
+static void gcmp_plot_flush ( GcmpPlot *plot )
+{
+	g_atomic_int_inc ( &plot->epoch );
+
+	g_hash_table_remove_all ( plot->tiles );
+
+	g_mutex_lock ( &plot->mutex );
+	g_hash_table_remove_all ( plot->columns );
+	g_mutex_unlock ( &plot->mutex );
+
+	gtk_widget_queue_draw ( GTK_WIDGET ( plot->area ) );
+}
+
+static void gcmp_plot_anchor ( GcmpPlot *plot )
+{
+	if ( fabs ( plot->cx ) < ANCHOR_MAX && fabs ( plot->cy ) < ANCHOR_MAX ) return;
+
+	double dx = round ( plot->cx ), dy = round ( plot->cy );
+
+	gcmp_plot_move ( plot->ox, dx, UNIT_SHIFT + plot->level );
+	gcmp_plot_move ( plot->oy, dy, UNIT_SHIFT + plot->level );
+
+	plot->cx -= dx;
+	plot->cy -= dy;
+
+	gcmp_plot_flush ( plot );
+}
+
+/* Index of the tile k levels coarser, rounded down */
+static int64_t gcmp_plot_coarse ( int64_t i, int k )
+{
+	return ( i >= 0 ) ? i >> k : -( ( -i - 1 ) >> k ) - 1;
+}
+
+/* A cached tile drawn f times its size at x, y; only the part over the tile at sx, sy */
+static gboolean gcmp_plot_paint ( GcmpPlot *plot, cairo_t *cr, Tile *t, double f, double x, double y, double sx, double sy )
+{
+	Entry *entry = g_hash_table_lookup ( plot->tiles, t );
+
+	if ( !entry || !entry->surface ) return FALSE;
+
+	entry->stamp = ++plot->stamp;
+
+	cairo_save ( cr );
+
+	cairo_rectangle ( cr, sx, sy, TILE, TILE );
+	cairo_clip ( cr );
+
+	cairo_translate ( cr, x, y );
+	cairo_scale ( cr, f, f );
+	cairo_set_source_surface ( cr, entry->surface, 0, 0 );
+	cairo_paint ( cr );
+
+	cairo_restore ( cr );
+
+	return TRUE;
+}
+
+/* Cached tile, or a coarser or finer one scaled while it is drawn */
+static void gcmp_plot_tile ( GcmpPlot *plot, cairo_t *cr, Tile *tile, double sx, double sy )
+{
+	if ( !g_hash_table_contains ( plot->tiles, tile ) ) gcmp_plot_request ( plot, tile );
+
+	if ( gcmp_plot_paint ( plot, cr, tile, 1, sx, sy, sx, sy ) ) return;
+
+	int k = 0;
+	for ( k = 1; k <= 4; k++ )
+	{
+		Tile t = { tile->level - k, tile->epoch, gcmp_plot_coarse ( tile->i, k ), gcmp_plot_coarse ( tile->j, k ) };
+
+		// This tile is a part of the coarser one
+		double x = sx - (double)( tile->i - t.i * ( 1 << k ) ) * TILE;
+		double y = sy - (double)( ( t.j + 1 ) * ( 1 << k ) - tile->j - 1 ) * TILE;
+
+		if ( gcmp_plot_paint ( plot, cr, &t, ldexp ( 1, k ), x, y, sx, sy ) ) return;
+	}
+
+	// Zooming out: the four halves of the finer level
+	int a = 0, b = 0;
+	for ( a = 0; a < 2; a++ )
+	for ( b = 0; b < 2; b++ )
+	{
+		Tile t = { tile->level + 1, tile->epoch, tile->i * 2 + a, tile->j * 2 + b };
+
+		gcmp_plot_paint ( plot, cr, &t, 0.5, sx + a * TILE / 2, sy + ( 1 - b ) * TILE / 2, sx, sy );
+	}
+}
+
+static void gcmp_plot_axes ( GcmpPlot *plot, cairo_t *cr, GtkStyleContext *context, double left, double top, int width, int height )
+{
+	GdkRGBA color;
+	gtk_style_context_get_color ( context, gtk_style_context_get_state ( context ), &color );
+
+	cairo_set_source_rgba ( cr, color.red, color.green, color.blue, 0.5 );
+	cairo_set_line_width ( cr, 1 );
+
+	mpfr_t t;
+	mpfr_init2 ( t, 64 );
+
+	// Pixels of x = 0 and y = 0 from the anchor
+	mpfr_mul_2si ( t, plot->ox, UNIT_SHIFT + plot->level, MPFR_RNDN );
+	double x = floor ( -mpfr_get_d ( t, MPFR_RNDN ) - left ) + 0.5;
+
+	mpfr_mul_2si ( t, plot->oy, UNIT_SHIFT + plot->level, MPFR_RNDN );
+	double y = floor ( top + mpfr_get_d ( t, MPFR_RNDN ) ) + 0.5;
+
+	mpfr_clear ( t );
+
+	if ( x > 0 && x < width  ) { cairo_move_to ( cr, x, 0 ); cairo_line_to ( cr, x, height ); }
+	if ( y > 0 && y < height ) { cairo_move_to ( cr, 0, y ); cairo_line_to ( cr, width, y ); }
+
+	cairo_stroke ( cr );
+}
+
+static gboolean gcmp_plot_draw ( GtkWidget *widget, cairo_t *cr, GcmpPlot *plot )
+{
+	int width  = gtk_widget_get_allocated_width  ( widget );
+	int height = gtk_widget_get_allocated_height ( widget );
+
+	GtkStyleContext *context = gtk_widget_get_style_context ( widget );
+	gtk_render_background ( context, cr, 0, 0, width, height );
+
+	// Pixel of the top left corner from the anchor
+	double left = floor ( plot->cx - width / 2.0 ), top = floor ( plot->cy + height / 2.0 );
+
+	gcmp_plot_axes ( plot, cr, context, left, top, width, height );
+
+	if ( !plot->text ) return FALSE;
+
+	int64_t i0 = (int64_t)floor ( left / TILE ), i1 = (int64_t)floor ( ( left + width  ) / TILE );
+	int64_t j0 = (int64_t)floor ( ( top - height ) / TILE ), j1 = (int64_t)floor ( top / TILE );
+
+	plot->visible = (uint32_t)( ( i1 - i0 + 1 ) * ( j1 - j0 + 1 ) );
+
+	int64_t i = 0, j = 0;
+	for ( i = i0; i <= i1; i++ )
+	for ( j = j0; j <= j1; j++ )
+	{
+		Tile tile = { plot->level, plot->epoch, i, j };
+
+		gcmp_plot_tile ( plot, cr, &tile, (double)i * TILE - left, top - (double)( j + 1 ) * TILE );
+	}
+
+	return FALSE;
+}
+
+static void gcmp_plot_status ( GcmpPlot *plot, double sx, double sy )
+{
+	GtkWidget *widget = GTK_WIDGET ( plot->area );
+
+	int shift = UNIT_SHIFT + plot->level;
+
+	double px = plot->cx - gtk_widget_get_allocated_width  ( widget ) / 2.0 + sx;
+	double py = plot->cy + gtk_widget_get_allocated_height ( widget ) / 2.0 - sy;
+
+	uint32_t digits = gcmp_plot_digits ( plot->ox, plot->oy, fabs ( px ), shift );
+
+	// Enough digits to tell one pixel from the next
+	int show = (int)MAX ( 6, ( MAX ( gcmp_plot_exp ( plot->ox ), gcmp_plot_exp ( plot->oy ) ) + shift ) * 3 / 10 + 3 );
+
+	mpfr_t x, y;
+	mpfr_init2 ( x, mpfr_get_prec ( plot->ox ) + 64 );
+	mpfr_init2 ( y, mpfr_get_prec ( plot->oy ) + 64 );
+	mpfr_set ( x, plot->ox, MPFR_RNDN );
+	mpfr_set ( y, plot->oy, MPFR_RNDN );
+
+	gcmp_plot_move ( x, px, shift );
+	gcmp_plot_move ( y, py, shift );
+
+	char *text = NULL;
+	mpfr_asprintf ( &text, "x = %.*Rg   y = %.*Rg", show, x, show, y );
+
+	g_autofree char *status = ( digits ) ? g_strdup_printf ( "%s   ( %u digits )", text, digits ) : g_strdup_printf ( "%s   ( double )", text );
+
+	gtk_label_set_text ( plot->label, status );
+
+	mpfr_free_str ( text );
+	mpfr_clear ( x );
+	mpfr_clear ( y );
+}
+
+static gboolean gcmp_plot_press ( G_GNUC_UNUSED GtkWidget *widget, GdkEventButton *event, GcmpPlot *plot )
+{
+	plot->drag_x = event->x;
+	plot->drag_y = event->y;
+
+	return TRUE;
+}
+
+static gboolean gcmp_plot_motion ( GtkWidget *widget, GdkEventMotion *event, GcmpPlot *plot )
+{
+	if ( event->state & GDK_BUTTON1_MASK )
+	{
+		plot->cx -= event->x - plot->drag_x;
+		plot->cy += event->y - plot->drag_y;
+
+		plot->drag_x = event->x;
+		plot->drag_y = event->y;
+
+		gcmp_plot_anchor ( plot );
+		gtk_widget_queue_draw ( widget );
+	}
+
+	gcmp_plot_status ( plot, event->x, event->y );
+
+	return TRUE;
+}
+
+/* One level in or out, the point under the pointer stays */
+static void gcmp_plot_zoom ( GcmpPlot *plot, int step, double sx, double sy )
+{
+	int level = CLAMP ( plot->level + step, LEVEL_MIN, LEVEL_MAX );
+
+	if ( level == plot->level ) return;
+
+	GtkWidget *widget = GTK_WIDGET ( plot->area );
+
+	double dx = sx - gtk_widget_get_allocated_width  ( widget ) / 2.0;
+	double dy = gtk_widget_get_allocated_height ( widget ) / 2.0 - sy;
+
+	double f = ( step > 0 ) ? 2 : 0.5;
+
+	plot->cx = ( plot->cx + dx ) * f - dx;
+	plot->cy = ( plot->cy + dy ) * f - dy;
+
+	g_atomic_int_set ( &plot->level, level );
+
+	gcmp_plot_anchor ( plot );
+	gcmp_plot_status ( plot, sx, sy );
+
+	gtk_widget_queue_draw ( widget );
+}
+
+static gboolean gcmp_plot_scroll ( G_GNUC_UNUSED GtkWidget *widget, GdkEventScroll *event, GcmpPlot *plot )
+{
+	double dx = 0, dy = 0;
+
+	if ( event->direction == GDK_SCROLL_UP   ) dy = -1;
+	if ( event->direction == GDK_SCROLL_DOWN ) dy =  1;
+
+	if ( event->direction == GDK_SCROLL_SMOOTH ) gdk_event_get_scroll_deltas ( (GdkEvent *)event, &dx, &dy );
+
+	// Touchpads scroll in fractions: a level per whole step
+	plot->scroll -= dy;
+
+	while ( plot->scroll >=  1 ) { plot->scroll -= 1; gcmp_plot_zoom ( plot,  1, event->x, event->y ); }
+	while ( plot->scroll <= -1 ) { plot->scroll += 1; gcmp_plot_zoom ( plot, -1, event->x, event->y ); }
+
+	return TRUE;
+}
+
+static void gcmp_plot_origin ( GcmpPlot *plot )
+{
+	mpfr_set_prec ( plot->ox, 64 );
+	mpfr_set_prec ( plot->oy, 64 );
+	mpfr_set_zero ( plot->ox, 1 );
+	mpfr_set_zero ( plot->oy, 1 );
+
+	plot->cx = plot->cy = 0;
+
+	g_atomic_int_set ( &plot->level, 0 );
+
+	gcmp_plot_flush ( plot );
+}
+
+static void gcmp_plot_reset ( G_GNUC_UNUSED GtkButton *button, GcmpPlot *plot )
+{
+	gcmp_plot_origin ( plot );
+}
+
+static void gcmp_plot_activate ( GtkEntry *entry, GcmpPlot *plot )
+{
+	const char *text = gtk_entry_get_text ( entry );
+
+	GcmpEval *eval = gcmp_eval_new ( text, plot->base );
+
+	if ( !eval ) { gtk_label_set_text ( plot->label, "Not an expression" ); return; }
+
+	gcmp_eval_free ( eval );
+
+	g_free ( plot->text );
+	plot->text = g_strdup ( text );
+
+	gtk_label_set_text ( plot->label, "" );
+
+	gcmp_plot_flush ( plot );
+}
+
+static void gcmp_plot_show ( GcmpPlot *plot, uint8_t base, uint8_t deg_rad )
+{
+	if ( base != plot->base || deg_rad != plot->deg_rad )
+	{
+		plot->base = base;
+		plot->deg_rad = deg_rad;
+
+		// Same text, other base: it has to be valid again
+		if ( plot->text ) gcmp_plot_activate ( plot->entry, plot );
+	}
+
+	gtk_window_present ( GTK_WINDOW ( plot ) );
+}
+
+static void gcmp_plot_create ( GcmpPlot *plot )
+{
+	GtkWindow *window = GTK_WINDOW ( plot );
+
+	gtk_window_set_title ( window, "Gcmp: plot" );
+	gtk_window_set_icon_name ( window, "gnome-calculator" );
+	gtk_window_set_default_size ( window, 640, 480 );
+
+	GtkBox *m_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_VERTICAL, 0 );
+	gtk_box_set_spacing ( m_box, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( m_box ), TRUE );
+
+	GtkBox *h_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
+	gtk_box_set_spacing ( h_box, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( h_box ), TRUE );
+
+	plot->entry = (GtkEntry *)gtk_entry_new ();
+	gtk_entry_set_placeholder_text ( plot->entry, "sin x / x" );
+	g_signal_connect ( plot->entry, "activate", G_CALLBACK ( gcmp_plot_activate ), plot );
+	gtk_widget_set_visible ( GTK_WIDGET ( plot->entry ), TRUE );
+
+	GtkButton *button = (GtkButton *)gtk_button_new_from_icon_name ( "zoom-original", GTK_ICON_SIZE_MENU );
+	g_signal_connect ( button, "clicked", G_CALLBACK ( gcmp_plot_reset ), plot );
+	gtk_widget_set_visible ( GTK_WIDGET ( button ), TRUE );
+
+	gtk_box_pack_start ( h_box, GTK_WIDGET ( plot->entry ), TRUE, TRUE, 0 );
+	gtk_box_pack_end   ( h_box, GTK_WIDGET ( button ), FALSE, FALSE, 0 );
+
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( h_box ), FALSE, FALSE, 0 );
+
+	plot->area = (GtkDrawingArea *)gtk_drawing_area_new ();
+	gtk_widget_add_events ( GTK_WIDGET ( plot->area ), GDK_BUTTON_PRESS_MASK | GDK_POINTER_MOTION_MASK | GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK );
+	gtk_widget_set_visible ( GTK_WIDGET ( plot->area ), TRUE );
+
+	g_signal_connect ( plot->area, "draw", G_CALLBACK ( gcmp_plot_draw ), plot );
+	g_signal_connect ( plot->area, "button-press-event", G_CALLBACK ( gcmp_plot_press ), plot );
+	g_signal_connect ( plot->area, "motion-notify-event", G_CALLBACK ( gcmp_plot_motion ), plot );
+	g_signal_connect ( plot->area, "scroll-event", G_CALLBACK ( gcmp_plot_scroll ), plot );
+
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( plot->area ), TRUE, TRUE, 0 );
+
+	plot->label = (GtkLabel *)gtk_label_new ( "Drag to move, scroll to zoom" );
+	gtk_label_set_selectable ( plot->label, TRUE );
+	gtk_label_set_ellipsize ( plot->label, PANGO_ELLIPSIZE_END );
+	gtk_widget_set_halign ( GTK_WIDGET ( plot->label ), GTK_ALIGN_START );
+	gtk_widget_set_visible ( GTK_WIDGET ( plot->label ), TRUE );
+
+	gtk_box_pack_end ( m_box, GTK_WIDGET ( plot->label ), FALSE, FALSE, 0 );
+
+	gtk_container_set_border_width ( GTK_CONTAINER ( m_box ), 10 );
+	gtk_container_add ( GTK_CONTAINER ( window ), GTK_WIDGET ( m_box ) );
+
+	g_signal_connect ( plot, "delete-event", G_CALLBACK ( gtk_widget_hide_on_delete ), NULL );
+}
+
+static void gcmp_plot_init ( GcmpPlot *plot )
+{
+	plot->base = 10;
+	plot->deg_rad = 1;
+
+	mpfr_init2 ( plot->ox, 64 );
+	mpfr_init2 ( plot->oy, 64 );
+
+	g_mutex_init ( &plot->mutex );
+
+	plot->tiles   = g_hash_table_new_full ( gcmp_plot_tile_hash, gcmp_plot_tile_equal, g_free, (GDestroyNotify)gcmp_plot_entry_free );
+	plot->columns = g_hash_table_new_full ( gcmp_plot_tile_hash, gcmp_plot_tile_equal, g_free, (GDestroyNotify)g_array_unref );
+
+	gcmp_plot_create ( plot );
+	gcmp_plot_origin ( plot );
+
+	g_signal_connect ( plot, "plot-show", G_CALLBACK ( gcmp_plot_show ), NULL );
+}
+
+static void gcmp_plot_dispose ( GObject *object )
+{
+	GcmpPlot *plot = GCMP_PLOT ( object );
+
+	// Queued jobs see the new epoch and drop out; each one still comes back to release its reference
+	g_atomic_int_inc ( &plot->epoch );
+	gcmp_pool_wait ( &plot->jobs );
+
+	if ( plot->tiles ) { g_hash_table_destroy ( plot->tiles ); plot->tiles = NULL; }
+
+	G_OBJECT_CLASS (gcmp_plot_parent_class)->dispose (object);
+}
+
+static void gcmp_plot_finalize ( GObject *object )
+{
+	GcmpPlot *plot = GCMP_PLOT ( object );
+
+	g_hash_table_destroy ( plot->columns );
+	g_mutex_clear ( &plot->mutex );
+
+	mpfr_clear ( plot->ox );
+	mpfr_clear ( plot->oy );
+
+	g_free ( plot->text );
+
+	G_OBJECT_CLASS (gcmp_plot_parent_class)->finalize (object);
+}
+
+static void gcmp_plot_class_init ( GcmpPlotClass *class )
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+
+	oclass->dispose  = gcmp_plot_dispose;
+	oclass->finalize = gcmp_plot_finalize;
+
+	g_signal_new ( "plot-show", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT );
+}
+
+GcmpPlot * gcmp_plot_new ( GtkWindow *parent )
+{
+	GcmpPlot *plot = g_object_new ( GCMP_TYPE_PLOT, NULL );
+
+	gtk_window_set_transient_for ( GTK_WINDOW ( plot ), parent );
+	gtk_window_set_destroy_with_parent ( GTK_WINDOW ( plot ), TRUE );
+
+	return plot;
+}
@@ -0,0 +1,220 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-pool.h"
+#include "gcmp-cost.h"
+
+#define MAX_WORKERS 16
+
+typedef struct _Task Task;
+
+struct _Task
+{
+	GcmpPoolFunc func;
+	gpointer data;
+
+	GcmpPoolGroup *group;
+};
+
+typedef struct _Deque Deque;
+
+struct _Deque
+{
+	GMutex mutex;
+	GQueue queue;
+};
+
+typedef struct _Pool Pool;
+
+struct _Pool
+{
+	// The last deque is for threads outside the pool
+	Deque deques[MAX_WORKERS + 1];
+	uint8_t n_workers;
+
+	// Threads started: at least one, so tasks nobody waits for ( gcmp-plot.c ) still run on one core
+	uint8_t n_threads;
+
+	// Sleep and wake: queued tasks, finished groups
+	GMutex mutex;
+	GCond cond;
+	gint queued;
+};
+
+static Pool pool;
+
+/* Deque of this thread: its own in a worker, the shared one elsewhere */
+static __thread int8_t self = -1;
+
+static Deque * gcmp_pool_deque ( void )
+{
+	return &pool.deques[( self >= 0 ) ? self : pool.n_threads];
+}
+
+static void gcmp_pool_wake ( void )
+{
+	g_mutex_lock ( &pool.mutex );
+	g_cond_broadcast ( &pool.cond );
+	g_mutex_unlock ( &pool.mutex );
+}
+
+/* Newest task of its own deque ( still warm ), else the oldest of another ( the biggest left ) */
+static Task * gcmp_pool_take ( void )
+{
+	Deque *own = gcmp_pool_deque ();
+
+	g_mutex_lock ( &own->mutex );
+	Task *task = g_queue_pop_tail ( &own->queue );
+	g_mutex_unlock ( &own->mutex );
+
+	uint8_t j = 0, n = pool.n_threads + 1, first = (uint8_t)( ( self >= 0 ) ? self + 1 : 0 );
+
+	for ( j = 0; !task && j < n; j++ )
+	{
+		Deque *deque = &pool.deques[( first + j ) % n];
+
+		if ( deque == own ) continue;
+
+		g_mutex_lock ( &deque->mutex );
+		task = g_queue_pop_head ( &deque->queue );
+		g_mutex_unlock ( &deque->mutex );
+	}
+
+	return task;
+}
+
+/* Outside the pool: the newest task of the group only, so a UI thread is never held up by another's work */
+static Task * gcmp_pool_take_group ( GcmpPoolGroup *group )
+{
+	Deque *own = gcmp_pool_deque ();
+	GList *link = NULL;
+
+	g_mutex_lock ( &own->mutex );
+
+	for ( link = own->queue.tail; link && ( (Task *)link->data )->group != group; link = link->prev );
+
+	Task *task = ( link ) ? link->data : NULL;
+	if ( link ) g_queue_delete_link ( &own->queue, link );
+
+	g_mutex_unlock ( &own->mutex );
+
+	return task;
+}
+
+/* Any task in a worker; only one of the group outside the pool ( NULL: any ) */
+static gboolean gcmp_pool_run_one ( GcmpPoolGroup *group )
+{
+	Task *task = ( self >= 0 || !group ) ? gcmp_pool_take () : gcmp_pool_take_group ( group );
+
+	if ( !task ) return FALSE;
+
+	g_atomic_int_add ( &pool.queued, -1 );
+	g_atomic_int_add ( &task->group->queued, -1 );
+
+	// A refusal in the task is the group's; one this thread had before stays its own
+	gboolean before = gcmp_cost_take_refused ();
+
+	task->func ( task->data );
+
+	if ( gcmp_cost_take_refused () ) g_atomic_int_set ( &task->group->refused, 1 );
+
+	if ( before ) gcmp_cost_set_refused ();
+
+	if ( g_atomic_int_dec_and_test ( &task->group->pending ) ) gcmp_pool_wake ();
+
+	g_free ( task );
+
+	return TRUE;
+}
+
+static gpointer gcmp_pool_worker ( gpointer data )
+{
+	self = (int8_t)GPOINTER_TO_INT ( data );
+
+	// MPFR caches ( constants, Bernoulli numbers ) are per thread: each worker keeps its own
+	while ( TRUE )
+	{
+		if ( gcmp_pool_run_one ( NULL ) ) continue;
+
+		g_mutex_lock ( &pool.mutex );
+
+		while ( g_atomic_int_get ( &pool.queued ) == 0 ) g_cond_wait ( &pool.cond, &pool.mutex );
+
+		g_mutex_unlock ( &pool.mutex );
+	}
+
+	return NULL;
+}
+
+static void gcmp_pool_init ( void )
+{
+	static gsize init = 0;
+
+	if ( !g_once_init_enter ( &init ) ) return;
+
+	pool.n_workers = (uint8_t)( MIN ( g_get_num_processors (), MAX_WORKERS ) - 1 );
+	pool.n_threads = MAX ( pool.n_workers, 1 );
+
+	uint8_t j = 0;
+	for ( j = 0; j <= pool.n_threads; j++ ) { g_mutex_init ( &pool.deques[j].mutex ); g_queue_init ( &pool.deques[j].queue ); }
+
+	g_mutex_init ( &pool.mutex );
+	g_cond_init ( &pool.cond );
+
+	for ( j = 0; j < pool.n_threads; j++ ) g_thread_unref ( g_thread_new ( "gcmp-pool", gcmp_pool_worker, GINT_TO_POINTER ( j ) ) );
+
+	g_once_init_leave ( &init, 1 );
+}
+
+uint8_t gcmp_pool_get_workers ( void )
+{
+	gcmp_pool_init ();
+
+	return pool.n_workers;
+}
+
+void gcmp_pool_spawn ( GcmpPoolGroup *group, GcmpPoolFunc func, gpointer data )
+{
+	gcmp_pool_init ();
+
+	Task *task = g_new ( Task, 1 );
+	*task = (Task){ func, data, group };
+
+	g_atomic_int_inc ( &group->pending );
+
+	Deque *deque = gcmp_pool_deque ();
+
+	g_mutex_lock ( &deque->mutex );
+	g_queue_push_tail ( &deque->queue, task );
+	g_mutex_unlock ( &deque->mutex );
+
+	g_atomic_int_inc ( &group->queued );
+	g_atomic_int_inc ( &pool.queued );
+
+	gcmp_pool_wake ();
+}
+
+void gcmp_pool_wait ( GcmpPoolGroup *group )
+{
+	while ( g_atomic_int_get ( &group->pending ) > 0 )
+	{
+		if ( gcmp_pool_run_one ( group ) ) continue;
+
+		// Nothing left to take: the rest is running elsewhere
+		gint *queued = ( self >= 0 ) ? &pool.queued : &group->queued;
+
+		g_mutex_lock ( &pool.mutex );
+
+		while ( g_atomic_int_get ( &group->pending ) > 0 && g_atomic_int_get ( queued ) == 0 ) g_cond_wait ( &pool.cond, &pool.mutex );
+
+		g_mutex_unlock ( &pool.mutex );
+	}
+
+	if ( g_atomic_int_get ( &group->refused ) ) gcmp_cost_set_refused ();
+}
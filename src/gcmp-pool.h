@@ -0,0 +1,42 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+/*
+* Work-stealing pool shared by the whole process: one deque per worker, one for other threads.
+* Tasks are for work of at least tens of microseconds; a task may spawn and wait for its own.
+* A group nobody waits for runs in the background ( gcmp-plot.c ).
+*/
+
+typedef void ( *GcmpPoolFunc ) ( gpointer );
+
+typedef struct _GcmpPoolGroup GcmpPoolGroup;
+
+/* Tasks spawned and not done yet; starts at zero */
+struct _GcmpPoolGroup
+{
+	gint pending;
+
+	// Of those, still in a deque: all a thread outside the pool may take
+	gint queued;
+
+	// A task was refused ( gcmp-cost.h ): the waiter's thread is flagged
+	gint refused;
+};
+
+/* Workers worth splitting for besides the caller ( 0 on one core: nothing to gain ) */
+uint8_t gcmp_pool_get_workers ( void );
+
+void gcmp_pool_spawn ( GcmpPoolGroup *, GcmpPoolFunc, gpointer );
+
+/* Runs queued tasks until the group is done: in a worker its own or stolen, elsewhere only the group's */
+void gcmp_pool_wait ( GcmpPoolGroup * );
@@ -0,0 +1,51 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+* Local evaluation service ( gcmp --service ): stream socket in $XDG_RUNTIME_DIR.
+* Frames are in host byte order; requests may be pipelined, replies keep their order.
+*
+* Request: GcmpProtoRequest, then size bytes of expression ( no terminator ).
+* Reply:   GcmpProtoReply,   then size bytes of result.
+*/
+
+#define GCMP_PROTO_SOCKET "gcmp.sock"
+
+#define GCMP_PROTO_MAX_SIZE ( 16 * 1024 * 1024 )
+
+enum proto_status
+{
+	GCMP_PROTO_OK,
+	GCMP_PROTO_ERROR
+};
+
+typedef struct _GcmpProtoRequest GcmpProtoRequest;
+
+struct _GcmpProtoRequest
+{
+	uint32_t size;
+	uint16_t digits;
+	uint8_t  base;
+	uint8_t  deg_rad;
+};
+
+typedef struct _GcmpProtoReply GcmpProtoReply;
+
+struct _GcmpProtoReply
+{
+	uint32_t size;
+	uint32_t usec;
+	uint8_t  status;
+	uint8_t  pad[3];
+};
+
@@ -0,0 +1,410 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-radix.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Decimal: exact from the mantissa while the power of ten is within digits + this, MPFR's scaled conversion past it */
+#define DEC_EXP_EXACT 400
+
+/* f notation keeps at most this many integer digits, e past it: the text stays within digits + 32 bytes */
+#define DEC_FIXED_INT 20
+
+static const char radix_digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+/* Powers of ten that fit a word: a short power is a few of them, no pow call */
+static const unsigned long dec_pow[] =
+{
+	1ul, 10ul, 100ul, 1000ul, 10000ul, 100000ul, 1000000ul, 10000000ul, 100000000ul, 1000000000ul,
+	10000000000ul, 100000000000ul, 1000000000000ul, 10000000000000ul, 100000000000000ul,
+	1000000000000000ul, 10000000000000000ul, 100000000000000000ul, 1000000000000000000ul, 10000000000000000000ul
+};
+
+#define DEC_POW_MAX ( sizeof ( dec_pow ) / sizeof ( dec_pow[0] ) - 1 )
+
+int gcmp_radix_is_digit ( char c, uint8_t base )
+{
+	int v = 99;
+
+	if ( c >= '0' && c <= '9' ) v = c - '0';
+	if ( c >= 'a' && c <= 'z' ) v = c - 'a' + 10;
+	if ( c >= 'A' && c <= 'Z' ) v = c - 'A' + 10;
+
+	return ( v < base );
+}
+
+static long gcmp_radix_floor_div ( long a, long b )
+{
+	return ( a >= 0 ) ? a / b : -( ( -a + b - 1 ) / b );
+}
+
+static uint8_t gcmp_radix_log2 ( uint8_t base )
+{
+	uint8_t k = 0;
+
+	while ( ( 1u << k ) < base ) k++;
+
+	return ( ( 1u << k ) == base ) ? k : 0;
+}
+
+/* k bits of the magnitude from bit pos up ( bits below 0 are zero ) */
+static unsigned gcmp_radix_bits ( const mp_limb_t *limbs, size_t n, long pos, uint8_t k )
+{
+	unsigned v = 0;
+
+	uint8_t j = 0;
+	for ( j = 0; j < k; j++ )
+	{
+		long p = pos + j;
+
+		if ( p < 0 ) continue;
+
+		size_t l = (size_t)p / GMP_NUMB_BITS;
+
+		if ( l >= n ) break;
+
+		v |= (unsigned)( ( limbs[l] >> ( (size_t)p % GMP_NUMB_BITS ) ) & 1 ) << j;
+	}
+
+	return v;
+}
+
+/* Power of two bases: digits read straight from the limbs, no arithmetic */
+static char * gcmp_radix_digits_pow2 ( mpfr_t val, uint8_t k, size_t max, long *exp )
+{
+	mpz_t z;
+	mpz_init ( z );
+
+	long e = mpfr_get_z_2exp ( z, val );
+	mpz_abs ( z, z );
+
+	size_t n_limbs = mpz_size ( z );
+	const mp_limb_t *limbs = mpz_limbs_read ( z );
+
+	// Leading digit holds the top bit; the last one holds bit 0 of the mantissa
+	long top = e + (long)mpz_sizeinbase ( z, 2 ) - 1;
+	long lead = gcmp_radix_floor_div ( top, k );
+	long last = gcmp_radix_floor_div ( e, k );
+
+	size_t n = (size_t)( lead - last + 1 );
+	if ( n > max ) n = max;
+
+	char *str = malloc ( n + 1 );
+
+	size_t j = 0;
+	for ( j = 0; j < n; j++ ) str[j] = radix_digits[gcmp_radix_bits ( limbs, n_limbs, ( lead - (long)j ) * k - e, k )];
+
+	str[n] = '\0';
+
+	*exp = lead;
+
+	mpz_clear ( z );
+
+	return str;
+}
+
+/* Other bases: MPFR's conversion ( divide and conquer in GMP for large values ) */
+static char * gcmp_radix_digits ( mpfr_t val, uint8_t base, size_t max, long *exp )
+{
+	mpfr_exp_t e = 0;
+	char *digits = mpfr_get_str ( NULL, &e, base, max, val, MPFR_RNDN );
+
+	const char *p = ( digits[0] == '-' ) ? digits + 1 : digits;
+	char *str = strdup ( p );
+
+	mpfr_free_str ( digits );
+
+	*exp = (long)e - 1;
+
+	return str;
+}
+
+char * gcmp_radix_get_str ( mpfr_t val, uint8_t base, uint32_t digits )
+{
+	if ( !mpfr_number_p ( val ) )
+	{
+		const char *name = ( mpfr_nan_p ( val ) ) ? "nan" : "inf";
+
+		char *str = malloc ( 8 );
+		sprintf ( str, ( base > 16 ) ? "%s@%s@" : "%s%s", ( mpfr_signbit ( val ) && !mpfr_nan_p ( val ) ) ? "-" : "", name );
+
+		return str;
+	}
+
+	if ( mpfr_zero_p ( val ) ) return strdup ( "0" );
+
+	uint8_t k = gcmp_radix_log2 ( base );
+
+	// As many digits as the precision carries: 4 bits per decimal digit setting
+	size_t max = mpfr_get_str_ndigits ( base, (mpfr_prec_t)digits * 4 );
+
+	long exp = 0;
+	char *str = ( k ) ? gcmp_radix_digits_pow2 ( val, k, max, &exp ) : gcmp_radix_digits ( val, base, max, &exp );
+
+	size_t n = strlen ( str );
+	while ( n > 1 && str[n-1] == '0' ) n--;
+
+	// Like %g: positional when short, d.ddd@exp otherwise
+	char *out = malloc ( max + n + 64 );
+	char *p = out;
+
+	if ( mpfr_signbit ( val ) ) *p++ = '-';
+
+	if ( exp >= 0 && exp < (long)max )
+	{
+		size_t int_len = (size_t)exp + 1;
+
+		if ( int_len <= n )
+		{
+			memcpy ( p, str, int_len ); p += int_len;
+
+			if ( int_len < n ) { *p++ = '.'; memcpy ( p, str + int_len, n - int_len ); p += n - int_len; }
+		}
+		else
+		{
+			memcpy ( p, str, n ); p += n;
+			memset ( p, '0', int_len - n ); p += int_len - n;
+		}
+
+		*p = '\0';
+	}
+	else if ( exp < 0 && exp >= -4 )
+	{
+		*p++ = '0'; *p++ = '.';
+		memset ( p, '0', (size_t)( -exp - 1 ) ); p += -exp - 1;
+		memcpy ( p, str, n ); p += n;
+
+		*p = '\0';
+	}
+	else
+	{
+		*p++ = str[0];
+
+		if ( n > 1 ) { *p++ = '.'; memcpy ( p, str + 1, n - 1 ); p += n - 1; }
+
+		sprintf ( p, "@%ld", exp );
+	}
+
+	free ( str );
+
+	return out;
+}
+
+static void gcmp_radix_pow10 ( mpz_t z, unsigned long k )
+{
+	if ( k > 8 * DEC_POW_MAX ) { mpz_ui_pow_ui ( z, 10, k ); return; }
+
+	mpz_set_ui ( z, 1 );
+
+	while ( k ) { unsigned long c = ( k < DEC_POW_MAX ) ? k : DEC_POW_MAX; mpz_mul_ui ( z, z, dec_pow[c] ); k -= c; }
+}
+
+/* | val | / 10^k to the nearest integer, ties to even: exact, from the mantissa times a power of ten and of two */
+static void gcmp_radix_dec_round ( mpz_t n, mpfr_t val, long k )
+{
+	mpz_t d;
+	mpz_init ( d );
+
+	long e = mpfr_get_z_2exp ( n, val );
+	mpz_abs ( n, n );
+
+	if ( k < 0 ) { gcmp_radix_pow10 ( d, (unsigned long)-k ); mpz_mul ( n, n, d ); }
+	if ( e > 0 ) mpz_mul_2exp ( n, n, (mp_bitcnt_t)e );
+
+	if ( k > 0 )
+	{
+		gcmp_radix_pow10 ( d, (unsigned long)k );
+		if ( e < 0 ) mpz_mul_2exp ( d, d, (mp_bitcnt_t)-e );
+
+		mpz_t r;
+		mpz_init ( r );
+
+		mpz_tdiv_qr ( n, r, n, d );
+		mpz_mul_2exp ( r, r, 1 );
+
+		int c = mpz_cmp ( r, d );
+		if ( c > 0 || ( c == 0 && mpz_odd_p ( n ) ) ) mpz_add_ui ( n, n, 1 );
+
+		mpz_clear ( r );
+	}
+	else if ( e < 0 )
+	{
+		mp_bitcnt_t s = (mp_bitcnt_t)-e;
+
+		// Half or more: bit s - 1; just half if none below it
+		int half = mpz_tstbit ( n, s - 1 ), tie = ( half && mpz_scan1 ( n, 0 ) == s - 1 );
+
+		mpz_fdiv_q_2exp ( n, n, s );
+		if ( half && ( !tie || mpz_odd_p ( n ) ) ) mpz_add_ui ( n, n, 1 );
+	}
+
+	mpz_clear ( d );
+}
+
+/* First decimal exponent of a nonzero value, or one less: 2^( E - 1 ) <= | val | < 2^E */
+static long gcmp_radix_dec_exp ( mpfr_t val )
+{
+	return (long)floor ( (double)( mpfr_get_exp ( val ) - 1 ) * 0.30102999566398119521 );
+}
+
+/* nd significant digits of | val | at buf ( nd + 4 bytes, and one before it ), the exponent of the first in x */
+static void gcmp_radix_dec_digits ( mpfr_t val, size_t nd, char *buf, long *x )
+{
+	long k = gcmp_radix_dec_exp ( val ) - (long)nd + 1;
+
+	if ( labs ( k ) > (long)nd + DEC_EXP_EXACT )
+	{
+		mpfr_exp_t e = 0;
+
+		// The sign, if any, goes to the byte before
+		mpfr_get_str ( ( mpfr_signbit ( val ) ) ? buf - 1 : buf, &e, 10, nd, val, MPFR_RNDN );
+
+		*x = (long)e - 1;
+
+		return;
+	}
+
+	mpz_t n;
+	mpz_init ( n );
+
+	gcmp_radix_dec_round ( n, val, k );
+	mpz_get_str ( buf, 10, n );
+
+	// A digit too many: the exponent was one more than its estimate, or the rounding carried over
+	if ( strlen ( buf ) > nd ) { gcmp_radix_dec_round ( n, val, ++k ); mpz_get_str ( buf, 10, n ); }
+
+	// Still one more only if it carried to 10^nd: the last is a zero
+	*x = k + (long)strlen ( buf ) - 1;
+	buf[nd] = '\0';
+
+	mpz_clear ( n );
+}
+
+static char * gcmp_radix_put_exp ( char *p, long x )
+{
+	char tmp[24];
+	size_t n = 0;
+
+	unsigned long u = ( x < 0 ) ? 0ul - (unsigned long)x : (unsigned long)x;
+
+	do { tmp[n++] = (char)( '0' + u % 10 ); u /= 10; } while ( u );
+
+	if ( n < 2 ) tmp[n++] = '0';
+
+	*p++ = 'e';
+	*p++ = ( x < 0 ) ? '-' : '+';
+
+	while ( n ) *p++ = tmp[--n];
+
+	return p;
+}
+
+/* f: the integer | val | 10^digits, the point put in; zeros before it if short */
+static char * gcmp_radix_dec_fixed ( mpfr_t val, uint32_t digits, char *p )
+{
+	mpz_t n;
+	mpz_init ( n );
+
+	if ( !mpfr_zero_p ( val ) ) gcmp_radix_dec_round ( n, val, -(long)digits );
+
+	char *q = p + 2;
+	mpz_get_str ( q, 10, n );
+
+	size_t len = strlen ( q );
+
+	mpz_clear ( n );
+
+	if ( digits == 0 ) { memmove ( p, q, len ); return p + len; }
+
+	if ( len <= digits )
+	{
+		memmove ( p + 2 + digits - len, q, len );
+
+		p[0] = '0'; p[1] = '.';
+		memset ( p + 2, '0', digits - len );
+
+		return p + 2 + digits;
+	}
+
+	size_t int_len = len - digits;
+
+	memmove ( p, q, int_len );
+	p[int_len] = '.';
+	memmove ( p + int_len + 1, q + int_len, digits );
+
+	return p + len + 1;
+}
+
+size_t gcmp_radix_get_dec ( mpfr_t val, uint32_t digits, uint8_t fm, char *out )
+{
+	char *p = out;
+
+	if ( mpfr_signbit ( val ) && !mpfr_nan_p ( val ) ) *p++ = '-';
+
+	if ( !mpfr_number_p ( val ) ) { strcpy ( p, ( mpfr_nan_p ( val ) ) ? "nan" : "inf" ); return (size_t)( p - out ) + 3; }
+
+	if ( fm == 2 && ( mpfr_zero_p ( val ) || gcmp_radix_dec_exp ( val ) < DEC_FIXED_INT ) )
+	{
+		p = gcmp_radix_dec_fixed ( val, digits, p );
+		*p = '\0';
+
+		return (size_t)( p - out );
+	}
+
+	// g: digits significant, trailing zeros dropped; e ( and f of a large value ): one before the point, digits after it
+	size_t nd = ( fm == 0 ) ? ( ( digits ) ? digits : 1 ) : (size_t)digits + 1;
+
+	// The digits a little ahead of where they go: "0.000" may come first
+	char *d = p + 8;
+	long x = 0;
+
+	if ( mpfr_zero_p ( val ) ) { memset ( d, '0', nd ); d[nd] = '\0'; }
+	else gcmp_radix_dec_digits ( val, nd, d, &x );
+
+	size_t n = nd;
+	if ( fm == 0 ) while ( n > 1 && d[n-1] == '0' ) n--;
+
+	if ( fm == 0 && x >= -4 && x < (long)nd )
+	{
+		if ( x < 0 )
+		{
+			memmove ( p + 1 - x, d, n );
+
+			p[0] = '0'; p[1] = '.';
+			memset ( p + 2, '0', (size_t)( -x - 1 ) );
+
+			p += 1 - x + (long)n;
+		}
+		else
+		{
+			size_t int_len = (size_t)x + 1;
+
+			memmove ( p, d, int_len );
+			p += int_len;
+
+			if ( n > int_len ) { *p++ = '.'; memmove ( p, d + int_len, n - int_len ); p += n - int_len; }
+		}
+	}
+	else
+	{
+		*p = d[0];
+
+		if ( n > 1 ) { p[1] = '.'; memmove ( p + 2, d + 1, n - 1 ); p += n; }
+
+		p = gcmp_radix_put_exp ( p + 1, x );
+	}
+
+	*p = '\0';
+
+	return (size_t)( p - out );
+}
@@ -0,0 +1,30 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <mpfr.h>
+
+/*
+* Text of the value in base 2 .. 36 ( digits 0-9a-z, '@' exponent in powers of the base ),
+* as many digits as digits * 4 bits carry; malloc'd.
+*/
+char * gcmp_radix_get_str ( mpfr_t, uint8_t, uint32_t );
+
+/*
+* Decimal text as %.*Rg ( fm 0 ), %.*Re ( 1 ) or %.*Rf ( 2 ) print it, into out ( digits + 32 bytes ); returns the length.
+* The digits of g are the shortest that read back to the value at 4 bits a digit, if there are as few as digits.
+* f of a value of more than 20 integer digits is e
+*/
+size_t gcmp_radix_get_dec ( mpfr_t, uint32_t, uint8_t, char * );
+
+/* Whether the character is a digit of the base */
+int gcmp_radix_is_digit ( char, uint8_t );
+
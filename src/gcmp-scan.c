@@ -0,0 +1,215 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-scan.h"
+
+#include <string.h>
+
+#if defined ( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#if defined ( __GNUC__ ) && defined ( __x86_64__ )
+#include <immintrin.h>
+#define SCAN_AVX2 1
+#endif
+
+enum scan_class
+{
+	SC_DIGIT,
+	SC_BLANK,
+	SC_SEP
+};
+
+static int gcmp_scan_is ( char c, enum scan_class cls )
+{
+	if ( cls == SC_DIGIT ) return ( c >= '0' && c <= '9' );
+
+	int blank = ( c == ' ' || c == '\t' || c == '\n' || c == '\r' );
+
+	return ( cls == SC_BLANK ) ? blank : ( blank || c == ',' || c == ';' );
+}
+
+#if defined ( __SSE2__ )
+
+/* Bit j set if byte j is of the class */
+static uint32_t gcmp_scan_mask16 ( __m128i v, enum scan_class cls )
+{
+	__m128i m;
+
+	if ( cls == SC_DIGIT )
+	{
+		// c - '0' <= 9 unsigned
+		__m128i d = _mm_sub_epi8 ( v, _mm_set1_epi8 ( '0' ) );
+		m = _mm_cmpeq_epi8 ( _mm_min_epu8 ( d, _mm_set1_epi8 ( 9 ) ), d );
+	}
+	else
+	{
+		m = _mm_or_si128 ( _mm_or_si128 ( _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( ' '  ) ), _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( '\t' ) ) ),
+		                   _mm_or_si128 ( _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( '\n' ) ), _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( '\r' ) ) ) );
+
+		if ( cls == SC_SEP ) m = _mm_or_si128 ( m, _mm_or_si128 ( _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( ',' ) ), _mm_cmpeq_epi8 ( v, _mm_set1_epi8 ( ';' ) ) ) );
+	}
+
+	return (uint32_t)_mm_movemask_epi8 ( m );
+}
+
+#endif
+
+#if defined ( SCAN_AVX2 )
+
+__attribute__ (( target ( "avx2" ) ))
+static uint32_t gcmp_scan_mask32 ( const char *s, enum scan_class cls )
+{
+	__m256i v = _mm256_loadu_si256 ( (const __m256i *)s ), m;
+
+	if ( cls == SC_DIGIT )
+	{
+		__m256i d = _mm256_sub_epi8 ( v, _mm256_set1_epi8 ( '0' ) );
+		m = _mm256_cmpeq_epi8 ( _mm256_min_epu8 ( d, _mm256_set1_epi8 ( 9 ) ), d );
+	}
+	else
+	{
+		m = _mm256_or_si256 ( _mm256_or_si256 ( _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( ' '  ) ), _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( '\t' ) ) ),
+		                      _mm256_or_si256 ( _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( '\n' ) ), _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( '\r' ) ) ) );
+
+		if ( cls == SC_SEP ) m = _mm256_or_si256 ( m, _mm256_or_si256 ( _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( ',' ) ), _mm256_cmpeq_epi8 ( v, _mm256_set1_epi8 ( ';' ) ) ) );
+	}
+
+	return (uint32_t)_mm256_movemask_epi8 ( m );
+}
+
+static int gcmp_scan_has_avx2 ( void )
+{
+	static int has = -1;
+
+	if ( has < 0 ) has = __builtin_cpu_supports ( "avx2" ) ? 1 : 0;
+
+	return has;
+}
+
+#endif
+
+/* Bytes from the start that are ( in ) or are not ( !in ) of the class */
+static size_t gcmp_scan_run ( const char *s, size_t len, enum scan_class cls, int in )
+{
+	size_t i = 0;
+
+#if defined ( SCAN_AVX2 )
+	if ( gcmp_scan_has_avx2 () )
+	{
+		for ( ; i + 32 <= len; i += 32 )
+		{
+			uint32_t m = gcmp_scan_mask32 ( s + i, cls );
+
+			if ( in ) m = ~m;
+
+			if ( m ) return i + (size_t)__builtin_ctz ( m );
+		}
+	}
+#endif
+
+#if defined ( __SSE2__ )
+	for ( ; i + 16 <= len; i += 16 )
+	{
+		uint32_t m = gcmp_scan_mask16 ( _mm_loadu_si128 ( (const __m128i *)( s + i ) ), cls );
+
+		if ( in ) m = ~m & 0xffff;
+
+		if ( m ) return i + (size_t)__builtin_ctz ( m );
+	}
+#endif
+
+	while ( i < len && gcmp_scan_is ( s[i], cls ) == in ) i++;
+
+	return i;
+}
+
+size_t gcmp_scan_digits ( const char *s, size_t len )
+{
+	return gcmp_scan_run ( s, len, SC_DIGIT, 1 );
+}
+
+size_t gcmp_scan_blanks ( const char *s, size_t len )
+{
+	return gcmp_scan_run ( s, len, SC_BLANK, 1 );
+}
+
+size_t gcmp_scan_seps ( const char *s, size_t len )
+{
+	return gcmp_scan_run ( s, len, SC_SEP, 1 );
+}
+
+size_t gcmp_scan_token ( const char *s, size_t len )
+{
+	return gcmp_scan_run ( s, len, SC_SEP, 0 );
+}
+
+size_t gcmp_scan_digits_str ( const char *s )
+{
+	size_t i = 0;
+
+#if defined ( __SSE2__ )
+	// Aligned loads stay within the page of the terminator
+	while ( ( (uintptr_t)( s + i ) & 15 ) && s[i] >= '0' && s[i] <= '9' ) i++;
+
+	if ( ( (uintptr_t)( s + i ) & 15 ) == 0 )
+	{
+		for ( ;; )
+		{
+			uint32_t m = ~gcmp_scan_mask16 ( _mm_load_si128 ( (const __m128i *)( s + i ) ), SC_DIGIT ) & 0xffff;
+
+			if ( m ) return i + (size_t)__builtin_ctz ( m );
+
+			i += 16;
+		}
+	}
+#endif
+
+	while ( s[i] >= '0' && s[i] <= '9' ) i++;
+
+	return i;
+}
+
+uint32_t gcmp_scan_parse8 ( const char *s )
+{
+	uint64_t v = 0;
+	memcpy ( &v, s, 8 );
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64 ( v );
+#endif
+
+	// First digit in the low byte: pairs, then fours, then all eight
+	v -= 0x3030303030303030ull;
+	v = ( v * 10 + ( v >> 8 ) ) & 0x00ff00ff00ff00ffull;
+	v = ( v * 100 + ( v >> 16 ) ) & 0x0000ffff0000ffffull;
+	v = ( v * 10000 + ( v >> 32 ) ) & 0xffffffffull;
+
+	return (uint32_t)v;
+}
+
+size_t gcmp_scan_group ( char *out, const char *s, size_t n, uint8_t group, char sep )
+{
+	size_t i = 0, o = 0;
+
+	if ( !group ) { memcpy ( out, s, n ); return n; }
+
+	for ( i = 0; i < n; i += group )
+	{
+		size_t k = ( n - i < group ) ? n - i : group;
+
+		if ( i ) out[o++] = sep;
+
+		memcpy ( out + o, s + i, k );
+		o += k;
+	}
+
+	return o;
+}
@@ -0,0 +1,37 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+* Text kernels for long numbers: 32 bytes at a time with AVX2 ( when the CPU has it ), 16 with SSE2, else bytewise.
+* Blanks are space, tab, newline and return; separators are blanks, ',' and ';'.
+*/
+
+/* Lengths of the runs at the start of the text */
+size_t gcmp_scan_digits ( const char *, size_t );
+
+size_t gcmp_scan_blanks ( const char *, size_t );
+
+size_t gcmp_scan_seps ( const char *, size_t );
+
+/* Length up to the first separator */
+size_t gcmp_scan_token ( const char *, size_t );
+
+/* Digits of a terminated string, up to the first other character */
+size_t gcmp_scan_digits_str ( const char * );
+
+/* Value of 8 decimal digits */
+uint32_t gcmp_scan_parse8 ( const char * );
+
+/* Digits with a separator after each group but the last: out holds n + n / group bytes; returns its length */
+size_t gcmp_scan_group ( char *, const char *, size_t, uint8_t, char );
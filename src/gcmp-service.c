@@ -0,0 +1,186 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-service.h"
+#include "gcmp-proto.h"
+#include "gcmp-eval.h"
+#include "gcmp-cost.h"
+#include "gcmp-vars.h"
+
+#include <signal.h>
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <gio/gunixsocketaddress.h>
+
+/* Connections served at once; each keeps its MPFR caches warm in its own thread */
+#define MAX_THREADS 8
+
+static void gcmp_service_eval ( GcmpProtoRequest *req, const char *expr, GByteArray *batch )
+{
+	gint64 time = g_get_monotonic_time ();
+
+	g_autofree char *res = NULL;
+
+	// The 16-bit field keeps service precision well below MAX_DIGITS
+	if ( req->digits >= 1 && req->base >= 2 && req->base <= 36 )
+	{
+		GcmpEval *eval = gcmp_eval_new ( expr, req->base );
+
+		if ( eval )
+		{
+			mpfr_t val;
+			mpfr_init2 ( val, (mpfr_prec_t)req->digits * 4 );
+
+			gcmp_cost_take_refused ();
+			gcmp_eval_run ( eval, val, req->digits, req->deg_rad );
+
+			// A refused request is an error, not a nan
+			if ( !gcmp_cost_take_refused () || !mpfr_nan_p ( val ) ) res = gcmp_mpfr_get_str_base ( val, req->digits, req->base );
+
+			mpfr_clear ( val );
+			gcmp_eval_free ( eval );
+		}
+	}
+
+	GcmpProtoReply reply = { 0, 0, GCMP_PROTO_ERROR, { 0 } };
+
+	reply.size   = ( res ) ? (uint32_t)strlen ( res ) : 0;
+	reply.usec   = (uint32_t)MIN ( g_get_monotonic_time () - time, G_MAXUINT32 );
+	reply.status = ( res ) ? GCMP_PROTO_OK : GCMP_PROTO_ERROR;
+
+	g_byte_array_append ( batch, (const uint8_t *)&reply, sizeof ( reply ) );
+	if ( res ) g_byte_array_append ( batch, (const uint8_t *)res, reply.size );
+}
+
+static gboolean gcmp_service_write ( GOutputStream *out, GByteArray *batch )
+{
+	gboolean ret = g_output_stream_write_all ( out, batch->data, batch->len, NULL, NULL, NULL );
+
+	g_byte_array_set_size ( batch, 0 );
+
+	return ret;
+}
+
+static gboolean gcmp_service_run ( G_GNUC_UNUSED GThreadedSocketService *service, GSocketConnection *connection, G_GNUC_UNUSED GObject *source, G_GNUC_UNUSED gpointer data )
+{
+	GInputStream *in = g_buffered_input_stream_new_sized ( g_io_stream_get_input_stream ( G_IO_STREAM ( connection ) ), 64 * 1024 );
+	GOutputStream *out = g_io_stream_get_output_stream ( G_IO_STREAM ( connection ) );
+
+	GByteArray *batch = g_byte_array_new ();
+
+	// The thread served other connections before: their ans and names are not this one's
+	gcmp_vars_clear ();
+
+	gsize n = 0;
+	GcmpProtoRequest req;
+
+	while ( g_input_stream_read_all ( in, &req, sizeof ( req ), &n, NULL, NULL ) && n == sizeof ( req ) )
+	{
+		if ( req.size > GCMP_PROTO_MAX_SIZE ) break;
+
+		char *expr = g_malloc ( (gsize)req.size + 1 );
+
+		if ( !g_input_stream_read_all ( in, expr, req.size, &n, NULL, NULL ) || n != req.size ) { g_free ( expr ); break; }
+
+		expr[req.size] = '\0';
+
+		gcmp_service_eval ( &req, expr, batch );
+
+		g_free ( expr );
+
+		// Pipelined requests already buffered are answered in one write
+		if ( g_buffered_input_stream_get_available ( G_BUFFERED_INPUT_STREAM ( in ) ) >= sizeof ( req ) ) continue;
+
+		if ( !gcmp_service_write ( out, batch ) ) break;
+	}
+
+	if ( batch->len ) gcmp_service_write ( out, batch );
+
+	g_byte_array_unref ( batch );
+	g_object_unref ( in );
+
+	return FALSE;
+}
+
+static gboolean gcmp_service_quit ( GMainLoop *loop )
+{
+	g_main_loop_quit ( loop );
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Some instance accepts connections on the socket */
+static gboolean gcmp_service_live ( const char *path )
+{
+	GSocketClient *client = g_socket_client_new ();
+	GSocketAddress *address = g_unix_socket_address_new ( path );
+
+	GSocketConnection *connection = g_socket_client_connect ( client, G_SOCKET_CONNECTABLE ( address ), NULL, NULL );
+
+	gboolean live = ( connection != NULL );
+
+	if ( connection ) g_object_unref ( connection );
+
+	g_object_unref ( address );
+	g_object_unref ( client );
+
+	return live;
+}
+
+int gcmp_service_main ( void )
+{
+	g_autofree char *path = g_build_filename ( g_get_user_runtime_dir (), GCMP_PROTO_SOCKET, NULL );
+
+	if ( gcmp_service_live ( path ) ) { g_printerr ( "%s: already running on %s \n", __func__, path ); return 1; }
+
+	// Only a socket no one listens on, left by a crash
+	g_unlink ( path );
+
+	// A shared service is not to be held by one request
+	gcmp_cost_set_limit ( 10, 512.0 * 1024 * 1024 );
+
+	GError *error = NULL;
+	GSocketAddress *address = g_unix_socket_address_new ( path );
+	GSocketService *service = g_threaded_socket_service_new ( MAX_THREADS );
+
+	g_socket_listener_add_address ( G_SOCKET_LISTENER ( service ), address, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, NULL, NULL, &error );
+	g_object_unref ( address );
+
+	if ( error )
+	{
+		g_printerr ( "%s: %s \n", __func__, error->message );
+
+		g_error_free ( error );
+		g_object_unref ( service );
+
+		return 1;
+	}
+
+	g_signal_connect ( service, "run", G_CALLBACK ( gcmp_service_run ), NULL );
+	g_socket_service_start ( service );
+
+	g_message ( "%s:: listening on %s ", __func__, path );
+
+	GMainLoop *loop = g_main_loop_new ( NULL, FALSE );
+
+	g_unix_signal_add ( SIGINT,  (GSourceFunc)gcmp_service_quit, loop );
+	g_unix_signal_add ( SIGTERM, (GSourceFunc)gcmp_service_quit, loop );
+
+	g_main_loop_run ( loop );
+
+	g_socket_service_stop ( service );
+	g_socket_listener_close ( G_SOCKET_LISTENER ( service ) );
+
+	g_main_loop_unref ( loop );
+	g_object_unref ( service );
+
+	g_unlink ( path );
+
+	return 0;
+}
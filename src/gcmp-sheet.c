@@ -0,0 +1,370 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-sheet.h"
+#include "gcmp-cost.h"
+
+typedef struct _Row Row;
+
+struct _Row
+{
+	uint32_t nrec;
+	gpointer owner;
+	GcmpEval *eval;
+
+	mpfr_t val;
+	char *res;
+
+	uint32_t digits;
+	uint32_t target;
+	uint8_t base;
+	uint8_t deg_rad;
+
+	// Its operands were bound at the precision of the time: it is not run again
+	gboolean bound;
+};
+
+typedef struct _Watch Watch;
+
+struct _Watch
+{
+	GcmpSheetDone done;
+	gpointer data;
+};
+
+struct _GcmpSheet
+{
+	GMutex mutex;
+	GPtrArray *rows;
+	GHashTable *by_nrec;
+	GArray *watches;
+
+	size_t budget;
+	size_t used;
+
+	uint32_t shown;
+	uint32_t vis_first;
+	uint32_t vis_last;
+
+	gint ref;
+	gboolean quit;
+	gboolean running;
+};
+
+typedef struct _Done Done;
+
+struct _Done
+{
+	GcmpSheet *sheet;
+	uint32_t nrec;
+};
+
+static size_t gcmp_sheet_bytes ( mpfr_srcptr val )
+{
+	return mpfr_custom_get_size ( mpfr_get_prec ( val ) );
+}
+
+static void gcmp_sheet_row_free ( Row *row )
+{
+	gcmp_eval_free ( row->eval );
+
+	mpfr_clear ( row->val );
+
+	g_free ( row->res );
+	g_free ( row );
+}
+
+static void gcmp_sheet_unref ( GcmpSheet *sheet )
+{
+	if ( !g_atomic_int_dec_and_test ( &sheet->ref ) ) return;
+
+	g_ptr_array_free ( sheet->rows, TRUE );
+	g_hash_table_destroy ( sheet->by_nrec );
+	g_array_free ( sheet->watches, TRUE );
+	g_mutex_clear ( &sheet->mutex );
+
+	g_free ( sheet );
+}
+
+/* Under the lock: values of the oldest rows go until the rest fit; the row given stays */
+static void gcmp_sheet_trim ( GcmpSheet *sheet, Row *keep )
+{
+	uint32_t j = 0;
+	for ( j = 0; j < sheet->rows->len && sheet->used > sheet->budget; j++ )
+	{
+		Row *row = g_ptr_array_index ( sheet->rows, j );
+
+		if ( row == keep || mpfr_get_prec ( row->val ) == MPFR_PREC_MIN ) continue;
+
+		sheet->used -= gcmp_sheet_bytes ( row->val );
+
+		mpfr_set_prec ( row->val, MPFR_PREC_MIN );
+		sheet->used += gcmp_sheet_bytes ( row->val );
+	}
+}
+
+static gboolean gcmp_sheet_done ( Done *done )
+{
+	GcmpSheet *sheet = done->sheet;
+
+	// On the main loop, as watching and unwatching are
+	uint32_t j = 0;
+	for ( j = 0; j < sheet->watches->len; j++ )
+	{
+		Watch *watch = &g_array_index ( sheet->watches, Watch, j );
+
+		watch->done ( done->nrec, watch->data );
+	}
+
+	gcmp_sheet_unref ( sheet );
+	g_free ( done );
+
+	return FALSE;
+}
+
+/* Next stale row: in view first, then the newest; NULL if none */
+static Row * gcmp_sheet_next ( GcmpSheet *sheet )
+{
+	Row *next = NULL;
+
+	uint32_t j = sheet->rows->len;
+	while ( j-- > 0 )
+	{
+		Row *row = g_ptr_array_index ( sheet->rows, j );
+
+		if ( row->digits == row->target ) continue;
+
+		if ( row->nrec >= sheet->vis_first && row->nrec <= sheet->vis_last ) return row;
+
+		if ( !next ) next = row;
+	}
+
+	return next;
+}
+
+static gpointer gcmp_sheet_thread ( GcmpSheet *sheet )
+{
+	g_mutex_lock ( &sheet->mutex );
+
+	Row *row = NULL;
+
+	while ( !sheet->quit && ( row = gcmp_sheet_next ( sheet ) ) )
+	{
+		uint32_t digits = row->target;
+
+		mpfr_t res;
+		mpfr_init2 ( res, digits * 4 );
+
+		// The value kept is the most precise one yet: it rounds to fewer digits, only a new run gets more
+		gboolean run = ( mpfr_get_prec ( row->val ) < mpfr_get_prec ( res ) );
+
+		if ( !run ) mpfr_set ( res, row->val, MPFR_RNDN );
+
+		g_mutex_unlock ( &sheet->mutex );
+
+		// Over the limits ( gcmp-cost.h ): the row keeps the value it has and says why it has no more
+		gboolean refused = ( run && !gcmp_eval_admit ( row->eval, digits ) );
+
+		if ( refused ) { gcmp_cost_take_refused (); run = FALSE; }
+
+		// Only read, as any thread may: the row stays until the sheet goes
+		if ( run ) gcmp_eval_run_at ( row->eval, res, digits, row->deg_rad, NULL );
+
+		char *text = ( refused ) ? g_strdup ( "refused, over the limits" ) : gcmp_mpfr_get_str_base ( res, MIN ( digits, sheet->shown ), row->base );
+
+		g_mutex_lock ( &sheet->mutex );
+
+		if ( run )
+		{
+			sheet->used += gcmp_sheet_bytes ( res );
+			sheet->used -= gcmp_sheet_bytes ( row->val );
+
+			mpfr_swap ( row->val, res );
+			gcmp_sheet_trim ( sheet, row );
+		}
+
+		mpfr_clear ( res );
+
+		g_free ( row->res );
+		row->res = text;
+		row->digits = digits;
+
+		Done *done = g_new0 ( Done, 1 );
+		done->sheet = sheet;
+		done->nrec = row->nrec;
+
+		g_atomic_int_inc ( &sheet->ref );
+		g_idle_add_full ( G_PRIORITY_LOW, (GSourceFunc)gcmp_sheet_done, done, NULL );
+	}
+
+	sheet->running = FALSE;
+
+	g_mutex_unlock ( &sheet->mutex );
+
+	gcmp_sheet_unref ( sheet );
+
+	return NULL;
+}
+
+/* Under the lock */
+static void gcmp_sheet_start ( GcmpSheet *sheet )
+{
+	if ( sheet->running || !gcmp_sheet_next ( sheet ) ) return;
+
+	sheet->running = TRUE;
+
+	g_atomic_int_inc ( &sheet->ref );
+	g_thread_unref ( g_thread_new ( "gcmp-sheet", (GThreadFunc)gcmp_sheet_thread, sheet ) );
+}
+
+void gcmp_sheet_watch ( GcmpSheet *sheet, GcmpSheetDone done, gpointer data )
+{
+	Watch watch = { done, data };
+
+	g_array_append_val ( sheet->watches, watch );
+}
+
+void gcmp_sheet_unwatch ( GcmpSheet *sheet, gpointer data )
+{
+	uint32_t j = sheet->watches->len;
+	while ( j-- > 0 )
+	{
+		if ( g_array_index ( sheet->watches, Watch, j ).data == data ) g_array_remove_index ( sheet->watches, j );
+	}
+
+	// Its rows stay as they are: a window made later at the same address is not their owner
+	g_mutex_lock ( &sheet->mutex );
+
+	for ( j = 0; j < sheet->rows->len; j++ )
+	{
+		Row *row = g_ptr_array_index ( sheet->rows, j );
+
+		if ( row->owner == data ) row->owner = NULL;
+	}
+
+	g_mutex_unlock ( &sheet->mutex );
+}
+
+void gcmp_sheet_add ( GcmpSheet *sheet, uint32_t nrec, gpointer owner, GcmpEval *eval, uint8_t base, uint8_t deg_rad, uint32_t digits, mpfr_srcptr val )
+{
+	Row *row = g_new0 ( Row, 1 );
+
+	row->nrec = nrec;
+	row->owner = owner;
+	row->eval = eval;
+	row->base = base;
+	row->deg_rad = deg_rad;
+	row->digits = digits;
+	row->target = digits;
+	row->bound = gcmp_eval_is_bound ( eval );
+
+	mpfr_init2 ( row->val, mpfr_get_prec ( val ) );
+	mpfr_set ( row->val, val, MPFR_RNDN );
+
+	g_mutex_lock ( &sheet->mutex );
+
+	g_ptr_array_add ( sheet->rows, row );
+	g_hash_table_insert ( sheet->by_nrec, GUINT_TO_POINTER ( nrec ), row );
+
+	sheet->used += gcmp_sheet_bytes ( row->val );
+	gcmp_sheet_trim ( sheet, row );
+
+	g_mutex_unlock ( &sheet->mutex );
+}
+
+void gcmp_sheet_set_digits ( GcmpSheet *sheet, gpointer owner, uint32_t digits )
+{
+	g_mutex_lock ( &sheet->mutex );
+
+	uint32_t j = 0;
+	for ( j = 0; j < sheet->rows->len; j++ )
+	{
+		Row *row = g_ptr_array_index ( sheet->rows, j );
+
+		if ( row->owner == owner && !row->bound ) row->target = digits;
+	}
+
+	gcmp_sheet_start ( sheet );
+
+	g_mutex_unlock ( &sheet->mutex );
+}
+
+void gcmp_sheet_set_visible ( GcmpSheet *sheet, uint32_t first, uint32_t last )
+{
+	g_mutex_lock ( &sheet->mutex );
+
+	sheet->vis_first = first;
+	sheet->vis_last  = last;
+
+	g_mutex_unlock ( &sheet->mutex );
+}
+
+char * gcmp_sheet_get_res ( GcmpSheet *sheet, uint32_t nrec, gboolean *stale )
+{
+	char *res = NULL;
+
+	g_mutex_lock ( &sheet->mutex );
+
+	Row *row = g_hash_table_lookup ( sheet->by_nrec, GUINT_TO_POINTER ( nrec ) );
+
+	*stale = ( row && row->digits != row->target );
+
+	if ( row && row->res ) res = g_strdup ( row->res );
+
+	g_mutex_unlock ( &sheet->mutex );
+
+	return res;
+}
+
+gboolean gcmp_sheet_get_value ( GcmpSheet *sheet, uint32_t nrec, mpfr_t val )
+{
+	g_mutex_lock ( &sheet->mutex );
+
+	Row *row = g_hash_table_lookup ( sheet->by_nrec, GUINT_TO_POINTER ( nrec ) );
+
+	// Not if the value went over the budget
+	gboolean ret = ( row && row->res && mpfr_get_prec ( row->val ) >= (mpfr_prec_t)row->digits * 4 );
+
+	if ( ret ) { mpfr_set_prec ( val, mpfr_get_prec ( row->val ) ); mpfr_set ( val, row->val, MPFR_RNDN ); }
+
+	g_mutex_unlock ( &sheet->mutex );
+
+	return ret;
+}
+
+GcmpSheet * gcmp_sheet_new ( uint32_t shown, size_t budget )
+{
+	GcmpSheet *sheet = g_new0 ( GcmpSheet, 1 );
+
+	g_mutex_init ( &sheet->mutex );
+
+	sheet->rows = g_ptr_array_new_with_free_func ( (GDestroyNotify)gcmp_sheet_row_free );
+	sheet->by_nrec = g_hash_table_new ( g_direct_hash, g_direct_equal );
+	sheet->watches = g_array_new ( FALSE, FALSE, sizeof ( Watch ) );
+
+	sheet->shown  = shown;
+	sheet->budget = budget;
+	sheet->ref    = 1;
+
+	sheet->vis_first = G_MAXUINT32;
+
+	return sheet;
+}
+
+void gcmp_sheet_free ( GcmpSheet *sheet )
+{
+	g_mutex_lock ( &sheet->mutex );
+
+	// The thread stops after the row it runs
+	sheet->quit = TRUE;
+
+	g_mutex_unlock ( &sheet->mutex );
+
+	gcmp_sheet_unref ( sheet );
+}
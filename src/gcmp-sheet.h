@@ -0,0 +1,52 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-eval.h"
+
+/*
+* Worksheet: the expressions evaluated this session, compiled, by history row; one for all windows.
+* When a window's precision changes, its rows not at it are stale and are run again on one thread in the background,
+* one at a time, those in view first, then the newest; a lower precision only rounds the value kept.
+* Rows with names or bound numbers ( gcmp_eval_is_bound ) stay as they are: their operands would not be any more precise.
+* The values kept stay within a budget: past it the oldest go, and their rows are run again when needed.
+*/
+typedef struct _GcmpSheet GcmpSheet;
+
+/* A row was refreshed; on the main loop */
+typedef void ( *GcmpSheetDone ) ( uint32_t, gpointer );
+
+/* Results are shown to at most that many digits; values kept up to that many bytes */
+GcmpSheet * gcmp_sheet_new ( uint32_t, size_t );
+
+/* Rows still being run finish on their own */
+void gcmp_sheet_free ( GcmpSheet * );
+
+/* Every refreshed row is told to each watcher; data tells them apart */
+void gcmp_sheet_watch ( GcmpSheet *, GcmpSheetDone, gpointer );
+
+/* The data also stops owning its rows: they keep the precision last set */
+void gcmp_sheet_unwatch ( GcmpSheet *, gpointer );
+
+/* History row, its owner, the compiled expression ( the sheet owns it from now ), its base, deg_rad, digits and result */
+void gcmp_sheet_add ( GcmpSheet *, uint32_t, gpointer, GcmpEval *, uint8_t, uint8_t, uint32_t, mpfr_srcptr );
+
+/* The precision the owner's rows are to be at */
+void gcmp_sheet_set_digits ( GcmpSheet *, gpointer, uint32_t );
+
+/* History rows in view, first to last */
+void gcmp_sheet_set_visible ( GcmpSheet *, uint32_t, uint32_t );
+
+/* Result text of the row once refreshed, newly allocated, else NULL; stale tells if it is behind the precision */
+char * gcmp_sheet_get_res ( GcmpSheet *, uint32_t, gboolean *stale );
+
+/* The value behind that text, at its own precision; FALSE if never refreshed or over the budget */
+gboolean gcmp_sheet_get_value ( GcmpSheet *, uint32_t, mpfr_t );
+
@@ -0,0 +1,290 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-stats.h"
+#include "gcmp-scan.h"
+#include "gcmp-pool.h"
+
+/* Workers, and the least input worth one */
+#define MAX_WORKERS 16
+#define PART_BYTES 65536
+
+/* Extra bits for the mean, the deviations and the product */
+#define GUARD_BITS 64
+
+typedef struct _Part Part;
+
+struct _Part
+{
+	const char *data;
+	size_t start, end;
+
+	uint8_t base;
+	mpfr_prec_t prec;
+
+	GArray *vals;
+	guint min, max;
+	mpfr_t prod;
+
+	gboolean failed;
+	size_t fail_at;
+
+	mpfr_ptr mean;
+};
+
+struct _GcmpStats
+{
+	uint64_t count;
+	mpfr_t val[ST_NUM];
+};
+
+static const char *stats_name[ST_NUM] = { "sum", "mean", "var", "sd", "min", "max", "prod" };
+
+/* First pass: parse the part, keeping its min, max and product */
+static void gcmp_stats_parse ( Part *part )
+{
+	GString *token = g_string_new ( NULL );
+
+	size_t i = part->start;
+
+	while ( i < part->end )
+	{
+		i += gcmp_scan_seps ( part->data + i, part->end - i );
+
+		if ( i == part->end ) break;
+
+		size_t start = i;
+		i += gcmp_scan_token ( part->data + i, part->end - i );
+
+		// mpfr_strtofr needs the token on its own
+		g_string_truncate ( token, 0 );
+		g_string_append_len ( token, part->data + start, (gssize)( i - start ) );
+
+		__mpfr_struct val;
+		mpfr_init2 ( &val, part->prec );
+
+		char *end = NULL;
+		mpfr_strtofr ( &val, token->str, &end, part->base, MPFR_RNDN );
+
+		if ( end == token->str || *end ) { mpfr_clear ( &val ); part->failed = TRUE; part->fail_at = start; break; }
+
+		g_array_append_val ( part->vals, val );
+
+		guint n = part->vals->len - 1;
+		mpfr_ptr v = &g_array_index ( part->vals, __mpfr_struct, n );
+
+		if ( n == 0 || mpfr_less_p    ( v, &g_array_index ( part->vals, __mpfr_struct, part->min ) ) ) part->min = n;
+		if ( n == 0 || mpfr_greater_p ( v, &g_array_index ( part->vals, __mpfr_struct, part->max ) ) ) part->max = n;
+
+		mpfr_mul ( part->prod, part->prod, v, MPFR_RNDN );
+	}
+
+	g_string_free ( token, TRUE );
+}
+
+/* Second pass: each value becomes its squared deviation from the mean */
+static void gcmp_stats_deviate ( Part *part )
+{
+	mpfr_t t;
+	mpfr_init2 ( t, part->prec + GUARD_BITS );
+
+	guint j = 0;
+	for ( j = 0; j < part->vals->len; j++ )
+	{
+		mpfr_ptr v = &g_array_index ( part->vals, __mpfr_struct, j );
+
+		mpfr_sub ( t, v, part->mean, MPFR_RNDN );
+
+		mpfr_set_prec ( v, part->prec + GUARD_BITS );
+		mpfr_sqr ( v, t, MPFR_RNDN );
+	}
+
+	mpfr_clear ( t );
+}
+
+/* Parts go to the pool ( gcmp-pool.h ); the caller takes the first */
+static void gcmp_stats_run ( Part *parts, uint8_t n_parts, GcmpPoolFunc func )
+{
+	GcmpPoolGroup group = { 0 };
+
+	uint8_t j = 0;
+	for ( j = 1; j < n_parts; j++ ) gcmp_pool_spawn ( &group, func, &parts[j] );
+
+	func ( &parts[0] );
+
+	gcmp_pool_wait ( &group );
+}
+
+static void gcmp_stats_reduce ( GcmpStats *stats, Part *parts, uint8_t n_parts, mpfr_prec_t prec )
+{
+	uint64_t n = stats->count, k = 0;
+	uint8_t j = 0;
+
+	mpfr_ptr *ptrs = g_new ( mpfr_ptr, n );
+
+	for ( j = 0; j < n_parts; j++ )
+	{
+		guint i = 0;
+		for ( i = 0; i < parts[j].vals->len; i++ ) ptrs[k++] = &g_array_index ( parts[j].vals, __mpfr_struct, i );
+	}
+
+	// One correctly rounded sum over all the values, however they were split
+	mpfr_sum ( stats->val[ST_SUM], ptrs, n, MPFR_RNDN );
+
+	mpfr_t mean;
+	mpfr_init2 ( mean, prec + GUARD_BITS );
+
+	mpfr_sum ( mean, ptrs, n, MPFR_RNDN );
+	mpfr_div_ui ( mean, mean, (unsigned long)n, MPFR_RNDN );
+	mpfr_set ( stats->val[ST_MEAN], mean, MPFR_RNDN );
+
+	mpfr_set ( stats->val[ST_PROD], parts[0].prod, MPFR_RNDN );
+	mpfr_set ( stats->val[ST_MIN], &g_array_index ( parts[0].vals, __mpfr_struct, parts[0].min ), MPFR_RNDN );
+	mpfr_set ( stats->val[ST_MAX], &g_array_index ( parts[0].vals, __mpfr_struct, parts[0].max ), MPFR_RNDN );
+
+	for ( j = 1; j < n_parts; j++ )
+	{
+		if ( !parts[j].vals->len ) continue;
+
+		mpfr_ptr min = &g_array_index ( parts[j].vals, __mpfr_struct, parts[j].min );
+		mpfr_ptr max = &g_array_index ( parts[j].vals, __mpfr_struct, parts[j].max );
+
+		if ( mpfr_less_p    ( min, stats->val[ST_MIN] ) ) mpfr_set ( stats->val[ST_MIN], min, MPFR_RNDN );
+		if ( mpfr_greater_p ( max, stats->val[ST_MAX] ) ) mpfr_set ( stats->val[ST_MAX], max, MPFR_RNDN );
+
+		mpfr_mul ( stats->val[ST_PROD], stats->val[ST_PROD], parts[j].prod, MPFR_RNDN );
+	}
+
+	// Sample variance from the deviations ( two passes, no cancellation )
+	for ( j = 0; j < n_parts; j++ ) parts[j].mean = mean;
+
+	gcmp_stats_run ( parts, n_parts, (GcmpPoolFunc)gcmp_stats_deviate );
+
+	mpfr_sum ( mean, ptrs, n, MPFR_RNDN );
+
+	if ( n > 1 )
+		mpfr_div_ui ( stats->val[ST_VAR], mean, (unsigned long)( n - 1 ), MPFR_RNDN );
+	else
+		mpfr_set_ui ( stats->val[ST_VAR], 0, MPFR_RNDN );
+
+	mpfr_sqrt ( stats->val[ST_SD], stats->val[ST_VAR], MPFR_RNDN );
+
+	mpfr_clear ( mean );
+	g_free ( ptrs );
+}
+
+GcmpStats * gcmp_stats_new ( const char *data, size_t len, uint8_t base, uint32_t digits, GError **error )
+{
+	mpfr_prec_t prec = (mpfr_prec_t)digits * 4;
+
+	uint8_t n_parts = (uint8_t)CLAMP ( len / PART_BYTES, 1, (size_t)MIN ( gcmp_pool_get_workers () + 1, MAX_WORKERS ) );
+
+	Part *parts = g_new0 ( Part, n_parts );
+
+	uint8_t j = 0;
+	size_t start = 0;
+
+	// Parts end on a separator, so no value is cut in two
+	for ( j = 0; j < n_parts; j++ )
+	{
+		size_t end = ( j == n_parts - 1 ) ? len : MAX ( len / n_parts * ( j + 1 ), start );
+
+		end += gcmp_scan_token ( data + end, len - end );
+
+		parts[j].data  = data;
+		parts[j].start = start;
+		parts[j].end   = end;
+		parts[j].base  = base;
+		parts[j].prec  = prec;
+		parts[j].vals  = g_array_new ( FALSE, FALSE, sizeof ( __mpfr_struct ) );
+
+		mpfr_init2 ( parts[j].prod, prec + GUARD_BITS );
+		mpfr_set_ui ( parts[j].prod, 1, MPFR_RNDN );
+
+		start = end;
+	}
+
+	gcmp_stats_run ( parts, n_parts, (GcmpPoolFunc)gcmp_stats_parse );
+
+	GcmpStats *stats = NULL;
+	uint64_t count = 0;
+
+	for ( j = 0; j < n_parts; j++ ) count += parts[j].vals->len;
+
+	for ( j = 0; j < n_parts; j++ )
+		if ( parts[j].failed ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "not a number ( byte %zu )", parts[j].fail_at + 1 ); break; }
+
+	if ( j == n_parts && count == 0 ) g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "no values" );
+
+	if ( j == n_parts && count )
+	{
+		stats = g_new0 ( GcmpStats, 1 );
+		stats->count = count;
+
+		for ( j = 0; j < ST_NUM; j++ ) mpfr_init2 ( stats->val[j], prec );
+
+		// The first part may be empty when the input starts with blanks
+		for ( j = 0; !parts[j].vals->len; j++ ) ;
+		if ( j ) { Part t = parts[0]; parts[0] = parts[j]; parts[j] = t; }
+
+		gcmp_stats_reduce ( stats, parts, n_parts, prec );
+	}
+
+	for ( j = 0; j < n_parts; j++ )
+	{
+		guint i = 0;
+		for ( i = 0; i < parts[j].vals->len; i++ ) mpfr_clear ( &g_array_index ( parts[j].vals, __mpfr_struct, i ) );
+
+		g_array_free ( parts[j].vals, TRUE );
+		mpfr_clear ( parts[j].prod );
+	}
+
+	g_free ( parts );
+
+	return stats;
+}
+
+GcmpStats * gcmp_stats_new_file ( const char *path, uint8_t base, uint32_t digits, GError **error )
+{
+	GMappedFile *mapped = g_mapped_file_new ( path, FALSE, error );
+
+	if ( !mapped ) return NULL;
+
+	GError *err = NULL;
+	GcmpStats *stats = gcmp_stats_new ( g_mapped_file_get_contents ( mapped ), g_mapped_file_get_length ( mapped ), base, digits, &err );
+
+	if ( err ) { g_set_error ( error, err->domain, err->code, "%s: %s", path, err->message ); g_error_free ( err ); }
+
+	g_mapped_file_unref ( mapped );
+
+	return stats;
+}
+
+void gcmp_stats_free ( GcmpStats *stats )
+{
+	uint8_t j = 0;
+	for ( j = 0; j < ST_NUM; j++ ) mpfr_clear ( stats->val[j] );
+
+	g_free ( stats );
+}
+
+uint64_t gcmp_stats_get_count ( GcmpStats *stats )
+{
+	return stats->count;
+}
+
+mpfr_ptr gcmp_stats_get ( GcmpStats *stats, enum stats num )
+{
+	return stats->val[num];
+}
+
+const char * gcmp_stats_get_name ( enum stats num )
+{
+	return stats_name[num];
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <gtk/gtk.h>
+
+enum stats
+{
+	ST_SUM,
+	ST_MEAN,
+	ST_VAR,
+	ST_SD,
+	ST_MIN,
+	ST_MAX,
+	ST_PROD,
+	ST_NUM
+};
+
+typedef struct _GcmpStats GcmpStats;
+
+/* Values separated by blanks, ',' or ';', in the given base; NULL and error if one is not a number */
+GcmpStats * gcmp_stats_new ( const char *, size_t, uint8_t, uint32_t, GError ** );
+
+/* The same, from a file */
+GcmpStats * gcmp_stats_new_file ( const char *, uint8_t, uint32_t, GError ** );
+
+void gcmp_stats_free ( GcmpStats * );
+
+uint64_t gcmp_stats_get_count ( GcmpStats * );
+
+mpfr_ptr gcmp_stats_get ( GcmpStats *, enum stats );
+
+const char * gcmp_stats_get_name ( enum stats );
@@ -0,0 +1,274 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-tab.h"
+#include "gcmp-radix.h"
+#include "gcmp-pool.h"
+
+#include <errno.h>
+
+/* Workers, and points per chunk: a round of chunks is written before the next one starts */
+#define MAX_WORKERS 16
+#define CHUNK_POINTS 512
+
+/* Largest decimal exponent of a bound or the step, and most points */
+#define EXP_MAX 100000
+#define TAB_MAX 1000000000000
+
+typedef struct _Grid Grid;
+
+struct _Grid
+{
+	mpz_t from, step, pow;
+	long exp;
+
+	uint64_t n;
+};
+
+typedef struct _Chunk Chunk;
+
+struct _Chunk
+{
+	GcmpEval *eval;
+	Grid *grid;
+
+	uint64_t first, last;
+
+	uint32_t digits;
+	uint8_t base, deg_rad;
+
+	GString *out;
+};
+
+/* [ sign ] digits [ . digits ] [ e exp ] as m × 10^e, exactly */
+static gboolean gcmp_tab_decimal ( const char *str, mpz_t m, long *e )
+{
+	const char *p = str;
+	gboolean neg = FALSE, point = FALSE;
+
+	if ( *p == '-' || *p == '+' ) { neg = ( *p == '-' ); p++; }
+
+	GString *digits = g_string_new ( NULL );
+	long frac = 0, exp = 0;
+	gboolean range = TRUE;
+
+	for ( ; g_ascii_isdigit ( *p ) || ( *p == '.' && !point ); p++ )
+	{
+		if ( *p == '.' ) { point = TRUE; continue; }
+
+		g_string_append_c ( digits, *p );
+
+		if ( point ) frac++;
+	}
+
+	if ( digits->len && ( *p == 'e' || *p == 'E' ) )
+	{
+		char *end = NULL;
+
+		errno = 0;
+		exp = strtol ( p + 1, &end, 10 );
+
+		// LONG_MIN or LONG_MAX: labs of the first is undefined
+		range = ( errno != ERANGE );
+
+		p = ( end == p + 1 ) ? p : end;
+	}
+
+	gboolean ret = ( digits->len && *p == '\0' && range && labs ( exp ) <= EXP_MAX && frac <= EXP_MAX );
+
+	if ( ret )
+	{
+		mpz_set_str ( m, digits->str, 10 );
+
+		if ( neg ) mpz_neg ( m, m );
+
+		*e = exp - frac;
+	}
+
+	g_string_free ( digits, TRUE );
+
+	return ret;
+}
+
+static void gcmp_tab_scale ( mpz_t m, long e, long to )
+{
+	mpz_t pow;
+	mpz_init ( pow );
+	mpz_ui_pow_ui ( pow, 10, (unsigned long)( e - to ) );
+
+	mpz_mul ( m, m, pow );
+
+	mpz_clear ( pow );
+}
+
+/* All three in units of one power of ten, so every point is an integer of those units */
+static gboolean gcmp_tab_grid ( Grid *grid, const char *from, const char *to, const char *step, GError **error )
+{
+	mpz_t t;
+	mpz_init ( t );
+
+	long ef = 0, et = 0, es = 0;
+
+	gboolean ret = ( gcmp_tab_decimal ( from, grid->from, &ef ) && gcmp_tab_decimal ( to, t, &et ) && gcmp_tab_decimal ( step, grid->step, &es ) );
+
+	if ( !ret ) g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s:%s:%s: bounds and step must be decimal numbers", from, to, step );
+
+	if ( ret )
+	{
+		grid->exp = MIN ( ef, MIN ( et, es ) );
+
+		gcmp_tab_scale ( grid->from, ef, grid->exp );
+		gcmp_tab_scale ( t, et, grid->exp );
+		gcmp_tab_scale ( grid->step, es, grid->exp );
+
+		mpz_ui_pow_ui ( grid->pow, 10, (unsigned long)labs ( grid->exp ) );
+
+		if ( mpz_sgn ( grid->step ) == 0 ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "the step is zero" ); ret = FALSE; }
+	}
+
+	if ( ret )
+	{
+		// Points: floor ( ( to - from ) / step ) + 1
+		mpz_sub ( t, t, grid->from );
+		mpz_fdiv_q ( t, t, grid->step );
+
+		if ( mpz_sgn ( t ) < 0 ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "the step goes away from %s", to ); ret = FALSE; }
+		else if ( mpz_cmp_ui ( t, TAB_MAX - 1 ) >= 0 ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "more than %lu points", (unsigned long)TAB_MAX ); ret = FALSE; }
+		else grid->n = mpz_get_ui ( t ) + 1;
+	}
+
+	mpz_clear ( t );
+
+	return ret;
+}
+
+/* From + k × step, exact, then rounded once */
+static void gcmp_tab_x ( Grid *grid, uint64_t k, mpq_t q, mpfr_t x )
+{
+	mpz_ptr num = mpq_numref ( q );
+
+	mpz_set_ui ( num, (unsigned long)k );
+	mpz_mul ( num, num, grid->step );
+	mpz_add ( num, num, grid->from );
+
+	if ( grid->exp >= 0 )
+	{
+		mpz_mul ( num, num, grid->pow );
+		mpz_set_ui ( mpq_denref ( q ), 1 );
+	}
+	else
+	{
+		mpz_set ( mpq_denref ( q ), grid->pow );
+		mpq_canonicalize ( q );
+	}
+
+	mpfr_set_q ( x, q, MPFR_RNDN );
+}
+
+static void gcmp_tab_append ( GString *out, mpfr_t val, uint32_t digits, uint8_t base )
+{
+	if ( base == 10 )
+	{
+		// Straight into the chunk's text
+		gsize len = out->len;
+
+		g_string_set_size ( out, len + digits + 32 );
+		g_string_set_size ( out, len + gcmp_radix_get_dec ( val, digits, 0, out->str + len ) );
+	}
+	else
+	{
+		char *str = gcmp_radix_get_str ( val, base, digits );
+		g_string_append ( out, str );
+		free ( str );
+	}
+}
+
+static void gcmp_tab_chunk ( Chunk *chunk )
+{
+	mpfr_t x, res;
+	mpfr_init2 ( x,   chunk->digits * 4 );
+	mpfr_init2 ( res, chunk->digits * 4 );
+
+	mpq_t q;
+	mpq_init ( q );
+
+	// Every point from its own exact value: nothing is carried from one to the next
+	uint64_t k = 0;
+	for ( k = chunk->first; k < chunk->last; k++ )
+	{
+		gcmp_tab_x ( chunk->grid, k, q, x );
+		gcmp_eval_run_at ( chunk->eval, res, chunk->digits, chunk->deg_rad, x );
+
+		gcmp_tab_append ( chunk->out, x, chunk->digits, chunk->base );
+		g_string_append_c ( chunk->out, '\t' );
+		gcmp_tab_append ( chunk->out, res, chunk->digits, chunk->base );
+		g_string_append_c ( chunk->out, '\n' );
+	}
+
+	mpq_clear ( q );
+	mpfr_clear ( x );
+	mpfr_clear ( res );
+}
+
+gboolean gcmp_tab_run ( GcmpEval *eval, const char *from, const char *to, const char *step, uint32_t digits, uint8_t base, uint8_t deg_rad, FILE *file, GError **error )
+{
+	Grid grid;
+	mpz_inits ( grid.from, grid.step, grid.pow, NULL );
+
+	gboolean ret = gcmp_tab_grid ( &grid, from, to, step, error );
+
+	// Each point is one run: admitted once for all of them ( gcmp-cost.h )
+	if ( ret && !gcmp_eval_admit ( eval, digits ) ) { g_set_error ( error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "refused, over the limits ( GCMP_LIMIT )" ); ret = FALSE; }
+
+	uint8_t j = 0, n_workers = (uint8_t)MIN ( gcmp_pool_get_workers () + 1, MAX_WORKERS );
+
+	Chunk chunks[MAX_WORKERS];
+
+	// Numbers read once for the whole range, not at every point; the chunks share the copy
+	GcmpEval *at = gcmp_eval_new_at ( eval, digits );
+
+	for ( j = 0; j < n_workers; j++ ) chunks[j] = (Chunk){ at, &grid, 0, 0, digits, base, deg_rad, g_string_new ( NULL ) };
+
+	uint64_t k = 0;
+
+	// A round of chunks at a time, written in order: memory stays bounded however long the range
+	while ( ret && k < grid.n )
+	{
+		uint8_t n = 0;
+
+		for ( n = 0; n < n_workers && k < grid.n; n++ )
+		{
+			chunks[n].first = k;
+			chunks[n].last  = k = MIN ( k + CHUNK_POINTS, grid.n );
+
+			g_string_truncate ( chunks[n].out, 0 );
+		}
+
+		// Chunks go to the pool ( gcmp-pool.h ); the caller takes the first
+		GcmpPoolGroup group = { 0 };
+
+		for ( j = 1; j < n; j++ ) gcmp_pool_spawn ( &group, (GcmpPoolFunc)gcmp_tab_chunk, &chunks[j] );
+
+		gcmp_tab_chunk ( &chunks[0] );
+
+		gcmp_pool_wait ( &group );
+
+		for ( j = 0; j < n; j++ ) fwrite ( chunks[j].out->str, 1, chunks[j].out->len, file );
+
+		if ( ferror ( file ) ) { g_set_error ( error, G_FILE_ERROR, g_file_error_from_errno ( errno ), "%s", g_strerror ( errno ) ); ret = FALSE; }
+	}
+
+	for ( j = 0; j < n_workers; j++ ) g_string_free ( chunks[j].out, TRUE );
+
+	gcmp_eval_free ( at );
+
+	mpz_clears ( grid.from, grid.step, grid.pow, NULL );
+
+	return ret;
+}
@@ -0,0 +1,18 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-eval.h"
+
+/*
+* The expression at x = from, from + step, ... up to to: one "x value" line each, in order.
+* The bounds and the step are decimal: every x is rounded once from its exact value.
+*/
+gboolean gcmp_tab_run ( GcmpEval *, const char *, const char *, const char *, uint32_t, uint8_t, uint8_t, FILE *, GError ** );
@@ -27,13 +27,14 @@ static const char *b_name[NUM_BUTTONS] =
 	"0", ".", "%", "+"
 };
 
-static const char *b_ext_name[NUM_BUTTONS] = 
+static const char *b_ext_name[NUM_BUTTONS_EXT] = 
 {
 	"e+", "e-", "π", "⚒",
 	"x²", "x³", "xⁿ", "n!",
 	"√", "³√", "ⁿ√", "⅟√",
 	"ln", "log", "mod", "⅟x",
-	"sin", "cos", "tan", "deg"
+	"sin", "cos", "tan", "deg",
+	"bin", "oct", "hex", "b36"
 };
 
 static void gcmp_tool_signal_handler_num ( GtkButton *button, GcmpTool *tool )
@@ -115,7 +116,7 @@ struct _GcmpToolExt
 {
 	GtkBox parent_instance;
 
-	GtkButton *button[NUM_BUTTONS];
+	GtkButton *button[NUM_BUTTONS_EXT];
 };
 
 G_DEFINE_TYPE ( GcmpToolExt, gcmp_tool_ext, GTK_TYPE_BOX )
@@ -146,7 +147,7 @@ static void gcmp_tool_ext_create ( GcmpToolExt *tool )
 
 	GtkBox *h_box;
 
-	for ( i = 0; i < NUM_BUTTONS; i++ )
+	for ( i = 0; i < NUM_BUTTONS_EXT; i++ )
 	{
 		if ( i == COL * row )
 		{
@@ -15,6 +15,9 @@
 #define ROW 5
 #define NUM_BUTTONS (COL*ROW)
 
+#define ROW_EXT 6
+#define NUM_BUTTONS_EXT (COL*ROW_EXT)
+
 #define BUTTON_SIZE 80
 
 enum b_num 
@@ -32,7 +35,8 @@ enum b_ext_num
 	BP2, BP3, BPN, BFC,
 	BR2, BR3, BRN, B1R,
 	BLN, BLG, BMD, B1X,
-	BSN, BCS, BTN, BDR
+	BSN, BCS, BTN, BDR,
+	BB2, BB8, B16, B36
 };
 
 #define GCMP_TYPE_TOOL gcmp_tool_get_type ()
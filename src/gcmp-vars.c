@@ -0,0 +1,117 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-vars.h"
+
+#include <string.h>
+
+/* Longest name kept */
+#define NAME_MAX_LEN 32
+
+static void gcmp_vars_value_free ( mpfr_ptr val )
+{
+	mpfr_clear ( val );
+
+	g_free ( val );
+}
+
+static void gcmp_vars_table_free ( GHashTable *table )
+{
+	g_hash_table_unref ( table );
+}
+
+static GPrivate vars_key = G_PRIVATE_INIT ( (GDestroyNotify)gcmp_vars_table_free );
+
+static GHashTable * gcmp_vars_table ( void )
+{
+	GHashTable *table = g_private_get ( &vars_key );
+
+	if ( table ) return table;
+
+	table = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, (GDestroyNotify)gcmp_vars_value_free );
+	g_private_set ( &vars_key, table );
+
+	return table;
+}
+
+size_t gcmp_vars_name ( const char *str )
+{
+	size_t len = 0;
+
+	if ( !g_ascii_isalpha ( *str ) ) return 0;
+
+	while ( g_ascii_isalnum ( str[len] ) ) len++;
+
+	return ( len <= NAME_MAX_LEN ) ? len : 0;
+}
+
+void gcmp_vars_set ( const char *name, mpfr_srcptr val )
+{
+	if ( gcmp_vars_name ( name ) != strlen ( name ) ) return;
+
+	mpfr_ptr copy = g_new ( __mpfr_struct, 1 );
+	mpfr_init2 ( copy, mpfr_get_prec ( val ) );
+	mpfr_set ( copy, val, MPFR_RNDN );
+
+	g_hash_table_replace ( gcmp_vars_table (), g_strdup ( name ), copy );
+}
+
+void gcmp_vars_clear ( void )
+{
+	GHashTable *table = g_private_get ( &vars_key );
+
+	if ( table ) g_hash_table_remove_all ( table );
+}
+
+void gcmp_vars_add ( const char *name, mpfr_srcptr val, int sign )
+{
+	mpfr_srcptr old = gcmp_vars_find ( name, strlen ( name ) );
+
+	mpfr_t sum;
+	mpfr_init2 ( sum, ( old ) ? MAX ( mpfr_get_prec ( old ), mpfr_get_prec ( val ) ) : mpfr_get_prec ( val ) );
+
+	if ( !old ) mpfr_set_zero ( sum, 1 ); else mpfr_set ( sum, old, MPFR_RNDN );
+
+	if ( sign < 0 ) mpfr_sub ( sum, sum, val, MPFR_RNDN ); else mpfr_add ( sum, sum, val, MPFR_RNDN );
+
+	gcmp_vars_set ( name, sum );
+
+	mpfr_clear ( sum );
+}
+
+void gcmp_vars_unset ( const char *name )
+{
+	g_hash_table_remove ( gcmp_vars_table (), name );
+}
+
+mpfr_srcptr gcmp_vars_find ( const char *name, size_t len )
+{
+	if ( !len || len > NAME_MAX_LEN ) return NULL;
+
+	char key[NAME_MAX_LEN + 1];
+	memcpy ( key, name, len );
+	key[len] = '\0';
+
+	return g_hash_table_lookup ( gcmp_vars_table (), key );
+}
+
+gboolean gcmp_vars_has_prefix ( const char *str, size_t len )
+{
+	GHashTableIter iter;
+	gpointer key = NULL;
+
+	g_hash_table_iter_init ( &iter, gcmp_vars_table () );
+
+	while ( g_hash_table_iter_next ( &iter, &key, NULL ) )
+	{
+		if ( strncmp ( key, str, len ) == 0 ) return TRUE;
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,40 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#pragma once
+
+#include "gcmp-mpfr.h"
+
+#include <glib.h>
+
+/*
+* Named values at full precision, binary: ans, the memory register M and those stored with -> name.
+* Per thread: the windows share the main thread's; a service thread clears them for each connection it serves.
+* A name is a letter, then letters and digits.
+*/
+
+/* Length of the name at the start of the text, 0 if none */
+size_t gcmp_vars_name ( const char * );
+
+/* A copy at the value's precision */
+void gcmp_vars_set ( const char *, mpfr_srcptr );
+
+/* Adds ( sign 1 ) or subtracts ( -1 ) at the greater precision of the two; an unset name counts as zero */
+void gcmp_vars_add ( const char *, mpfr_srcptr, int );
+
+void gcmp_vars_unset ( const char * );
+
+/* Every name of this thread: a service thread serves one connection after another */
+void gcmp_vars_clear ( void );
+
+/* The value of the name of that many bytes, NULL if unset; valid until the name is set again */
+mpfr_srcptr gcmp_vars_find ( const char *, size_t );
+
+/* Some name starts with these bytes */
+gboolean gcmp_vars_has_prefix ( const char *, size_t );
@@ -0,0 +1,339 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+#include "gcmp-view.h"
+#include "gcmp-digits.h"
+#include "gcmp-scan.h"
+
+/* Digits per group; rows hold as many groups as fit the width */
+#define GROUP_DIGITS 10
+
+struct _GcmpView
+{
+	GtkWindow  parent_instance;
+
+	GtkLabel *label;
+	GtkDrawingArea *area;
+	GtkAdjustment *adj;
+
+	GtkSpinButton *spin_pos;
+	GtkSpinButton *spin_from;
+	GtkSpinButton *spin_to;
+
+	GcmpDigits *digits;
+
+	uint32_t row_digits;
+	int char_width;
+	int row_height;
+};
+
+G_DEFINE_TYPE ( GcmpView, gcmp_view, GTK_TYPE_WINDOW )
+
+static uint32_t gcmp_view_len ( GcmpView *view )
+{
+	return ( view->digits ) ? gcmp_digits_get_len ( view->digits ) : 0;
+}
+
+static uint8_t gcmp_view_pos_width ( GcmpView *view )
+{
+	char buf[16];
+
+	return (uint8_t)snprintf ( buf, sizeof ( buf ), "%u", gcmp_view_len ( view ) );
+}
+
+static PangoLayout * gcmp_view_layout ( GcmpView *view )
+{
+	PangoLayout *layout = gtk_widget_create_pango_layout ( GTK_WIDGET ( view->area ), NULL );
+
+	PangoFontDescription *font = pango_font_description_from_string ( "Monospace" );
+	pango_layout_set_font_description ( layout, font );
+	pango_font_description_free ( font );
+
+	return layout;
+}
+
+static void gcmp_view_rows ( GcmpView *view )
+{
+	PangoLayout *layout = gcmp_view_layout ( view );
+	pango_layout_set_text ( layout, "0000000000", -1 );
+
+	int width = 0, height = 0;
+	pango_layout_get_pixel_size ( layout, &width, &height );
+	g_object_unref ( layout );
+
+	view->char_width = MAX ( width / 10, 1 );
+	view->row_height = MAX ( height, 1 );
+
+	int area_width  = gtk_widget_get_allocated_width  ( GTK_WIDGET ( view->area ) );
+	int area_height = gtk_widget_get_allocated_height ( GTK_WIDGET ( view->area ) );
+
+	// Position column, then groups separated by a space
+	int chars = area_width / view->char_width - gcmp_view_pos_width ( view ) - 3;
+	uint32_t groups = (uint32_t)MAX ( chars / ( GROUP_DIGITS + 1 ), 1 );
+
+	uint32_t first = view->row_digits * (uint32_t)gtk_adjustment_get_value ( view->adj );
+
+	view->row_digits = groups * GROUP_DIGITS;
+
+	uint32_t len = gcmp_view_len ( view );
+	double rows = ( len + view->row_digits - 1 ) / view->row_digits;
+	double page = area_height / view->row_height;
+
+	// The same digits stay on top after a resize
+	gtk_adjustment_configure ( view->adj, first / view->row_digits, 0, rows, 1, MAX ( page - 1, 1 ), page );
+}
+
+static void gcmp_view_size_allocate ( G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED GdkRectangle *alloc, GcmpView *view )
+{
+	gcmp_view_rows ( view );
+}
+
+static gboolean gcmp_view_draw ( GtkWidget *widget, cairo_t *cr, GcmpView *view )
+{
+	GtkStyleContext *context = gtk_widget_get_style_context ( widget );
+
+	int width  = gtk_widget_get_allocated_width  ( widget );
+	int height = gtk_widget_get_allocated_height ( widget );
+
+	gtk_render_background ( context, cr, 0, 0, width, height );
+
+	if ( !view->digits || view->row_digits == 0 ) return TRUE;
+
+	uint32_t len = gcmp_view_len ( view );
+	uint32_t row = (uint32_t)gtk_adjustment_get_value ( view->adj );
+	uint8_t pos_width = gcmp_view_pos_width ( view );
+
+	PangoLayout *layout = gcmp_view_layout ( view );
+
+	char digits[view->row_digits + 1];
+	GString *line = g_string_sized_new ( view->row_digits * 2 );
+
+	// Only the rows on screen are formatted
+	int y = 0;
+	for ( y = 0; y < height && (uint64_t)row * view->row_digits < len; y += view->row_height, row++ )
+	{
+		uint32_t pos = row * view->row_digits;
+		uint32_t n = gcmp_digits_get ( view->digits, pos, view->row_digits, digits );
+
+		g_string_printf ( line, "%*u   ", pos_width, pos + 1 );
+
+		size_t at = line->len;
+		g_string_set_size ( line, at + n + n / GROUP_DIGITS );
+		g_string_truncate ( line, at + gcmp_scan_group ( line->str + at, digits, n, GROUP_DIGITS, ' ' ) );
+
+		pango_layout_set_text ( layout, line->str, (int)line->len );
+		gtk_render_layout ( context, cr, 0, y, layout );
+	}
+
+	g_string_free ( line, TRUE );
+	g_object_unref ( layout );
+
+	return TRUE;
+}
+
+static void gcmp_view_scrolled ( G_GNUC_UNUSED GtkAdjustment *adj, GcmpView *view )
+{
+	gtk_widget_queue_draw ( GTK_WIDGET ( view->area ) );
+}
+
+static gboolean gcmp_view_scroll_event ( G_GNUC_UNUSED GtkWidget *widget, GdkEventScroll *event, GcmpView *view )
+{
+	double step = 3, value = gtk_adjustment_get_value ( view->adj );
+
+	if ( event->direction == GDK_SCROLL_UP   ) value -= step;
+	if ( event->direction == GDK_SCROLL_DOWN ) value += step;
+	if ( event->direction == GDK_SCROLL_SMOOTH ) value += event->delta_y * step;
+
+	gtk_adjustment_set_value ( view->adj, value );
+
+	return TRUE;
+}
+
+static void gcmp_view_jump ( G_GNUC_UNUSED GtkButton *button, GcmpView *view )
+{
+	gtk_spin_button_update ( view->spin_pos );
+
+	uint32_t pos = (uint32_t)gtk_spin_button_get_value ( view->spin_pos );
+
+	if ( pos && view->row_digits ) gtk_adjustment_set_value ( view->adj, ( pos - 1 ) / view->row_digits );
+}
+
+static void gcmp_view_copy ( G_GNUC_UNUSED GtkButton *button, GcmpView *view )
+{
+	gtk_spin_button_update ( view->spin_from );
+	gtk_spin_button_update ( view->spin_to );
+
+	uint32_t from = (uint32_t)gtk_spin_button_get_value ( view->spin_from );
+	uint32_t to   = (uint32_t)gtk_spin_button_get_value ( view->spin_to );
+
+	if ( !view->digits || from == 0 || to < from ) return;
+
+	char *text = g_malloc ( (size_t)( to - from ) + 2 );
+	uint32_t n = gcmp_digits_get ( view->digits, from - 1, to - from + 1, text );
+
+	gtk_clipboard_set_text ( gtk_clipboard_get ( GDK_SELECTION_CLIPBOARD ), text, (int)n );
+
+	g_free ( text );
+}
+
+static void gcmp_view_set_value ( GcmpView *view, mpfr_ptr val, uint32_t n_digits )
+{
+	if ( view->digits ) gcmp_digits_free ( view->digits );
+
+	view->digits = gcmp_digits_new ( val, n_digits );
+
+	uint32_t len = gcmp_view_len ( view );
+
+	g_autofree char *text = NULL;
+
+	if ( len )
+		text = g_strdup_printf ( "%s0.d1 d2 ... d%u × 10^%ld", ( gcmp_digits_is_neg ( view->digits ) ) ? "-" : "", len, gcmp_digits_get_exp ( view->digits ) );
+	else
+	{
+		char *str = NULL;
+		mpfr_asprintf ( &str, "%Rg", val );
+
+		text = g_strdup ( str );
+		mpfr_free_str ( str );
+	}
+
+	gtk_label_set_text ( view->label, text );
+
+	gtk_spin_button_set_range ( view->spin_pos,  1, MAX ( len, 1 ) );
+	gtk_spin_button_set_range ( view->spin_from, 1, MAX ( len, 1 ) );
+	gtk_spin_button_set_range ( view->spin_to,   1, MAX ( len, 1 ) );
+	gtk_spin_button_set_value ( view->spin_to, MIN ( len, 100 ) );
+
+	view->row_digits = 0;
+	gtk_adjustment_set_value ( view->adj, 0 );
+
+	if ( gtk_widget_get_realized ( GTK_WIDGET ( view->area ) ) ) gcmp_view_rows ( view );
+
+	gtk_widget_queue_draw ( GTK_WIDGET ( view->area ) );
+	gtk_window_present ( GTK_WINDOW ( view ) );
+}
+
+static GtkSpinButton * gcmp_view_create_spin ( const char *text )
+{
+	GtkSpinButton *spin = (GtkSpinButton *)gtk_spin_button_new_with_range ( 1, 1, 1 );
+
+	gtk_entry_set_icon_from_icon_name ( GTK_ENTRY ( spin ), GTK_ENTRY_ICON_PRIMARY, "info" );
+	gtk_entry_set_icon_tooltip_text   ( GTK_ENTRY ( spin ), GTK_ENTRY_ICON_PRIMARY, text );
+
+	gtk_widget_set_visible ( GTK_WIDGET ( spin ), TRUE );
+
+	return spin;
+}
+
+static GtkButton * gcmp_view_create_button ( const char *icon_name, void ( *f )( GtkButton *, GcmpView * ), GcmpView *view )
+{
+	GtkButton *button = (GtkButton *)gtk_button_new_from_icon_name ( icon_name, GTK_ICON_SIZE_MENU );
+	gtk_widget_set_visible ( GTK_WIDGET ( button ), TRUE );
+
+	g_signal_connect ( button, "clicked", G_CALLBACK ( f ), view );
+
+	return button;
+}
+
+static void gcmp_view_create ( GcmpView *view )
+{
+	GtkWindow *window = GTK_WINDOW ( view );
+
+	gtk_window_set_title ( window, "Gcmp: result" );
+	gtk_window_set_icon_name ( window, "gnome-calculator" );
+	gtk_window_set_default_size ( window, 640, 400 );
+
+	GtkBox *m_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_VERTICAL, 0 );
+	gtk_box_set_spacing ( m_box, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( m_box ), TRUE );
+
+	view->label = (GtkLabel *)gtk_label_new ( "" );
+	gtk_label_set_selectable ( view->label, TRUE );
+	gtk_widget_set_visible ( GTK_WIDGET ( view->label ), TRUE );
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( view->label ), FALSE, FALSE, 0 );
+
+	GtkBox *h_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
+	gtk_widget_set_visible ( GTK_WIDGET ( h_box ), TRUE );
+
+	view->adj  = gtk_adjustment_new ( 0, 0, 1, 1, 1, 1 );
+	g_signal_connect ( view->adj, "value-changed", G_CALLBACK ( gcmp_view_scrolled ), view );
+
+	view->area = (GtkDrawingArea *)gtk_drawing_area_new ();
+	gtk_widget_add_events ( GTK_WIDGET ( view->area ), GDK_SCROLL_MASK | GDK_SMOOTH_SCROLL_MASK );
+	g_signal_connect ( view->area, "draw", G_CALLBACK ( gcmp_view_draw ), view );
+	g_signal_connect ( view->area, "size-allocate", G_CALLBACK ( gcmp_view_size_allocate ), view );
+	g_signal_connect ( view->area, "scroll-event", G_CALLBACK ( gcmp_view_scroll_event ), view );
+	gtk_widget_set_visible ( GTK_WIDGET ( view->area ), TRUE );
+
+	GtkWidget *scrollbar = gtk_scrollbar_new ( GTK_ORIENTATION_VERTICAL, view->adj );
+	gtk_widget_set_visible ( scrollbar, TRUE );
+
+	gtk_box_pack_start ( h_box, GTK_WIDGET ( view->area ), TRUE, TRUE, 0 );
+	gtk_box_pack_end   ( h_box, scrollbar, FALSE, FALSE, 0 );
+	gtk_box_pack_start ( m_box, GTK_WIDGET ( h_box ), TRUE, TRUE, 0 );
+
+	h_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
+	gtk_box_set_spacing ( h_box, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( h_box ), TRUE );
+
+	view->spin_pos  = gcmp_view_create_spin ( "Position" );
+	view->spin_from = gcmp_view_create_spin ( "Copy from" );
+	view->spin_to   = gcmp_view_create_spin ( "Copy to" );
+
+	gtk_box_pack_start ( h_box, GTK_WIDGET ( view->spin_pos ), FALSE, FALSE, 0 );
+	gtk_box_pack_start ( h_box, GTK_WIDGET ( gcmp_view_create_button ( "go-jump", gcmp_view_jump, view ) ), FALSE, FALSE, 0 );
+
+	gtk_box_pack_end ( h_box, GTK_WIDGET ( gcmp_view_create_button ( "edit-copy", gcmp_view_copy, view ) ), FALSE, FALSE, 0 );
+	gtk_box_pack_end ( h_box, GTK_WIDGET ( view->spin_to ), FALSE, FALSE, 0 );
+	gtk_box_pack_end ( h_box, GTK_WIDGET ( view->spin_from ), FALSE, FALSE, 0 );
+
+	gtk_box_pack_end ( m_box, GTK_WIDGET ( h_box ), FALSE, FALSE, 0 );
+
+	gtk_container_set_border_width ( GTK_CONTAINER ( m_box ), 10 );
+	gtk_container_add ( GTK_CONTAINER ( window ), GTK_WIDGET ( m_box ) );
+
+	// Closing only hides: the next long result reuses the window
+	g_signal_connect ( view, "delete-event", G_CALLBACK ( gtk_widget_hide_on_delete ), NULL );
+}
+
+static void gcmp_view_init ( GcmpView *view )
+{
+	gcmp_view_create ( view );
+
+	g_signal_connect ( view, "view-set-value", G_CALLBACK ( gcmp_view_set_value ), NULL );
+}
+
+static void gcmp_view_finalize ( GObject *object )
+{
+	GcmpView *view = GCMP_VIEW ( object );
+
+	if ( view->digits ) gcmp_digits_free ( view->digits );
+
+	G_OBJECT_CLASS (gcmp_view_parent_class)->finalize (object);
+}
+
+static void gcmp_view_class_init ( GcmpViewClass *class )
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+
+	oclass->finalize = gcmp_view_finalize;
+
+	g_signal_new ( "view-set-value", G_TYPE_FROM_CLASS ( class ), G_SIGNAL_RUN_LAST,
+		0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_POINTER, G_TYPE_UINT );
+}
+
+GcmpView * gcmp_view_new ( GtkWindow *parent )
+{
+	GcmpView *view = g_object_new ( GCMP_TYPE_VIEW, NULL );
+
+	gtk_window_set_transient_for ( GTK_WINDOW ( view ), parent );
+	gtk_window_set_destroy_with_parent ( GTK_WINDOW ( view ), TRUE );
+
+	return view;
+}
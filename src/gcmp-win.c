@@ -8,29 +8,74 @@
 */
 
 #include "gcmp-win.h"
-#include "gcmp-mpfr.h"
+#include "gcmp-eval.h"
+#include "gcmp-file.h"
 #include "gcmp-tool.h"
 #include "gcmp-entry.h"
+#include "gcmp-view.h"
+#include "gcmp-list.h"
+#include "gcmp-plot.h"
+#include "gcmp-const.h"
+#include "gcmp-vars.h"
+#include "gcmp-cost.h"
 
 #include <locale.h>
-#include <uchar.h>
 
-/* Precision ( maximum characters ) */
-#define MAX_DIGITS 1000
+/* From here evaluations run on a thread, with progress and a way out */
+#define WAIT_DIGITS 100000
+
+typedef struct _Job Job;
+
+/* Main thread, with the result: the window uses it, then the job goes */
+typedef void ( *JobDone ) ( GcmpWin *, Job * );
+
+/* An expression, a function of a value or a constant, at the window's settings when it began */
+struct _Job
+{
+	GcmpWin *win;
+	JobDone done;
+
+	GcmpEval *eval;
+	enum math_ext mt;
+	mpfr_t a, res;
+
+	uint32_t digits, got;
+	uint8_t deg_rad;
+	gboolean ball, wait;
+
+	// What the result is for: Save's file, the sign of M+ and M-
+	char *path;
+	int sign;
+
+	GcmpConstProgress prog;
+	gboolean ok, refused;
+
+	GtkDialog *dialog;
+	GtkProgressBar *bar;
+	guint timer;
+};
 
 struct _GcmpWin
 {
 	GtkWindow  parent_instance;
 
 	GcmpEntry *entry;
+	GcmpView *view;
+	GcmpList *list;
+	GcmpPlot *plot;
 	GtkPopover *popover;
 
+	Job *job;
+
 	GcmpTool *tool;
 	GcmpToolExt *tool_ext;
+	GtkBox *box_tool;
 
 	uint8_t base;
 	uint8_t deg_rad;
-	uint16_t digits;
+	uint32_t digits;
+
+	gboolean ball;
 
 	gboolean debug;
 };
@@ -59,145 +104,219 @@ static void gcmp_win_about ( GcmpWin *win )
 	gtk_widget_destroy ( GTK_WIDGET (dialog) );
 }
 
-static enum math gcmp_win_parse_get_op ( const uint32_t sym )
+/* Shows a result to the given digits: in the entry, and in the viewer past ENTRY_DIGITS */
+static void gcmp_win_result_digits ( GcmpWin *win, mpfr_t res, uint32_t shown )
 {
-	enum math mtf = UNF;
+	uint32_t digits = MIN ( shown, ENTRY_DIGITS );
 
-	if ( sym == '+' ) mtf = ADD;
-	if ( sym == '-' ) mtf = SUB;
-	if ( sym == '/' ) mtf = DIV;
-	if ( sym == '*' ) mtf = MUL;
-	if ( sym == '%' ) mtf = PRC;
-	if ( sym == '^' ) mtf = POW;
-	if ( sym == 'm' ) mtf = MOD;
-	if ( sym == U'√' ) mtf = RUT; // √ : 0XE2889A; '\342\210\232'; ( multi-character )
+	g_autofree char *out_str = gcmp_mpfr_get_str_base ( res, digits, win->base );
 
-	return mtf;
+	if ( win->debug ) g_message ( "%s: set %s ", __func__, out_str );
+
+	// Also those of the keypad functions, constants and lists, which do not go through the parser
+	gcmp_vars_set ( "ans", res );
+
+	// The short text stays bound to the full value, so the next operation loses nothing
+	g_signal_emit_by_name ( win->entry, "entry-set-value", out_str, res, FALSE );
+
+	if ( shown <= ENTRY_DIGITS ) return;
+
+	if ( !win->view ) win->view = gcmp_view_new ( GTK_WINDOW ( win ) );
+
+	g_signal_emit_by_name ( win->view, "view-set-value", res, shown );
 }
 
-static uint8_t gcmp_win_parse_space ( const char *str )
+static void gcmp_win_result ( GcmpWin *win, mpfr_t res )
 {
-	uint8_t ret = 0, j = 0;
+	gcmp_win_result_digits ( win, res, win->digits );
+}
+
+static void gcmp_win_message ( GcmpWin *win, const char *text );
+
+static gboolean gcmp_win_is_const ( enum math_ext mt )
+{
+	return ( mt == CPI || mt == CEU || mt == CEX || mt == CL2 );
+}
+
+/* A nan that a refusal made ( gcmp-cost.h ) is told as such, not shown */
+static gboolean gcmp_win_refused ( GcmpWin *win, Job *job )
+{
+	if ( !job->refused ) return FALSE;
+
+	gcmp_win_message ( win, "Refused: over the time or memory limit ( GCMP_LIMIT )" );
 
-	for ( j = 0; j < 255; j++ ) if ( str[j] == ' ' ) ret++; else break;
+	return TRUE;
+}
 
-	return ret;
+/* Any thread: ans and stored names are left to the done handler, in the window's variables */
+static void gcmp_win_job_work ( Job *job )
+{
+	// Only this job's refusals count
+	gcmp_cost_take_refused ();
+
+	if ( job->eval && job->ball )
+		job->got = gcmp_eval_run_ball ( job->eval, job->res, job->digits, job->deg_rad );
+	else if ( job->eval && gcmp_eval_admit ( job->eval, job->digits ) )
+		gcmp_eval_run_at ( job->eval, job->res, job->digits, job->deg_rad, NULL );
+	else if ( job->eval )
+		mpfr_set_nan ( job->res );
+	else if ( job->wait && gcmp_win_is_const ( job->mt ) )
+		// Closed or cancelled, the run goes on from its last checkpoint the next time
+		job->ok = gcmp_const_run_ckpt ( job->mt, job->res, MPFR_RNDN, &job->prog, NULL );
+	else if ( gcmp_eval_admit_fn ( job->mt, job->digits ) )
+		gcmp_mpfr_op_ext ( job->mt, job->res, job->a, job->digits, job->deg_rad );
+	else
+		mpfr_set_nan ( job->res );
+
+	job->refused = ( gcmp_cost_take_refused () && mpfr_nan_p ( job->res ) );
 }
 
-static void gcmp_win_parse_sct ( const char *str, char *out, GcmpWin *win )
+static void gcmp_win_job_free ( Job *job )
 {
-	if ( g_str_has_prefix ( str, "sin" ) ) gcmp_mpfr_all_ext ( SIN, str + 3, win->digits, 0, win->base, out, win->deg_rad );
-	if ( g_str_has_prefix ( str, "cos" ) ) gcmp_mpfr_all_ext ( COS, str + 3, win->digits, 0, win->base, out, win->deg_rad );
-	if ( g_str_has_prefix ( str, "tan" ) ) gcmp_mpfr_all_ext ( TAN, str + 3, win->digits, 0, win->base, out, win->deg_rad );
+	if ( job->eval ) gcmp_eval_free ( job->eval );
 
-	g_signal_emit_by_name ( win->entry, "entry-set-text", out, FALSE );
+	mpfr_clear ( job->a );
+	mpfr_clear ( job->res );
+
+	g_free ( job->path );
+	g_free ( job );
 }
 
-static void gcmp_win_parse_log ( const char *str, char *out, GcmpWin *win )
+/* Main thread: a job on a thread comes back here, done, cancelled or left */
+static gboolean gcmp_win_job_done ( Job *job )
 {
-	if ( g_str_has_prefix ( str, "ln"  ) ) gcmp_mpfr_all_ext ( LGN, str + 2, win->digits, 0, win->base, out, win->deg_rad );
-	if ( g_str_has_prefix ( str, "log" ) ) gcmp_mpfr_all_ext ( LOG, str + 3, win->digits, 0, win->base, out, win->deg_rad );
+	GcmpWin *win = job->win;
+
+	if ( job->dialog ) { g_source_remove ( job->timer ); gtk_widget_destroy ( GTK_WIDGET ( job->dialog ) ); }
+
+	if ( win->job == job ) win->job = NULL;
+
+	if ( job->ok && !g_atomic_int_get ( &job->prog.cancel ) ) job->done ( win, job );
+
+	gcmp_win_job_free ( job );
+	g_object_unref ( win );
 
-	g_signal_emit_by_name ( win->entry, "entry-set-text", out, FALSE );
+	return G_SOURCE_REMOVE;
 }
 
-static void gcmp_win_parse ( const char *str, uint16_t len, GcmpWin *win )
+static gpointer gcmp_win_job_thread ( Job *job )
 {
-	if ( win->debug ) g_message ( "%s:: string: %s ", __func__, str );
+	gcmp_win_job_work ( job );
 
-	const char *pattern = str;
+	g_idle_add ( (GSourceFunc)gcmp_win_job_done, job );
 
-	enum math mtf = UNF;
-	gboolean first = FALSE;
+	return NULL;
+}
+
+static gboolean gcmp_win_job_tick ( Job *job )
+{
+	gint done = g_atomic_int_get ( &job->prog.done ), total = g_atomic_int_get ( &job->prog.total );
 
-	if ( len > MAX_DIGITS ) len = MAX_DIGITS+8;
+	// Only the constants count their runs
+	if ( total > 0 ) gtk_progress_bar_set_fraction ( job->bar, MIN ( 1.0, (double)done / total ) ); else gtk_progress_bar_pulse ( job->bar );
 
-	char base[len+1]; base[0] = '\0';
-	char out_str[win->digits+1]; out_str[0] = '\0';
-	char out_str_one_a[win->digits+1]; out_str_one_a[0] = '\0';
-	char out_str_one_b[win->digits+1]; out_str_one_b[0] = '\0';
+	return G_SOURCE_CONTINUE;
+}
+
+/* Cancel or close: a constant stops at its next merge, then the dialog goes; anything else is left to finish unseen */
+static void gcmp_win_job_response ( GtkDialog *dialog, G_GNUC_UNUSED int response, Job *job )
+{
+	g_atomic_int_set ( &job->prog.cancel, 1 );
 
-	uint32_t c = g_utf8_get_char ( pattern );
+	if ( !job->eval && gcmp_win_is_const ( job->mt ) )
+	{
+		gtk_progress_bar_set_text ( job->bar, "Cancelling ..." );
+		gtk_dialog_set_response_sensitive ( dialog, GTK_RESPONSE_CANCEL, FALSE );
 
-	uint8_t space_n = gcmp_win_parse_space ( pattern );
-	if ( space_n ) pattern += space_n;
+		return;
+	}
 
-	// c = g_utf8_get_char  ( pattern );
-	// if ( c == '-' ) pattern++;
+	g_source_remove ( job->timer );
+	gtk_widget_destroy ( GTK_WIDGET ( dialog ) );
 
-	if ( g_str_has_prefix ( pattern, "sin" ) || g_str_has_prefix ( pattern, "cos" ) || g_str_has_prefix ( pattern, "tan" ) )
-		{ gcmp_win_parse_sct ( pattern, out_str_one_a, win ); pattern += 3; }
+	job->dialog = NULL;
+	job->win->job = NULL;
+}
 
-	if ( g_str_has_prefix ( pattern, "ln" ) || g_str_has_prefix ( pattern, "log" ) )
-		{ gcmp_win_parse_log ( pattern, out_str_one_a, win ); pattern += ( g_str_has_prefix ( pattern, "log" ) ) ? 3 : 2; }
+static Job * gcmp_win_job_new ( GcmpWin *win, GcmpEval *eval, enum math_ext mt, JobDone done )
+{
+	Job *job = g_new0 ( Job, 1 );
 
-	space_n = gcmp_win_parse_space ( pattern );
-	if ( space_n ) pattern += space_n;
+	job->win  = win;
+	job->done = done;
+	job->eval = eval;
+	job->mt   = mt;
+	job->ok   = TRUE;
 
-	c = g_utf8_get_char  ( pattern );
-	if ( c == '-' ) pattern++;
+	job->digits  = win->digits;
+	job->deg_rad = win->deg_rad;
 
-	c = g_utf8_get_char  ( pattern );
+	mpfr_init2 ( job->a,   win->digits * 4 );
+	mpfr_init2 ( job->res, win->digits * 4 );
 
-	pattern = g_utf8_next_char ( pattern );
+	return job;
+}
 
-	while ( c )
+/* Below WAIT_DIGITS the job runs here and now; from there on a thread, behind a dialog */
+static void gcmp_win_job_run ( GcmpWin *win, Job *job )
+{
+	if ( job->digits < WAIT_DIGITS )
 	{
-		if ( c == 'e' )
-		{
-			c = g_utf8_get_char ( pattern ); pattern = g_utf8_next_char ( pattern );
+		gcmp_win_job_work ( job );
+		job->done ( win, job );
+		gcmp_win_job_free ( job );
 
-			if ( c == '+' || c == '-' ) { c = g_utf8_get_char ( pattern ); pattern = g_utf8_next_char ( pattern ); }
-		}
+		return;
+	}
 
-		mtf = gcmp_win_parse_get_op ( c );
+	if ( win->job ) { gcmp_win_job_free ( job ); return; }
 
-		if ( mtf != UNF )
-		{
-			space_n = gcmp_win_parse_space ( pattern );
-			if ( space_n ) pattern += space_n;
+	job->wait = TRUE;
+	job->win  = g_object_ref ( win );
 
-			// c = g_utf8_get_char  ( pattern );
-			// if ( c == '-' ) pattern++;
+	const char *name = ( job->eval || !gcmp_win_is_const ( job->mt ) ) ? "Evaluation" : ( job->mt == CPI ) ? "π" : ( job->mt == CEX ) ? "e" : ( job->mt == CL2 ) ? "ln 2" : "γ";
 
-			if ( g_str_has_prefix ( pattern, "sin" ) || g_str_has_prefix ( pattern, "cos" ) || g_str_has_prefix ( pattern, "tan" ) )
-				{ gcmp_win_parse_sct ( pattern, out_str_one_b, win ); pattern += 3; }
+	job->dialog = (GtkDialog *)gtk_dialog_new_with_buttons ( "Gcmp", GTK_WINDOW ( win ), GTK_DIALOG_MODAL, "gtk-cancel", GTK_RESPONSE_CANCEL, NULL );
+	gtk_window_set_default_size ( GTK_WINDOW ( job->dialog ), 300, -1 );
+	g_signal_connect ( job->dialog, "response", G_CALLBACK ( gcmp_win_job_response ), job );
 
-			if ( g_str_has_prefix ( pattern, "ln" ) || g_str_has_prefix ( pattern, "log" ) )
-				{ gcmp_win_parse_log ( pattern, out_str_one_b, win ); pattern += ( g_str_has_prefix ( pattern, "log" ) ) ? 3 : 2; }
+	g_autofree char *text = g_strdup_printf ( "%s: %u digits", name, job->digits );
 
-			if ( strlen ( out_str ) ) sprintf ( base, "%.*s", win->digits + 1, out_str );
+	job->bar = (GtkProgressBar *)gtk_progress_bar_new ();
+	gtk_progress_bar_set_text ( job->bar, text );
+	gtk_progress_bar_set_show_text ( job->bar, TRUE );
+	gtk_widget_set_visible ( GTK_WIDGET ( job->bar ), TRUE );
 
-			if ( strlen ( out_str_one_a ) || strlen ( out_str_one_b ) )
-			{
-				if ( strlen ( out_str_one_a ) && strlen ( out_str_one_b ) )
-					gcmp_mpfr_all ( mtf, out_str_one_a, out_str_one_b, win->digits, 0, win->base, out_str );
-				else if ( strlen ( out_str_one_a ) )
-					gcmp_mpfr_all ( mtf, out_str_one_a, pattern, win->digits, 0, win->base, out_str );
-				else
-					gcmp_mpfr_all ( mtf, ( first ) ? base : str, out_str_one_b, win->digits, 0, win->base, out_str );
-			}
-			else
-				gcmp_mpfr_all ( mtf, ( first ) ? base : str, pattern, win->digits, 0, win->base, out_str );
+	GtkBox *content = (GtkBox *)gtk_dialog_get_content_area ( job->dialog );
+	gtk_container_set_border_width ( GTK_CONTAINER ( content ), 10 );
+	gtk_box_pack_start ( content, GTK_WIDGET ( job->bar ), TRUE, TRUE, 0 );
 
-			if ( win->debug ) g_message ( "%s: set %s ", __func__, out_str );
+	gtk_window_present ( GTK_WINDOW ( job->dialog ) );
 
-			mtf = UNF;
-			first = TRUE;
-			out_str_one_a[0] = '\0';
-			out_str_one_b[0] = '\0';
+	win->job = job;
+	job->timer = g_timeout_add ( 100, (GSourceFunc)gcmp_win_job_tick, job );
 
-			space_n = gcmp_win_parse_space ( pattern );
-			if ( space_n ) pattern += space_n;
+	g_thread_unref ( g_thread_new ( "gcmp-job", (GThreadFunc)gcmp_win_job_thread, job ) );
+}
+
+static void gcmp_win_equal_done ( GcmpWin *win, Job *job )
+{
+	if ( gcmp_win_refused ( win, job ) ) return;
 
-			c = g_utf8_get_char  ( pattern );
-			if ( c == '-' ) pattern++;
-		}
+	// Certified: only the digits the ball proves are shown
+	if ( job->ball )
+	{
+		if ( job->got ) { gcmp_eval_keep ( job->eval, job->res ); gcmp_win_result_digits ( win, job->res, job->got ); } else gcmp_win_message ( win, "No digit certified" );
 
-		c = g_utf8_get_char ( pattern ); pattern = g_utf8_next_char ( pattern );
+		return;
 	}
 
-	if ( strlen ( out_str ) ) g_signal_emit_by_name ( win->entry, "entry-set-text", out_str, FALSE );
+	gcmp_eval_keep ( job->eval, job->res );
+	gcmp_win_result ( win, job->res );
+
+	// The history row keeps the expression, to run it again at another precision
+	g_signal_emit_by_name ( win->entry, "entry-set-expr", job->eval, job->res, job->digits, job->deg_rad );
+	job->eval = NULL;
 }
 
 static void gcmp_win_equal ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
@@ -205,25 +324,63 @@ static void gcmp_win_equal ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
 	g_autofree char *text = NULL;
 	g_signal_emit_by_name ( win->entry, "entry-get-text", &text );
 
-	uint16_t len = ( uint16_t )strlen ( text );
+	if ( win->debug ) g_message ( "%s:: string: %s ", __func__, text );
+
+	GcmpEval *eval = NULL;
+	g_signal_emit_by_name ( win->entry, "entry-get-eval", &eval );
 
-	gcmp_win_parse ( text, len, win );
+	if ( !eval ) return;
+
+	if ( gcmp_eval_is_plain ( eval ) ) { gcmp_eval_free ( eval ); return; }
+
+	Job *job = gcmp_win_job_new ( win, eval, UND, gcmp_win_equal_done );
+	job->ball = win->ball;
+
+	gcmp_win_job_run ( win, job );
+}
+
+static void gcmp_win_ext_done ( GcmpWin *win, Job *job )
+{
+	if ( !gcmp_win_refused ( win, job ) ) gcmp_win_result ( win, job->res );
 }
 
 static void gcmp_win_equal_ext ( enum math_ext mt, GcmpWin *win )
 {
-	char out_str[win->digits+1]; out_str[0] = '\0';
+	Job *job = gcmp_win_job_new ( win, NULL, mt, gcmp_win_ext_done );
 
-	g_autofree char *text = NULL;
-	g_signal_emit_by_name ( win->entry, "entry-get-text", &text );
+	// A constant needs no operand
+	if ( !gcmp_win_is_const ( mt ) )
+	{
+		g_autofree char *text = NULL;
+		g_signal_emit_by_name ( win->entry, "entry-get-text", &text );
+
+		GcmpEval *eval = NULL;
+		g_signal_emit_by_name ( win->entry, "entry-get-eval", &eval );
+
+		// A number shown for a value held in full is that value
+		if ( eval && gcmp_eval_is_plain ( eval ) ) gcmp_eval_run_at ( eval, job->a, win->digits, win->deg_rad, NULL ); else gcmp_mpfr_set_str ( job->a, text, win->base );
+
+		if ( eval ) gcmp_eval_free ( eval );
+	}
 
-	gcmp_mpfr_all_ext ( mt, text, win->digits, 0, win->base, out_str, win->deg_rad );
+	gcmp_win_job_run ( win, job );
+}
+
+static void gcmp_win_buttons_ext_click_handler ( GcmpTool *tool, uint8_t num, const char *label, GcmpWin *win );
 
-	g_signal_emit_by_name ( win->entry, "entry-set-text", out_str, FALSE );
+static void gcmp_win_ext_create ( GcmpWin *win )
+{
+	win->tool_ext = gcmp_tool_ext_new ();
+	gtk_widget_set_visible ( GTK_WIDGET ( win->tool_ext ), FALSE );
+	gtk_box_pack_start ( win->box_tool, GTK_WIDGET ( win->tool_ext ), TRUE, TRUE, 0 );
+	g_signal_connect ( win->tool_ext, "buttons-click-num-label", G_CALLBACK ( gcmp_win_buttons_ext_click_handler ), win );
 }
 
 static void gcmp_win_ext ( GcmpWin *win )
 {
+	// The extended panel is built on first use, not before the first frame
+	if ( !win->tool_ext ) gcmp_win_ext_create ( win );
+
 	gboolean vis = gtk_widget_get_visible ( GTK_WIDGET ( win->tool_ext ) );
 
 	gtk_widget_set_visible ( GTK_WIDGET ( win->tool_ext ), !vis );
@@ -262,8 +419,64 @@ static void gcmp_win_grd ( GcmpWin *win )
 	g_signal_emit_by_name ( win->tool_ext, "toolext-set-label", BDR, new_label );
 }
 
+static void gcmp_win_base ( uint8_t num, GcmpWin *win )
+{
+	enum b_ext_num btb_n[] = { BB2, BB8, B16, B36 };
+	const char *label_n[] = { "bin", "oct", "hex", "b36" };
+	uint8_t base_n[] = { 2, 8, 16, 36 };
+
+	uint8_t j = 0, base = 10;
+	for ( j = 0; j < G_N_ELEMENTS ( btb_n ); j++ ) if ( num == btb_n[j] && win->base != base_n[j] ) base = base_n[j];
+
+	// A plain number is carried over to the new base; an unfinished expression is left as it is
+	GcmpEval *eval = NULL;
+	g_signal_emit_by_name ( win->entry, "entry-get-eval", &eval );
+
+	if ( eval && gcmp_eval_is_plain ( eval ) )
+	{
+		mpfr_t val;
+		mpfr_init2 ( val, win->digits * 4 );
+
+		// A result keeps its full value, not that of the digits shown, and the new text stays bound to it
+		gcmp_eval_run_at ( eval, val, win->digits, win->deg_rad, NULL );
+
+		g_autofree char *out_str = gcmp_mpfr_get_str_base ( val, MIN ( win->digits, ENTRY_DIGITS ), base );
+
+		g_signal_emit_by_name ( win->entry, "entry-clr" );
+		g_signal_emit_by_name ( win->entry, "entry-set-base", base );
+		g_signal_emit_by_name ( win->entry, "entry-set-value", out_str, val, TRUE );
+
+		mpfr_clear ( val );
+	}
+	else
+		g_signal_emit_by_name ( win->entry, "entry-set-base", base );
+
+	if ( eval ) gcmp_eval_free ( eval );
+
+	win->base = base;
+
+	// The active base shows in capitals; a second press goes back to decimal
+	for ( j = 0; j < G_N_ELEMENTS ( btb_n ); j++ )
+	{
+		g_autofree char *label = ( base == base_n[j] ) ? g_ascii_strup ( label_n[j], -1 ) : g_strdup ( label_n[j] );
+
+		g_signal_emit_by_name ( win->tool_ext, "toolext-set-label", btb_n[j], label );
+	}
+}
+
+static GtkPopover * gcmp_win_popover_pref ( GcmpWin *win );
+
 static void gcmp_win_pref ( GcmpWin *win )
 {
+	if ( !win->popover )
+	{
+		GObject *object = NULL;
+		g_signal_emit_by_name ( win->tool_ext, "toolext-get-button", &object );
+
+		win->popover = gcmp_win_popover_pref ( win );
+		gtk_popover_set_relative_to ( win->popover, GTK_WIDGET ( object ) );
+	}
+
 	gtk_popover_popup ( win->popover );
 }
 
@@ -283,6 +496,8 @@ static void gcmp_win_buttons_ext_click_handler ( G_GNUC_UNUSED GcmpTool *tool, u
 
 	if ( num == BPF || num == BPI || num == BDR ) return;
 
+	if ( num == BB2 || num == BB8 || num == B16 || num == B36 ) { gcmp_win_base ( num, win ); return; }
+
 	if ( num == BPN ) g_signal_emit_by_name ( win->entry, "entry-set-text", "^", TRUE );
 	if ( num == BRN ) g_signal_emit_by_name ( win->entry, "entry-set-text", "√", TRUE );
 	if ( num == BMD ) g_signal_emit_by_name ( win->entry, "entry-set-text", "m", TRUE );
@@ -309,6 +524,165 @@ static void gcmp_win_menu_dark ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
 
 }
 
+static void gcmp_win_message ( GcmpWin *win, const char *text )
+{
+	GtkWidget *dialog = gtk_message_dialog_new ( GTK_WINDOW ( win ), GTK_DIALOG_MODAL, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE, "%s", text );
+
+	gtk_dialog_run ( GTK_DIALOG ( dialog ) );
+	gtk_widget_destroy ( dialog );
+}
+
+static char * gcmp_win_file ( GcmpWin *win, GtkFileChooserAction action )
+{
+	gboolean save = ( action == GTK_FILE_CHOOSER_ACTION_SAVE );
+
+	GtkWidget *dialog = gtk_file_chooser_dialog_new ( NULL, GTK_WINDOW ( win ), action,
+		"gtk-cancel", GTK_RESPONSE_CANCEL, ( save ) ? "gtk-save" : "gtk-open", GTK_RESPONSE_ACCEPT, NULL );
+
+	gtk_file_chooser_set_do_overwrite_confirmation ( GTK_FILE_CHOOSER ( dialog ), save );
+
+	char *path = NULL;
+
+	if ( gtk_dialog_run ( GTK_DIALOG ( dialog ) ) == GTK_RESPONSE_ACCEPT ) path = gtk_file_chooser_get_filename ( GTK_FILE_CHOOSER ( dialog ) );
+
+	gtk_widget_destroy ( dialog );
+
+	return path;
+}
+
+static void gcmp_win_menu_load ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
+{
+	gtk_widget_set_visible ( GTK_WIDGET ( win->popover ), FALSE );
+
+	g_autofree char *path = gcmp_win_file ( win, GTK_FILE_CHOOSER_ACTION_OPEN );
+
+	if ( !path ) return;
+
+	GError *error = NULL;
+
+	mpfr_t val;
+	mpfr_init2 ( val, win->digits * 4 );
+
+	if ( gcmp_file_import ( path, val, win->digits, &error ) )
+	{
+		// The operand shows as a result does: short text, full value behind it
+		uint32_t digits = MIN ( win->digits, ENTRY_DIGITS );
+
+		g_autofree char *out_str = gcmp_mpfr_get_str_base ( val, digits, win->base );
+
+		g_autofree char *text = NULL;
+		g_signal_emit_by_name ( win->entry, "entry-get-text", &text );
+
+		// After a number it replaces the entry, after an operator it completes it
+		if ( text[0] && ( g_ascii_isalnum ( text[strlen ( text ) - 1] ) || text[strlen ( text ) - 1] == '.' ) ) g_signal_emit_by_name ( win->entry, "entry-clr" );
+
+		g_signal_emit_by_name ( win->entry, "entry-set-value", out_str, val, TRUE );
+	}
+	else
+	{
+		gcmp_win_message ( win, error->message );
+		g_error_free ( error );
+	}
+
+	mpfr_clear ( val );
+}
+
+static void gcmp_win_save_done ( GcmpWin *win, Job *job )
+{
+	if ( gcmp_win_refused ( win, job ) ) return;
+
+	gcmp_eval_keep ( job->eval, job->res );
+
+	GError *error = NULL;
+
+	if ( !gcmp_file_export ( job->path, job->res, job->digits, &error ) ) { gcmp_win_message ( win, error->message ); g_error_free ( error ); }
+}
+
+static void gcmp_win_menu_save ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
+{
+	gtk_widget_set_visible ( GTK_WIDGET ( win->popover ), FALSE );
+
+	GcmpEval *eval = NULL;
+	g_signal_emit_by_name ( win->entry, "entry-get-eval", &eval );
+
+	if ( !eval ) { gcmp_win_message ( win, "Nothing to save" ); return; }
+
+	char *path = gcmp_win_file ( win, GTK_FILE_CHOOSER_ACTION_SAVE );
+
+	if ( !path ) { gcmp_eval_free ( eval ); return; }
+
+	// A result is saved with its full value, an expression is evaluated first
+	Job *job = gcmp_win_job_new ( win, eval, UND, gcmp_win_save_done );
+	job->path = path;
+
+	gcmp_win_job_run ( win, job );
+}
+
+static void gcmp_win_list_result ( G_GNUC_UNUSED GcmpList *list, mpfr_ptr val, GcmpWin *win )
+{
+	gcmp_win_result ( win, val );
+}
+
+static void gcmp_win_menu_list ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
+{
+	gtk_widget_set_visible ( GTK_WIDGET ( win->popover ), FALSE );
+
+	if ( !win->list )
+	{
+		win->list = gcmp_list_new ( GTK_WINDOW ( win ) );
+		g_signal_connect ( win->list, "list-result", G_CALLBACK ( gcmp_win_list_result ), win );
+	}
+
+	g_signal_emit_by_name ( win->list, "list-show", win->digits, win->base );
+}
+
+static void gcmp_win_menu_plot ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
+{
+	gtk_widget_set_visible ( GTK_WIDGET ( win->popover ), FALSE );
+
+	if ( !win->plot ) win->plot = gcmp_plot_new ( GTK_WINDOW ( win ) );
+
+	g_signal_emit_by_name ( win->plot, "plot-show", win->base, win->deg_rad );
+}
+
+static void gcmp_win_menu_const ( GtkButton *button, GcmpWin *win )
+{
+	gtk_widget_set_visible ( GTK_WIDGET ( win->popover ), FALSE );
+
+	gcmp_win_equal_ext ( (enum math_ext)GPOINTER_TO_INT ( g_object_get_data ( G_OBJECT ( button ), "math-ext" ) ), win );
+}
+
+/* Not a result: ans stays as it is */
+static void gcmp_win_mem_done ( GcmpWin *win, Job *job )
+{
+	if ( !gcmp_win_refused ( win, job ) ) gcmp_vars_add ( "M", job->res, job->sign );
+}
+
+/* M+, M-: the entry's value into the register M, in binary; MR: M at the cursor; MC: M cleared */
+static void gcmp_win_menu_mem ( GtkButton *button, GcmpWin *win )
+{
+	const char *op = g_object_get_data ( G_OBJECT ( button ), "mem-op" );
+
+	if ( g_str_equal ( op, "MC" ) ) { gcmp_vars_unset ( "M" ); return; }
+
+	if ( g_str_equal ( op, "MR" ) )
+	{
+		if ( gcmp_vars_find ( "M", 1 ) ) g_signal_emit_by_name ( win->entry, "entry-set-text", "M", TRUE );
+
+		return;
+	}
+
+	GcmpEval *eval = NULL;
+	g_signal_emit_by_name ( win->entry, "entry-get-eval", &eval );
+
+	if ( !eval ) return;
+
+	Job *job = gcmp_win_job_new ( win, eval, UND, gcmp_win_mem_done );
+	job->sign = ( g_str_equal ( op, "M+" ) ) ? 1 : -1;
+
+	gcmp_win_job_run ( win, job );
+}
+
 static void gcmp_win_menu_quit ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
 {
 	gtk_widget_destroy ( GTK_WIDGET ( win ) );
@@ -317,10 +691,12 @@ static void gcmp_win_menu_quit ( G_GNUC_UNUSED GtkButton *button, GcmpWin *win )
 static void gcmp_win_pref_changed_digits ( GtkSpinButton *button, GcmpWin *win )
 {
 	gtk_spin_button_update ( button );
-	win->digits = (uint16_t)gtk_spin_button_get_value_as_int ( button );
+	win->digits = (uint32_t)gtk_spin_button_get_value_as_int ( button );
+
+	g_signal_emit_by_name ( win->entry, "entry-set-digits", win->digits );
 }
 
-static GtkSpinButton * gcmp_win_pref_create_spinbutton ( uint16_t val, uint16_t min, uint16_t max, uint16_t step, const char *text )
+static GtkSpinButton * gcmp_win_pref_create_spinbutton ( uint32_t val, uint32_t min, uint32_t max, uint32_t step, const char *text )
 {
 	GtkSpinButton *spinbutton = (GtkSpinButton *)gtk_spin_button_new_with_range ( min, max, step );
 	gtk_spin_button_set_value ( spinbutton, val );
@@ -343,6 +719,11 @@ static GtkSpinButton * gcmp_win_pref_create_spin ( GcmpWin *win )
 	return spinbutton;
 }
 
+static void gcmp_win_pref_toggled_ball ( GtkToggleButton *button, GcmpWin *win )
+{
+	win->ball = gtk_toggle_button_get_active ( button );
+}
+
 static GtkButton * gcmp_win_pref_create_button ( const char *icon_name, void ( *f )( GtkButton *, GcmpWin * ), GcmpWin *win )
 {
 	GtkButton *button = (GtkButton *)gtk_button_new_from_icon_name ( icon_name, GTK_ICON_SIZE_MENU );
@@ -366,10 +747,62 @@ static GtkPopover * gcmp_win_popover_pref ( GcmpWin *win )
 
 	gtk_box_pack_start ( vbox, GTK_WIDGET ( gcmp_win_pref_create_spin ( win ) ), FALSE, FALSE, 0 );
 
+	GtkCheckButton *ball = (GtkCheckButton *)gtk_check_button_new_with_label ( "Certified digits" );
+	gtk_toggle_button_set_active ( GTK_TOGGLE_BUTTON ( ball ), win->ball );
+	gtk_widget_set_tooltip_text ( GTK_WIDGET ( ball ), "Ball arithmetic: only the digits proven correct" );
+	g_signal_connect ( ball, "toggled", G_CALLBACK ( gcmp_win_pref_toggled_ball ), win );
+
+	gtk_widget_set_visible ( GTK_WIDGET ( ball ), TRUE );
+	gtk_box_pack_start ( vbox, GTK_WIDGET ( ball ), FALSE, FALSE, 0 );
+
+	// Constants besides π ( on the keypad )
+	GtkBox *cbox = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
+	gtk_box_set_spacing ( cbox, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( cbox ), TRUE );
+
+	const char *c_label[] = { "e", "ln 2", "γ" };
+	enum math_ext c_mt[] = { CEX, CL2, CEU };
+
+	uint8_t j = 0;
+	for ( j = 0; j < G_N_ELEMENTS ( c_mt ); j++ )
+	{
+		GtkButton *button = (GtkButton *)gtk_button_new_with_label ( c_label[j] );
+		g_object_set_data ( G_OBJECT ( button ), "math-ext", GINT_TO_POINTER ( c_mt[j] ) );
+		g_signal_connect ( button, "clicked", G_CALLBACK ( gcmp_win_menu_const ), win );
+
+		gtk_widget_set_visible ( GTK_WIDGET ( button ), TRUE );
+		gtk_box_pack_start ( cbox, GTK_WIDGET ( button ), TRUE, TRUE, 0 );
+	}
+
+	gtk_box_pack_start ( vbox, GTK_WIDGET ( cbox ), FALSE, FALSE, 0 );
+
+	// Memory: the register M, also usable by name in expressions
+	GtkBox *mbox = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
+	gtk_box_set_spacing ( mbox, 5 );
+	gtk_widget_set_visible ( GTK_WIDGET ( mbox ), TRUE );
+
+	const char *m_label[] = { "M+", "M-", "MR", "MC" };
+
+	for ( j = 0; j < G_N_ELEMENTS ( m_label ); j++ )
+	{
+		GtkButton *button = (GtkButton *)gtk_button_new_with_label ( m_label[j] );
+		g_object_set_data ( G_OBJECT ( button ), "mem-op", (gpointer)m_label[j] );
+		g_signal_connect ( button, "clicked", G_CALLBACK ( gcmp_win_menu_mem ), win );
+
+		gtk_widget_set_visible ( GTK_WIDGET ( button ), TRUE );
+		gtk_box_pack_start ( mbox, GTK_WIDGET ( button ), TRUE, TRUE, 0 );
+	}
+
+	gtk_box_pack_start ( vbox, GTK_WIDGET ( mbox ), FALSE, FALSE, 0 );
+
 	GtkBox *hbox = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_HORIZONTAL, 0 );
 	gtk_box_set_spacing ( hbox, 5 );
 	gtk_widget_set_visible ( GTK_WIDGET ( hbox ), TRUE );
 
+	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "document-open", gcmp_win_menu_load, win ) ), TRUE, TRUE, 0 );
+	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "document-save", gcmp_win_menu_save, win ) ), TRUE, TRUE, 0 );
+	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "view-list", gcmp_win_menu_list, win ) ), TRUE, TRUE, 0 );
+	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "applications-graphics", gcmp_win_menu_plot, win ) ), TRUE, TRUE, 0 );
 	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "weather-clear-night", gcmp_win_menu_dark,  win ) ), TRUE, TRUE, 0 );
 	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "gtk-info", gcmp_win_menu_about, win ) ), TRUE, TRUE, 0 );
 	gtk_box_pack_start ( hbox, GTK_WIDGET ( gcmp_win_pref_create_button ( "gtk-quit", gcmp_win_menu_quit,  win ) ), TRUE, TRUE, 0 );
@@ -381,7 +814,7 @@ static GtkPopover * gcmp_win_popover_pref ( GcmpWin *win )
 	return popover;
 }
 
-static void gcmp_win_create ( GcmpWin *win )
+static void gcmp_win_create ( GcmpWin *win, GcmpApp *app )
 {
 	setlocale ( LC_NUMERIC, "C" );
 
@@ -393,8 +826,6 @@ static void gcmp_win_create ( GcmpWin *win )
 	GtkAccelGroup *accel_group = gtk_accel_group_new ();
 	gtk_window_add_accel_group ( window, accel_group );
 
-	win->popover = gcmp_win_popover_pref ( win );
-
 	GtkBox *m_box = (GtkBox *)gtk_box_new ( GTK_ORIENTATION_VERTICAL, 0 );
 	gtk_box_set_spacing ( m_box, 5 );
 	gtk_widget_set_visible ( GTK_WIDGET ( m_box ), TRUE );
@@ -403,7 +834,7 @@ static void gcmp_win_create ( GcmpWin *win )
 	gtk_box_set_spacing ( h_box, 5 );
 	gtk_widget_set_visible ( GTK_WIDGET ( h_box ), TRUE );
 
-	win->entry = gcmp_entry_new ();
+	win->entry = gcmp_entry_new ( gcmp_app_get_history ( app ), gcmp_app_get_sheet ( app ) );
 	gtk_box_pack_start ( h_box, GTK_WIDGET ( win->entry ), TRUE, TRUE, 0 );
 	gtk_box_pack_start ( m_box, GTK_WIDGET ( h_box ), TRUE, TRUE, 0 );
 
@@ -415,9 +846,7 @@ static void gcmp_win_create ( GcmpWin *win )
 	gtk_box_pack_start ( h_box, GTK_WIDGET ( win->tool ), TRUE, TRUE, 0 );
 	g_signal_connect ( win->tool, "buttons-click-num-label", G_CALLBACK ( gcmp_win_buttons_click_handler ), win );
 
-	win->tool_ext = gcmp_tool_ext_new ();
-	gtk_box_pack_start ( h_box, GTK_WIDGET ( win->tool_ext ), TRUE, TRUE, 0 );
-	g_signal_connect ( win->tool_ext, "buttons-click-num-label", G_CALLBACK ( gcmp_win_buttons_ext_click_handler ), win );
+	win->box_tool = h_box;
 
 	gtk_box_pack_start ( m_box, GTK_WIDGET ( h_box ), TRUE, TRUE, 0 );
 
@@ -439,13 +868,6 @@ static void gcmp_win_create ( GcmpWin *win )
 	gtk_container_add ( GTK_CONTAINER ( window ), GTK_WIDGET ( m_box ) );
 
 	gtk_window_present ( window );
-
-	GObject *object = NULL;
-	g_signal_emit_by_name ( win->tool_ext, "toolext-get-button", &object );
-
-	gtk_popover_set_relative_to ( win->popover, GTK_WIDGET ( object ) );
-
-	gcmp_win_ext ( win );
 }
 
 static void gcmp_win_init ( GcmpWin *win )
@@ -455,8 +877,6 @@ static void gcmp_win_init ( GcmpWin *win )
 	win->deg_rad = 1;
 
 	win->debug = ( g_getenv ( "GCMP_DEBUG" ) ) ? TRUE : FALSE;
-
-	gcmp_win_create ( win );
 }
 
 static void gcmp_win_finalize ( GObject *object )
@@ -473,5 +893,10 @@ static void gcmp_win_class_init ( GcmpWinClass *class )
 
 GcmpWin * gcmp_win_new ( GcmpApp *app )
 {
-	return g_object_new ( GCMP_TYPE_WIN, "application", app, NULL );
+	GcmpWin *win = g_object_new ( GCMP_TYPE_WIN, "application", app, NULL );
+
+	// The engine is the application's: the widgets come once it is known
+	gcmp_win_create ( win, app );
+
+	return win;
 }
@@ -8,14 +8,17 @@
 */
 
 #include "gcmp-app.h"
+#include "gcmp-mpfr.h"
 
-int main ( void )
+int main ( int argc, char *argv[] )
 {
 	GcmpApp *app = gcmp_app_new ();
 
-	int status = g_application_run ( G_APPLICATION ( app ), 0, NULL );
+	int status = g_application_run ( G_APPLICATION ( app ), argc, argv );
 
 	g_object_unref ( app );
 
+	mpfr_free_cache ();
+
 	return status;
 }
@@ -0,0 +1,156 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+/*
+* gcmp-ntt against GMP and MPFR: the same products, quotients and roots, the same ternaries.
+* Built with NTT_MIN_CORES 1, so the transforms run on any machine.
+*/
+
+#include "gcmp-ntt.h"
+
+#include <glib.h>
+
+/* Limbs of the operands: above NTT_MIN_LIMBS */
+#define N_LIMBS 20000
+
+static gmp_randstate_t state;
+
+static const mpfr_rnd_t rnd_n[] = { MPFR_RNDN, MPFR_RNDZ, MPFR_RNDU, MPFR_RNDD };
+
+static int gcmp_ntt_test_sgn ( int ret )
+{
+	return ( ret > 0 ) - ( ret < 0 );
+}
+
+static void gcmp_ntt_test_mul_z ( void )
+{
+	mpz_t a, b, r, s;
+	mpz_inits ( a, b, r, s, NULL );
+
+	uint8_t j = 0;
+	for ( j = 0; j < 4; j++ )
+	{
+		mpz_urandomb ( a, state, N_LIMBS * GMP_NUMB_BITS + j * 1000 );
+		mpz_rrandomb ( b, state, N_LIMBS * GMP_NUMB_BITS - j * 1000 );
+
+		if ( j & 1 ) mpz_neg ( a, a );
+
+		mpz_mul ( s, a, b );
+		gcmp_ntt_mul_z ( r, a, b );
+		g_assert_true ( mpz_cmp ( r, s ) == 0 );
+
+		// Squares take one transform
+		mpz_mul ( s, a, a );
+		gcmp_ntt_mul_z ( r, a, a );
+		g_assert_true ( mpz_cmp ( r, s ) == 0 );
+	}
+
+	mpz_clears ( a, b, r, s, NULL );
+}
+
+static void gcmp_ntt_test_mul ( void )
+{
+	mpfr_prec_t prec = N_LIMBS * GMP_NUMB_BITS;
+
+	mpfr_t a, b, r, s;
+	mpfr_inits2 ( prec, a, b, r, s, NULL );
+
+	mpfr_urandomb ( a, state );
+	mpfr_urandomb ( b, state );
+
+	uint8_t j = 0;
+	for ( j = 0; j < G_N_ELEMENTS ( rnd_n ); j++ )
+	{
+		int ret_s = mpfr_mul ( s, a, b, rnd_n[j] );
+		int ret_r = gcmp_ntt_mul ( r, a, b, rnd_n[j] );
+
+		g_assert_true ( mpfr_equal_p ( r, s ) );
+		g_assert_cmpint ( gcmp_ntt_test_sgn ( ret_r ), ==, gcmp_ntt_test_sgn ( ret_s ) );
+	}
+
+	mpfr_clears ( a, b, r, s, NULL );
+}
+
+/* Random and exact: a / b with a = q b, sqrt ( k² ), 1 / sqrt ( 4^k ) */
+static void gcmp_ntt_test_div_sqrt ( void )
+{
+	mpfr_prec_t prec = N_LIMBS * GMP_NUMB_BITS;
+
+	mpfr_t a, b, r, s;
+	mpfr_inits2 ( prec, a, b, r, s, NULL );
+
+	uint8_t e = 0, j = 0;
+	for ( e = 0; e < 2; e++ )
+	{
+		mpfr_urandomb ( b, state );
+		mpfr_urandomb ( a, state );
+
+		if ( e )
+		{
+			// Half the bits each: the products are exact
+			mpfr_prec_round ( a, prec / 2 - 64, MPFR_RNDN );
+			mpfr_prec_round ( b, prec / 2 - 64, MPFR_RNDN );
+			mpfr_prec_round ( a, prec, MPFR_RNDN );
+			mpfr_prec_round ( b, prec, MPFR_RNDN );
+
+			mpfr_mul ( a, a, b, MPFR_RNDN );
+		}
+
+		for ( j = 0; j < G_N_ELEMENTS ( rnd_n ); j++ )
+		{
+			int ret_s = mpfr_div ( s, a, b, rnd_n[j] );
+			int ret_r = gcmp_ntt_div ( r, a, b, rnd_n[j] );
+
+			g_assert_true ( mpfr_equal_p ( r, s ) );
+			g_assert_cmpint ( gcmp_ntt_test_sgn ( ret_r ), ==, gcmp_ntt_test_sgn ( ret_s ) );
+		}
+
+		if ( e ) mpfr_mul ( a, b, b, MPFR_RNDN );
+
+		for ( j = 0; j < G_N_ELEMENTS ( rnd_n ); j++ )
+		{
+			int ret_s = mpfr_sqrt ( s, a, rnd_n[j] );
+			int ret_r = gcmp_ntt_sqrt ( r, a, rnd_n[j] );
+
+			g_assert_true ( mpfr_equal_p ( r, s ) );
+			g_assert_cmpint ( gcmp_ntt_test_sgn ( ret_r ), ==, gcmp_ntt_test_sgn ( ret_s ) );
+		}
+
+		if ( e ) mpfr_set_ui_2exp ( a, 1, 2 * 1001, MPFR_RNDN );
+
+		for ( j = 0; j < G_N_ELEMENTS ( rnd_n ); j++ )
+		{
+			int ret_s = mpfr_rec_sqrt ( s, a, rnd_n[j] );
+			int ret_r = gcmp_ntt_rec_sqrt ( r, a, rnd_n[j] );
+
+			g_assert_true ( mpfr_equal_p ( r, s ) );
+			g_assert_cmpint ( gcmp_ntt_test_sgn ( ret_r ), ==, gcmp_ntt_test_sgn ( ret_s ) );
+		}
+	}
+
+	mpfr_clears ( a, b, r, s, NULL );
+}
+
+int main ( int argc, char *argv[] )
+{
+	g_test_init ( &argc, &argv, NULL );
+
+	gmp_randinit_default ( state );
+	gmp_randseed_ui ( state, g_test_rand_int () );
+
+	g_test_add_func ( "/ntt/mul-z", gcmp_ntt_test_mul_z );
+	g_test_add_func ( "/ntt/mul", gcmp_ntt_test_mul );
+	g_test_add_func ( "/ntt/div-sqrt", gcmp_ntt_test_div_sqrt );
+
+	int ret = g_test_run ();
+
+	gmp_randclear ( state );
+
+	return ret;
+}
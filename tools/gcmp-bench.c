@@ -0,0 +1,194 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+/*
+* Load generator for gcmp --service
+* Usage: gcmp-bench [ -n requests ] [ -c connections ] [ -p depth ] [ -d N ] [ EXPR ]
+*/
+
+#include "gcmp-proto.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+static int requests = 10000;
+static int connections = 1;
+static int depth = 32;
+static int digits = 24;
+
+static const char *expr = "sin 30 * ln 2 + 2^0.5";
+
+static GOptionEntry entries[] =
+{
+	{ "requests",    'n', 0, G_OPTION_ARG_INT, &requests,    "Requests per connection", "N" },
+	{ "connections", 'c', 0, G_OPTION_ARG_INT, &connections, "Parallel connections", "N" },
+	{ "depth",       'p', 0, G_OPTION_ARG_INT, &depth,       "Pipeline depth", "N" },
+	{ "digits",      'd', 0, G_OPTION_ARG_INT, &digits,      "Precision ( maximum characters )", "N" },
+	{ NULL }
+};
+
+typedef struct _Bench Bench;
+
+struct _Bench
+{
+	int fd;
+
+	gint64 *lat;
+	gint64 server;
+	uint32_t errors;
+};
+
+static gboolean gcmp_bench_io ( int fd, void *data, size_t len, gboolean write_data )
+{
+	char *p = data;
+
+	while ( len )
+	{
+		ssize_t n = ( write_data ) ? write ( fd, p, len ) : read ( fd, p, len );
+
+		if ( n <= 0 ) return FALSE;
+
+		p += n; len -= (size_t)n;
+	}
+
+	return TRUE;
+}
+
+static gpointer gcmp_bench_thread ( Bench *bench )
+{
+	size_t len = strlen ( expr );
+	GcmpProtoRequest req = { (uint32_t)len, (uint16_t)digits, 10, 1 };
+
+	// One frame, sent as is for every request
+	g_autofree char *frame = g_malloc ( sizeof ( req ) + len );
+	memcpy ( frame, &req, sizeof ( req ) );
+	memcpy ( frame + sizeof ( req ), expr, len );
+
+	gint64 *sent = g_new ( gint64, requests );
+	char *res = g_malloc ( 64 * 1024 );
+
+	int n_sent = 0, n_recv = 0;
+
+	while ( n_recv < requests )
+	{
+		while ( n_sent < requests && n_sent - n_recv < depth )
+		{
+			sent[n_sent++] = g_get_monotonic_time ();
+
+			if ( !gcmp_bench_io ( bench->fd, frame, sizeof ( req ) + len, TRUE ) ) goto out;
+		}
+
+		GcmpProtoReply reply;
+
+		if ( !gcmp_bench_io ( bench->fd, &reply, sizeof ( reply ), FALSE ) ) goto out;
+		if ( reply.size > 64 * 1024 || !gcmp_bench_io ( bench->fd, res, reply.size, FALSE ) ) goto out;
+
+		bench->lat[n_recv] = g_get_monotonic_time () - sent[n_recv];
+		bench->server += reply.usec;
+
+		if ( reply.status != GCMP_PROTO_OK ) bench->errors++;
+
+		n_recv++;
+	}
+
+out:
+	bench->errors += (uint32_t)( requests - n_recv );
+
+	g_free ( sent );
+	g_free ( res );
+
+	return NULL;
+}
+
+static int gcmp_bench_connect ( void )
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	g_autofree char *path = g_build_filename ( g_get_user_runtime_dir (), GCMP_PROTO_SOCKET, NULL );
+	g_strlcpy ( addr.sun_path, path, sizeof ( addr.sun_path ) );
+
+	int fd = socket ( AF_UNIX, SOCK_STREAM, 0 );
+
+	if ( fd < 0 || connect ( fd, (struct sockaddr *)&addr, sizeof ( addr ) ) < 0 ) { perror ( path ); if ( fd >= 0 ) close ( fd ); return -1; }
+
+	return fd;
+}
+
+static int gcmp_bench_cmp ( const void *a, const void *b )
+{
+	gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+
+	return ( x > y ) - ( x < y );
+}
+
+int main ( int argc, char *argv[] )
+{
+	GError *error = NULL;
+	GOptionContext *context = g_option_context_new ( "[EXPR]" );
+	g_option_context_add_main_entries ( context, entries, NULL );
+
+	if ( !g_option_context_parse ( context, &argc, &argv, &error ) ) { g_printerr ( "%s\n", error->message ); return 1; }
+
+	g_option_context_free ( context );
+
+	if ( argc > 1 ) expr = argv[1];
+
+	if ( requests < 1 || connections < 1 || depth < 1 ) { g_printerr ( "gcmp-bench: invalid arguments\n" ); return 1; }
+
+	int j = 0;
+	Bench *bench = g_new0 ( Bench, connections );
+	GThread **thread = g_new0 ( GThread *, connections );
+
+	for ( j = 0; j < connections; j++ )
+	{
+		bench[j].fd  = gcmp_bench_connect ();
+		bench[j].lat = g_new0 ( gint64, requests );
+
+		if ( bench[j].fd < 0 ) return 1;
+	}
+
+	gint64 time = g_get_monotonic_time ();
+
+	for ( j = 0; j < connections; j++ ) thread[j] = g_thread_new ( "bench", (GThreadFunc)gcmp_bench_thread, &bench[j] );
+	for ( j = 0; j < connections; j++ ) g_thread_join ( thread[j] );
+
+	double secs = (double)( g_get_monotonic_time () - time ) / G_USEC_PER_SEC;
+
+	size_t total = (size_t)requests * (size_t)connections;
+	gint64 *lat = g_new ( gint64, total ), server = 0;
+	uint32_t errors = 0;
+
+	for ( j = 0; j < connections; j++ )
+	{
+		memcpy ( lat + (size_t)j * (size_t)requests, bench[j].lat, sizeof ( gint64 ) * (size_t)requests );
+
+		server += bench[j].server;
+		errors += bench[j].errors;
+
+		close ( bench[j].fd );
+		g_free ( bench[j].lat );
+	}
+
+	qsort ( lat, total, sizeof ( gint64 ), gcmp_bench_cmp );
+
+	g_print ( "expression:  %s ( %d digits )\n", expr, digits );
+	g_print ( "requests:    %zu over %d connection(s), depth %d, errors %u\n", total, connections, depth, errors );
+	g_print ( "throughput:  %.0f req/s\n", (double)total / secs );
+	g_print ( "latency:     p50 %.1f us, p99 %.1f us, max %.1f us\n", (double)lat[total / 2], (double)lat[total * 99 / 100], (double)lat[total - 1] );
+	g_print ( "server eval: %.1f us mean\n", (double)server / (double)total );
+
+	g_free ( lat );
+	g_free ( bench );
+	g_free ( thread );
+
+	return 0;
+}
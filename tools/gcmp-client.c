@@ -0,0 +1,140 @@
+/*
+* Copyright 2020 Stepan Perun
+* This program is free software.
+*
+* License: Gnu General Public License GPL-3
+* file:///usr/share/common-licenses/GPL-3
+* http://www.gnu.org/licenses/gpl-3.0.html
+*/
+
+/*
+* Client for gcmp --service
+* Usage: gcmp-client [ -d N ] [ -b BASE ] [ -r ] [ -t ] [ EXPR ... ]   ( expressions from stdin when none given )
+*/
+
+#include "gcmp-proto.h"
+
+#include <glib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+/* Requests in flight before waiting for a reply */
+#define WINDOW 64
+
+static int digits = 24;
+static int base = 10;
+static gboolean radians = FALSE;
+static gboolean timing  = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "digits",  'd', 0, G_OPTION_ARG_INT,  &digits,  "Precision ( maximum characters )", "N" },
+	{ "base",    'b', 0, G_OPTION_ARG_INT,  &base,    "Base of the expressions and results ( 2 - 36 )", "BASE" },
+	{ "radians", 'r', 0, G_OPTION_ARG_NONE, &radians, "Angles in radians", NULL },
+	{ "time",    't', 0, G_OPTION_ARG_NONE, &timing,  "Print the evaluation time", NULL },
+	{ NULL }
+};
+
+static int gcmp_client_connect ( void )
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	g_autofree char *path = g_build_filename ( g_get_user_runtime_dir (), GCMP_PROTO_SOCKET, NULL );
+	g_strlcpy ( addr.sun_path, path, sizeof ( addr.sun_path ) );
+
+	int fd = socket ( AF_UNIX, SOCK_STREAM, 0 );
+
+	if ( fd < 0 || connect ( fd, (struct sockaddr *)&addr, sizeof ( addr ) ) < 0 ) { perror ( path ); if ( fd >= 0 ) close ( fd ); return -1; }
+
+	return fd;
+}
+
+static gboolean gcmp_client_io ( int fd, void *data, size_t len, gboolean write_data )
+{
+	char *p = data;
+
+	while ( len )
+	{
+		ssize_t n = ( write_data ) ? write ( fd, p, len ) : read ( fd, p, len );
+
+		if ( n <= 0 ) return FALSE;
+
+		p += n; len -= (size_t)n;
+	}
+
+	return TRUE;
+}
+
+static gboolean gcmp_client_send ( int fd, const char *expr )
+{
+	GcmpProtoRequest req = { (uint32_t)strlen ( expr ), (uint16_t)digits, (uint8_t)base, ( radians ) ? 0 : 1 };
+
+	return gcmp_client_io ( fd, &req, sizeof ( req ), TRUE ) && gcmp_client_io ( fd, (void *)expr, req.size, TRUE );
+}
+
+static gboolean gcmp_client_recv ( int fd )
+{
+	GcmpProtoReply reply;
+
+	if ( !gcmp_client_io ( fd, &reply, sizeof ( reply ), FALSE ) ) return FALSE;
+
+	g_autofree char *res = g_malloc ( (gsize)reply.size + 1 );
+
+	if ( !gcmp_client_io ( fd, res, reply.size, FALSE ) ) return FALSE;
+
+	res[reply.size] = '\0';
+
+	if ( reply.status != GCMP_PROTO_OK ) g_print ( "error" ); else g_print ( "%s", res );
+	if ( timing ) g_print ( "\t%u us", reply.usec );
+
+	g_print ( "\n" );
+
+	return TRUE;
+}
+
+int main ( int argc, char *argv[] )
+{
+	GError *error = NULL;
+	GOptionContext *context = g_option_context_new ( "[EXPR...]" );
+	g_option_context_add_main_entries ( context, entries, NULL );
+
+	if ( !g_option_context_parse ( context, &argc, &argv, &error ) ) { g_printerr ( "%s\n", error->message ); return 1; }
+
+	g_option_context_free ( context );
+
+	if ( digits < 1 || digits > UINT16_MAX ) { g_printerr ( "Digits out of range ( 1 - %u ): %d\n", UINT16_MAX, digits ); return 1; }
+	if ( base < 2 || base > 36 ) { g_printerr ( "Base out of range ( 2 - 36 ): %d\n", base ); return 1; }
+
+	int fd = gcmp_client_connect ();
+
+	if ( fd < 0 ) return 1;
+
+	int j = 0;
+	uint32_t sent = 0, recv = 0;
+
+	char line[4096];
+	gboolean ok = TRUE;
+
+	while ( ok )
+	{
+		const char *expr = NULL;
+
+		if ( argc > 1 ) expr = ( j + 1 < argc ) ? argv[++j] : NULL;
+		else if ( fgets ( line, sizeof ( line ), stdin ) ) { line[strcspn ( line, "\n" )] = '\0'; expr = line; }
+
+		if ( !expr ) break;
+
+		ok = gcmp_client_send ( fd, expr );
+		sent++;
+
+		if ( ok && sent - recv >= WINDOW ) { ok = gcmp_client_recv ( fd ); recv++; }
+	}
+
+	while ( ok && recv < sent ) { ok = gcmp_client_recv ( fd ); recv++; }
+
+	close ( fd );
+
+	return ( ok ) ? 0 : 1;
+}